@@ -108,6 +108,54 @@ BOOL DG_CLIENT_API_send_diag_req(int socket, DG_CLIENT_API_REQ_T* diag_req);
 DG_CLIENT_API_RSP_T* DG_CLIENT_API_recv_diag_rsp(int socket, DG_CLIENT_API_REQ_T* diag_req,
                                                  BOOL is_unsol, UINT32 timeout_in_ms);
 
+/*=============================================================================================*//**
+@brief Sends a DIAG request and receives its response, resending it while the engine is busy
+
+@param [in] socket        - Server connection socket
+@param [in] diag_req      - diag request
+@param [in] timeout_in_ms - Time to wait for the DIAG response (in msec) including the retries,
+                            0 means wait forever
+
+@return Pointer to DIAG response, NULL on a send or receive error
+
+@note
+  - A busy response carries the retry delay of the engine, the request is sent again after the
+    longer of that delay and an exponential backoff with jitter
+  - The last busy response is returned if the timeout ends before the engine accepts the request
+  - The calling function is responsible for freeing the memory pointed to by the returned pointer
+    by using DG_CLIENT_API_diag_rsp_free()
+*//*==============================================================================================*/
+DG_CLIENT_API_RSP_T* DG_CLIENT_API_send_recv_diag(int socket, DG_CLIENT_API_REQ_T* diag_req,
+                                                  UINT32 timeout_in_ms);
+
+/*=============================================================================================*//**
+@brief Gets the time to wait before resending a request if the engine answered busy
+
+@param [in]     diag_rsp   - The response to the request
+@param [in,out] backoff_ms - Backoff of the request, 0 before the first retry, doubled by each call
+@param [in,out] seed       - rand_r() seed of the caller, for the jitter
+
+@return the delay in msec, the longer of the delay asked by the engine and the backoff with jitter,
+        0 if the response is not busy
+*//*==============================================================================================*/
+UINT32 DG_CLIENT_API_busy_delay(const DG_CLIENT_API_RSP_T* diag_rsp, UINT32* backoff_ms,
+                                unsigned int* seed);
+
+/*=============================================================================================*//**
+@brief Receives the next DIAG response from the specified socket, whichever request it belongs to
+
+@param [in] socket        - Server connection socket
+@param [in] timeout_in_ms - Time to wait for a DIAG response (in msec), 0 means wait forever
+
+@return Pointer to DIAG response, NULL on timeout or a connection error
+
+@note
+  - Used to pipeline requests, the caller matches the response by opcode and timestamp
+  - The calling function is responsible for freeing the memory pointed to by the returned pointer
+    by using DG_CLIENT_API_diag_rsp_free()
+*//*==============================================================================================*/
+DG_CLIENT_API_RSP_T* DG_CLIENT_API_recv_any_diag_rsp(int socket, UINT32 timeout_in_ms);
+
 /*=============================================================================================*//**
 @brief Frees a given DIAG response
 
@@ -0,0 +1,75 @@
+#ifndef _DG_SHM_H
+#define _DG_SHM_H
+/*==================================================================================================
+
+    Module Name:  dg_shm.h
+
+    General Description: Shared memory transport between the DIAG engine and local clients
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include "dg_platform_defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*==================================================================================================
+                                             CONSTANTS
+==================================================================================================*/
+/*
+ * A client connected to the internal socket may move its DIAG traffic onto a pair of byte rings
+ * in a sealed memfd:
+ *
+ *   1. the client creates the channel with DG_SHM_create() and sends a DG_SHM_OPCODE request
+ *      with no data over the socket, the memfd and the two eventfds ride along as SCM_RIGHTS
+ *   2. the engine maps the memfd with DG_SHM_open() and answers the request over the socket
+ *   3. on success both sides DG_SHM_attach() the channel to their socket, from then on the
+ *      requests and the responses are carried by the rings with the same framing as on the
+ *      socket, the socket itself only tells when the other side is gone
+ *
+ * Each side sleeps on its own eventfd and is only signalled while it is sleeping, so a busy
+ * connection makes no system calls at all.
+ */
+#define DG_SHM_OPCODE            0x0FFB       /**< Transport negotiation, never reaches a handler */
+#define DG_SHM_FD_NUM            3            /**< memfd, client eventfd, engine eventfd */
+#define DG_SHM_RING_SIZE_DEFAULT (1024 * 1024)
+#define DG_SHM_RING_SIZE_MIN     4096
+#define DG_SHM_RING_SIZE_MAX     (64 * 1024 * 1024)
+
+/*==================================================================================================
+                                               MACROS
+==================================================================================================*/
+
+/*==================================================================================================
+                                TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+typedef struct DG_SHM_CHANNEL_S DG_SHM_CHANNEL_T;
+
+/*==================================================================================================
+                                        FUNCTION PROTOTYPES
+==================================================================================================*/
+DG_SHM_CHANNEL_T* DG_SHM_create(int socket, UINT32 ring_size, int* fds);
+DG_SHM_CHANNEL_T* DG_SHM_open(int socket, int* fds);
+void              DG_SHM_close(DG_SHM_CHANNEL_T* shm);
+void              DG_SHM_attach(DG_SHM_CHANNEL_T* shm);
+void              DG_SHM_detach(int socket);
+DG_SHM_CHANNEL_T* DG_SHM_get(int socket);
+void              DG_SHM_put(DG_SHM_CHANNEL_T* shm);
+BOOL              DG_SHM_wait(DG_SHM_CHANNEL_T* shm, UINT32 timeout_in_ms);
+BOOL              DG_SHM_read(DG_SHM_CHANNEL_T* shm, void* buff, UINT32 len);
+BOOL              DG_SHM_write(DG_SHM_CHANNEL_T* shm, const void* buff, UINT32 len);
+BOOL              DG_SHM_send_fds(int socket, const void* buff, UINT32 len, const int* fds);
+int               DG_SHM_recv_fds(int socket, void* buff, UINT32 len, int* fds);
+
+/*==================================================================================================
+                                          GLOBAL VARIABLES
+==================================================================================================*/
+
+#ifdef __cplusplus
+}
+#endif
+#endif
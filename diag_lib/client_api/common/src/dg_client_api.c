@@ -12,15 +12,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
 #include "dg_defs.h"
+#include "dg_rsp_code.h"
 #include "dg_pal_client_api.h"
 #include "dg_pal_client_platform_inc.h"
 #include "dg_client_api.h"
+#include "dg_shm.h"
 
 
 /*==================================================================================================
                                           LOCAL CONSTANTS
 ==================================================================================================*/
+#define DG_CLIENT_API_SHM_ENV     "DIAG_SHM" /**< 1 moves local sessions to shared memory */
+#define DG_CLIENT_API_SHM_TIMEOUT 5000       /**< Max wait time in ms for the engine to attach */
+#define DG_CLIENT_API_BUSY_MIN    10         /**< First backoff in ms after a busy response */
+#define DG_CLIENT_API_BUSY_MAX    1000       /**< Longest backoff in ms after a busy response */
 
 /*==================================================================================================
                                             LOCAL MACROS
@@ -37,6 +46,10 @@ static UINT8* dg_client_api_recv_diag_rsp(int socket, UINT32 timeout_in_ms);
 
 static void dg_client_api_parse_diag_rsp(UINT8* raw_rsp_ptr, DG_CLIENT_API_RSP_T* diag_rsp);
 
+static void dg_client_api_shm_attach(int socket);
+
+static UINT32 dg_client_api_get_msec(void);
+
 /*==================================================================================================
                                           GLOBAL VARIABLES
 ==================================================================================================*/
@@ -76,14 +89,23 @@ BOOL DG_CLIENT_API_launch_server(void)
 @param [in] serv_addr - the diag server address, if NULL, internal socket would be used
 
 @return socket for server connection, -1 if failed
+
+@note
+  - With DIAG_SHM=1 in the environment an internal session moves its traffic onto shared memory,
+    it silently stays on the socket if the server can't attach
 *//*==============================================================================================*/
 int DG_CLIENT_API_connect_to_server(const char* serv_addr)
 {
-    int socket_fd = -1;
+    int         socket_fd = -1;
+    const char* shm_env   = getenv(DG_CLIENT_API_SHM_ENV);
 
     if (serv_addr == NULL)
     {
         socket_fd = DG_PAL_CLIENT_API_create_int_diag_socket();
+        if ((socket_fd >= 0) && (shm_env != NULL) && (strcmp(shm_env, "1") == 0))
+        {
+            dg_client_api_shm_attach(socket_fd);
+        }
     }
     else
     {
@@ -254,6 +276,144 @@ DG_CLIENT_API_RSP_T* DG_CLIENT_API_recv_diag_rsp(int socket, DG_CLIENT_API_REQ_T
     return diag_rsp;
 }
 
+/*=============================================================================================*//**
+@brief Sends a DIAG request and receives its response, resending it while the engine is busy
+
+@param [in] socket        - Server connection socket
+@param [in] diag_req      - diag request
+@param [in] timeout_in_ms - Time to wait for the DIAG response (in msec) including the retries,
+                            0 means wait forever
+
+@return Pointer to DIAG response, NULL on a send or receive error
+
+@note
+  - A busy response carries the retry delay of the engine, the request is sent again after the
+    longer of that delay and an exponential backoff with jitter
+  - The last busy response is returned if the timeout ends before the engine accepts the request
+  - The calling function is responsible for freeing the memory pointed to by the returned pointer
+    by using DG_CLIENT_API_diag_rsp_free()
+*//*==============================================================================================*/
+DG_CLIENT_API_RSP_T* DG_CLIENT_API_send_recv_diag(int socket, DG_CLIENT_API_REQ_T* diag_req,
+                                                  UINT32 timeout_in_ms)
+{
+    DG_CLIENT_API_RSP_T* diag_rsp   = NULL;
+    UINT32               start_ms   = dg_client_api_get_msec();
+    UINT32               backoff_ms = 0;
+    UINT32               wait_ms    = timeout_in_ms;
+    unsigned int         seed       = start_ms ^ ((unsigned int)getpid() << 16) ^ socket;
+    UINT32               elapsed_ms;
+    UINT32               delay_ms;
+
+    while (DG_CLIENT_API_send_diag_req(socket, diag_req))
+    {
+        diag_rsp = DG_CLIENT_API_recv_diag_rsp(socket, diag_req, FALSE, wait_ms);
+        if ((diag_rsp == NULL) ||
+            ((delay_ms = DG_CLIENT_API_busy_delay(diag_rsp, &backoff_ms, &seed)) == 0))
+        {
+            break;
+        }
+
+        elapsed_ms = dg_client_api_get_msec() - start_ms;
+        if ((timeout_in_ms != 0) && (elapsed_ms + delay_ms >= timeout_in_ms))
+        {
+            DG_CLIENT_API_ERROR("DIAG opcode 0x%04x still busy after %d ms",
+                                diag_req->opcode, elapsed_ms);
+            break;
+        }
+
+        DG_CLIENT_API_TRACE("DIAG opcode 0x%04x busy, retry in %d ms", diag_req->opcode, delay_ms);
+        DG_CLIENT_API_diag_rsp_free(diag_rsp);
+        diag_rsp = NULL;
+        usleep(delay_ms * 1000);
+
+        if (timeout_in_ms != 0)
+        {
+            /* The retries share the time of the whole call */
+            elapsed_ms = dg_client_api_get_msec() - start_ms;
+            wait_ms    = (elapsed_ms < timeout_in_ms) ? (timeout_in_ms - elapsed_ms) : 1;
+        }
+    }
+
+    return diag_rsp;
+}
+
+/*=============================================================================================*//**
+@brief Gets the time to wait before resending a request if the engine answered busy
+
+@param [in]     diag_rsp   - The response to the request
+@param [in,out] backoff_ms - Backoff of the request, 0 before the first retry, doubled by each call
+@param [in,out] seed       - rand_r() seed of the caller, for the jitter
+
+@return the delay in msec, the longer of the delay asked by the engine and the backoff with jitter,
+        0 if the response is not busy
+*//*==============================================================================================*/
+UINT32 DG_CLIENT_API_busy_delay(const DG_CLIENT_API_RSP_T* diag_rsp, UINT32* backoff_ms,
+                                unsigned int* seed)
+{
+    UINT32 delay_ms;
+    UINT32 retry_ms;
+
+    if (diag_rsp->rsp_code != DG_RSP_CODE_CMD_RSP_BUSY)
+    {
+        return 0;
+    }
+
+    if (*backoff_ms == 0)
+    {
+        *backoff_ms = DG_CLIENT_API_BUSY_MIN;
+    }
+
+    /* The engine shed the request, wait at least as long as it asked before sending again */
+    delay_ms = *backoff_ms + (UINT32)(rand_r(seed) % *backoff_ms);
+    if (diag_rsp->data_len >= sizeof(UINT32))
+    {
+        retry_ms = ((UINT32)diag_rsp->data_ptr[0] << 24) | ((UINT32)diag_rsp->data_ptr[1] << 16) |
+                   ((UINT32)diag_rsp->data_ptr[2] << 8) | (UINT32)diag_rsp->data_ptr[3];
+        delay_ms = (retry_ms > delay_ms) ? retry_ms : delay_ms;
+    }
+
+    *backoff_ms = (*backoff_ms * 2 > DG_CLIENT_API_BUSY_MAX) ? DG_CLIENT_API_BUSY_MAX :
+                  *backoff_ms * 2;
+
+    return delay_ms;
+}
+
+/*=============================================================================================*//**
+@brief Receives the next DIAG response from the specified socket, whichever request it belongs to
+
+@param [in] socket        - Server connection socket
+@param [in] timeout_in_ms - Time to wait for a DIAG response (in msec), 0 means wait forever
+
+@return Pointer to DIAG response, NULL on timeout or a connection error
+
+@note
+  - Used to pipeline requests, the caller matches the response by opcode and timestamp
+  - The calling function is responsible for freeing the memory pointed to by the returned pointer
+    by using DG_CLIENT_API_diag_rsp_free()
+*//*==============================================================================================*/
+DG_CLIENT_API_RSP_T* DG_CLIENT_API_recv_any_diag_rsp(int socket, UINT32 timeout_in_ms)
+{
+    DG_CLIENT_API_RSP_T* diag_rsp;
+    UINT8*               raw_diag_rsp;
+
+    if ((diag_rsp = (DG_CLIENT_API_RSP_T*)malloc(sizeof(DG_CLIENT_API_RSP_T))) == NULL)
+    {
+        DG_CLIENT_API_ERROR("Malloc diag_rsp failed to recv!");
+    }
+    else if ((raw_diag_rsp = dg_client_api_recv_diag_rsp(socket, timeout_in_ms)) == NULL)
+    {
+        DG_CLIENT_API_ERROR("Failed to recv diag response!");
+        free(diag_rsp);
+        diag_rsp = NULL;
+    }
+    else
+    {
+        dg_client_api_parse_diag_rsp(raw_diag_rsp, diag_rsp);
+    }
+
+    return diag_rsp;
+}
+
 /*=============================================================================================*//**
 @brief Frees a given DIAG response
 
@@ -355,3 +515,71 @@ void dg_client_api_parse_diag_rsp(UINT8* raw_rsp_ptr, DG_CLIENT_API_RSP_T* diag_
 
 }
 
+/*=============================================================================================*//**
+@brief Moves a freshly connected internal session onto a shared memory channel
+
+@param [in] socket - Server connection socket, nothing is sent or received on it yet
+
+@note
+  - The session stays on the socket on any failure
+*//*==============================================================================================*/
+void dg_client_api_shm_attach(int socket)
+{
+    DG_SHM_CHANNEL_T*      shm;
+    DG_DEFS_DIAG_REQ_HDR_T req_hdr_h; /* DIAG Header in endianess of host */
+    DG_DEFS_DIAG_REQ_HDR_T req_hdr;
+    DG_CLIENT_API_RSP_T    diag_rsp;
+    UINT8*                 raw_diag_rsp;
+    int                    fds[DG_SHM_FD_NUM];
+
+    /* The request has no data, the engine takes the ring size from the memfd */
+    memset(&req_hdr_h, 0, sizeof(req_hdr_h));
+    req_hdr_h.opcode = DG_SHM_OPCODE;
+    DG_PAL_CLIENT_API_req_hdr_hton(&req_hdr_h, &req_hdr);
+
+    if ((shm = DG_SHM_create(socket, DG_SHM_RING_SIZE_DEFAULT, fds)) == NULL)
+    {
+        DG_CLIENT_API_ERROR("Failed to create shared memory, errno=%d(%m)", errno);
+    }
+    else if (!DG_SHM_send_fds(socket, &req_hdr, sizeof(req_hdr), fds))
+    {
+        DG_CLIENT_API_ERROR("Failed to pass shared memory to socket %d, errno=%d(%m)",
+                            socket, errno);
+        DG_SHM_close(shm);
+    }
+    else if ((raw_diag_rsp = dg_client_api_recv_diag_rsp(socket,
+                                                          DG_CLIENT_API_SHM_TIMEOUT)) == NULL)
+    {
+        DG_CLIENT_API_ERROR("No shared memory response on socket %d", socket);
+        DG_SHM_close(shm);
+    }
+    else
+    {
+        dg_client_api_parse_diag_rsp(raw_diag_rsp, &diag_rsp);
+        if ((diag_rsp.opcode != DG_SHM_OPCODE) || diag_rsp.is_fail)
+        {
+            DG_CLIENT_API_ERROR("Server refused shared memory on socket %d, rsp_code=0x%02x",
+                                socket, diag_rsp.rsp_code);
+            DG_SHM_close(shm);
+        }
+        else
+        {
+            DG_SHM_attach(shm);
+            DG_CLIENT_API_TRACE("Socket %d moved to shared memory", socket);
+        }
+        free(raw_diag_rsp);
+    }
+}
+
+/*=============================================================================================*//**
+@brief Gets a monotonic time in msec, for measuring intervals only
+
+@return The time in msec
+*//*==============================================================================================*/
+UINT32 dg_client_api_get_msec(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (UINT32)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
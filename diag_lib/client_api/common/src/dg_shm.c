@@ -0,0 +1,804 @@
+/*==================================================================================================
+
+    Module Name:  dg_shm.c
+
+    General Description: Shared memory transport between the DIAG engine and local clients
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include "dg_platform_defs.h"
+#include "dg_shm.h"
+
+/*==================================================================================================
+                                          LOCAL CONSTANTS
+==================================================================================================*/
+#define DG_SHM_MAGIC      0x4447534D /**< "DGSM" */
+#define DG_SHM_VERSION    1
+#define DG_SHM_HDR_SIZE   4096       /**< The rings start on the page after the header */
+#define DG_SHM_CACHE_LINE 64
+#define DG_SHM_SPIN_NUM   2000       /**< Ring polls before sleeping, on multi core only */
+#define DG_SHM_SOCKET_MAX 1024       /**< Sockets from this number on stay on the socket */
+
+/*==================================================================================================
+                                            LOCAL MACROS
+==================================================================================================*/
+#define DG_SHM_MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+/*==================================================================================================
+                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+/** Side of the channel, side N writes ring N and sleeps on fds[1 + N] */
+enum
+{
+    DG_SHM_SIDE_CLIENT = 0,
+    DG_SHM_SIDE_ENGINE = 1,
+};
+
+/** Index pair of a ring, both are free running byte counters */
+typedef struct
+{
+    volatile UINT32 head;                                    /**< Moved by the producer only */
+    UINT8           pad0[DG_SHM_CACHE_LINE - sizeof(UINT32)];
+    volatile UINT32 tail;                                    /**< Moved by the consumer only */
+    UINT8           pad1[DG_SHM_CACHE_LINE - sizeof(UINT32)];
+} DG_SHM_RING_T;
+
+/** Header at the start of the memfd */
+typedef struct
+{
+    UINT32          magic;
+    UINT32          version;
+    UINT32          ring_size;
+    UINT8           pad[DG_SHM_CACHE_LINE - 3 * sizeof(UINT32)];
+    DG_SHM_RING_T   ring[2];        /**< Ring 0 carries the requests, ring 1 the responses */
+    volatile UINT32 sleepers[2][2]; /**< [side][is_read] threads sleeping on the side's eventfd */
+} DG_SHM_HDR_T;
+
+struct DG_SHM_CHANNEL_S
+{
+    DG_SHM_HDR_T*   hdr;
+    UINT8*          data;      /**< Ring N data starts at N * ring_size */
+    UINT32          ring_size; /**< Own copy, the shared header is not trusted after the mapping */
+    size_t          map_size;
+    int             fds[DG_SHM_FD_NUM];
+    int             side;
+    int             socket;
+    int             ref;
+    int             spin_num;  /**< Spinning only steals the time of the other side on one core */
+    pthread_mutex_t tx_mutex;
+    pthread_mutex_t rx_mutex;
+};
+
+/*==================================================================================================
+                                     LOCAL FUNCTION PROTOTYPES
+==================================================================================================*/
+static BOOL              dg_shm_size_is_valid(UINT32 ring_size);
+static DG_SHM_CHANNEL_T* dg_shm_alloc(int socket, int side, UINT32 ring_size);
+static UINT32            dg_shm_ready(DG_SHM_CHANNEL_T* shm, BOOL is_read);
+static BOOL              dg_shm_wait_ready(DG_SHM_CHANNEL_T* shm, BOOL is_read,
+                                           UINT32 timeout_in_ms);
+static void              dg_shm_wake(DG_SHM_CHANNEL_T* shm, BOOL is_read);
+static UINT64            dg_shm_now_ms(void);
+
+/*==================================================================================================
+                                          LOCAL VARIABLES
+==================================================================================================*/
+static pthread_mutex_t   dg_shm_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DG_SHM_CHANNEL_T* dg_shm_table[DG_SHM_SOCKET_MAX];
+
+/* read without the lock, so the sockets pay nothing while no channel is attached */
+static volatile int dg_shm_attached = 0;
+
+/*==================================================================================================
+                                          GLOBAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Creates the client side of a channel
+
+@param[in]  socket    - The socket connected to the engine
+@param[in]  ring_size - Size of each ring, a power of 2
+@param[out] fds       - DG_SHM_FD_NUM file descriptors to pass to the engine
+
+@return the channel, NULL with errno set on failure
+
+@note
+- the channel owns the file descriptors, they stay open until it is closed
+*//*==============================================================================================*/
+DG_SHM_CHANNEL_T* DG_SHM_create(int socket, UINT32 ring_size, int* fds)
+{
+    DG_SHM_CHANNEL_T* shm = NULL;
+
+    if ((socket < 0) || (socket >= DG_SHM_SOCKET_MAX) || !dg_shm_size_is_valid(ring_size))
+    {
+        errno = EINVAL;
+    }
+    else if ((shm = dg_shm_alloc(socket, DG_SHM_SIDE_CLIENT, ring_size)) == NULL)
+    {
+        /* errno is set by malloc */
+    }
+    else if (((shm->fds[0] = memfd_create("diag_shm", MFD_CLOEXEC | MFD_ALLOW_SEALING)) < 0) ||
+             (ftruncate(shm->fds[0], shm->map_size) != 0) ||
+             (fcntl(shm->fds[0], F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) ||
+             ((shm->fds[1] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) ||
+             ((shm->fds[2] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) ||
+             ((shm->hdr = (DG_SHM_HDR_T*)mmap(NULL, shm->map_size, PROT_READ | PROT_WRITE,
+                                              MAP_SHARED, shm->fds[0], 0)) == MAP_FAILED))
+    {
+        shm->hdr = NULL;
+        DG_SHM_close(shm);
+        shm = NULL;
+    }
+    else
+    {
+        /* a new memfd is all zeros, only the identification is left to fill */
+        shm->data           = (UINT8*)shm->hdr + DG_SHM_HDR_SIZE;
+        shm->hdr->magic     = DG_SHM_MAGIC;
+        shm->hdr->version   = DG_SHM_VERSION;
+        shm->hdr->ring_size = ring_size;
+        memcpy(fds, shm->fds, sizeof(shm->fds));
+    }
+
+    return shm;
+}
+
+/*=============================================================================================*//**
+@brief Opens the engine side of a channel created by a client
+
+@param[in] socket - The socket of the client
+@param[in] fds    - The DG_SHM_FD_NUM file descriptors received from the client
+
+@return the channel, NULL with errno set on failure
+
+@note
+- takes the file descriptors over, they are closed on failure
+- the memfd must be sealed against shrinking, the engine never faults on a cut mapping
+*//*==============================================================================================*/
+DG_SHM_CHANNEL_T* DG_SHM_open(int socket, int* fds)
+{
+    DG_SHM_CHANNEL_T* shm = NULL;
+    struct stat       st;
+    int               seals;
+    int               i;
+    UINT32            ring_size = 0;
+
+    if ((fds[0] >= 0) && (fstat(fds[0], &st) == 0) && (st.st_size > DG_SHM_HDR_SIZE))
+    {
+        ring_size = (UINT32)((st.st_size - DG_SHM_HDR_SIZE) / 2);
+    }
+
+    if ((socket < 0) || (socket >= DG_SHM_SOCKET_MAX) || (fds[1] < 0) || (fds[2] < 0) ||
+        !dg_shm_size_is_valid(ring_size) ||
+        (st.st_size != DG_SHM_HDR_SIZE + 2 * (off_t)ring_size))
+    {
+        errno = EINVAL;
+    }
+    else if (((seals = fcntl(fds[0], F_GET_SEALS)) < 0) || ((seals & F_SEAL_SHRINK) == 0))
+    {
+        errno = EPERM;
+    }
+    else
+    {
+        shm = dg_shm_alloc(socket, DG_SHM_SIDE_ENGINE, ring_size);
+    }
+
+    if (shm == NULL)
+    {
+        for (i = 0; i < DG_SHM_FD_NUM; i++)
+        {
+            if (fds[i] >= 0)
+            {
+                close(fds[i]);
+            }
+        }
+    }
+    else
+    {
+        memcpy(shm->fds, fds, sizeof(shm->fds));
+
+        /* a blocking fd from the client must not hang the engine in dg_shm_wait_ready() */
+        if ((fcntl(shm->fds[1], F_SETFL, O_NONBLOCK) != 0) ||
+            (fcntl(shm->fds[2], F_SETFL, O_NONBLOCK) != 0) ||
+            ((shm->hdr = (DG_SHM_HDR_T*)mmap(NULL, shm->map_size, PROT_READ | PROT_WRITE,
+                                             MAP_SHARED, shm->fds[0], 0)) == MAP_FAILED))
+        {
+            shm->hdr = NULL;
+            DG_SHM_close(shm);
+            shm = NULL;
+        }
+        else if ((shm->hdr->magic != DG_SHM_MAGIC) || (shm->hdr->version != DG_SHM_VERSION) ||
+                 (shm->hdr->ring_size != ring_size))
+        {
+            DG_SHM_close(shm);
+            shm   = NULL;
+            errno = EPROTO;
+        }
+        else
+        {
+            shm->data = (UINT8*)shm->hdr + DG_SHM_HDR_SIZE;
+        }
+    }
+
+    return shm;
+}
+
+/*=============================================================================================*//**
+@brief Unmaps a channel and closes its file descriptors
+
+@param[in] shm - The channel, NULL is ignored
+
+@note
+- only for a channel that is not attached, an attached one is closed by its last DG_SHM_put()
+*//*==============================================================================================*/
+void DG_SHM_close(DG_SHM_CHANNEL_T* shm)
+{
+    int saved_errno = errno;
+    int i;
+
+    if (shm != NULL)
+    {
+        if (shm->hdr != NULL)
+        {
+            munmap(shm->hdr, shm->map_size);
+        }
+
+        for (i = 0; i < DG_SHM_FD_NUM; i++)
+        {
+            if (shm->fds[i] >= 0)
+            {
+                close(shm->fds[i]);
+            }
+        }
+
+        pthread_mutex_destroy(&shm->tx_mutex);
+        pthread_mutex_destroy(&shm->rx_mutex);
+        free(shm);
+    }
+
+    errno = saved_errno;
+}
+
+/*=============================================================================================*//**
+@brief Moves the traffic of the channel's socket onto the channel
+
+@param[in] shm - The channel
+*//*==============================================================================================*/
+void DG_SHM_attach(DG_SHM_CHANNEL_T* shm)
+{
+    pthread_mutex_lock(&dg_shm_mutex);
+
+    shm->ref                  = 1;
+    dg_shm_table[shm->socket] = shm;
+    dg_shm_attached++;
+
+    pthread_mutex_unlock(&dg_shm_mutex);
+}
+
+/*=============================================================================================*//**
+@brief Detaches the channel of a socket, if any, before the socket is closed
+
+@param[in] socket - The socket
+*//*==============================================================================================*/
+void DG_SHM_detach(int socket)
+{
+    DG_SHM_CHANNEL_T* shm = NULL;
+
+    if ((socket >= 0) && (socket < DG_SHM_SOCKET_MAX))
+    {
+        pthread_mutex_lock(&dg_shm_mutex);
+
+        if ((shm = dg_shm_table[socket]) != NULL)
+        {
+            dg_shm_table[socket] = NULL;
+            dg_shm_attached--;
+        }
+
+        pthread_mutex_unlock(&dg_shm_mutex);
+    }
+
+    if (shm != NULL)
+    {
+        DG_SHM_put(shm);
+    }
+}
+
+/*=============================================================================================*//**
+@brief Gets the channel attached to a socket
+
+@param[in] socket - The socket
+
+@return the channel, NULL if the socket is not attached
+
+@note
+- the channel must be released with DG_SHM_put(), it stays mapped until then even if the socket
+  is detached in the meantime
+*//*==============================================================================================*/
+DG_SHM_CHANNEL_T* DG_SHM_get(int socket)
+{
+    DG_SHM_CHANNEL_T* shm = NULL;
+
+    if ((dg_shm_attached != 0) && (socket >= 0) && (socket < DG_SHM_SOCKET_MAX))
+    {
+        pthread_mutex_lock(&dg_shm_mutex);
+
+        if ((shm = dg_shm_table[socket]) != NULL)
+        {
+            shm->ref++;
+        }
+
+        pthread_mutex_unlock(&dg_shm_mutex);
+    }
+
+    return shm;
+}
+
+/*=============================================================================================*//**
+@brief Releases a channel got by DG_SHM_get()
+
+@param[in] shm - The channel
+*//*==============================================================================================*/
+void DG_SHM_put(DG_SHM_CHANNEL_T* shm)
+{
+    BOOL is_last;
+
+    pthread_mutex_lock(&dg_shm_mutex);
+    is_last = (--shm->ref == 0);
+    pthread_mutex_unlock(&dg_shm_mutex);
+
+    if (is_last)
+    {
+        DG_SHM_close(shm);
+    }
+}
+
+/*=============================================================================================*//**
+@brief Waits until there is data to read from a channel
+
+@param[in] shm           - The channel
+@param[in] timeout_in_ms - Time to wait (in msec), 0 means wait forever
+
+@return TRUE if there is data, FALSE on timeout (errno ETIMEDOUT) or if the other side is gone
+*//*==============================================================================================*/
+BOOL DG_SHM_wait(DG_SHM_CHANNEL_T* shm, UINT32 timeout_in_ms)
+{
+    return dg_shm_wait_ready(shm, TRUE, timeout_in_ms);
+}
+
+/*=============================================================================================*//**
+@brief Reads the specified number of bytes from a channel
+
+@param[in]  shm  - The channel
+@param[out] buff - Buffer to read into
+@param[in]  len  - Number of bytes to read
+
+@return TRUE if all the bytes are read, FALSE with errno set if the other side is gone
+*//*==============================================================================================*/
+BOOL DG_SHM_read(DG_SHM_CHANNEL_T* shm, void* buff, UINT32 len)
+{
+    BOOL           status = TRUE;
+    DG_SHM_RING_T* ring   = &shm->hdr->ring[1 - shm->side];
+    UINT8*         data   = shm->data + (1 - shm->side) * shm->ring_size;
+    UINT32         done   = 0;
+    UINT32         tail;
+    UINT32         avail;
+    UINT32         offset;
+    UINT32         first;
+
+    pthread_mutex_lock(&shm->rx_mutex);
+
+    while (status && (done < len))
+    {
+        tail  = ring->tail;
+        avail = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+
+        if (avail > shm->ring_size)
+        {
+            /* the other side broke the ring */
+            errno  = EPROTO;
+            status = FALSE;
+        }
+        else if (avail == 0)
+        {
+            status = dg_shm_wait_ready(shm, TRUE, 0);
+        }
+        else
+        {
+            avail  = DG_SHM_MIN(avail, len - done);
+            offset = tail & (shm->ring_size - 1);
+            first  = DG_SHM_MIN(avail, shm->ring_size - offset);
+
+            memcpy((UINT8*)buff + done, data + offset, first);
+            memcpy((UINT8*)buff + done + first, data, avail - first);
+            __atomic_store_n(&ring->tail, tail + avail, __ATOMIC_RELEASE);
+
+            done += avail;
+            dg_shm_wake(shm, FALSE);
+        }
+    }
+
+    pthread_mutex_unlock(&shm->rx_mutex);
+
+    return status;
+}
+
+/*=============================================================================================*//**
+@brief Writes the specified number of bytes to a channel
+
+@param[in] shm  - The channel
+@param[in] buff - Buffer to write from
+@param[in] len  - Number of bytes to write
+
+@return TRUE if all the bytes are written, FALSE with errno set if the other side is gone
+
+@note
+- a write is never interleaved with another one on the same channel, so a whole frame written at
+  once stays in one piece
+*//*==============================================================================================*/
+BOOL DG_SHM_write(DG_SHM_CHANNEL_T* shm, const void* buff, UINT32 len)
+{
+    BOOL           status = TRUE;
+    DG_SHM_RING_T* ring   = &shm->hdr->ring[shm->side];
+    UINT8*         data   = shm->data + shm->side * shm->ring_size;
+    UINT32         done   = 0;
+    UINT32         head;
+    UINT32         used;
+    UINT32         space;
+    UINT32         offset;
+    UINT32         first;
+
+    pthread_mutex_lock(&shm->tx_mutex);
+
+    while (status && (done < len))
+    {
+        head = ring->head;
+        used = head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+        if (used > shm->ring_size)
+        {
+            errno  = EPROTO;
+            status = FALSE;
+        }
+        else if (used == shm->ring_size)
+        {
+            status = dg_shm_wait_ready(shm, FALSE, 0);
+        }
+        else
+        {
+            space  = DG_SHM_MIN(shm->ring_size - used, len - done);
+            offset = head & (shm->ring_size - 1);
+            first  = DG_SHM_MIN(space, shm->ring_size - offset);
+
+            memcpy(data + offset, (const UINT8*)buff + done, first);
+            memcpy(data, (const UINT8*)buff + done + first, space - first);
+            __atomic_store_n(&ring->head, head + space, __ATOMIC_RELEASE);
+
+            done += space;
+            dg_shm_wake(shm, TRUE);
+        }
+    }
+
+    pthread_mutex_unlock(&shm->tx_mutex);
+
+    return status;
+}
+
+/*=============================================================================================*//**
+@brief Sends data over a unix socket together with the file descriptors of a channel
+
+@param[in] socket - The socket
+@param[in] buff   - Data to send
+@param[in] len    - Length of the data, at least 1 byte
+@param[in] fds    - DG_SHM_FD_NUM file descriptors
+
+@return TRUE if all the data is sent
+*//*==============================================================================================*/
+BOOL DG_SHM_send_fds(int socket, const void* buff, UINT32 len, const int* fds)
+{
+    struct msghdr   msg;
+    struct iovec    iov;
+    struct cmsghdr* cmsg;
+    union
+    {
+        struct cmsghdr align;
+        char           buff[CMSG_SPACE(sizeof(int) * DG_SHM_FD_NUM)];
+    } ctrl;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(&ctrl, 0, sizeof(ctrl));
+    iov.iov_base       = (void*)buff;
+    iov.iov_len        = len;
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctrl.buff;
+    msg.msg_controllen = sizeof(ctrl.buff);
+
+    cmsg             = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(int) * DG_SHM_FD_NUM);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * DG_SHM_FD_NUM);
+
+    return (sendmsg(socket, &msg, MSG_NOSIGNAL) == (ssize_t)len) ? TRUE : FALSE;
+}
+
+/*=============================================================================================*//**
+@brief Receives data from a socket, keeping the file descriptors passed along with it
+
+@param[in]  socket - The socket
+@param[out] buff   - Buffer to receive into
+@param[in]  len    - Size of the buffer
+@param[out] fds    - DG_SHM_FD_NUM file descriptors, -1 for the ones not received
+
+@return number of bytes received, 0 if the other side is gone, -1 on error
+
+@note
+- the caller owns the received file descriptors, extra ones are closed here
+*//*==============================================================================================*/
+int DG_SHM_recv_fds(int socket, void* buff, UINT32 len, int* fds)
+{
+    struct msghdr   msg;
+    struct iovec    iov;
+    struct cmsghdr* cmsg;
+    int             received;
+    int             fd_num = 0;
+    int             fd;
+    UINT32          i;
+    union
+    {
+        struct cmsghdr align;
+        char           buff[CMSG_SPACE(sizeof(int) * DG_SHM_FD_NUM)];
+    } ctrl;
+
+    for (i = 0; i < DG_SHM_FD_NUM; i++)
+    {
+        fds[i] = -1;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base       = buff;
+    iov.iov_len        = len;
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctrl.buff;
+    msg.msg_controllen = sizeof(ctrl.buff);
+
+    received = recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); (received >= 0) && (cmsg != NULL);
+         cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS))
+        {
+            for (i = 0; i < (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int); i++)
+            {
+                memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                if (fd_num < DG_SHM_FD_NUM)
+                {
+                    fds[fd_num++] = fd;
+                }
+                else
+                {
+                    close(fd);
+                }
+            }
+        }
+    }
+
+    return received;
+}
+
+/*==================================================================================================
+                                           LOCAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Checks a ring size
+
+@param[in] ring_size - The ring size
+
+@return TRUE if the size is a power of 2 within the limits
+*//*==============================================================================================*/
+static BOOL dg_shm_size_is_valid(UINT32 ring_size)
+{
+    return ((ring_size >= DG_SHM_RING_SIZE_MIN) && (ring_size <= DG_SHM_RING_SIZE_MAX) &&
+            ((ring_size & (ring_size - 1)) == 0)) ? TRUE : FALSE;
+}
+
+/*=============================================================================================*//**
+@brief Allocates a channel with nothing mapped or opened yet
+
+@param[in] socket    - The socket of the channel
+@param[in] side      - The side of the channel
+@param[in] ring_size - Size of each ring
+
+@return the channel, NULL if out of memory
+*//*==============================================================================================*/
+static DG_SHM_CHANNEL_T* dg_shm_alloc(int socket, int side, UINT32 ring_size)
+{
+    DG_SHM_CHANNEL_T* shm;
+    int               i;
+
+    if ((shm = (DG_SHM_CHANNEL_T*)malloc(sizeof(DG_SHM_CHANNEL_T))) != NULL)
+    {
+        memset(shm, 0, sizeof(DG_SHM_CHANNEL_T));
+        for (i = 0; i < DG_SHM_FD_NUM; i++)
+        {
+            shm->fds[i] = -1;
+        }
+        shm->side      = side;
+        shm->socket    = socket;
+        shm->ring_size = ring_size;
+        shm->map_size  = DG_SHM_HDR_SIZE + 2 * (size_t)ring_size;
+        shm->spin_num  = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? DG_SHM_SPIN_NUM : 0;
+        pthread_mutex_init(&shm->tx_mutex, NULL);
+        pthread_mutex_init(&shm->rx_mutex, NULL);
+    }
+
+    return shm;
+}
+
+/*=============================================================================================*//**
+@brief Checks how much a side can read or write right now
+
+@param[in] shm     - The channel
+@param[in] is_read - TRUE for the bytes to read, FALSE for the room to write
+
+@return number of bytes, a broken ring reads as ready so the caller finds the error
+*//*==============================================================================================*/
+static UINT32 dg_shm_ready(DG_SHM_CHANNEL_T* shm, BOOL is_read)
+{
+    DG_SHM_RING_T* ring;
+    UINT32         used;
+
+    if (is_read)
+    {
+        ring = &shm->hdr->ring[1 - shm->side];
+        return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - ring->tail;
+    }
+
+    ring = &shm->hdr->ring[shm->side];
+    used = ring->head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    return (used == shm->ring_size) ? 0 : shm->ring_size - used;
+}
+
+/*=============================================================================================*//**
+@brief Waits until a side can read or write
+
+@param[in] shm           - The channel
+@param[in] is_read       - TRUE to wait for data, FALSE to wait for room
+@param[in] timeout_in_ms - Time to wait (in msec), 0 means wait forever
+
+@return TRUE if ready, FALSE on timeout (errno ETIMEDOUT) or if the socket of the channel is closed
+        (errno EPIPE)
+
+@note
+- the sleeper count is raised before the last check of the ring, and the other side checks it
+  after moving the ring, so a wake up can't fall between the check and the poll()
+*//*==============================================================================================*/
+static BOOL dg_shm_wait_ready(DG_SHM_CHANNEL_T* shm, BOOL is_read, UINT32 timeout_in_ms)
+{
+    BOOL          status  = FALSE;
+    BOOL          is_done = FALSE;
+    UINT64        deadline;
+    UINT64        now;
+    UINT64        counter;
+    struct pollfd fds[2];
+    int           poll_status;
+    int           timeout;
+    int           i;
+
+    for (i = 0; (i < shm->spin_num) && !status; i++)
+    {
+        status = (dg_shm_ready(shm, is_read) != 0) ? TRUE : FALSE;
+    }
+
+    deadline = dg_shm_now_ms() + timeout_in_ms;
+
+    while (!status && !is_done)
+    {
+        __atomic_add_fetch(&shm->hdr->sleepers[shm->side][is_read], 1, __ATOMIC_SEQ_CST);
+
+        if (dg_shm_ready(shm, is_read) != 0)
+        {
+            status = TRUE;
+        }
+        else
+        {
+            timeout = -1;
+            if (timeout_in_ms != 0)
+            {
+                now     = dg_shm_now_ms();
+                timeout = (now < deadline) ? (int)(deadline - now) : 0;
+            }
+
+            /* the socket is only watched for the other side going away */
+            fds[0].fd      = shm->fds[1 + shm->side];
+            fds[0].events  = POLLIN;
+            fds[0].revents = 0;
+            fds[1].fd      = shm->socket;
+            fds[1].events  = POLLRDHUP;
+            fds[1].revents = 0;
+
+            poll_status = poll(fds, 2, timeout);
+            if (poll_status == 0)
+            {
+                errno   = ETIMEDOUT;
+                is_done = TRUE;
+            }
+            else if (poll_status < 0)
+            {
+                is_done = (errno != EINTR) ? TRUE : FALSE;
+            }
+            else
+            {
+                if ((fds[0].revents & POLLIN) &&
+                    (read(fds[0].fd, &counter, sizeof(counter)) < 0))
+                {
+                    /* drained by the other thread of this side */
+                }
+
+                if ((fds[1].revents != 0) && (dg_shm_ready(shm, is_read) == 0))
+                {
+                    errno   = EPIPE;
+                    is_done = TRUE;
+                }
+            }
+        }
+
+        __atomic_sub_fetch(&shm->hdr->sleepers[shm->side][is_read], 1, __ATOMIC_SEQ_CST);
+    }
+
+    return status;
+}
+
+/*=============================================================================================*//**
+@brief Wakes the other side up if it is sleeping on what was just done
+
+@param[in] shm     - The channel, the ring indexes are already moved
+@param[in] is_read - TRUE to wake up the readers after a write, FALSE the writers after a read
+
+@note
+- a reader waiting for the response is not woken up by the request being taken off the ring
+*//*==============================================================================================*/
+static void dg_shm_wake(DG_SHM_CHANNEL_T* shm, BOOL is_read)
+{
+    UINT64 one  = 1;
+    int    peer = 1 - shm->side;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if ((__atomic_load_n(&shm->hdr->sleepers[peer][is_read], __ATOMIC_RELAXED) != 0) &&
+        (write(shm->fds[1 + peer], &one, sizeof(one)) < 0))
+    {
+        /* the counter is pending already, the other side wakes up anyway */
+    }
+}
+
+/*=============================================================================================*//**
+@brief Gets the monotonic time in milliseconds
+
+@return the time in milliseconds
+*//*==============================================================================================*/
+static UINT64 dg_shm_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
@@ -44,6 +44,7 @@ LOCAL_EXPORT_C_INCLUDE_DIRS := $(addprefix $(LOCAL_PATH)/, $(DG_CLIENT_EXPORT_IN
 
 LOCAL_SRC_FILES := \
   common/src/dg_client_api.c \
+  common/src/dg_shm.c \
   platform/src/dg_pal_client_api.c
 
 include $(BUILD_STATIC_LIBRARY)
@@ -21,6 +21,7 @@
 #include "dg_pal_client_platform_inc.h"
 #include "dg_defs.h"
 #include "dg_pal_client_api.h"
+#include "dg_shm.h"
 
 
 /*==================================================================================================
@@ -153,6 +154,7 @@ int DG_PAL_CLIENT_API_create_ext_diag_socket(const char* serv_addr)
 *//*==============================================================================================*/
 void DG_PAL_CLIENT_API_close_diag_socket(int socket)
 {
+    DG_SHM_detach(socket);
     close(socket);
 }
 
@@ -169,10 +171,30 @@ BOOL DG_PAL_CLIENT_API_wait(int socket, BOOL is_read, UINT32 timeout_in_ms)
 {
     BOOL status = FALSE;
 
-    struct timeval  timeout;
-    struct timeval* timeout_ptr = NULL;
-    fd_set          fd_set;
-    int             select_status;
+    struct timeval    timeout;
+    struct timeval*   timeout_ptr = NULL;
+    fd_set            fd_set;
+    int               select_status;
+    DG_SHM_CHANNEL_T* shm;
+
+    /* A shared memory write waits for room by itself, only the reads wait here */
+    if ((shm = DG_SHM_get(socket)) != NULL)
+    {
+        if (!is_read || DG_SHM_wait(shm, timeout_in_ms))
+        {
+            status = TRUE;
+        }
+        else if (errno == ETIMEDOUT)
+        {
+            DG_CLIENT_API_TRACE("Timeout occurred!");
+        }
+        else
+        {
+            DG_CLIENT_API_ERROR("Wait on shared memory failed, errno=%d(%m)", errno);
+        }
+        DG_SHM_put(shm);
+        return status;
+    }
 
     /* Convert the timeout (in milliseconds) to seconds & microseconds if timeout used */
     if (timeout_in_ms != 0)
@@ -227,13 +249,25 @@ BOOL DG_PAL_CLIENT_API_wait(int socket, BOOL is_read, UINT32 timeout_in_ms)
 *//*==============================================================================================*/
 BOOL DG_PAL_CLIENT_API_read(int socket, UINT32 len_to_read, UINT8* buff_ptr)
 {
-    BOOL  status             = TRUE;
-    INT32 total_bytes_read   = 0;
-    INT32 current_bytes_read = 0;
-    INT32 try_count          = 0;
+    BOOL              status             = TRUE;
+    INT32             total_bytes_read   = 0;
+    INT32             current_bytes_read = 0;
+    INT32             try_count          = 0;
+    DG_SHM_CHANNEL_T* shm;
 
     DG_CLIENT_API_TRACE("Attempting to read %d bytes from %d.", len_to_read, socket);
 
+    if ((shm = DG_SHM_get(socket)) != NULL)
+    {
+        if (!DG_SHM_read(shm, buff_ptr, len_to_read))
+        {
+            DG_CLIENT_API_ERROR("Read from shared memory failed, errno=%d(%m)", errno);
+            status = FALSE;
+        }
+        DG_SHM_put(shm);
+        return status;
+    }
+
     /* Continue to read until an error occurs or we read the desired number of bytes */
     while (status && (total_bytes_read != (int)len_to_read))
     {
@@ -271,9 +305,20 @@ BOOL DG_PAL_CLIENT_API_read(int socket, UINT32 len_to_read, UINT8* buff_ptr)
 *//*==============================================================================================*/
 BOOL DG_PAL_CLIENT_API_write(int socket, UINT8* buf, UINT32 len)
 {
-    BOOL status = TRUE;
+    BOOL              status = TRUE;
+    DG_SHM_CHANNEL_T* shm;
 
-    if (send(socket, buf, len, 0) != (int)len)
+    if ((shm = DG_SHM_get(socket)) != NULL)
+    {
+        if (!DG_SHM_write(shm, buf, len))
+        {
+            DG_CLIENT_API_ERROR("Failed to write %d bytes to shared memory of socket %d. "
+                                "errno=%d(%m)", len, socket, errno);
+            status = FALSE;
+        }
+        DG_SHM_put(shm);
+    }
+    else if (send(socket, buf, len, 0) != (int)len)
     {
         DG_CLIENT_API_ERROR("Failed to send %d bytes to socket %d. errno=%d(%m)",
                             len, socket, errno);
@@ -332,6 +377,8 @@ BOOL dg_pal_client_api_connect_socket(int socket, struct sockaddr* addr, socklen
     long      orig_flags;
     int       error_value = 0;
     socklen_t errval_size = sizeof(error_value);
+    UINT32    wait_ms     = 0;
+    int       ret;
 
     orig_flags = fcntl(socket, F_GETFL);
     if ((orig_flags == -1) || (fcntl(socket, F_SETFL, O_NONBLOCK) == -1))
@@ -341,7 +388,20 @@ BOOL dg_pal_client_api_connect_socket(int socket, struct sockaddr* addr, socklen
     else
     {
         DG_CLIENT_API_TRACE("Attempting to connect to socket %d", socket);
-        connect(socket, addr, len);
+
+        /* A unix socket doesn't connect in background, it fails with EAGAIN while the listen
+           queue of the server is full, so try again until the server accepts the connection */
+        while (((ret = connect(socket, addr, len)) != 0) && (errno == EAGAIN) &&
+               (wait_ms < DG_PAL_CLIENT_API_CONNECT_WAIT))
+        {
+            usleep(1000);
+            wait_ms++;
+        }
+
+        if (ret == 0)
+        {
+            errno = 0;
+        }
 
         switch (errno)
         {
@@ -353,6 +413,12 @@ BOOL dg_pal_client_api_connect_socket(int socket, struct sockaddr* addr, socklen
         }
         break;
 
+        case EAGAIN:
+        {
+            DG_CLIENT_API_ERROR("cannot connect to server, server is busy. errno=%d(%m)", errno);
+        }
+        break;
+
         default:
         {
             DG_CLIENT_API_TRACE("waiting for connection. errno=%d(%m)", errno);
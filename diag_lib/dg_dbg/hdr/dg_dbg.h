@@ -11,6 +11,8 @@
 ====================================================================================================
                                            INCLUDE FILES
 ==================================================================================================*/
+#include <stdarg.h>
+#include "dg_dbg_err.h"
 
 /** @addtogroup libdg_dbg
 @{
@@ -60,19 +62,35 @@ enum
 @param[in] ...    - Variable argument, used to populated format string
 
 @note
-- If err_string already has a string, the old one will be freed
+- the string is kept in a per thread buffer and truncated to DG_DBG_ERR_STRING_MAX
+- the error code is set to DG_DBG_ERR_GENERIC
 *//*==============================================================================================*/
 void DG_DBG_set_err_string(const char* format, ...);
 
+/*=============================================================================================*//**
+@brief Sets a structured error for the current thread without formatting any text
+
+@param[in] code   - the error code, see DG_DBG_ERR_*
+@param[in] detail - code specific detail, e.g. errno for DG_DBG_ERR_IO
+*//*==============================================================================================*/
+void DG_DBG_set_err(DG_DBG_ERR_T code, int detail);
+
+/*=============================================================================================*//**
+@brief Gets the error code for the current thread
+
+@return - the last error code, DG_DBG_ERR_NONE if no error was set
+*//*==============================================================================================*/
+DG_DBG_ERR_T DG_DBG_get_err_code();
+
 /*=============================================================================================*//**
 @brief Gets an error string for the current thread
 
 @return - the current thread error string
 
 @note
-- get error string from thread specific data
+- a structured error is formatted into the per thread buffer on the first request
 - If no error string was set, will return NULL
-- caller should NOT free the string
+- caller should NOT free the string, it is valid until the thread sets another error
 *//*==============================================================================================*/
 char* DG_DBG_get_err_string();
 
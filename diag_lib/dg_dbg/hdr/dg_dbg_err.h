@@ -0,0 +1,86 @@
+#ifndef _DG_DBG_ERR_H_
+#define _DG_DBG_ERR_H_
+/*==================================================================================================
+
+    Module Name:  dg_dbg_err.h
+
+    General Description: This file provides the structured error codes and the error formatting
+                         shared by the dg_dbg library and the diagd drivers
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include <stdarg.h>
+
+/** @addtogroup libdg_dbg
+@{
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*==================================================================================================
+                                              MACROS
+==================================================================================================*/
+/** capacity of the per thread error string including the NULL terminator */
+#define DG_DBG_ERR_STRING_MAX 256
+
+/*==================================================================================================
+                                               ENUMS
+==================================================================================================*/
+/** structured error code, the text is only formatted when the error string is requested */
+enum
+{
+    DG_DBG_ERR_NONE          = 0,
+    DG_DBG_ERR_GENERIC       = 1, /**< error only described by the error string */
+    DG_DBG_ERR_PARAM         = 2, /**< invalid parameter, detail is the parameter value */
+    DG_DBG_ERR_NO_MEM        = 3, /**< out of memory, detail is the requested size */
+    DG_DBG_ERR_IO            = 4, /**< system call failed, detail is errno */
+    DG_DBG_ERR_TIMEOUT       = 5, /**< operation timed out, detail is milliseconds waited */
+    DG_DBG_ERR_NOT_SUPPORTED = 6, /**< operation not supported, detail is the request */
+    DG_DBG_ERR_HW            = 7, /**< hardware failure, detail is device specific */
+    DG_DBG_ERR_NUM
+};
+
+/*==================================================================================================
+                                   STRUCTURES AND OTHER TYPEDEFS
+==================================================================================================*/
+typedef int DG_DBG_ERR_T;
+
+/*==================================================================================================
+                                        FUNCTION PROTOTYPES
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Format a structured error into a buffer
+
+@param[out] buf    - the output buffer
+@param[in]  size   - size of the output buffer
+@param[in]  code   - the error code, see DG_DBG_ERR_*
+@param[in]  detail - code specific detail
+
+@return - the output buffer
+*//*==============================================================================================*/
+char* DG_DBG_format_err(char* buf, int size, DG_DBG_ERR_T code, int detail);
+
+/*=============================================================================================*//**
+@brief Format a string into a fixed size buffer and mark truncation
+
+@param[out] buf    - the output buffer
+@param[in]  size   - size of the output buffer
+@param[in]  format - printf style format string
+@param[in]  args   - the variable argument list
+
+@note
+- a truncated string ends with "..." so it can be told apart from a complete one
+*//*==============================================================================================*/
+void DG_DBG_vformat(char* buf, int size, const char* format, va_list args);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+#endif /* _DG_DBG_ERR_H_ */
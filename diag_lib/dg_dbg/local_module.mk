@@ -28,7 +28,8 @@ LOCAL_C_INCLUDES := $(addprefix $(LOCAL_PATH)/, $(DG_LOOP_INC))
 LOCAL_EXPORT_C_INCLUDE_DIRS :=  $(addprefix $(LOCAL_PATH)/, $(DG_LOOP_EXPORT_INC))
 
 LOCAL_SRC_FILES := \
-  src/dg_dbg.c
+  src/dg_dbg.c \
+  src/dg_dbg_err.c
 
 include $(BUILD_STATIC_LIBRARY)
 
@@ -12,7 +12,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
-#include <pthread.h>
+#include <string.h>
 #include <errno.h>
 #include "dg_dbg.h"
 
@@ -34,9 +34,6 @@
 /*==================================================================================================
                                      LOCAL FUNCTION PROTOTYPES
 ==================================================================================================*/
-static void dg_dbg_init_err_string();
-static void dg_dbg_create_error_string_key();
-static void dg_dbg_free_error_string(void* err_str);
 
 /*==================================================================================================
                                          GLOBAL VARIABLES
@@ -45,8 +42,11 @@ static void dg_dbg_free_error_string(void* err_str);
 /*==================================================================================================
                                           LOCAL VARIABLES
 ==================================================================================================*/
-static pthread_key_t  dg_dbg_error_string_key;
-static pthread_once_t dg_dbg_key_once = PTHREAD_ONCE_INIT;
+/* the error of each thread lives in TLS, so reporting an error never touches the heap */
+static __thread char         dg_dbg_err_buf[DG_DBG_ERR_STRING_MAX];
+static __thread DG_DBG_ERR_T dg_dbg_err_code;
+static __thread int          dg_dbg_err_detail;
+static __thread int          dg_dbg_err_b_text; /* dg_dbg_err_buf holds the text of the error */
 
 /*default dbg level is just print error */
 static int dg_dbg_level = DG_DBG_LVL_ERROR;
@@ -114,120 +114,84 @@ void DG_DBG_print(int debug_level, const char* format, ...)
 @param[in] ...    - Variable argument, used to populated format string
 
 @note
-- If err_string already has a string, the old one will be freed
+- the string is kept in a per thread buffer and truncated to DG_DBG_ERR_STRING_MAX
+- the error code is set to DG_DBG_ERR_GENERIC
 *//*==============================================================================================*/
 void DG_DBG_set_err_string(const char* format, ...)
 {
-    va_list args;       /* Variable arg list */
-    char*   p_err_str;  /* pointer to the error string */
+    va_list args; /* Variable arg list */
 
-    dg_dbg_init_err_string();
-
-    /* Init variable arg list */
-    va_start(args, format);
-
-    if (vasprintf(&p_err_str, format, args) < 0)
-    {
-        DG_DBG_ERROR("vasprintf() set error string failed. errno=%d(%m)", errno);
-    }
-    else
+    if (dg_dbg_err_b_text)
     {
-        char* old_err_str = (char*)pthread_getspecific(dg_dbg_error_string_key);
-
-        /* Free any existing error string */
-        if (old_err_str != NULL)
-        {
-            DG_DBG_TRACE("Overwriting error string: %s", old_err_str);
-            free(old_err_str);
-        }
-
-        /* Set new error string */
-        if (pthread_setspecific(dg_dbg_error_string_key, p_err_str) != 0)
-        {
-            DG_DBG_ERROR("pthread_setspecific() set error string failed. errno=%d(%m)", errno);
-        }
-        else
-        {
-            DG_DBG_ERROR("Thread error string set to: %s", p_err_str);
-        }
+        DG_DBG_TRACE("Overwriting error string: %s", dg_dbg_err_buf);
     }
 
+    va_start(args, format);
+    DG_DBG_vformat(dg_dbg_err_buf, sizeof(dg_dbg_err_buf), format, args);
     va_end(args);
+
+    dg_dbg_err_code   = DG_DBG_ERR_GENERIC;
+    dg_dbg_err_detail = 0;
+    dg_dbg_err_b_text = 1;
+
+    DG_DBG_ERROR("Thread error string set to: %s", dg_dbg_err_buf);
 }
 
 /*=============================================================================================*//**
-@brief Gets an error string for the current driver thread
-
-@return - the current driver thread error string
+@brief Sets a structured error for the current thread without formatting any text
 
-@note
-- get error string from thread specific data
-- If no error string was set, will return NULL
-- caller should NOT free the string
+@param[in] code   - the error code, see DG_DBG_ERR_*
+@param[in] detail - code specific detail, e.g. errno for DG_DBG_ERR_IO
 *//*==============================================================================================*/
-char* DG_DBG_get_err_string()
+void DG_DBG_set_err(DG_DBG_ERR_T code, int detail)
 {
-    return pthread_getspecific(dg_dbg_error_string_key);
-}
+    dg_dbg_err_code   = code;
+    dg_dbg_err_detail = detail;
+    dg_dbg_err_b_text = 0;
 
-/*==================================================================================================
-                                          LOCAL FUNCTIONS
-==================================================================================================*/
+    DG_DBG_TRACE("Thread error code set to: %d, detail=%d", code, detail);
+}
 
 /*=============================================================================================*//**
-@brief Initializes error string for the current thread
+@brief Gets the error code for the current thread
 
-@note
-- the init would only happen once for threads, please see the pthread_once manual
+@return - the last error code, DG_DBG_ERR_NONE if no error was set
 *//*==============================================================================================*/
-void dg_dbg_init_err_string()
+DG_DBG_ERR_T DG_DBG_get_err_code()
 {
-    static int b_init = 0;
-
-    if (b_init != 0)
-    {
-        return;
-    }
-
-    if (pthread_once(&dg_dbg_key_once, dg_dbg_create_error_string_key) != 0)
-    {
-        DG_DBG_ERROR("pthread_once() for error string key failed. errno=%d(%m)", errno);
-    }
-    else
-    {
-        b_init = 1;
-    }
+    return dg_dbg_err_code;
 }
 
 /*=============================================================================================*//**
-@brief Create error string key for threads specific data
+@brief Gets an error string for the current driver thread
+
+@return - the current driver thread error string
 
 @note
-- this function register a free error string hanldler when thread exit
-- you should free the old error string before set a new error string
+- a structured error is formatted into the per thread buffer on the first request
+- If no error string was set, will return NULL
+- caller should NOT free the string, it is valid until the thread sets another error
 *//*==============================================================================================*/
-void dg_dbg_create_error_string_key()
+char* DG_DBG_get_err_string()
 {
-    int ret = pthread_key_create(&dg_dbg_error_string_key, dg_dbg_free_error_string);
-
-    if (ret != 0)
+    if (dg_dbg_err_code == DG_DBG_ERR_NONE)
     {
-        DG_DBG_ERROR("pthread_key_create() for error string failed. errno=%d(%m)", errno);
+        return NULL;
     }
-}
 
-/*=============================================================================================*//**
-@brief Initializes error string for the current thread
+    if (!dg_dbg_err_b_text)
+    {
+        DG_DBG_format_err(dg_dbg_err_buf, sizeof(dg_dbg_err_buf), dg_dbg_err_code,
+                          dg_dbg_err_detail);
+        dg_dbg_err_b_text = 1;
+    }
 
-@note
-- when thread exit automatically call this function to free the error string
-*//*==============================================================================================*/
-void dg_dbg_free_error_string(void* err_str)
-{
-    DG_DBG_TRACE("Free error string for thread %p", pthread_self());
-    free(err_str);
+    return dg_dbg_err_buf;
 }
 
+/*==================================================================================================
+                                          LOCAL FUNCTIONS
+==================================================================================================*/
 
 /** @} */
 
@@ -0,0 +1,120 @@
+/*==================================================================================================
+
+    Module Name:  dg_dbg_err.c
+
+    General Description: Implements the error formatting of the dg_dbg library
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "dg_dbg_err.h"
+
+/** @addtogroup libdg_dbg
+@{
+*/
+/*==================================================================================================
+                                          LOCAL CONSTANTS
+==================================================================================================*/
+
+/*==================================================================================================
+                                           LOCAL MACROS
+==================================================================================================*/
+
+/*==================================================================================================
+                            LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+
+/*==================================================================================================
+                                     LOCAL FUNCTION PROTOTYPES
+==================================================================================================*/
+
+/*==================================================================================================
+                                         GLOBAL VARIABLES
+==================================================================================================*/
+
+/*==================================================================================================
+                                          LOCAL VARIABLES
+==================================================================================================*/
+/* names of the structured error codes */
+static const char* const dg_dbg_err_name[DG_DBG_ERR_NUM] =
+{
+    "no error",
+    "error",
+    "invalid parameter",
+    "out of memory",
+    "I/O error",
+    "timeout",
+    "not supported",
+    "hardware error",
+};
+
+/*==================================================================================================
+                                         GLOBAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Format a structured error into a buffer
+
+@param[out] buf    - the output buffer
+@param[in]  size   - size of the output buffer
+@param[in]  code   - the error code, see DG_DBG_ERR_*
+@param[in]  detail - code specific detail
+
+@return - the output buffer
+*//*==============================================================================================*/
+char* DG_DBG_format_err(char* buf, int size, DG_DBG_ERR_T code, int detail)
+{
+    if ((code < DG_DBG_ERR_NONE) || (code >= DG_DBG_ERR_NUM))
+    {
+        snprintf(buf, size, "unknown error %d, detail=%d", code, detail);
+    }
+    else if (code == DG_DBG_ERR_IO)
+    {
+        char err_buf[64];
+
+        snprintf(buf, size, "%s, errno=%d(%s)", dg_dbg_err_name[code], detail,
+                 strerror_r(detail, err_buf, sizeof(err_buf)));
+    }
+    else
+    {
+        snprintf(buf, size, "%s, detail=%d", dg_dbg_err_name[code], detail);
+    }
+
+    return buf;
+}
+
+/*=============================================================================================*//**
+@brief Format a string into a fixed size buffer and mark truncation
+
+@param[out] buf    - the output buffer
+@param[in]  size   - size of the output buffer
+@param[in]  format - printf style format string
+@param[in]  args   - the variable argument list
+
+@note
+- a truncated string ends with "..." so it can be told apart from a complete one
+*//*==============================================================================================*/
+void DG_DBG_vformat(char* buf, int size, const char* format, va_list args)
+{
+    int len = vsnprintf(buf, size, format, args);
+
+    if (len < 0)
+    {
+        buf[0] = '\0';
+    }
+    else if ((len >= size) && (size > 4))
+    {
+        strcpy(buf + size - 4, "...");
+    }
+}
+
+/*==================================================================================================
+                                          LOCAL FUNCTIONS
+==================================================================================================*/
+
+/** @} */
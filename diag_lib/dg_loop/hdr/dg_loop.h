@@ -27,6 +27,15 @@ extern "C" {
 #define DG_LOOP_PACKET_SIZE_MAX 9000
 #define DG_LOOP_PACKET_SIZE_MIN 80
 #define DG_LOOP_RUN_IFINITE     -1
+#define DG_LOOP_CACHE_LINE_SIZE 64
+#define DG_LOOP_TOPO_CACHE_FILE "/var/cache/dg_loop.topo" /* default detected topology cache */
+
+#define DG_LOOP_LAT_HIST_SUB 4   /* latency histogram buckets in each power of two ns */
+#define DG_LOOP_LAT_HIST_NUM 128 /* latency histogram buckets, up to 2^32 ns          */
+#define DG_LOOP_GAP_HIST_NUM 16  /* loss/reorder histogram buckets, one for each power of two */
+
+#define DG_LOOP_IMIX_MAX        8  /* max packet sizes in the size mix   */
+#define DG_LOOP_IMIX_WEIGHT_MAX 64 /* max total weight of the size mix   */
 
 /*==================================================================================================
                                                ENUMS
@@ -84,6 +93,30 @@ enum
 };
 typedef UINT8 DG_LOOP_CFG_T;
 
+/** packet data pattern type */
+enum
+{
+    DG_LOOP_PATTERN_FIXED     = 0x00, /** every byte is the pattern value            */
+    DG_LOOP_PATTERN_INCREMENT = 0x01, /** bytes increase from the pattern value      */
+    DG_LOOP_PATTERN_RANDOM    = 0x02, /** pseudo random words seeded by the pattern  */
+    DG_LOOP_PATTERN_PRBS31    = 0x03, /** PRBS-31 bit stream seeded by the pattern   */
+    DG_LOOP_PATTERN_PRBS7     = 0x04, /** PRBS-7 bit stream seeded by the pattern    */
+    DG_LOOP_PATTERN_PRBS15    = 0x05, /** PRBS-15 bit stream seeded by the pattern   */
+    DG_LOOP_PATTERN_PRBS23    = 0x06, /** PRBS-23 bit stream seeded by the pattern   */
+    DG_LOOP_PATTERN_NUM
+};
+typedef UINT8 DG_LOOP_PATTERN_T;
+
+/** port backend type */
+enum
+{
+    DG_LOOP_BACKEND_SIM    = 0x00, /** socketpair simulation, the default           */
+    DG_LOOP_BACKEND_PACKET = 0x01, /** AF_PACKET TPACKET_V2 memory mapped rx/tx ring */
+    DG_LOOP_BACKEND_URING  = 0x02, /** AF_PACKET socket driven by io_uring          */
+    DG_LOOP_BACKEND_NUM
+};
+typedef UINT8 DG_LOOP_BACKEND_T;
+
 /*==================================================================================================
                                    STRUCTURES AND OTHER TYPEDEFS
 ==================================================================================================*/
@@ -96,29 +129,113 @@ typedef struct
 
 typedef struct
 {
-    int    fail_send;  /* failed send packets number */
-    int    fail_recv;  /* failed recv packets number */
-    UINT64 total_send; /* total send packets number  */
-    UINT64 total_recv; /* total recv packets number  */
-    int    wrong_recv; /* wrong recv packets number  */
+    int    fail_send;  /* failed send packets number            */
+    int    fail_recv;  /* failed recv packets number            */
+    UINT64 total_send; /* total send packets number             */
+    UINT64 total_recv; /* total recv packets number             */
+    UINT64 total_byte; /* total recv bytes number               */
+    int    wrong_recv; /* wrong recv packets number             */
+    UINT64 bit_error;  /* total error bits in wrong packets     */
+    int    err_offset; /* first wrong byte of last wrong packet */
+    UINT64 total_bit;  /* total checked bits                    */
+    UINT64 sync_loss;  /* PRBS checker re-synchronization times */
+    int    total_sec;  /* seconds since the recv thread started */
+    int    error_sec;  /* seconds with bit error or lost packet */
+
+    /* valid only if the test embeds the packet stamp */
+    UINT64 lost;                               /* packets lost in sequence gaps   */
+    UINT64 reorder;                            /* packets received out of order   */
+    UINT64 lat_min;                            /* minimum latency in ns           */
+    UINT64 lat_max;                            /* maximum latency in ns           */
+    UINT64 lat_sum;                            /* latency sum in ns               */
+    UINT64 jitter;                             /* RFC 3550 arrival jitter in ns   */
+    UINT32 lat_hist[DG_LOOP_LAT_HIST_NUM];     /* latency histogram               */
+    UINT32 loss_hist[DG_LOOP_GAP_HIST_NUM];    /* lost packets burst length log2  */
+    UINT32 reorder_hist[DG_LOOP_GAP_HIST_NUM]; /* reorder distance log2           */
 } DG_LOOP_TEST_STATISTIC_T;
 
+/** the stamp at the start of the packet when the test embeds the packet stamp */
+typedef struct
+{
+    UINT32 seq;     /* packet sequence number        */
+    UINT32 size;    /* packet size                   */
+    UINT64 tx_time; /* monotonic time of send in ns  */
+} DG_LOOP_STAMP_T;
+
+/** one packet size of the size mix */
+typedef struct
+{
+    int size;   /* packet size                                   */
+    int weight; /* how many packets of this size in one mix cycle */
+} DG_LOOP_IMIX_T;
+
+/** the test result snapshot */
+typedef struct
+{
+    UINT64                   time;   /* monotonic time of the snapshot in ns */
+    DG_LOOP_TEST_STATISTIC_T result; /* the consistent copy of the result    */
+} DG_LOOP_TEST_SNAPSHOT_T;
+
+/** the rate between two snapshots */
+typedef struct
+{
+    double send_pps; /* sent packets per second     */
+    double recv_pps; /* received packets per second */
+    double recv_bps; /* received bits per second    */
+} DG_LOOP_TEST_RATE_T;
+
+/** the counters written by only one thread, kept in their own cache line */
+typedef struct
+{
+    UINT32                   seq;  /* sequence number, odd while the writer is updating */
+    DG_LOOP_TEST_STATISTIC_T stat; /* the counters                                      */
+} __attribute__((aligned(DG_LOOP_CACHE_LINE_SIZE))) DG_LOOP_TEST_COUNTER_T;
+
+/** the pattern check result */
+typedef struct
+{
+    UINT32 offset;    /* first mismatched byte offset, equals size if no mismatch */
+    UINT32 bit_error; /* number of mismatched bits                                */
+    UINT32 bit_count; /* number of checked bits                                   */
+    UINT32 sync_loss; /* number of PRBS re-synchronization                        */
+} DG_LOOP_PATTERN_CHECK_T;
+
+/** the bit error rate with the 95% confidence bounds */
+typedef struct
+{
+    double ber;   /* the measured bit error rate */
+    double lower; /* the lower confidence bound  */
+    double upper; /* the upper confidence bound  */
+} DG_LOOP_BER_T;
+
 typedef struct
 {
     /* public sector */
-    DG_LOOP_PORT_T           tx_port;     /* [in]  - the port that will send data */
-    DG_LOOP_PORT_T           rx_port;     /* [in]  - the port that will recv data */
-    UINT8                    pattern;     /* [in]  - packet data pattern          */
-    int                      size;        /* [in]  - packet size of each transfer */
-    int                      number;      /* [in]  - how many times to send/recv  */
-    DG_LOOP_TEST_STATISTIC_T result;      /* [out] - test result                  */
+    DG_LOOP_PORT_T           tx_port;      /* [in]  - the port that will send data */
+    DG_LOOP_PORT_T           rx_port;      /* [in]  - the port that will recv data */
+    UINT8                    pattern;      /* [in]  - packet data pattern          */
+    DG_LOOP_PATTERN_T        pattern_type; /* [in]  - packet data pattern type     */
+    BOOL                     b_stamp;      /* [in]  - embed seq number and time    */
+    int                      size;         /* [in]  - packet size of each transfer */
+    int                      number;       /* [in]  - how many times to send/recv  */
+    UINT64                   rate_pps;     /* [in]  - packets per second, 0 no limit */
+    UINT64                   rate_bps;     /* [in]  - bits per second, 0 no limit  */
+    int                      burst;        /* [in]  - packets sent back to back    */
+    int                      imix_num;     /* [in]  - size mix entries, 0 use size */
+    DG_LOOP_IMIX_T           imix[DG_LOOP_IMIX_MAX]; /* [in]  - packet size mix    */
+    DG_LOOP_TEST_STATISTIC_T result;       /* [out] - final test result            */
     /* private sector */
-    pthread_t send_thread; /* [pri] - send thread        */
-    pthread_t recv_thread; /* [pri] - recv thread        */
-    BOOL      b_run;       /* [pri] - thread run control */
-    BOOL      b_recv;      /* [pri] - recv run control   */
-    sem_t     send_sem;    /* [pri] - send semaphore     */
-    sem_t     recv_sem;    /* [pri] - recv semaphore     */
+    UINT16                 size_seq[DG_LOOP_IMIX_WEIGHT_MAX]; /* [pri] - size of each packet */
+    int                    size_num;    /* [pri] - packets in one size cycle */
+    int                    size_max;    /* [pri] - the max packet size      */
+    pthread_t              send_thread; /* [pri] - send thread              */
+    pthread_t              recv_thread; /* [pri] - recv thread              */
+    BOOL                   b_run;       /* [pri] - thread run control       */
+    BOOL                   b_recv;      /* [pri] - recv run control         */
+    sem_t                  send_sem;    /* [pri] - send semaphore           */
+    sem_t                  recv_sem;    /* [pri] - recv semaphore           */
+    DG_LOOP_TEST_COUNTER_T send_cnt;    /* [pri] - counters of send thread  */
+    DG_LOOP_TEST_COUNTER_T recv_cnt;    /* [pri] - counters of recv thread  */
 } DG_LOOP_TEST_T;
 
 /*==================================================================================================
@@ -166,6 +283,30 @@ BOOL DG_LOOP_connect(DG_LOOP_PORT_T port1, DG_LOOP_PORT_T port2);
 *//*==============================================================================================*/
 void DG_LOOP_disconnect_all();
 
+/*=============================================================================================*//**
+@brief get the port backend type
+
+@param[in]  name - the backend name: sim, packet, uring
+
+@return -1 if invalid, otherwise the backend type
+*//*==============================================================================================*/
+int DG_LOOP_get_backend(const char* name);
+
+/*=============================================================================================*//**
+@brief set the backend of the port
+
+@param[in]  port    - the port
+@param[in]  backend - the backend type
+@param[in]  ifname  - the network interface of the port, not used by the simulation backend
+
+@return TRUE if success
+
+@note
+- the port must be closed
+- if error happened, call DG_DBG_get_err_string() to get the last error
+*//*==============================================================================================*/
+BOOL DG_LOOP_set_backend(DG_LOOP_PORT_T port, DG_LOOP_BACKEND_T backend, const char* ifname);
+
 /*=============================================================================================*//**
 @brief open port for send/recv data
 
@@ -213,6 +354,19 @@ BOOL DG_LOOP_send(int fd, UINT8* buf, UINT32 len);
 *//*==============================================================================================*/
 BOOL DG_LOOP_recv(int fd, UINT8* buf, UINT32 len);
 
+/*=============================================================================================*//**
+@brief get the system file descriptor to poll for the received data
+
+@param[in]  fd      - the fd that opened by DG_LOOP_open()
+
+@return the system file descriptor, -1 if error happened
+
+@note
+- the descriptor is only for select/poll/epoll, use DG_LOOP_recv() to read the data
+- if error happened, call DG_DBG_get_err_string() to get the last error
+*//*==============================================================================================*/
+int DG_LOOP_get_poll_fd(int fd);
+
 /*=============================================================================================*//**
 @brief loopback node configuration
 
@@ -249,8 +403,14 @@ BOOL DG_LOOP_config_all_normal();
 - this function would start two threads in the background and return immediately
 - one thread for sending the packets and one thread for receiving packets
 - if test->number == DG_LOOP_RUN_IFINITE, the test would run forever
-- the statistic result is stored in test->result
-- user can READ it any time to print out the result
+- if test->b_stamp is set, DG_LOOP_STAMP_T is put at the start of each packet to measure
+  latency, jitter, loss and reorder, the pattern is only checked after the stamp
+- if test->imix_num > 0, the packet sizes cycle through test->imix in weighted round robin,
+  otherwise every packet is test->size bytes
+- if test->rate_pps or test->rate_bps is set, the send thread is paced by a token bucket of
+  test->burst packets on the monotonic clock, the lower rate wins if both are set
+- the final statistic result is stored in test->result by DG_LOOP_wait_test()
+- user can call DG_LOOP_get_result() any time to print out the running result
 - user can all DG_LOOP_stop_test() to stop the test
 - if error happened, call DG_DBG_get_err_string() to get the last error
 *//*==============================================================================================*/
@@ -276,6 +436,40 @@ void DG_LOOP_stop_test(DG_LOOP_TEST_T* test);
 *//*==============================================================================================*/
 BOOL DG_LOOP_query_test(DG_LOOP_TEST_T* test);
 
+/*=============================================================================================*//**
+@brief get the consistent snapshot of the running test result
+
+@param[in]  test - which test to query
+@param[out] snap - the result snapshot
+
+@note
+- the send/recv threads never wait for the reader, the reader retries if a thread is updating
+*//*==============================================================================================*/
+void DG_LOOP_get_result(DG_LOOP_TEST_T* test, DG_LOOP_TEST_SNAPSHOT_T* snap);
+
+/*=============================================================================================*//**
+@brief calculate the rate between two result snapshots
+
+@param[in]  prev - the previous snapshot
+@param[in]  cur  - the current snapshot
+@param[out] rate - the rate
+*//*==============================================================================================*/
+void DG_LOOP_get_rate(const DG_LOOP_TEST_SNAPSHOT_T* prev, const DG_LOOP_TEST_SNAPSHOT_T* cur,
+                      DG_LOOP_TEST_RATE_T* rate);
+
+/*=============================================================================================*//**
+@brief get the latency percentile of the test result
+
+@param[in]  result  - the test result
+@param[in]  percent - the percentile, 0 ~ 100
+
+@return the latency in ns, 0 if no latency sample
+
+@note
+- the value is the upper bound of the histogram bucket, which is at most 25% above the sample
+*//*==============================================================================================*/
+UINT64 DG_LOOP_get_latency(const DG_LOOP_TEST_STATISTIC_T* result, double percent);
+
 /*=============================================================================================*//**
 @brief wait the loopback test finished
 
@@ -284,17 +478,122 @@ BOOL DG_LOOP_query_test(DG_LOOP_TEST_T* test);
 @note
 - this function would wait the two threads in the background that started by DG_LOOP_start_test()
 - it should be used after DG_LOOP_stop_test(), and block until all the thread released
+- the final result is stored in test->result
 *//*==============================================================================================*/
 void DG_LOOP_wait_test(DG_LOOP_TEST_T* test);
 
+/*=============================================================================================*//**
+@brief get the pattern type
+
+@param[in]  name - the pattern type name
+
+@return -1 if invalid, otherwise the pattern type
+*//*==============================================================================================*/
+int DG_LOOP_get_pattern(const char* name);
+
+/*=============================================================================================*//**
+@brief get the pattern type name
+
+@param[in]  type - the pattern type
+
+@return NULL if invalid, otherwise the name of the pattern type
+*//*==============================================================================================*/
+const char* DG_LOOP_pattern_name(DG_LOOP_PATTERN_T type);
+
+/*=============================================================================================*//**
+@brief fill the buffer with the data pattern
+
+@param[out] buf  - the buffer to fill
+@param[in]  size - the buffer size
+@param[in]  type - the pattern type
+@param[in]  seed - the pattern value, used as the seed for generated patterns
+
+@note
+- the buffer is filled one 64-bit word at a time
+- the same type and seed always generate the same data
+*//*==============================================================================================*/
+void DG_LOOP_fill_pattern(UINT8* buf, UINT32 size, DG_LOOP_PATTERN_T type, UINT8 seed);
+
+/*=============================================================================================*//**
+@brief compare the received data with the expected pattern data
+
+@param[in]  buf    - the received data
+@param[in]  expect - the expected data generated by DG_LOOP_fill_pattern()
+@param[in]  size   - the data size
+@param[out] check  - the first mismatched offset and the number of mismatched bits
+
+@return TRUE if the data match
+
+@note
+- the data is compared one 64-bit word at a time when both buffers have the same alignment
+*//*==============================================================================================*/
+BOOL DG_LOOP_check_pattern(const UINT8* buf, const UINT8* expect, UINT32 size,
+                           DG_LOOP_PATTERN_CHECK_T* check);
+
+/*=============================================================================================*//**
+@brief check if the pattern type is a PRBS pattern
+
+@param[in]  type - the pattern type
+
+@return TRUE if it is a PRBS pattern
+*//*==============================================================================================*/
+BOOL DG_LOOP_is_prbs(DG_LOOP_PATTERN_T type);
+
+/*=============================================================================================*//**
+@brief check the received data with the self-synchronizing PRBS checker
+
+@param[in]  buf   - the received data
+@param[in]  size  - the data size
+@param[in]  type  - the PRBS pattern type
+@param[out] check - the check result
+
+@return TRUE if the data match
+
+@note
+- the checker synchronizes on the first 64 bits of the data, so the seed is not required
+- the checker re-synchronizes when a 64-bit word has too many errors, sync_loss is counted
+- the bits used for synchronization are not counted in check->bit_count
+*//*==============================================================================================*/
+BOOL DG_LOOP_check_prbs(const UINT8* buf, UINT32 size, DG_LOOP_PATTERN_T type,
+                        DG_LOOP_PATTERN_CHECK_T* check);
+
+/*=============================================================================================*//**
+@brief calculate the bit error rate of the test result
+
+@param[in]  result - the test result
+@param[out] ber    - the bit error rate and its 95% confidence bounds
+
+@note
+- the bounds are the Wilson score interval, so they are valid even if no error found
+*//*==============================================================================================*/
+void DG_LOOP_get_ber(const DG_LOOP_TEST_STATISTIC_T* result, DG_LOOP_BER_T* ber);
+
 /*=============================================================================================*//**
 @brief auto detect the loop connection and fill the port pair
 
 @return the port pair array, NULL if failed
 
+@note
+- all the ports are probed at the same time and polled by one thread
+- the probes of undetected ports are repeated, the detection is bounded by 500ms
+
 *//*==============================================================================================*/
 DG_LOOP_PORT_PAIR_T* DG_LOOP_auto_detect();
 
+/*=============================================================================================*//**
+@brief detect the loop connection with the cached topology
+
+@param[in] file - the topology cache file
+
+@return the port pair array, NULL if failed
+
+@note
+- if the cache is valid, only the cached pairs are probed to verify it
+- the ports that no longer match are detected again, and the cache is updated
+- if the cache is missing or invalid, all the ports are detected and the cache is created
+*//*==============================================================================================*/
+DG_LOOP_PORT_PAIR_T* DG_LOOP_cached_detect(const char* file);
+
 #ifdef __cplusplus
 }
 #endif
@@ -34,7 +34,10 @@ LOCAL_SRC_FILES := \
   src/dg_loop_api.c \
   src/dg_loop_cfg.c \
   src/dg_loop_detect.c\
-  src/dg_loop_test.c
+  src/dg_loop_packet.c \
+  src/dg_loop_pattern.c \
+  src/dg_loop_test.c \
+  src/dg_loop_uring.c
 
 include $(BUILD_STATIC_LIBRARY)
 
@@ -36,28 +36,6 @@
 /*==================================================================================================
                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
 ==================================================================================================*/
-struct DG_LOOP_PORT_FD_S;
-
-typedef struct
-{
-    BOOL (* open)(struct DG_LOOP_PORT_FD_S* fd);
-    void (* close)(struct DG_LOOP_PORT_FD_S* fd);
-    BOOL (* send)(struct DG_LOOP_PORT_FD_S* fd, UINT32 size, UINT8* data);
-    BOOL (* recv)(struct DG_LOOP_PORT_FD_S* fd, UINT32 size, UINT8* data);
-} DG_LOOP_PORT_OP_T;
-
-typedef struct DG_LOOP_PORT_FD_S
-{
-    DG_LOOP_PORT_T port;   /* the stored port  */
-    const char*    name;   /* the port name    */
-
-    int ref;               /* reference count  */
-    int tx_fd;             /* the actual tx fd */
-    int rx_fd;             /* the actual rx fd */
-
-    DG_LOOP_PORT_OP_T* op;
-    pthread_mutex_t    mutex; /* mutex protection */
-} DG_LOOP_PORT_FD_T;
 
 /*==================================================================================================
                                      LOCAL FUNCTION PROTOTYPES
@@ -80,11 +58,27 @@ static DG_LOOP_PORT_OP_T dg_loop_port_sim_op =
     dg_loop_open_sim, dg_loop_close_sys, dg_loop_write_sim, dg_loop_read_sim
 };
 
+/** the operations of each backend */
+static DG_LOOP_PORT_OP_T* dg_loop_backend_op[DG_LOOP_BACKEND_NUM] =
+{
+    [DG_LOOP_BACKEND_SIM]    = &dg_loop_port_sim_op,
+    [DG_LOOP_BACKEND_PACKET] = &dg_loop_port_packet_op,
+    [DG_LOOP_BACKEND_URING]  = &dg_loop_port_uring_op,
+};
+
+static const char* dg_loop_backend_name[DG_LOOP_BACKEND_NUM] =
+{
+    [DG_LOOP_BACKEND_SIM]    = "sim",
+    [DG_LOOP_BACKEND_PACKET] = "packet",
+    [DG_LOOP_BACKEND_URING]  = "uring",
+};
+
 /** internal real file descriptor array for each ports */
 static DG_LOOP_PORT_FD_T dg_loop_port_fd[DG_LOOP_PORT_NUM] =
 {
 #define PORT_FD_INIT(port) \
-    { DG_LOOP_PORT_ ## port, # port, 0, -1, -1, &dg_loop_port_sim_op, PTHREAD_MUTEX_INITIALIZER }
+    { DG_LOOP_PORT_ ## port, # port, 0, -1, -1, &dg_loop_port_sim_op, PTHREAD_MUTEX_INITIALIZER, \
+      "", NULL }
     PORT_FD_INIT(mgt),
     PORT_FD_INIT(ha),
     PORT_FD_INIT(wtb0),
@@ -246,6 +240,105 @@ void DG_LOOP_disconnect_all()
     }
 }
 
+/*=============================================================================================*//**
+@brief get the port backend type
+
+@param[in]  name - the backend name: sim, packet, uring
+
+@return -1 if invalid, otherwise the backend type
+*//*==============================================================================================*/
+int DG_LOOP_get_backend(const char* name)
+{
+    int backend;
+
+    for (backend = 0; backend < DG_LOOP_BACKEND_NUM; backend++)
+    {
+        if (strcmp(name, dg_loop_backend_name[backend]) == 0)
+        {
+            return backend;
+        }
+    }
+
+    return -1;
+}
+
+/*=============================================================================================*//**
+@brief set the backend of the port
+
+@param[in]  port    - the port
+@param[in]  backend - the backend type
+@param[in]  ifname  - the network interface of the port, not used by the simulation backend
+
+@return TRUE if success
+
+@note
+- the port must be closed
+- if error happened, call DG_DBG_get_err_string() to get the last error
+*//*==============================================================================================*/
+BOOL DG_LOOP_set_backend(DG_LOOP_PORT_T port, DG_LOOP_BACKEND_T backend, const char* ifname)
+{
+    BOOL ret = FALSE;
+
+    pthread_mutex_t* mutex;
+
+    if (port >= DG_LOOP_PORT_NUM)
+    {
+        DG_DBG_set_err_string("Invalid Port to set backend, port=0x%02x", port);
+        return FALSE;
+    }
+
+    if (backend >= DG_LOOP_BACKEND_NUM)
+    {
+        DG_DBG_set_err_string("Invalid backend, backend=%d", backend);
+        return FALSE;
+    }
+
+    if ((backend != DG_LOOP_BACKEND_SIM) &&
+        ((ifname == NULL) || (ifname[0] == '\0') || (strlen(ifname) >= DG_LOOP_IFNAME_MAX)))
+    {
+        DG_DBG_set_err_string("Invalid interface for %s backend, port=%s",
+                              dg_loop_backend_name[backend], dg_loop_port_fd[port].name);
+        return FALSE;
+    }
+
+    mutex = &dg_loop_port_fd[port].mutex;
+    DG_LOOP_MUTEX_LOCK(mutex);
+    if (dg_loop_port_fd[port].ref > 0)
+    {
+        DG_DBG_set_err_string("Can't set backend of the opened port, port=%s",
+                              dg_loop_port_fd[port].name);
+    }
+    else
+    {
+        dg_loop_port_fd[port].op = dg_loop_backend_op[backend];
+        snprintf(dg_loop_port_fd[port].ifname, DG_LOOP_IFNAME_MAX, "%s",
+                 (ifname != NULL) ? ifname : "");
+        ret = TRUE;
+    }
+    DG_LOOP_MUTEX_UNLOCK(mutex);
+
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief get the network interface of the port
+
+@param[in] port - the port
+
+@return the interface name, NULL if the port is invalid or uses the simulation backend
+*//*==============================================================================================*/
+const char* dg_loop_port_ifname(DG_LOOP_PORT_T port)
+{
+    const char* ifname = NULL;
+
+    if ((port < DG_LOOP_PORT_NUM) && (dg_loop_port_fd[port].op != &dg_loop_port_sim_op))
+    {
+        ifname = dg_loop_port_fd[port].ifname;
+    }
+
+    return ifname;
+}
+
 /*=============================================================================================*//**
 @brief open port for send/recv data
 
@@ -411,6 +504,35 @@ BOOL DG_LOOP_recv(int fd, UINT8* buf, UINT32 len)
     return dg_loop_port_fd[index].op->recv(&dg_loop_port_fd[index], len, buf);
 }
 
+/*=============================================================================================*//**
+@brief get the system file descriptor to poll for the received data
+
+@param[in]  fd      - the fd that opened by DG_LOOP_open()
+
+@return the system file descriptor, -1 if error happened
+
+@note
+- if error happened, call DG_DBG_get_err_string() to get the last error
+*//*==============================================================================================*/
+int DG_LOOP_get_poll_fd(int fd)
+{
+    int index = fd;
+
+    if ((index < 0) || (index >= DG_LOOP_PORT_NUM))
+    {
+        DG_DBG_set_err_string("Invalid Port fd to poll, fd=%d", fd);
+        return -1;
+    }
+
+    if (dg_loop_port_fd[index].ref <= 0)
+    {
+        DG_DBG_set_err_string("the fd is closed, fd=%d", fd);
+        return -1;
+    }
+
+    return dg_loop_port_fd[index].rx_fd;
+}
+
 /*==================================================================================================
                                           LOCAL FUNCTIONS
 ==================================================================================================*/
@@ -9,11 +9,18 @@
 ====================================================================================================
                                            INCLUDE FILES
 ==================================================================================================*/
+#include <stdio.h>
 #include <stdlib.h>
-#include <stdint.h>
 #include <string.h>
-#include <pthread.h>
 #include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <net/if.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include "dg_platform_defs.h"
 #include "dg_dbg.h"
 #include "dg_loop.h"
@@ -33,6 +40,13 @@
 #define DG_LOOP_DETECT_HDR_OFFSET  400
 #define DG_LOOP_DETECT_FILL        0xBE
 
+#define DG_LOOP_DETECT_WINDOW_MS 500 /* the whole detection window             */
+#define DG_LOOP_DETECT_ROUNDS    3   /* probe rounds for the undetected ports   */
+#define DG_LOOP_DETECT_DRAIN_MS  10  /* quiet time to drain the late probes     */
+
+#define DG_LOOP_TOPO_VERSION  2   /* the topology cache file format version */
+#define DG_LOOP_TOPO_LINE_MAX 128
+
 /*==================================================================================================
                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
 ==================================================================================================*/
@@ -40,7 +54,14 @@
 /*==================================================================================================
                                      LOCAL FUNCTION PROTOTYPES
 ==================================================================================================*/
-static void* dg_loop_detect_thread(void* arg);
+static BOOL  dg_loop_detect_ports(const BOOL* wanted, const BOOL* awaited);
+static void  dg_loop_detect_send(const int* fd, const BOOL* wanted, UINT8* packet);
+static int   dg_loop_detect_poll(int epoll_fd, const int* fd, UINT8* buf, int time_out);
+static BOOL  dg_loop_detect_done(const int* fd, const BOOL* wanted);
+static UINT32 dg_loop_topo_fingerprint(void);
+static BOOL  dg_loop_topo_load(const char* file, DG_LOOP_PORT_T* rx_port);
+static BOOL  dg_loop_topo_save(const char* file);
+static long  dg_loop_detect_time();
 static BOOL  dg_loop_is_detect_packet(UINT8* buf, UINT8* tx_port, UINT8* rx_port);
 
 /*==================================================================================================
@@ -96,63 +117,97 @@ static DG_LOOP_PORT_PAIR_T dg_loop_detect_info[DG_LOOP_PORT_NUM] =
 *//*==============================================================================================*/
 DG_LOOP_PORT_PAIR_T* DG_LOOP_auto_detect()
 {
-    int       port;
-    int       fd;
-    int       old_dbg_lvl;
-    UINT8*    packet = malloc(DG_LOOP_DETECT_PACKET_SIZE);
-    UINT8*    p_tx   = packet + DG_LOOP_DETECT_HDR_OFFSET;
-    pthread_t detect_thread[DG_LOOP_PORT_NUM] = { 0 };
-
-    if (packet == NULL)
+    BOOL wanted[DG_LOOP_PORT_NUM];
+    int  port;
+
+    for (port = 0; port < DG_LOOP_PORT_NUM; port++)
     {
-        return NULL;
+        wanted[port] = TRUE;
     }
 
-    memset(packet, DG_LOOP_DETECT_FILL, DG_LOOP_DETECT_PACKET_SIZE);
+    return dg_loop_detect_ports(wanted, wanted) ? dg_loop_detect_info : NULL;
+}
 
-    old_dbg_lvl = DG_DBG_get_dbg_level();
-    DG_DBG_set_dbg_level(DG_DBG_LVL_DISABLE);
+/*=============================================================================================*//**
+@brief detect the loop connection with the cached topology
 
-    /* start the detection threads */
-    for (port = 0; port < DG_LOOP_PORT_NUM; port++)
+@param[in] file - the topology cache file
+
+@return the port pair array, NULL if failed
+
+@note
+- if the cache is valid only the cached pairs are waited for, the ports cached as unconnected are
+  probed along with them once, so a port cabled since is found without waiting for the others
+- if any cached pair doesn't match, the ports except the matched pairs are detected again
+- the cache is detected from scratch if it is missing or its fingerprint doesn't match
+- the cache is rewritten if the topology changed
+*//*==============================================================================================*/
+DG_LOOP_PORT_PAIR_T* DG_LOOP_cached_detect(const char* file)
+{
+    DG_LOOP_PORT_T known[DG_LOOP_PORT_NUM];
+    BOOL           wanted[DG_LOOP_PORT_NUM];
+    BOOL           awaited[DG_LOOP_PORT_NUM];
+    BOOL           b_mismatch = FALSE;
+    BOOL           b_changed  = FALSE;
+    int            port;
+
+    if (!dg_loop_topo_load(file, known))
     {
-        if (pthread_create(&detect_thread[port], NULL,
-                           dg_loop_detect_thread, (void*)(intptr_t)port) != 0)
+        DG_DBG_TRACE("no valid topology cache, detect all the ports");
+
+        if (DG_LOOP_auto_detect() == NULL)
         {
-            DG_DBG_ERROR("failed to start detect thread, rx_port=0x%02x, errno=%d(%m)", port, errno);
+            return NULL;
         }
+
+        dg_loop_topo_save(file);
+        return dg_loop_detect_info;
     }
 
-    /* send the detection packet */
+    /* verify the known pairs, the unconnected ports are probed too but not waited for */
     for (port = 0; port < DG_LOOP_PORT_NUM; port++)
     {
-        *p_tx = port;
+        wanted[port]  = TRUE;
+        awaited[port] = (known[port] != 0xFF);
+    }
+
+    if (!dg_loop_detect_ports(wanted, awaited))
+    {
+        return NULL;
+    }
 
-        if ((fd = DG_LOOP_open(port)) < 0)
+    for (port = 0; port < DG_LOOP_PORT_NUM; port++)
+    {
+        if ((known[port] != 0xFF) && (dg_loop_detect_info[port].rx_port != known[port]))
         {
-            DG_DBG_ERROR("failed to open tx port, tx_port=0x%02x", port);
+            DG_DBG_TRACE("port %s doesn't match the cached pair", DG_LOOP_port_name(port));
+            b_mismatch = TRUE;
         }
-        else if (!DG_LOOP_send(fd, packet, DG_LOOP_DETECT_PACKET_SIZE))
+        else if ((known[port] == 0xFF) && (dg_loop_detect_info[port].rx_port != 0xFF))
         {
-            DG_DBG_ERROR("failed to send detection packet, tx_port=0x%02x", port);
+            DG_DBG_TRACE("port %s is connected since the cache", DG_LOOP_port_name(port));
+            b_changed = TRUE;
         }
 
-        if (fd >= 0)
-        {
-            DG_LOOP_close(fd);
-        }
+        wanted[port] = (dg_loop_detect_info[port].rx_port != known[port]) ||
+                       (dg_loop_detect_info[port].rx_port == 0xFF);
     }
 
-    /* wait the detection threads */
-    for (port = 0; port < DG_LOOP_PORT_NUM; port++)
+    /* the cabling changed, detect the ports that don't match again */
+    if (b_mismatch)
     {
-        if (detect_thread[port] != 0)
+        if (!dg_loop_detect_ports(wanted, wanted))
         {
-            pthread_join(detect_thread[port], NULL);
+            return NULL;
         }
+
+        b_changed = TRUE;
     }
 
-    DG_DBG_set_dbg_level(old_dbg_lvl);
+    if (b_changed)
+    {
+        dg_loop_topo_save(file);
+    }
 
     return dg_loop_detect_info;
 }
@@ -162,49 +217,205 @@ DG_LOOP_PORT_PAIR_T* DG_LOOP_auto_detect()
 ==================================================================================================*/
 
 /*=============================================================================================*//**
-@brief recv packet thread function
+@brief detect the loop connection of the wanted tx ports
+
+@param[in] wanted  - the tx ports to detect, the others are kept
+@param[in] awaited - the wanted ports the detection waits for, the others are only found if their
+                     probe comes back before that
 
-@param[in] arg - the test parameter
+@return TRUE if success
 
-@return NULL returned
+@note
+- the wanted ports are probed at the same time and all the ports are polled by one thread
 *//*==============================================================================================*/
-void* dg_loop_detect_thread(void* arg)
+BOOL dg_loop_detect_ports(const BOOL* wanted, const BOOL* awaited)
 {
-    int    fd;
-    UINT32 size     = DG_LOOP_DETECT_PACKET_SIZE;
-    UINT8* recv_buf = NULL;
+    int    port;
+    int    round;
+    int    epoll_fd;
+    int    old_dbg_lvl;
+    long   start;
+    long   deadline;
+    long   now;
+    int    fd[DG_LOOP_PORT_NUM];
+    UINT8* packet   = malloc(DG_LOOP_DETECT_PACKET_SIZE);
+    UINT8* recv_buf = malloc(DG_LOOP_DETECT_PACKET_SIZE);
+
+    struct epoll_event event;
+
+    BOOL ret = FALSE;
+
+    if ((packet == NULL) || (recv_buf == NULL))
+    {
+        DG_DBG_set_err_string("failed to malloc detection buf, size=%d",
+                              DG_LOOP_DETECT_PACKET_SIZE);
+        free(packet);
+        free(recv_buf);
+        return FALSE;
+    }
 
-    DG_LOOP_PORT_T m_port = (DG_LOOP_PORT_T)(intptr_t)arg;
-    DG_LOOP_PORT_T tx_port;
-    DG_LOOP_PORT_T rx_port = m_port;
+    if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+    {
+        DG_DBG_set_err_string("failed to create epoll, errno=%d(%m)", errno);
+        free(packet);
+        free(recv_buf);
+        return FALSE;
+    }
 
-    DG_DBG_TRACE("enter into detect thread: %p", (void*)pthread_self());
+    memset(packet, DG_LOOP_DETECT_FILL, DG_LOOP_DETECT_PACKET_SIZE);
+
+    old_dbg_lvl = DG_DBG_get_dbg_level();
+    DG_DBG_set_dbg_level(DG_DBG_LVL_DISABLE);
 
-    /* open the port for receiving data */
-    if ((fd = DG_LOOP_open(rx_port)) < 0)
+    /* open all the ports once and poll them in this thread */
+    for (port = 0; port < DG_LOOP_PORT_NUM; port++)
     {
-        DG_DBG_ERROR("failed to open recv port, rx_port=0x%02x", rx_port);
-        goto detect_finish;
+        if (wanted[port])
+        {
+            dg_loop_detect_info[port].rx_port = 0xFF;
+        }
+
+        if ((fd[port] = DG_LOOP_open(port)) < 0)
+        {
+            DG_DBG_ERROR("failed to open port, port=0x%02x", port);
+            continue;
+        }
+
+        /* the event carries the port, fd[] maps it back to the opened fd */
+        event.events   = EPOLLIN;
+        event.data.u32 = port;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, DG_LOOP_get_poll_fd(fd[port]), &event) != 0)
+        {
+            DG_DBG_ERROR("failed to poll port, port=0x%02x, errno=%d(%m)", port, errno);
+            DG_LOOP_close(fd[port]);
+            fd[port] = -1;
+        }
     }
 
-    /* prepare the data to send */
-    if ((recv_buf = malloc(size)) == NULL)
+    /* probe the undetected ports in each round, until all detected or out of the window, the
+       first round is always sent for the ports not waited for */
+    start = dg_loop_detect_time();
+    for (round = 1;
+         (round <= DG_LOOP_DETECT_ROUNDS) && ((round == 1) || !dg_loop_detect_done(fd, awaited));
+         round++)
     {
-        DG_DBG_ERROR("failed to malloc recv buf, size=%d", size);
-        goto detect_finish;
+        dg_loop_detect_send(fd, wanted, packet);
+
+        deadline = start + DG_LOOP_DETECT_WINDOW_MS * round / DG_LOOP_DETECT_ROUNDS;
+        while (((now = dg_loop_detect_time()) < deadline) && !dg_loop_detect_done(fd, awaited))
+        {
+            if (dg_loop_detect_poll(epoll_fd, fd, recv_buf, deadline - now) < 0)
+            {
+                goto detect_finish;
+            }
+        }
+    }
+
+    /* drain the repeated probes, so they won't be seen by the following test, a probe of a port
+       not waited for may still come back here */
+    while (dg_loop_detect_poll(epoll_fd, fd, recv_buf, DG_LOOP_DETECT_DRAIN_MS) > 0)
+    {
+    }
+
+    DG_DBG_TRACE("detection finished in %ldms, rounds=%d", dg_loop_detect_time() - start, round);
+    ret = TRUE;
+
+detect_finish:
+    for (port = 0; port < DG_LOOP_PORT_NUM; port++)
+    {
+        if (fd[port] >= 0)
+        {
+            DG_LOOP_close(fd[port]);
+        }
     }
 
-    while (TRUE)
+    close(epoll_fd);
+    free(packet);
+    free(recv_buf);
+
+    DG_DBG_set_dbg_level(old_dbg_lvl);
+
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief send the detection packet on all the wanted and undetected ports
+
+@param[in] fd     - the opened ports, -1 if not opened
+@param[in] wanted - the tx ports to detect
+@param[in] packet - the detection packet
+*//*==============================================================================================*/
+void dg_loop_detect_send(const int* fd, const BOOL* wanted, UINT8* packet)
+{
+    int    port;
+    UINT8* p_tx = packet + DG_LOOP_DETECT_HDR_OFFSET;
+
+    for (port = 0; port < DG_LOOP_PORT_NUM; port++)
     {
+        if ((fd[port] < 0) || !wanted[port] || (dg_loop_detect_info[port].rx_port != 0xFF))
+        {
+            continue;
+        }
+
+        *p_tx = port;
+
+        if (!DG_LOOP_send(fd[port], packet, DG_LOOP_DETECT_PACKET_SIZE))
+        {
+            DG_DBG_ERROR("failed to send detection packet, tx_port=0x%02x", port);
+        }
+    }
+}
+
+/*=============================================================================================*//**
+@brief wait and handle the received detection packets
+
+@param[in] epoll_fd - the epoll fd of all the opened ports
+@param[in] fd       - the opened fd of each port, -1 if not opened
+@param[in] buf      - the buffer to receive data
+@param[in] time_out - the time out in ms
+
+@return the number of ready ports, 0 if time out, -1 if error happened
+*//*==============================================================================================*/
+int dg_loop_detect_poll(int epoll_fd, const int* fd, UINT8* buf, int time_out)
+{
+    struct epoll_event events[DG_LOOP_PORT_NUM];
+
+    int   num;
+    int   i;
+    UINT8 tx_port;
+    UINT8 rx_port;
+
+    DG_LOOP_PORT_T m_port;
+
+    if ((num = epoll_wait(epoll_fd, events, DG_LOOP_PORT_NUM, time_out)) < 0)
+    {
+        if (errno == EINTR)
+        {
+            return 0;
+        }
+
+        DG_DBG_set_err_string("failed to wait epoll, errno=%d(%m)", errno);
+        return -1;
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        m_port = (DG_LOOP_PORT_T)events[i].data.u32;
+        if ((events[i].data.u32 >= DG_LOOP_PORT_NUM) || (fd[m_port] < 0))
+        {
+            DG_DBG_ERROR("epoll event for unknown port, port=0x%02x", events[i].data.u32);
+            continue;
+        }
+
         /* init the buffer with different data first */
-        memset(recv_buf, 0, size);
+        memset(buf, 0, DG_LOOP_DETECT_PACKET_SIZE);
 
-        if (!DG_LOOP_recv(fd, recv_buf, size))
+        if (!DG_LOOP_recv(fd[m_port], buf, DG_LOOP_DETECT_PACKET_SIZE))
         {
             DG_DBG_TRACE("port %s failed to recv packet", DG_LOOP_port_name(m_port));
-            break;
         }
-        else if (!dg_loop_is_detect_packet(recv_buf, &tx_port, &rx_port))
+        else if (!dg_loop_is_detect_packet(buf, &tx_port, &rx_port) ||
+                 (tx_port >= DG_LOOP_PORT_NUM))
         {
             DG_DBG_TRACE("port %s recv wrong packet", DG_LOOP_port_name(m_port));
         }
@@ -219,16 +430,252 @@ void* dg_loop_detect_thread(void* arg)
         }
     }
 
-detect_finish:
-    free(recv_buf);
+    return num;
+}
+
+/*=============================================================================================*//**
+@brief check if all the opened and wanted ports are detected
+
+@param[in] fd     - the opened ports, -1 if not opened
+@param[in] wanted - the tx ports to detect
+
+@return TRUE if all the opened and wanted ports are detected
+*//*==============================================================================================*/
+BOOL dg_loop_detect_done(const int* fd, const BOOL* wanted)
+{
+    int port;
+
+    for (port = 0; port < DG_LOOP_PORT_NUM; port++)
+    {
+        if ((fd[port] >= 0) && wanted[port] && (dg_loop_detect_info[port].rx_port == 0xFF))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/*=============================================================================================*//**
+@brief get the monotonic time
+
+@return the monotonic time in ms
+*//*==============================================================================================*/
+long dg_loop_detect_time()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/*=============================================================================================*//**
+@brief get the fingerprint of the port set and its link state
+
+@return the FNV-1a hash of each port name, its interface, the interface index, the link flags and
+        the MAC address
+
+@note
+- a cache taken with another port layout, other interfaces or another link state is not used
+- the ports of the simulation backend only contribute their names
+*//*==============================================================================================*/
+UINT32 dg_loop_topo_fingerprint(void)
+{
+    UINT32       hash = 2166136261U;
+    const char*  p_ch;
+    const char*  ifname;
+    UINT8*       p_byte;
+    UINT32       size;
+    int          port;
+    int          sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    struct ifreq ifr;
+
+    struct
+    {
+        UINT32 index;
+        UINT32 flags;
+        UINT8  mac[6];
+    } link;
+
+    for (port = 0; port < DG_LOOP_PORT_NUM; port++)
+    {
+        for (p_ch = DG_LOOP_port_name(port); *p_ch != '\0'; p_ch++)
+        {
+            hash = (hash ^ (UINT8)*p_ch) * 16777619U;
+        }
+
+        if ((ifname = dg_loop_port_ifname(port)) == NULL)
+        {
+            continue;
+        }
+
+        memset(&link, 0, sizeof(link));
+        memset(&ifr, 0, sizeof(ifr));
+        snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", ifname);
+
+        /* a missing interface leaves zeros, which is a state of its own */
+        link.index = if_nametoindex(ifname);
+        if ((sock >= 0) && (ioctl(sock, SIOCGIFFLAGS, &ifr) == 0))
+        {
+            link.flags = ifr.ifr_flags & (IFF_UP | IFF_RUNNING);
+        }
+        if ((sock >= 0) && (ioctl(sock, SIOCGIFHWADDR, &ifr) == 0))
+        {
+            memcpy(link.mac, ifr.ifr_hwaddr.sa_data, sizeof(link.mac));
+        }
+
+        for (p_ch = ifname; *p_ch != '\0'; p_ch++)
+        {
+            hash = (hash ^ (UINT8)*p_ch) * 16777619U;
+        }
+        for (p_byte = (UINT8*)&link, size = sizeof(link); size > 0; p_byte++, size--)
+        {
+            hash = (hash ^ *p_byte) * 16777619U;
+        }
+    }
+
+    if (sock >= 0)
+    {
+        close(sock);
+    }
+
+    return hash;
+}
+
+/*=============================================================================================*//**
+@brief load the topology cache
+
+@param[in]  file    - the topology cache file
+@param[out] rx_port - the rx port of each tx port, 0xFF if not connected
+
+@return TRUE if the cache is valid
+
+@note
+- an invalid cache is not an error, it is only traced
+*//*==============================================================================================*/
+BOOL dg_loop_topo_load(const char* file, DG_LOOP_PORT_T* rx_port)
+{
+    FILE*  fp;
+    char   line[DG_LOOP_TOPO_LINE_MAX];
+    char   tx_name[DG_LOOP_TOPO_LINE_MAX];
+    char   rx_name[DG_LOOP_TOPO_LINE_MAX];
+    int    version     = -1;
+    UINT32 fingerprint = 0;
+    int    tx;
+    int    rx;
+    BOOL   ret = TRUE;
+
+    memset(rx_port, 0xFF, DG_LOOP_PORT_NUM * sizeof(DG_LOOP_PORT_T));
+
+    if ((fp = fopen(file, "r")) == NULL)
+    {
+        DG_DBG_TRACE("can't open topology cache %s, errno=%d(%m)", file, errno);
+        return FALSE;
+    }
+
+    while (ret && (fgets(line, sizeof(line), fp) != NULL))
+    {
+        if ((line[0] == '#') || (line[0] == '\n'))
+        {
+            continue;
+        }
+
+        if ((sscanf(line, "version %d", &version) == 1) ||
+            (sscanf(line, "fingerprint %x", &fingerprint) == 1))
+        {
+            continue;
+        }
+
+        if ((sscanf(line, "%s %s", tx_name, rx_name) != 2) ||
+            ((tx = DG_LOOP_get_port(tx_name)) < 0) ||
+            ((rx = DG_LOOP_get_port(rx_name)) < 0))
+        {
+            DG_DBG_TRACE("invalid line in topology cache %s: %s", file, line);
+            ret = FALSE;
+        }
+        else
+        {
+            rx_port[tx] = rx;
+        }
+    }
+
+    fclose(fp);
+
+    if (ret && (version != DG_LOOP_TOPO_VERSION))
+    {
+        DG_DBG_TRACE("unsupported topology cache version %d", version);
+        ret = FALSE;
+    }
+
+    if (ret && (fingerprint != dg_loop_topo_fingerprint()))
+    {
+        DG_DBG_TRACE("ports or links changed since the topology cache, file=0x%08x", fingerprint);
+        ret = FALSE;
+    }
+
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief save the detected topology to the cache
+
+@param[in] file - the topology cache file
+
+@return TRUE if success
+
+@note
+- the cache is written to a new temporary file and renamed, so a reader never sees a partial file
+- mkstemp() creates the temporary file exclusively, a planted file or symlink is never followed
+*//*==============================================================================================*/
+BOOL dg_loop_topo_save(const char* file)
+{
+    char  tmp_file[DG_LOOP_TOPO_LINE_MAX];
+    FILE* fp;
+    int   tmp_fd;
+    int   port;
+
+    if (snprintf(tmp_file, sizeof(tmp_file), "%s.XXXXXX", file) >= (int)sizeof(tmp_file))
+    {
+        DG_DBG_ERROR("topology cache path too long, file=%s", file);
+        return FALSE;
+    }
+
+    if ((tmp_fd = mkstemp(tmp_file)) < 0)
+    {
+        DG_DBG_ERROR("can't create topology cache %s, errno=%d(%m)", tmp_file, errno);
+        return FALSE;
+    }
+
+    if ((fchmod(tmp_fd, 0644) != 0) || ((fp = fdopen(tmp_fd, "w")) == NULL))
+    {
+        DG_DBG_ERROR("can't write topology cache %s, errno=%d(%m)", tmp_file, errno);
+        close(tmp_fd);
+        unlink(tmp_file);
+        return FALSE;
+    }
+
+    fprintf(fp, "# dg_loop detected topology, remove the file to detect again\n");
+    fprintf(fp, "version %d\n", DG_LOOP_TOPO_VERSION);
+    fprintf(fp, "fingerprint %08x\n", dg_loop_topo_fingerprint());
+
+    for (port = 0; port < DG_LOOP_PORT_NUM; port++)
+    {
+        if (dg_loop_detect_info[port].rx_port != 0xFF)
+        {
+            fprintf(fp, "%s %s\n", DG_LOOP_port_name(port),
+                    DG_LOOP_port_name(dg_loop_detect_info[port].rx_port));
+        }
+    }
 
-    if (fd >= 0)
+    if ((fclose(fp) != 0) || (rename(tmp_file, file) != 0))
     {
-        DG_LOOP_close(fd);
+        DG_DBG_ERROR("can't save topology cache %s, errno=%d(%m)", file, errno);
+        unlink(tmp_file);
+        return FALSE;
     }
 
-    DG_DBG_TRACE("leave detect thread: %p", (void*)pthread_self());
-    return NULL;
+    return TRUE;
 }
 
 /*=============================================================================================*//**
@@ -0,0 +1,430 @@
+/*==================================================================================================
+
+    Module Name:  dg_loop_packet.c
+
+    General Description: Implements the AF_PACKET memory mapped ring port backend
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include "dg_platform_defs.h"
+#include "dg_dbg.h"
+#include "dg_loop.h"
+#include "dg_loop_priv.h"
+
+/** @addtogroup libdg_loop
+@{
+*/
+/*==================================================================================================
+                                          LOCAL CONSTANTS
+==================================================================================================*/
+
+/*==================================================================================================
+                                           LOCAL MACROS
+==================================================================================================*/
+/* each ring frame holds one packet up to DG_LOOP_FRAME_MAX */
+#define DG_LOOP_PACKET_FRAME_SIZE 16384
+#define DG_LOOP_PACKET_BLOCK_SIZE (DG_LOOP_PACKET_FRAME_SIZE * 8)
+#define DG_LOOP_PACKET_BLOCK_NUM  32
+#define DG_LOOP_PACKET_FRAME_NUM \
+    (DG_LOOP_PACKET_BLOCK_SIZE / DG_LOOP_PACKET_FRAME_SIZE * DG_LOOP_PACKET_BLOCK_NUM)
+#define DG_LOOP_PACKET_RING_SIZE  (DG_LOOP_PACKET_BLOCK_SIZE * DG_LOOP_PACKET_BLOCK_NUM)
+
+/* the frame data offset in the tx ring */
+#define DG_LOOP_PACKET_TX_DATA_OFFSET (TPACKET2_HDRLEN - sizeof(struct sockaddr_ll))
+
+/*==================================================================================================
+                            LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+/** the ring state of the port */
+typedef struct
+{
+    UINT8* map;      /* the mapped rx ring followed by the tx ring */
+    UINT8* tx_ring;  /* the start of the tx ring                   */
+    int    rx_frame; /* the next rx frame, only used by recv thread */
+    int    tx_frame; /* the next tx frame, only used by send thread */
+    UINT32 skipped;  /* rx frames of other size, only used by recv thread */
+} DG_LOOP_PACKET_RING_T;
+
+/*==================================================================================================
+                                     LOCAL FUNCTION PROTOTYPES
+==================================================================================================*/
+static BOOL dg_loop_open_packet(DG_LOOP_PORT_FD_T* fd);
+static void dg_loop_close_packet(DG_LOOP_PORT_FD_T* fd);
+static BOOL dg_loop_write_packet(DG_LOOP_PORT_FD_T* fd, UINT32 bytes_to_write, UINT8* data);
+static BOOL dg_loop_read_packet(DG_LOOP_PORT_FD_T* fd, UINT32 bytes_to_read, UINT8* data);
+
+/*==================================================================================================
+                                         GLOBAL VARIABLES
+==================================================================================================*/
+DG_LOOP_PORT_OP_T dg_loop_port_packet_op =
+{
+    dg_loop_open_packet, dg_loop_close_packet, dg_loop_write_packet, dg_loop_read_packet
+};
+
+/*==================================================================================================
+                                          LOCAL VARIABLES
+==================================================================================================*/
+
+/*==================================================================================================
+                                         GLOBAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief open a raw AF_PACKET socket on the network interface
+
+@param[in] ifname - the network interface
+
+@return the socket, -1 if error happened
+
+@note
+- the interface is set to promiscuous mode and the outgoing frames are not received
+- if error happened, call DG_DBG_get_err_string() to get the last error
+*//*==============================================================================================*/
+int dg_loop_packet_socket(const char* ifname)
+{
+    int                sock;
+    int                one = 1;
+    struct sockaddr_ll addr;
+    struct packet_mreq mreq;
+
+    if ((sock = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL))) < 0)
+    {
+        DG_DBG_set_err_string("Failed to create packet socket, errno=%d(%m)", errno);
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family   = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex  = if_nametoindex(ifname);
+
+    if (addr.sll_ifindex == 0)
+    {
+        DG_DBG_set_err_string("Unknown interface %s, errno=%d(%m)", ifname, errno);
+        close(sock);
+        return -1;
+    }
+
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        DG_DBG_set_err_string("Failed to bind packet socket to %s, errno=%d(%m)", ifname, errno);
+        close(sock);
+        return -1;
+    }
+
+    /* the test frames don't carry the interface MAC address */
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.mr_ifindex = addr.sll_ifindex;
+    mreq.mr_type    = PACKET_MR_PROMISC;
+    if (setsockopt(sock, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0)
+    {
+        DG_DBG_ERROR("Failed to set %s promiscuous, errno=%d(%m)", ifname, errno);
+    }
+
+    /* the frames sent by the port itself are filtered again in the recv path if unsupported */
+    setsockopt(sock, SOL_PACKET, PACKET_IGNORE_OUTGOING, &one, sizeof(one));
+
+    return sock;
+}
+
+/*=============================================================================================*//**
+@brief get the time left to receive a frame
+
+@param[in,out] deadline - the monotonic deadline in ms, 0 to start DG_LOOP_RECV_TIMEOUT from now
+
+@return the ms left, 0 if the deadline has passed
+*//*==============================================================================================*/
+int dg_loop_recv_time_left(long* deadline)
+{
+    struct timespec now;
+    long            now_ms;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    now_ms = now.tv_sec * 1000 + now.tv_nsec / 1000000;
+
+    if (*deadline == 0)
+    {
+        *deadline = now_ms + DG_LOOP_RECV_TIMEOUT;
+    }
+
+    return (*deadline > now_ms) ? (int)(*deadline - now_ms) : 0;
+}
+
+/*==================================================================================================
+                                          LOCAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief open packet ring port implementation
+
+@param[out] fd - the fd
+
+@return TRUE if success
+
+@note
+- one socket with a TPACKET_V2 rx ring and tx ring, both mapped in one area
+- if error happened, call DG_DBG_get_err_string() to get the last error
+*//*==============================================================================================*/
+static BOOL dg_loop_open_packet(DG_LOOP_PORT_FD_T* fd)
+{
+    int                    sock;
+    int                    version = TPACKET_V2;
+    struct tpacket_req     req;
+    DG_LOOP_PACKET_RING_T* ring;
+
+    if ((ring = calloc(1, sizeof(DG_LOOP_PACKET_RING_T))) == NULL)
+    {
+        DG_DBG_set_err_string("Failed to malloc ring, port=%s", fd->name);
+        return FALSE;
+    }
+
+    if ((sock = dg_loop_packet_socket(fd->ifname)) < 0)
+    {
+        free(ring);
+        return FALSE;
+    }
+
+    /* the same layout for both rings */
+    req.tp_block_size = DG_LOOP_PACKET_BLOCK_SIZE;
+    req.tp_block_nr   = DG_LOOP_PACKET_BLOCK_NUM;
+    req.tp_frame_size = DG_LOOP_PACKET_FRAME_SIZE;
+    req.tp_frame_nr   = DG_LOOP_PACKET_FRAME_NUM;
+
+    if ((setsockopt(sock, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0) ||
+        (setsockopt(sock, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) != 0) ||
+        (setsockopt(sock, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) != 0))
+    {
+        DG_DBG_set_err_string("Failed to setup packet ring, port=%s, errno=%d(%m)",
+                              fd->name, errno);
+        close(sock);
+        free(ring);
+        return FALSE;
+    }
+
+    ring->map = mmap(NULL, DG_LOOP_PACKET_RING_SIZE * 2, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_LOCKED | MAP_POPULATE, sock, 0);
+    if (ring->map == MAP_FAILED)
+    {
+        /* MAP_LOCKED needs the memlock limit */
+        ring->map = mmap(NULL, DG_LOOP_PACKET_RING_SIZE * 2, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, sock, 0);
+    }
+
+    if (ring->map == MAP_FAILED)
+    {
+        DG_DBG_set_err_string("Failed to map packet ring, port=%s, errno=%d(%m)", fd->name, errno);
+        close(sock);
+        free(ring);
+        return FALSE;
+    }
+
+    ring->tx_ring = ring->map + DG_LOOP_PACKET_RING_SIZE;
+
+    DG_DBG_TRACE("port=%s opened on %s with packet ring", fd->name, fd->ifname);
+
+    fd->tx_fd = sock;
+    fd->rx_fd = sock;
+    fd->priv  = ring;
+
+    return TRUE;
+}
+
+/*=============================================================================================*//**
+@brief close packet ring port implementation
+
+@param[in] fd - the fd
+
+@note
+- the number of skipped rx frames of other size is reported
+*//*==============================================================================================*/
+static void dg_loop_close_packet(DG_LOOP_PORT_FD_T* fd)
+{
+    DG_LOOP_PACKET_RING_T* ring = fd->priv;
+
+    if (ring != NULL)
+    {
+        if (ring->skipped > 0)
+        {
+            DG_DBG_WARN("port=%s skipped %u rx frames of other size", fd->name, ring->skipped);
+        }
+
+        munmap(ring->map, DG_LOOP_PACKET_RING_SIZE * 2);
+        free(ring);
+        fd->priv = NULL;
+    }
+
+    if (fd->tx_fd >= 0)
+    {
+        close(fd->tx_fd);
+    }
+
+    fd->tx_fd = -1;
+    fd->rx_fd = -1;
+}
+
+/*=============================================================================================*//**
+@brief Writes one frame to the packet ring
+
+@param[in] fd             - The port fd
+@param[in] bytes_to_write - The number of bytes to write
+@param[in] data           - Data to write
+
+@return TRUE = success, FALSE = failure
+
+@note
+ - the frame is copied into the ring and the kernel is kicked without waiting for the sending
+*//*==============================================================================================*/
+static BOOL dg_loop_write_packet(DG_LOOP_PORT_FD_T* fd, UINT32 bytes_to_write, UINT8* data)
+{
+    DG_LOOP_PACKET_RING_T* ring = fd->priv;
+    struct tpacket2_hdr*   hdr;
+    struct pollfd          pfd;
+    int                    ret;
+
+    if (bytes_to_write > DG_LOOP_FRAME_MAX)
+    {
+        DG_DBG_set_err_string("Frame is too big, port=%s, size=%u", fd->name, bytes_to_write);
+        return FALSE;
+    }
+
+    hdr = (struct tpacket2_hdr*)(ring->tx_ring + ring->tx_frame * DG_LOOP_PACKET_FRAME_SIZE);
+
+    /* wait the kernel to release the frame */
+    while (__atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE) != TP_STATUS_AVAILABLE)
+    {
+        if (__atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE) & TP_STATUS_WRONG_FORMAT)
+        {
+            DG_DBG_ERROR("Wrong frame format in tx ring, port=%s", fd->name);
+            __atomic_store_n(&hdr->tp_status, TP_STATUS_AVAILABLE, __ATOMIC_RELEASE);
+            break;
+        }
+
+        pfd.fd     = fd->tx_fd;
+        pfd.events = POLLOUT;
+        if ((ret = poll(&pfd, 1, DG_LOOP_RECV_TIMEOUT)) == 0)
+        {
+            DG_DBG_ERROR("tx ring is full, port=%s", fd->name);
+            return FALSE;
+        }
+        else if ((ret < 0) && (errno != EINTR))
+        {
+            DG_DBG_ERROR("Failed to poll tx ring, port=%s, errno=%d(%m)", fd->name, errno);
+            return FALSE;
+        }
+    }
+
+    memcpy((UINT8*)hdr + DG_LOOP_PACKET_TX_DATA_OFFSET, data, bytes_to_write);
+    hdr->tp_len     = bytes_to_write;
+    hdr->tp_snaplen = bytes_to_write;
+    __atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+
+    ring->tx_frame = (ring->tx_frame + 1) % DG_LOOP_PACKET_FRAME_NUM;
+
+    /* kick the kernel to send all the pending frames */
+    if ((send(fd->tx_fd, NULL, 0, MSG_DONTWAIT) < 0) && (errno != EAGAIN) && (errno != ENOBUFS))
+    {
+        DG_DBG_ERROR("Failed to kick tx ring, port=%s, errno=%d(%m)", fd->name, errno);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*=============================================================================================*//**
+@brief Reads one frame of the specified size from the packet ring
+
+@param[in]  fd            - port fd
+@param[in]  bytes_to_read - The number of bytes to read
+@param[out] data          - Data read
+
+@return TRUE = success, FALSE = failure
+
+@note
+ - the frames of other size and the frames sent by the port itself are skipped, the frames of
+   other size are counted and reported when the port is closed
+ - poll is only called when the next frame is still owned by the kernel
+ - the timeout runs from the first wait or skipped frame, so a steady flow of other frames can't
+   hold the read forever
+*//*==============================================================================================*/
+static BOOL dg_loop_read_packet(DG_LOOP_PORT_FD_T* fd, UINT32 bytes_to_read, UINT8* data)
+{
+    DG_LOOP_PACKET_RING_T* ring = fd->priv;
+    struct tpacket2_hdr*   hdr;
+    struct sockaddr_ll*    addr;
+    struct pollfd          pfd;
+    long                   deadline = 0;
+    int                    time_left;
+    int                    ret;
+    BOOL                   b_found  = FALSE;
+
+    while (!b_found)
+    {
+        hdr = (struct tpacket2_hdr*)(ring->map + ring->rx_frame * DG_LOOP_PACKET_FRAME_SIZE);
+
+        /* wait the kernel to hand over the frame */
+        if (!(__atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+        {
+            pfd.fd     = fd->rx_fd;
+            pfd.events = POLLIN | POLLERR;
+            if (((time_left = dg_loop_recv_time_left(&deadline)) == 0) ||
+                ((ret = poll(&pfd, 1, time_left)) == 0))
+            {
+                DG_DBG_ERROR("read timeout occurred!");
+                return FALSE;
+            }
+            else if ((ret < 0) && (errno != EINTR))
+            {
+                DG_DBG_ERROR("Failed to poll rx ring, port=%s, errno=%d(%m)", fd->name, errno);
+                return FALSE;
+            }
+            continue;
+        }
+
+        addr = (struct sockaddr_ll*)((UINT8*)hdr + TPACKET_ALIGN(sizeof(*hdr)));
+
+        if (addr->sll_pkttype == PACKET_OUTGOING)
+        {
+            /* sent by the port itself */
+        }
+        else if (hdr->tp_snaplen == bytes_to_read)
+        {
+            memcpy(data, (UINT8*)hdr + hdr->tp_mac, bytes_to_read);
+            b_found = TRUE;
+        }
+        else
+        {
+            ring->skipped++;
+        }
+
+        /* give the frame back to the kernel */
+        __atomic_store_n(&hdr->tp_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        ring->rx_frame = (ring->rx_frame + 1) % DG_LOOP_PACKET_FRAME_NUM;
+
+        if (!b_found && (dg_loop_recv_time_left(&deadline) == 0))
+        {
+            DG_DBG_ERROR("read timeout occurred!");
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/** @} */
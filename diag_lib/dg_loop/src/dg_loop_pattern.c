@@ -0,0 +1,632 @@
+/*==================================================================================================
+
+    Module Name:  dg_loop_pattern.c
+
+    General Description: Implements the packet data pattern generation and verification
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <endian.h>
+#include <math.h>
+#include "dg_platform_defs.h"
+#include "dg_dbg.h"
+#include "dg_loop.h"
+#include "dg_loop_priv.h"
+
+/** @addtogroup libdg_loop
+@{
+*/
+/*==================================================================================================
+                                          LOCAL CONSTANTS
+==================================================================================================*/
+
+/*==================================================================================================
+                                           LOCAL MACROS
+==================================================================================================*/
+#define DG_LOOP_WORD_SIZE     sizeof(UINT64)
+#define DG_LOOP_WORD_BYTES(x) ((UINT64)(x) * 0x0101010101010101ULL)
+
+/* a word with more error bits than this means the PRBS checker lost the synchronization */
+#define DG_LOOP_PRBS_SYNC_LOSS_BITS 16
+
+/* z value of the 95% confidence level */
+#define DG_LOOP_BER_CONFIDENCE_Z 1.96
+
+/*==================================================================================================
+                            LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+/** PRBS polynomial x^len + x^tap + 1 */
+typedef struct
+{
+    UINT32 len;     /* the polynomial order                         */
+    UINT32 tap;     /* the feedback tap                             */
+    UINT32 far_len; /* the order of the 2^n power of the polynomial */
+    UINT32 far_tap; /* the tap of the 2^n power of the polynomial   */
+} DG_LOOP_PRBS_POLY_T;
+
+/** PRBS generator */
+typedef struct
+{
+    const DG_LOOP_PRBS_POLY_T* poly;      /* the polynomial               */
+    UINT64                     prev;      /* the word before the last one */
+    UINT64                     last;      /* the last generated word      */
+    BOOL                       b_pending; /* last word is not output yet  */
+} DG_LOOP_PRBS_T;
+
+/** the word generator state of one pattern */
+typedef struct
+{
+    DG_LOOP_PATTERN_T type; /* the pattern type                  */
+    UINT64            word; /* the next word for fixed/increment */
+    UINT64            seed; /* random generator state            */
+    DG_LOOP_PRBS_T    prbs; /* prbs generator state              */
+} DG_LOOP_PATTERN_GEN_T;
+
+/*==================================================================================================
+                                     LOCAL FUNCTION PROTOTYPES
+==================================================================================================*/
+static void   dg_loop_pattern_gen_init(DG_LOOP_PATTERN_GEN_T* gen, DG_LOOP_PATTERN_T type,
+                                       UINT8 seed);
+static UINT64 dg_loop_pattern_gen_next(DG_LOOP_PATTERN_GEN_T* gen);
+static UINT32 dg_loop_pattern_bit_count(UINT64 value);
+static void   dg_loop_prbs_init(DG_LOOP_PRBS_T* prbs, const DG_LOOP_PRBS_POLY_T* poly, UINT8 seed);
+static void   dg_loop_prbs_sync(DG_LOOP_PRBS_T* prbs, const DG_LOOP_PRBS_POLY_T* poly, UINT64 word);
+static UINT64 dg_loop_prbs_next(DG_LOOP_PRBS_T* prbs);
+static UINT64 dg_loop_prbs_step(UINT64 hist, const DG_LOOP_PRBS_POLY_T* poly);
+static UINT64 dg_loop_prbs_load(const UINT8* buf, UINT32 size);
+
+/*==================================================================================================
+                                         GLOBAL VARIABLES
+==================================================================================================*/
+
+/*==================================================================================================
+                                          LOCAL VARIABLES
+==================================================================================================*/
+static const char* dg_loop_pattern_names[DG_LOOP_PATTERN_NUM] =
+{
+    [DG_LOOP_PATTERN_FIXED]     = "fixed",
+    [DG_LOOP_PATTERN_INCREMENT] = "inc",
+    [DG_LOOP_PATTERN_RANDOM]    = "random",
+    [DG_LOOP_PATTERN_PRBS31]    = "prbs31",
+    [DG_LOOP_PATTERN_PRBS7]     = "prbs7",
+    [DG_LOOP_PATTERN_PRBS15]    = "prbs15",
+    [DG_LOOP_PATTERN_PRBS23]    = "prbs23",
+};
+
+/* ITU-T O.150 polynomials, zero for non PRBS pattern
+   the far taps are chosen >= 64 so the next 64 bits only depend on the last 128 bits */
+static const DG_LOOP_PRBS_POLY_T dg_loop_prbs_poly[DG_LOOP_PATTERN_NUM] =
+{
+    [DG_LOOP_PATTERN_PRBS7]  = { 7,  6,  7 * 16, 6 * 16 },
+    [DG_LOOP_PATTERN_PRBS15] = { 15, 14, 15 * 8, 14 * 8 },
+    [DG_LOOP_PATTERN_PRBS23] = { 23, 18, 23 * 4, 18 * 4 },
+    [DG_LOOP_PATTERN_PRBS31] = { 31, 28, 31 * 4, 28 * 4 },
+};
+
+/*==================================================================================================
+                                         GLOBAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief get the pattern type
+
+@param[in]  name - the pattern type name
+
+@return -1 if invalid, otherwise the pattern type
+*//*==============================================================================================*/
+int DG_LOOP_get_pattern(const char* name)
+{
+    int type = 0;
+    while (type < DG_LOOP_PATTERN_NUM)
+    {
+        if (strcasecmp(name, dg_loop_pattern_names[type]) == 0)
+        {
+            return type;
+        }
+
+        type++;
+    }
+
+    DG_DBG_set_err_string("Invalid pattern type name: %s", name);
+    return -1;
+}
+
+/*=============================================================================================*//**
+@brief get the pattern type name
+
+@param[in]  type - the pattern type
+
+@return NULL if invalid, otherwise the name of the pattern type
+*//*==============================================================================================*/
+const char* DG_LOOP_pattern_name(DG_LOOP_PATTERN_T type)
+{
+    if (type >= DG_LOOP_PATTERN_NUM)
+    {
+        DG_DBG_set_err_string("Invalid pattern type: %d", type);
+        return NULL;
+    }
+
+    return dg_loop_pattern_names[type];
+}
+
+/*=============================================================================================*//**
+@brief fill the buffer with the data pattern
+
+@param[out] buf  - the buffer to fill
+@param[in]  size - the buffer size
+@param[in]  type - the pattern type
+@param[in]  seed - the pattern value, used as the seed for generated patterns
+
+@note
+- the buffer is filled one 64-bit word at a time
+- the same type and seed always generate the same data
+*//*==============================================================================================*/
+void DG_LOOP_fill_pattern(UINT8* buf, UINT32 size, DG_LOOP_PATTERN_T type, UINT8 seed)
+{
+    DG_LOOP_PATTERN_GEN_T gen;
+    UINT64                word;
+    UINT32                offset = 0;
+
+    if (type == DG_LOOP_PATTERN_FIXED)
+    {
+        memset(buf, seed, size);
+        return;
+    }
+
+    dg_loop_pattern_gen_init(&gen, type, seed);
+
+    while (offset + DG_LOOP_WORD_SIZE <= size)
+    {
+        word = dg_loop_pattern_gen_next(&gen);
+        memcpy(buf + offset, &word, DG_LOOP_WORD_SIZE);
+        offset += DG_LOOP_WORD_SIZE;
+    }
+
+    if (offset < size)
+    {
+        word = dg_loop_pattern_gen_next(&gen);
+        memcpy(buf + offset, &word, size - offset);
+    }
+}
+
+/*=============================================================================================*//**
+@brief compare the received data with the expected pattern data
+
+@param[in]  buf    - the received data
+@param[in]  expect - the expected data generated by DG_LOOP_fill_pattern()
+@param[in]  size   - the data size
+@param[out] check  - the first mismatched offset and the number of mismatched bits
+
+@return TRUE if the data match
+
+@note
+- the data is compared one 64-bit word at a time when both buffers have the same alignment
+*//*==============================================================================================*/
+BOOL DG_LOOP_check_pattern(const UINT8* buf, const UINT8* expect, UINT32 size,
+                           DG_LOOP_PATTERN_CHECK_T* check)
+{
+    UINT32 offset = 0;
+    UINT64 diff;
+
+    check->offset    = size;
+    check->bit_error = 0;
+    check->bit_count = size * 8;
+    check->sync_loss = 0;
+
+    if ((((uintptr_t)buf ^ (uintptr_t)expect) & (DG_LOOP_WORD_SIZE - 1)) == 0)
+    {
+        /* compare the head bytes until the buffer is word aligned */
+        while ((offset < size) && (((uintptr_t)(buf + offset) & (DG_LOOP_WORD_SIZE - 1)) != 0))
+        {
+            if ((diff = buf[offset] ^ expect[offset]) != 0)
+            {
+                if (check->offset == size)
+                {
+                    check->offset = offset;
+                }
+                check->bit_error += dg_loop_pattern_bit_count(diff);
+            }
+            offset++;
+        }
+
+        while (offset + DG_LOOP_WORD_SIZE <= size)
+        {
+            diff = *(const UINT64*)(buf + offset) ^ *(const UINT64*)(expect + offset);
+            if (diff != 0)
+            {
+                if (check->offset == size)
+                {
+                    /* find out the first wrong byte in the word */
+                    check->offset = offset;
+                    while (buf[check->offset] == expect[check->offset])
+                    {
+                        check->offset++;
+                    }
+                }
+                check->bit_error += dg_loop_pattern_bit_count(diff);
+            }
+            offset += DG_LOOP_WORD_SIZE;
+        }
+    }
+
+    /* compare the tail bytes, or all the bytes if the alignment is different */
+    while (offset < size)
+    {
+        if ((diff = buf[offset] ^ expect[offset]) != 0)
+        {
+            if (check->offset == size)
+            {
+                check->offset = offset;
+            }
+            check->bit_error += dg_loop_pattern_bit_count(diff);
+        }
+        offset++;
+    }
+
+    return check->bit_error == 0;
+}
+
+/*=============================================================================================*//**
+@brief check if the pattern type is a PRBS pattern
+
+@param[in]  type - the pattern type
+
+@return TRUE if it is a PRBS pattern
+*//*==============================================================================================*/
+BOOL DG_LOOP_is_prbs(DG_LOOP_PATTERN_T type)
+{
+    return (type < DG_LOOP_PATTERN_NUM) && (dg_loop_prbs_poly[type].len != 0);
+}
+
+/*=============================================================================================*//**
+@brief check the received data with the self-synchronizing PRBS checker
+
+@param[in]  buf   - the received data
+@param[in]  size  - the data size
+@param[in]  type  - the PRBS pattern type
+@param[out] check - the check result
+
+@return TRUE if the data match
+
+@note
+- the checker synchronizes on the first 64 bits of the data, so the seed is not required
+- the checker re-synchronizes when a 64-bit word has too many errors, sync_loss is counted
+- the bits used for synchronization are not counted in check->bit_count
+*//*==============================================================================================*/
+BOOL DG_LOOP_check_prbs(const UINT8* buf, UINT32 size, DG_LOOP_PATTERN_T type,
+                        DG_LOOP_PATTERN_CHECK_T* check)
+{
+    DG_LOOP_PRBS_T prbs;
+    UINT32         offset = DG_LOOP_WORD_SIZE;
+    UINT64         expect;
+    UINT32         bytes;
+    UINT32         errors;
+    UINT64         mask;
+    UINT64         word;
+    UINT64         diff;
+
+    check->offset    = size;
+    check->bit_error = 0;
+    check->bit_count = 0;
+    check->sync_loss = 0;
+
+    if (!DG_LOOP_is_prbs(type))
+    {
+        DG_DBG_set_err_string("Invalid PRBS pattern type: %d", type);
+        return FALSE;
+    }
+
+    if (size <= DG_LOOP_WORD_SIZE)
+    {
+        /* nothing left to check after the synchronization */
+        return TRUE;
+    }
+
+    /* synchronize the local generator on the first word */
+    dg_loop_prbs_sync(&prbs, &dg_loop_prbs_poly[type], dg_loop_prbs_load(buf, DG_LOOP_WORD_SIZE));
+
+    while (offset < size)
+    {
+        bytes  = (size - offset < DG_LOOP_WORD_SIZE) ? (size - offset) : DG_LOOP_WORD_SIZE;
+        mask   = ~0ULL << ((DG_LOOP_WORD_SIZE - bytes) * 8);
+        word   = dg_loop_prbs_load(buf + offset, bytes);
+        expect = dg_loop_prbs_next(&prbs);
+        diff   = (word ^ expect) & mask;
+        errors = dg_loop_pattern_bit_count(diff);
+
+        if (errors > DG_LOOP_PRBS_SYNC_LOSS_BITS)
+        {
+            /* out of sync, take the received word as the new generator state */
+            check->sync_loss++;
+            dg_loop_prbs_sync(&prbs, prbs.poly, word);
+        }
+        else
+        {
+            if ((diff != 0) && (check->offset == size))
+            {
+                check->offset = offset;
+                while ((diff & 0xFF00000000000000ULL) == 0)
+                {
+                    check->offset++;
+                    diff <<= 8;
+                }
+            }
+            check->bit_error += errors;
+            check->bit_count += bytes * 8;
+        }
+
+        offset += bytes;
+    }
+
+    return (check->bit_error == 0) && (check->sync_loss == 0);
+}
+
+/*=============================================================================================*//**
+@brief calculate the bit error rate of the test result
+
+@param[in]  result - the test result
+@param[out] ber    - the bit error rate and its 95% confidence bounds
+
+@note
+- the bounds are the Wilson score interval, so they are valid even if no error found
+*//*==============================================================================================*/
+void DG_LOOP_get_ber(const DG_LOOP_TEST_STATISTIC_T* result, DG_LOOP_BER_T* ber)
+{
+    double n = (double)result->total_bit;
+    double z = DG_LOOP_BER_CONFIDENCE_Z;
+    double center;
+    double half;
+    double denom;
+
+    if (result->total_bit == 0)
+    {
+        ber->ber   = 0;
+        ber->lower = 0;
+        ber->upper = 1;
+        return;
+    }
+
+    ber->ber = (double)result->bit_error / n;
+
+    denom  = 1 + z * z / n;
+    center = (ber->ber + z * z / (2 * n)) / denom;
+    half   = z * sqrt(ber->ber * (1 - ber->ber) / n + z * z / (4 * n * n)) / denom;
+
+    ber->lower = ((result->bit_error != 0) && (center > half)) ? (center - half) : 0;
+    ber->upper = center + half;
+}
+
+/*==================================================================================================
+                                          LOCAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief init the word generator of the pattern
+
+@param[out] gen  - the generator
+@param[in]  type - the pattern type
+@param[in]  seed - the pattern value
+*//*==============================================================================================*/
+void dg_loop_pattern_gen_init(DG_LOOP_PATTERN_GEN_T* gen, DG_LOOP_PATTERN_T type, UINT8 seed)
+{
+    UINT8 bytes[DG_LOOP_WORD_SIZE];
+    int   i;
+
+    memset(gen, 0, sizeof(*gen));
+    gen->type = type;
+
+    switch (type)
+    {
+    case DG_LOOP_PATTERN_INCREMENT:
+        for (i = 0; i < (int)DG_LOOP_WORD_SIZE; i++)
+        {
+            bytes[i] = (UINT8)(seed + i);
+        }
+        memcpy(&gen->word, bytes, DG_LOOP_WORD_SIZE);
+        break;
+
+    case DG_LOOP_PATTERN_RANDOM:
+        /* xorshift state must not be zero */
+        gen->seed = DG_LOOP_WORD_BYTES(seed) ^ 0x9E3779B97F4A7C15ULL;
+        break;
+
+    case DG_LOOP_PATTERN_PRBS7:
+    case DG_LOOP_PATTERN_PRBS15:
+    case DG_LOOP_PATTERN_PRBS23:
+    case DG_LOOP_PATTERN_PRBS31:
+        dg_loop_prbs_init(&gen->prbs, &dg_loop_prbs_poly[type], seed);
+        break;
+
+    default:
+        gen->word = DG_LOOP_WORD_BYTES(seed);
+        break;
+    }
+}
+
+/*=============================================================================================*//**
+@brief generate the next word of the pattern
+
+@param[in,out] gen - the generator
+
+@return the next 8 bytes of the pattern in memory order
+*//*==============================================================================================*/
+UINT64 dg_loop_pattern_gen_next(DG_LOOP_PATTERN_GEN_T* gen)
+{
+    UINT64 word = gen->word;
+
+    switch (gen->type)
+    {
+    case DG_LOOP_PATTERN_INCREMENT:
+        /* add 8 to each byte lane without carry into the next lane */
+        gen->word = ((word & DG_LOOP_WORD_BYTES(0x7F)) + DG_LOOP_WORD_BYTES(DG_LOOP_WORD_SIZE)) ^
+                    (word & DG_LOOP_WORD_BYTES(0x80));
+        break;
+
+    case DG_LOOP_PATTERN_RANDOM:
+        gen->seed ^= gen->seed << 13;
+        gen->seed ^= gen->seed >> 7;
+        gen->seed ^= gen->seed << 17;
+        word       = gen->seed;
+        break;
+
+    case DG_LOOP_PATTERN_PRBS7:
+    case DG_LOOP_PATTERN_PRBS15:
+    case DG_LOOP_PATTERN_PRBS23:
+    case DG_LOOP_PATTERN_PRBS31:
+        /* the bit stream is sent MSB first */
+        word = htobe64(dg_loop_prbs_next(&gen->prbs));
+        break;
+
+    default:
+        break;
+    }
+
+    return word;
+}
+
+/*=============================================================================================*//**
+@brief count the set bits of the value
+
+@param[in] value - the value
+
+@return the number of set bits
+*//*==============================================================================================*/
+UINT32 dg_loop_pattern_bit_count(UINT64 value)
+{
+    value = value - ((value >> 1) & 0x5555555555555555ULL);
+    value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+
+    return (UINT32)((value * 0x0101010101010101ULL) >> 56);
+}
+
+/*=============================================================================================*//**
+@brief init the PRBS generator
+
+@param[out] prbs - the generator
+@param[in]  poly - the polynomial
+@param[in]  seed - the seed of the initial state
+*//*==============================================================================================*/
+void dg_loop_prbs_init(DG_LOOP_PRBS_T* prbs, const DG_LOOP_PRBS_POLY_T* poly, UINT8 seed)
+{
+    UINT64 state = (DG_LOOP_WORD_BYTES(seed) ^ 0x5555555555555555ULL) & ((1ULL << poly->len) - 1);
+
+    /* all zero state would lock the generator */
+    if (state == 0)
+    {
+        state = 1;
+    }
+
+    dg_loop_prbs_sync(prbs, poly, dg_loop_prbs_step(state, poly));
+}
+
+/*=============================================================================================*//**
+@brief synchronize the PRBS generator on a known word of the stream
+
+@param[out] prbs - the generator
+@param[in]  poly - the polynomial
+@param[in]  word - the 64 bits of the stream, the first bit in the MSB
+
+@note
+- the next generated word is the 64 bits following the word
+*//*==============================================================================================*/
+void dg_loop_prbs_sync(DG_LOOP_PRBS_T* prbs, const DG_LOOP_PRBS_POLY_T* poly, UINT64 word)
+{
+    prbs->poly      = poly;
+    prbs->prev      = word;
+    prbs->last      = dg_loop_prbs_step(word, poly);
+    prbs->b_pending = TRUE;
+}
+
+/*=============================================================================================*//**
+@brief generate the next 64 bits of the PRBS stream
+
+@param[in,out] prbs - the generator
+
+@return the next 64 bits, the first generated bit in the MSB
+
+@note
+- the power polynomial gives bit[k] = bit[k - far_len] ^ bit[k - far_tap], with far_tap >= 64 and
+  far_len <= 128 the whole word is generated from the last two words in one step
+*//*==============================================================================================*/
+UINT64 dg_loop_prbs_next(DG_LOOP_PRBS_T* prbs)
+{
+    UINT32 shift_len = prbs->poly->far_len - 64;
+    UINT32 shift_tap = prbs->poly->far_tap - 64;
+    UINT64 word;
+
+    if (prbs->b_pending)
+    {
+        prbs->b_pending = FALSE;
+        return prbs->last;
+    }
+
+    /* shift the 128 bits history (prev:last) right */
+    word = (prbs->last >> shift_len) | (prbs->prev << (64 - shift_len));
+    word ^= (shift_tap == 0) ? prbs->last :
+            ((prbs->last >> shift_tap) | (prbs->prev << (64 - shift_tap)));
+
+    prbs->prev = prbs->last;
+    prbs->last = word;
+
+    return word;
+}
+
+/*=============================================================================================*//**
+@brief generate the 64 bits following the history bits with the original polynomial
+
+@param[in] hist - the history bits, the newest in bit 0
+@param[in] poly - the polynomial
+
+@return the next 64 bits, the first generated bit in the MSB
+
+@note
+- bit[k] = bit[k - len] ^ bit[k - tap], so up to tap bits are generated in one step
+*//*==============================================================================================*/
+UINT64 dg_loop_prbs_step(UINT64 hist, const DG_LOOP_PRBS_POLY_T* poly)
+{
+    UINT64 word = 0;
+    UINT64 bits;
+    UINT32 left = 64;
+    UINT32 chunk;
+
+    while (left > 0)
+    {
+        chunk = (left < poly->tap) ? left : poly->tap;
+        bits  = ((hist >> (poly->len - chunk)) ^ (hist >> (poly->tap - chunk))) &
+                ((1ULL << chunk) - 1);
+
+        hist = (hist << chunk) | bits;
+        word = (word << chunk) | bits;
+        left -= chunk;
+    }
+
+    return word;
+}
+
+/*=============================================================================================*//**
+@brief load the PRBS bits from the buffer
+
+@param[in] buf  - the data buffer
+@param[in] size - the bytes to load, no more than 8
+
+@return the loaded bits, the first bit in the MSB
+*//*==============================================================================================*/
+UINT64 dg_loop_prbs_load(const UINT8* buf, UINT32 size)
+{
+    UINT64 word = 0;
+
+    memcpy(&word, buf, size);
+
+    return be64toh(word);
+}
+
+/** @} */
+
@@ -11,6 +11,7 @@
 ====================================================================================================
                                            INCLUDE FILES
 ==================================================================================================*/
+#include <pthread.h>
 
 /** @addtogroup libdg_loop
 @{
@@ -30,6 +31,18 @@ extern "C" {
     pthread_mutex_unlock(x); \
     pthread_cleanup_pop(0)
 
+/* seqlock write side of DG_LOOP_TEST_COUNTER_T, only one writer thread for each counter block */
+#define DG_LOOP_COUNTER_WRITE_BEGIN(cnt) \
+    __atomic_store_n(&(cnt)->seq, (cnt)->seq + 1, __ATOMIC_RELAXED); \
+    __atomic_thread_fence(__ATOMIC_RELEASE)
+
+#define DG_LOOP_COUNTER_WRITE_END(cnt) \
+    __atomic_store_n(&(cnt)->seq, (cnt)->seq + 1, __ATOMIC_RELEASE)
+
+#define DG_LOOP_IFNAME_MAX   16    /* same as IFNAMSIZ                       */
+#define DG_LOOP_RECV_TIMEOUT 100   /* ms to wait for a packet in the backend */
+#define DG_LOOP_FRAME_MAX    9216  /* the max frame a backend buffer holds   */
+
 /*==================================================================================================
                                                ENUMS
 ==================================================================================================*/
@@ -39,14 +52,75 @@ extern "C" {
 ==================================================================================================*/
 typedef void (* DG_LOOP_MUTEX_UNLOCK_FUN_T) (void*);
 
+struct DG_LOOP_PORT_FD_S;
+
+/** the port backend operations */
+typedef struct
+{
+    BOOL (* open)(struct DG_LOOP_PORT_FD_S* fd);
+    void (* close)(struct DG_LOOP_PORT_FD_S* fd);
+    BOOL (* send)(struct DG_LOOP_PORT_FD_S* fd, UINT32 size, UINT8* data);
+    BOOL (* recv)(struct DG_LOOP_PORT_FD_S* fd, UINT32 size, UINT8* data);
+} DG_LOOP_PORT_OP_T;
+
+/** the port file descriptor */
+typedef struct DG_LOOP_PORT_FD_S
+{
+    DG_LOOP_PORT_T port;   /* the stored port  */
+    const char*    name;   /* the port name    */
+
+    int ref;               /* reference count  */
+    int tx_fd;             /* the actual tx fd */
+    int rx_fd;             /* the actual rx fd */
+
+    DG_LOOP_PORT_OP_T* op;
+    pthread_mutex_t    mutex; /* mutex protection */
+
+    char  ifname[DG_LOOP_IFNAME_MAX]; /* the network interface of the real backend */
+    void* priv;                       /* the backend private data                  */
+} DG_LOOP_PORT_FD_T;
+
 /*==================================================================================================
                                    GLOBAL VARIABLE DECLARATIONS
 ==================================================================================================*/
 extern DG_LOOP_MUTEX_UNLOCK_FUN_T dg_loop_mutex_unlock;
 
+extern DG_LOOP_PORT_OP_T dg_loop_port_packet_op;
+extern DG_LOOP_PORT_OP_T dg_loop_port_uring_op;
+
 /*==================================================================================================
                                         FUNCTION PROTOTYPES
 ==================================================================================================*/
+/*=============================================================================================*//**
+@brief open a raw AF_PACKET socket on the network interface
+
+@param[in] ifname - the network interface
+
+@return the socket, -1 if error happened
+
+@note
+- the interface is set to promiscuous mode and the outgoing frames are not received
+- if error happened, call DG_DBG_get_err_string() to get the last error
+*//*==============================================================================================*/
+int dg_loop_packet_socket(const char* ifname);
+
+/*=============================================================================================*//**
+@brief get the time left to receive a frame
+
+@param[in,out] deadline - the monotonic deadline in ms, 0 to start DG_LOOP_RECV_TIMEOUT from now
+
+@return the ms left, 0 if the deadline has passed
+*//*==============================================================================================*/
+int dg_loop_recv_time_left(long* deadline);
+
+/*=============================================================================================*//**
+@brief get the network interface of the port
+
+@param[in] port - the port
+
+@return the interface name, NULL if the port is invalid or uses the simulation backend
+*//*==============================================================================================*/
+const char* dg_loop_port_ifname(DG_LOOP_PORT_T port);
 
 #ifdef __cplusplus
 }
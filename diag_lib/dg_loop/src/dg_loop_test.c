@@ -13,6 +13,7 @@
 #include <string.h>
 #include <pthread.h>
 #include <errno.h>
+#include <time.h>
 #include "dg_platform_defs.h"
 #include "dg_dbg.h"
 #include "dg_loop.h"
@@ -31,17 +32,41 @@
 /* this value can't be too big, or it will lost packets */
 #define DG_LOOP_CACHE_COUNT_MAX 4
 
+#define DG_LOOP_STAMP_SIZE sizeof(DG_LOOP_STAMP_T)
+
+/* wait longer than this is slept on the monotonic clock, the rest is spun */
+#define DG_LOOP_PACE_SPIN_NS  50000ULL
+#define DG_LOOP_PACE_SLICE_NS 100000000ULL /* check the run flag every 100ms */
+
 /*==================================================================================================
                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
 ==================================================================================================*/
+/** the receive side state of the packet stamp */
+typedef struct
+{
+    BOOL   b_first;   /* no stamp received yet           */
+    UINT32 next_seq;  /* the next expected sequence      */
+    UINT64 last_tx;   /* send time of the last packet    */
+    UINT64 last_rx;   /* recv time of the last packet    */
+    INT64  jitter;    /* RFC 3550 jitter, scaled by 16   */
+} DG_LOOP_STAMP_STATE_T;
 
 /*==================================================================================================
                                      LOCAL FUNCTION PROTOTYPES
 ==================================================================================================*/
 static void* dg_loop_send_thread(void* arg);
 static void* dg_loop_recv_thread(void* arg);
-static BOOL  dg_loop_check_recv_data(UINT8* buf, UINT32 size, UINT8 pattern);
 static int   wait_sem(sem_t* sem, int time_out);
+static void  dg_loop_count_second(DG_LOOP_TEST_COUNTER_T* cnt, time_t* last_sec, UINT64* last_err);
+static void  dg_loop_read_counter(DG_LOOP_TEST_COUNTER_T* cnt, DG_LOOP_TEST_STATISTIC_T* stat);
+static void  dg_loop_check_stamp(DG_LOOP_TEST_STATISTIC_T* result, DG_LOOP_STAMP_STATE_T* state,
+                                 const DG_LOOP_STAMP_T* stamp, UINT64 rx_time);
+static UINT64 dg_loop_get_time();
+static int    dg_loop_log2(UINT64 value);
+static int    dg_loop_lat_bucket(UINT64 value);
+static UINT64 dg_loop_lat_bucket_upper(int bucket);
+static BOOL   dg_loop_build_sizes(DG_LOOP_TEST_T* test);
+static void   dg_loop_pace(DG_LOOP_TEST_T* test, UINT64* tat, int size);
 
 /*==================================================================================================
                                          GLOBAL VARIABLES
@@ -66,8 +91,8 @@ static int   wait_sem(sem_t* sem, int time_out);
 - this function would start two threads in the background and return immediately
 - one thread for sending the packets and one thread for receiving packets
 - if test->number == DG_LOOP_RUN_IFINITE, the test would run forever
-- the statistic result is stored in test->result
-- user can READ it any time to print out the result
+- the final statistic result is stored in test->result by DG_LOOP_wait_test()
+- user can call DG_LOOP_get_result() any time to print out the running result
 - user can all DG_LOOP_stop_test() to stop the test
 - if error happened, call DG_DBG_get_err_string() to get the last error
 *//*==============================================================================================*/
@@ -87,6 +112,11 @@ BOOL DG_LOOP_start_test(DG_LOOP_TEST_T* test)
         return FALSE;
     }
 
+    if (!dg_loop_build_sizes(test))
+    {
+        return FALSE;
+    }
+
     if (sem_init(&test->send_sem, 0, 0) != 0)
     {
         DG_DBG_set_err_string("can't init send semaphore, errno=%d(%m)", errno);
@@ -99,6 +129,10 @@ BOOL DG_LOOP_start_test(DG_LOOP_TEST_T* test)
         return FALSE;
     }
 
+    memset(&test->result, 0, sizeof(test->result));
+    memset(&test->send_cnt, 0, sizeof(test->send_cnt));
+    memset(&test->recv_cnt, 0, sizeof(test->recv_cnt));
+
     test->b_run  = TRUE;
     test->b_recv = TRUE; /* let the recv thread run, controlled by send thread */
 
@@ -186,6 +220,8 @@ BOOL DG_LOOP_query_test(DG_LOOP_TEST_T* test)
 *//*==============================================================================================*/
 void DG_LOOP_wait_test(DG_LOOP_TEST_T* test)
 {
+    DG_LOOP_TEST_SNAPSHOT_T snap;
+
     /* tell the thread to stop */
     test->b_run = FALSE;
 
@@ -203,6 +239,111 @@ void DG_LOOP_wait_test(DG_LOOP_TEST_T* test)
 
     sem_destroy(&test->send_sem);
     sem_destroy(&test->recv_sem);
+
+    DG_LOOP_get_result(test, &snap);
+    test->result = snap.result;
+}
+
+/*=============================================================================================*//**
+@brief get the consistent snapshot of the running test result
+
+@param[in]  test - which test to query
+@param[out] snap - the result snapshot
+
+@note
+- the send/recv threads never wait for the reader, the reader retries if a thread is updating
+*//*==============================================================================================*/
+void DG_LOOP_get_result(DG_LOOP_TEST_T* test, DG_LOOP_TEST_SNAPSHOT_T* snap)
+{
+    DG_LOOP_TEST_STATISTIC_T send;
+
+    snap->time = dg_loop_get_time();
+
+    dg_loop_read_counter(&test->recv_cnt, &snap->result);
+    dg_loop_read_counter(&test->send_cnt, &send);
+
+    /* the send counters only come from the send thread */
+    snap->result.fail_send  = send.fail_send;
+    snap->result.total_send = send.total_send;
+}
+
+/*=============================================================================================*//**
+@brief calculate the rate between two result snapshots
+
+@param[in]  prev - the previous snapshot
+@param[in]  cur  - the current snapshot
+@param[out] rate - the rate
+*//*==============================================================================================*/
+void DG_LOOP_get_rate(const DG_LOOP_TEST_SNAPSHOT_T* prev, const DG_LOOP_TEST_SNAPSHOT_T* cur,
+                      DG_LOOP_TEST_RATE_T* rate)
+{
+    double sec = (double)(cur->time - prev->time) / 1e9;
+
+    memset(rate, 0, sizeof(*rate));
+
+    if (cur->time <= prev->time)
+    {
+        return;
+    }
+
+    rate->send_pps = (double)(cur->result.total_send - prev->result.total_send) / sec;
+    rate->recv_pps = (double)(cur->result.total_recv - prev->result.total_recv) / sec;
+    rate->recv_bps = (double)(cur->result.total_byte - prev->result.total_byte) * 8 / sec;
+}
+
+/*=============================================================================================*//**
+@brief get the latency percentile of the test result
+
+@param[in]  result  - the test result
+@param[in]  percent - the percentile, 0 ~ 100
+
+@return the latency in ns, 0 if no latency sample
+
+@note
+- the value is the upper bound of the histogram bucket, which is at most 25% above the sample
+*//*==============================================================================================*/
+UINT64 DG_LOOP_get_latency(const DG_LOOP_TEST_STATISTIC_T* result, double percent)
+{
+    UINT64 total = 0;
+    UINT64 count = 0;
+    UINT64 latency;
+    double target;
+    int    bucket;
+
+    for (bucket = 0; bucket < DG_LOOP_LAT_HIST_NUM; bucket++)
+    {
+        total += result->lat_hist[bucket];
+    }
+
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    target = total * percent / 100;
+
+    for (bucket = 0; bucket < DG_LOOP_LAT_HIST_NUM - 1; bucket++)
+    {
+        count += result->lat_hist[bucket];
+        if ((count > 0) && (count >= target))
+        {
+            break;
+        }
+    }
+
+    latency = dg_loop_lat_bucket_upper(bucket);
+
+    /* the sample can't be out of the range */
+    if (latency > result->lat_max)
+    {
+        latency = result->lat_max;
+    }
+    if (latency < result->lat_min)
+    {
+        latency = result->lat_min;
+    }
+
+    return latency;
 }
 
 /*==================================================================================================
@@ -219,12 +360,19 @@ void DG_LOOP_wait_test(DG_LOOP_TEST_T* test)
 void* dg_loop_send_thread(void* arg)
 {
     DG_LOOP_TEST_T*           test   = (DG_LOOP_TEST_T*)arg;
-    DG_LOOP_TEST_STATISTIC_T* result = &test->result;
+    DG_LOOP_TEST_COUNTER_T*   cnt    = &test->send_cnt;
+    DG_LOOP_TEST_STATISTIC_T* result = &cnt->stat;
 
     int    fd;
     int    number   = test->number;
-    int    size     = test->size;
+    int    size;
+    int    size_idx = 0;
     UINT8* send_buf = NULL;
+    UINT32 seq      = 0;
+    UINT64 tat      = 0;
+    BOOL   b_pace   = (test->rate_pps != 0) || (test->rate_bps != 0);
+
+    DG_LOOP_STAMP_T stamp;
 
     DG_DBG_TRACE("enter into send thread: %p", (void*)pthread_self());
 
@@ -236,14 +384,14 @@ void* dg_loop_send_thread(void* arg)
         goto send_finish;
     }
 
-    /* prepare the data to send */
-    if ((send_buf = malloc(size)) == NULL)
+    /* prepare the data to send, smaller packets send the head of it */
+    if ((send_buf = malloc(test->size_max)) == NULL)
     {
-        DG_DBG_set_err_string("failed to malloc send buf, size=%d", size);
+        DG_DBG_set_err_string("failed to malloc send buf, size=%d", test->size_max);
         goto send_finish;
     }
 
-    memset(send_buf, test->pattern, size);
+    DG_LOOP_fill_pattern(send_buf, test->size_max, test->pattern_type, test->pattern);
 
     while (test->b_run)
     {
@@ -269,13 +417,36 @@ void* dg_loop_send_thread(void* arg)
             number--;
         }
 
+        size = test->size_seq[size_idx];
+
+        if (b_pace)
+        {
+            dg_loop_pace(test, &tat, size);
+        }
+
+        if (test->b_stamp)
+        {
+            stamp.seq     = seq;
+            stamp.size    = size;
+            stamp.tx_time = dg_loop_get_time();
+            memcpy(send_buf, &stamp, DG_LOOP_STAMP_SIZE);
+        }
+
         if (!DG_LOOP_send(fd, send_buf, size))
         {
+            DG_LOOP_COUNTER_WRITE_BEGIN(cnt);
             result->fail_send++;
+            DG_LOOP_COUNTER_WRITE_END(cnt);
         }
         else
         {
+            DG_LOOP_COUNTER_WRITE_BEGIN(cnt);
             result->total_send++;
+            DG_LOOP_COUNTER_WRITE_END(cnt);
+            /* only a frame that left moves on in the size and the stamp sequences, the recv
+               thread follows the same size sequence */
+            size_idx = (size_idx + 1) % test->size_num;
+            seq++;
             sem_post(&test->send_sem);
         }
     }
@@ -307,14 +478,27 @@ send_finish:
 void* dg_loop_recv_thread(void* arg)
 {
     DG_LOOP_TEST_T*           test   = (DG_LOOP_TEST_T*)arg;
-    DG_LOOP_TEST_STATISTIC_T* result = &test->result;
+    DG_LOOP_TEST_COUNTER_T*   cnt    = &test->recv_cnt;
+    DG_LOOP_TEST_STATISTIC_T* result = &cnt->stat;
 
     int    fd;
     int    send_cout    = 0;
     int    number       = test->number;
-    int    size         = test->size;
+    int    size         = test->size_max;
+    int    size_idx     = 0;
     UINT8* recv_buf     = NULL;
+    UINT8* expect_buf   = NULL;
     UINT8  init_pattern = ~test->pattern;
+    BOOL   is_prbs      = DG_LOOP_is_prbs(test->pattern_type);
+    BOOL   is_ok;
+    time_t last_sec     = 0;
+    UINT64 last_err     = 0;
+    UINT64 rx_time      = 0;
+    UINT32 data_offset  = test->b_stamp ? DG_LOOP_STAMP_SIZE : 0;
+
+    DG_LOOP_PATTERN_CHECK_T check;
+    DG_LOOP_STAMP_T         stamp;
+    DG_LOOP_STAMP_STATE_T   stamp_state = { TRUE, 0, 0, 0, 0 };
 
     DG_DBG_TRACE("enter into recv thread: %p", (void*)pthread_self());
 
@@ -333,10 +517,25 @@ void* dg_loop_recv_thread(void* arg)
         goto recv_finish;
     }
 
+    /* prepare the expected data, PRBS data is checked by the self-synchronizing checker */
+    if (!is_prbs)
+    {
+        if ((expect_buf = malloc(size)) == NULL)
+        {
+            DG_DBG_set_err_string("failed to malloc expect buf, size=%d", size);
+            goto recv_finish;
+        }
+
+        DG_LOOP_fill_pattern(expect_buf, size, test->pattern_type, test->pattern);
+    }
+
+    dg_loop_count_second(cnt, &last_sec, &last_err);
+
     while (test->b_recv || send_cout > 0)
     {
         int status = wait_sem(&test->send_sem, 500);
         sem_getvalue(&test->send_sem, &send_cout);
+        dg_loop_count_second(cnt, &last_sec, &last_err);
         if (status < 0)
         {
             /* DG_DBG_ERROR("Error waiting on send semaphore, errno=%d(%m)", errno); */
@@ -357,23 +556,65 @@ void* dg_loop_recv_thread(void* arg)
             number--;
         }
 
+        size = test->size_seq[size_idx];
+
         /* init the buffer with different data first */
         memset(recv_buf, init_pattern, size);
 
         if (!DG_LOOP_recv(fd, recv_buf, size))
         {
             /* if read time out we consider there is no data */
+            DG_LOOP_COUNTER_WRITE_BEGIN(cnt);
             result->fail_recv++;
+            DG_LOOP_COUNTER_WRITE_END(cnt);
         }
         else
         {
-            /* verify the data */
-            if (!dg_loop_check_recv_data(recv_buf, size, test->pattern))
+            /* only a received frame moves on in the size sequence of the send thread, a miss
+               expects the same size again */
+            size_idx = (size_idx + 1) % test->size_num;
+
+            if (test->b_stamp)
+            {
+                rx_time = dg_loop_get_time();
+                memcpy(&stamp, recv_buf, DG_LOOP_STAMP_SIZE);
+            }
+
+            /* verify the data after the stamp */
+            if (is_prbs)
+            {
+                is_ok = DG_LOOP_check_prbs(recv_buf + data_offset, size - data_offset,
+                                           test->pattern_type, &check);
+            }
+            else
+            {
+                is_ok = DG_LOOP_check_pattern(recv_buf + data_offset, expect_buf + data_offset,
+                                              size - data_offset, &check);
+            }
+            check.offset += data_offset;
+
+            DG_LOOP_COUNTER_WRITE_BEGIN(cnt);
+            if (!is_ok)
             {
                 result->wrong_recv++;
-                DG_DBG_set_err_string("receive wrong data");
+                result->bit_error += check.bit_error;
+                result->sync_loss += check.sync_loss;
+                result->err_offset = check.offset;
+            }
+            if (test->b_stamp)
+            {
+                dg_loop_check_stamp(result, &stamp_state, &stamp, rx_time);
             }
+            result->total_bit  += check.bit_count;
+            result->total_byte += size;
             result->total_recv++;
+            DG_LOOP_COUNTER_WRITE_END(cnt);
+
+            if (!is_ok)
+            {
+                DG_DBG_set_err_string("receive wrong data, offset=%u, bit_error=%u, sync_loss=%u",
+                                      check.offset, check.bit_error, check.sync_loss);
+            }
         }
 
         sem_post(&test->recv_sem);
@@ -381,6 +622,7 @@ void* dg_loop_recv_thread(void* arg)
 
 recv_finish:
     free(recv_buf);
+    free(expect_buf);
 
     if (fd >= 0)
     {
@@ -394,27 +636,6 @@ recv_finish:
     return NULL;
 }
 
-/*=============================================================================================*//**
-@brief check the received data
-
-@param[in] buf      - the buffer of data to check
-@param[in] size     - the buffer size
-@param[in] pattern  - the check pattern
-
-@return TURE if success
-*//*==============================================================================================*/
-BOOL dg_loop_check_recv_data(UINT8* buf, UINT32 size, UINT8 pattern)
-{
-    UINT8 v = 0;
-
-    while ((size-- > 0) && (v == 0))
-    {
-        v = *(buf++) - pattern;
-    }
-
-    return v == 0;
-}
-
 /*=============================================================================================*//**
 @brief Wait the semaphore for specified time
 
@@ -463,5 +684,369 @@ int wait_sem(sem_t* sem, int time_out)
 }
 
 
+/*=============================================================================================*//**
+@brief count the elapsed seconds and the seconds with errors
+
+@param[in,out] cnt      - the recv thread counters
+@param[in,out] last_sec - the last counted second, 0 to start counting
+@param[in,out] last_err - the error count at the last counted second
+
+@note
+- bit errors, PRBS sync loss and failed recv all make the second an errored second
+*//*==============================================================================================*/
+void dg_loop_count_second(DG_LOOP_TEST_COUNTER_T* cnt, time_t* last_sec, UINT64* last_err)
+{
+    DG_LOOP_TEST_STATISTIC_T* result = &cnt->stat;
+    struct timespec           now;
+    UINT64                    errors = result->bit_error + result->sync_loss + result->fail_recv +
+                                       result->lost;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now) != 0)
+    {
+        return;
+    }
+
+    if (*last_sec == 0)
+    {
+        *last_sec = now.tv_sec;
+        *last_err = errors;
+    }
+    else if (now.tv_sec > *last_sec)
+    {
+        DG_LOOP_COUNTER_WRITE_BEGIN(cnt);
+        result->total_sec += now.tv_sec - *last_sec;
+        if (errors != *last_err)
+        {
+            result->error_sec++;
+        }
+        DG_LOOP_COUNTER_WRITE_END(cnt);
+        *last_sec = now.tv_sec;
+        *last_err = errors;
+    }
+}
+
+/*=============================================================================================*//**
+@brief read the consistent copy of the counters written by another thread
+
+@param[in]  cnt  - the counters
+@param[out] stat - the copy of the counters
+*//*==============================================================================================*/
+void dg_loop_read_counter(DG_LOOP_TEST_COUNTER_T* cnt, DG_LOOP_TEST_STATISTIC_T* stat)
+{
+    UINT32 seq;
+
+    do
+    {
+        /* wait the writer to finish the update */
+        while ((seq = __atomic_load_n(&cnt->seq, __ATOMIC_ACQUIRE)) & 1)
+        {
+            sched_yield();
+        }
+
+        memcpy(stat, &cnt->stat, sizeof(*stat));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&cnt->seq, __ATOMIC_RELAXED) != seq);
+}
+
+/*=============================================================================================*//**
+@brief build the packet size sequence of the test
+
+@param[in,out] test - the test parameter
+
+@return TRUE if the sizes are valid
+
+@note
+- the sizes are interleaved in smooth weighted round robin, so 7:4:1 gives a mixed sequence
+  instead of 7 small packets followed by 4 medium and 1 large
+*//*==============================================================================================*/
+BOOL dg_loop_build_sizes(DG_LOOP_TEST_T* test)
+{
+    int current[DG_LOOP_IMIX_MAX] = { 0 };
+    int total = 0;
+    int best;
+    int i;
+    int n;
+    int min_size = test->b_stamp ? (int)DG_LOOP_STAMP_SIZE : 1;
+
+    if (test->imix_num == 0)
+    {
+        if ((test->size < min_size) || (test->size > DG_LOOP_PACKET_SIZE_MAX))
+        {
+            DG_DBG_set_err_string("Invalid packet size, size=%d", test->size);
+            return FALSE;
+        }
+
+        test->size_seq[0] = test->size;
+        test->size_num    = 1;
+        test->size_max    = test->size;
+        return TRUE;
+    }
+
+    if ((test->imix_num < 0) || (test->imix_num > DG_LOOP_IMIX_MAX))
+    {
+        DG_DBG_set_err_string("Invalid size mix number, imix_num=%d", test->imix_num);
+        return FALSE;
+    }
+
+    test->size_max = 0;
+    for (i = 0; i < test->imix_num; i++)
+    {
+        if ((test->imix[i].size < min_size) || (test->imix[i].size > DG_LOOP_PACKET_SIZE_MAX))
+        {
+            DG_DBG_set_err_string("Invalid packet size in size mix, size=%d", test->imix[i].size);
+            return FALSE;
+        }
+
+        if (test->imix[i].weight <= 0)
+        {
+            DG_DBG_set_err_string("Invalid weight in size mix, weight=%d", test->imix[i].weight);
+            return FALSE;
+        }
+
+        if (test->imix[i].size > test->size_max)
+        {
+            test->size_max = test->imix[i].size;
+        }
+
+        total += test->imix[i].weight;
+    }
+
+    if (total > DG_LOOP_IMIX_WEIGHT_MAX)
+    {
+        DG_DBG_set_err_string("Too much total weight in size mix, total=%d, max=%d",
+                              total, DG_LOOP_IMIX_WEIGHT_MAX);
+        return FALSE;
+    }
+
+    for (n = 0; n < total; n++)
+    {
+        best = 0;
+        for (i = 0; i < test->imix_num; i++)
+        {
+            current[i] += test->imix[i].weight;
+            if (current[i] > current[best])
+            {
+                best = i;
+            }
+        }
+
+        current[best]    -= total;
+        test->size_seq[n] = test->imix[best].size;
+    }
+
+    test->size_num = total;
+
+    return TRUE;
+}
+
+/*=============================================================================================*//**
+@brief wait until the next packet is allowed by the token bucket
+
+@param[in]     test - the test parameter
+@param[in,out] tat  - the theoretical arrival time of the next packet in ns, 0 at the start
+@param[in]     size - the packet size to send
+
+@note
+- this is the GCRA form of the token bucket, up to test->burst packets can be sent back to back
+- the wait is on absolute monotonic time, so the rate doesn't drift with the send time
+*//*==============================================================================================*/
+void dg_loop_pace(DG_LOOP_TEST_T* test, UINT64* tat, int size)
+{
+    UINT64 cost  = 0;
+    UINT64 tau;
+    UINT64 now   = dg_loop_get_time();
+    UINT64 deadline;
+
+    struct timespec wake;
+
+    if (test->rate_pps != 0)
+    {
+        cost = 1000000000ULL / test->rate_pps;
+    }
+
+    if ((test->rate_bps != 0) && ((UINT64)size * 8 * 1000000000ULL / test->rate_bps > cost))
+    {
+        cost = (UINT64)size * 8 * 1000000000ULL / test->rate_bps;
+    }
+
+    tau = (test->burst > 1) ? cost * (test->burst - 1) : 0;
+
+    if (*tat == 0)
+    {
+        *tat = now;
+    }
+
+    if (*tat > now + tau)
+    {
+        deadline = *tat - tau;
+
+        /* sleep on the absolute time for the long part */
+        while (test->b_run && (deadline > now + DG_LOOP_PACE_SPIN_NS))
+        {
+            wake.tv_sec  = (deadline - DG_LOOP_PACE_SPIN_NS) / 1000000000ULL;
+            wake.tv_nsec = (deadline - DG_LOOP_PACE_SPIN_NS) % 1000000000ULL;
+            if (deadline - now > DG_LOOP_PACE_SLICE_NS)
+            {
+                wake.tv_sec  = (now + DG_LOOP_PACE_SLICE_NS) / 1000000000ULL;
+                wake.tv_nsec = (now + DG_LOOP_PACE_SLICE_NS) % 1000000000ULL;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+            now = dg_loop_get_time();
+        }
+
+        /* spin for the rest */
+        while (test->b_run && (now < deadline))
+        {
+            now = dg_loop_get_time();
+        }
+    }
+
+    *tat = ((*tat > now) ? *tat : now) + cost;
+}
+
+/*=============================================================================================*//**
+@brief update the latency, jitter, loss and reorder statistic with the received stamp
+
+@param[in,out] result  - the recv thread result
+@param[in,out] state   - the stamp state of the recv thread
+@param[in]     stamp   - the received stamp
+@param[in]     rx_time - the receive time in ns
+*//*==============================================================================================*/
+void dg_loop_check_stamp(DG_LOOP_TEST_STATISTIC_T* result, DG_LOOP_STAMP_STATE_T* state,
+                         const DG_LOOP_STAMP_T* stamp, UINT64 rx_time)
+{
+    UINT64 latency = (rx_time > stamp->tx_time) ? (rx_time - stamp->tx_time) : 0;
+    UINT32 gap;
+    INT64  diff;
+
+    /* latency */
+    if ((latency < result->lat_min) || (result->lat_min == 0))
+    {
+        result->lat_min = latency;
+    }
+    if (latency > result->lat_max)
+    {
+        result->lat_max = latency;
+    }
+    result->lat_sum += latency;
+    result->lat_hist[dg_loop_lat_bucket(latency)]++;
+
+    if (state->b_first)
+    {
+        state->b_first  = FALSE;
+        state->next_seq = stamp->seq + 1;
+    }
+    else
+    {
+        /* jitter: J += (|D| - J) / 16 */
+        diff = (INT64)(rx_time - state->last_rx) - (INT64)(stamp->tx_time - state->last_tx);
+        diff = (diff < 0) ? -diff : diff;
+        state->jitter  += diff - ((state->jitter + 8) >> 4);
+        result->jitter  = state->jitter >> 4;
+
+        if (stamp->seq == state->next_seq)
+        {
+            state->next_seq++;
+        }
+        else if ((INT32)(stamp->seq - state->next_seq) > 0)
+        {
+            /* the packets in the gap are lost, unless they come later */
+            gap = stamp->seq - state->next_seq;
+            result->lost += gap;
+            result->loss_hist[dg_loop_log2(gap)]++;
+            state->next_seq = stamp->seq + 1;
+        }
+        else
+        {
+            /* a late packet, it was counted as lost */
+            gap = state->next_seq - 1 - stamp->seq;
+            result->reorder++;
+            result->reorder_hist[dg_loop_log2((gap > 0) ? gap : 1)]++;
+            if (result->lost > 0)
+            {
+                result->lost--;
+            }
+        }
+    }
+
+    state->last_tx = stamp->tx_time;
+    state->last_rx = rx_time;
+}
+
+/*=============================================================================================*//**
+@brief get the monotonic time
+
+@return the monotonic time in ns
+*//*==============================================================================================*/
+UINT64 dg_loop_get_time()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (UINT64)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/*=============================================================================================*//**
+@brief get the gap histogram bucket
+
+@param[in] value - the value, must be > 0
+
+@return floor(log2(value)), limited to the last bucket
+*//*==============================================================================================*/
+int dg_loop_log2(UINT64 value)
+{
+    int bucket = 63 - __builtin_clzll(value);
+
+    return (bucket < DG_LOOP_GAP_HIST_NUM) ? bucket : (DG_LOOP_GAP_HIST_NUM - 1);
+}
+
+/*=============================================================================================*//**
+@brief get the latency histogram bucket
+
+@param[in] value - the latency in ns
+
+@return the bucket, DG_LOOP_LAT_HIST_SUB buckets for each power of two
+*//*==============================================================================================*/
+int dg_loop_lat_bucket(UINT64 value)
+{
+    int msb;
+    int bucket;
+
+    if (value < DG_LOOP_LAT_HIST_SUB)
+    {
+        return (int)value;
+    }
+
+    /* the power of two, then the next 2 bits below the MSB */
+    msb    = 63 - __builtin_clzll(value);
+    bucket = (msb - 1) * DG_LOOP_LAT_HIST_SUB + (int)((value >> (msb - 2)) & 3);
+
+    return (bucket < DG_LOOP_LAT_HIST_NUM) ? bucket : (DG_LOOP_LAT_HIST_NUM - 1);
+}
+
+/*=============================================================================================*//**
+@brief get the upper bound of the latency histogram bucket
+
+@param[in] bucket - the bucket
+
+@return the upper bound in ns
+*//*==============================================================================================*/
+UINT64 dg_loop_lat_bucket_upper(int bucket)
+{
+    int msb;
+    int sub;
+
+    if (bucket < DG_LOOP_LAT_HIST_SUB)
+    {
+        return (UINT64)bucket + 1;
+    }
+
+    msb = bucket / DG_LOOP_LAT_HIST_SUB + 1;
+    sub = bucket % DG_LOOP_LAT_HIST_SUB;
+
+    return (UINT64)(DG_LOOP_LAT_HIST_SUB + sub + 1) << (msb - 2);
+}
+
 /** @} */
 
@@ -0,0 +1,610 @@
+/*==================================================================================================
+
+    Module Name:  dg_loop_uring.c
+
+    General Description: Implements the io_uring port backend
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "dg_platform_defs.h"
+#include "dg_dbg.h"
+#include "dg_loop.h"
+#include "dg_loop_priv.h"
+
+/** @addtogroup libdg_loop
+@{
+*/
+/*==================================================================================================
+                                          LOCAL CONSTANTS
+==================================================================================================*/
+
+/*==================================================================================================
+                                           LOCAL MACROS
+==================================================================================================*/
+#define DG_LOOP_URING_DEPTH   64 /* buffers in flight for each direction */
+#define DG_LOOP_URING_IDLE_MS 10 /* idle time before the SQ poll thread sleeps */
+
+#define DG_LOOP_URING_SQPOLL_CPUS 2 /* only use the SQ poll thread with more CPUs */
+
+/*==================================================================================================
+                            LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+/** one io_uring instance, only used by one thread */
+typedef struct
+{
+    int    fd;          /* the io_uring fd */
+    BOOL   b_sqpoll;    /* the kernel polls the SQ, no syscall to submit */
+    UINT8* sq_map;
+    size_t sq_map_size;
+    UINT8* cq_map;
+    size_t cq_map_size;
+
+    struct io_uring_sqe* sqes;
+    size_t               sqes_size;
+
+    UINT32* sq_head;
+    UINT32* sq_tail;
+    UINT32* sq_mask;
+    UINT32* sq_flags;
+    UINT32* sq_array;
+    UINT32* cq_head;
+    UINT32* cq_tail;
+    UINT32* cq_mask;
+
+    struct io_uring_cqe* cqes;
+
+    UINT8* buf;                          /* DG_LOOP_URING_DEPTH frame buffers       */
+    UINT32 ready[DG_LOOP_URING_DEPTH];   /* rx: received buffers in order; tx: free */
+    int    ready_len[DG_LOOP_URING_DEPTH];
+    int    ready_head;
+    int    ready_num;
+    UINT32 skipped;                      /* rx: received frames of other size       */
+} DG_LOOP_URING_T;
+
+/** the io_uring state of the port */
+typedef struct
+{
+    DG_LOOP_URING_T tx; /* used by the send thread */
+    DG_LOOP_URING_T rx; /* used by the recv thread */
+} DG_LOOP_URING_PORT_T;
+
+/*==================================================================================================
+                                     LOCAL FUNCTION PROTOTYPES
+==================================================================================================*/
+static BOOL dg_loop_open_uring(DG_LOOP_PORT_FD_T* fd);
+static void dg_loop_close_uring(DG_LOOP_PORT_FD_T* fd);
+static BOOL dg_loop_write_uring(DG_LOOP_PORT_FD_T* fd, UINT32 bytes_to_write, UINT8* data);
+static BOOL dg_loop_read_uring(DG_LOOP_PORT_FD_T* fd, UINT32 bytes_to_read, UINT8* data);
+
+static void dg_loop_uring_reset(DG_LOOP_URING_T* ring);
+static BOOL dg_loop_uring_init(DG_LOOP_URING_T* ring);
+static void dg_loop_uring_exit(DG_LOOP_URING_T* ring);
+static void dg_loop_uring_prep(DG_LOOP_URING_T* ring, UINT8 opcode, int sock, UINT32 index,
+                               UINT32 len);
+static BOOL dg_loop_uring_submit(DG_LOOP_URING_T* ring);
+static int  dg_loop_uring_reap(DG_LOOP_URING_T* ring, int sock, BOOL b_rx);
+
+/*==================================================================================================
+                                         GLOBAL VARIABLES
+==================================================================================================*/
+DG_LOOP_PORT_OP_T dg_loop_port_uring_op =
+{
+    dg_loop_open_uring, dg_loop_close_uring, dg_loop_write_uring, dg_loop_read_uring
+};
+
+/*==================================================================================================
+                                          LOCAL VARIABLES
+==================================================================================================*/
+
+/*==================================================================================================
+                                         GLOBAL FUNCTIONS
+==================================================================================================*/
+
+/*==================================================================================================
+                                          LOCAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief open io_uring port implementation
+
+@param[out] fd - the fd
+
+@return TRUE if success
+
+@note
+- one packet socket with one ring for sending and one ring for receiving
+- all the rx buffers are queued to receive at the beginning
+- if error happened, call DG_DBG_get_err_string() to get the last error
+*//*==============================================================================================*/
+static BOOL dg_loop_open_uring(DG_LOOP_PORT_FD_T* fd)
+{
+    DG_LOOP_URING_PORT_T* port;
+    int                   sock;
+    UINT32                index;
+
+    if ((port = calloc(1, sizeof(DG_LOOP_URING_PORT_T))) == NULL)
+    {
+        DG_DBG_set_err_string("Failed to malloc io_uring, port=%s", fd->name);
+        return FALSE;
+    }
+
+    if ((sock = dg_loop_packet_socket(fd->ifname)) < 0)
+    {
+        free(port);
+        return FALSE;
+    }
+
+    /* either ring can be released, whichever of them failed to setup */
+    dg_loop_uring_reset(&port->tx);
+    dg_loop_uring_reset(&port->rx);
+
+    if (!dg_loop_uring_init(&port->tx) || !dg_loop_uring_init(&port->rx))
+    {
+        dg_loop_uring_exit(&port->tx);
+        dg_loop_uring_exit(&port->rx);
+        close(sock);
+        free(port);
+        return FALSE;
+    }
+
+    /* all the tx buffers are free */
+    for (index = 0; index < DG_LOOP_URING_DEPTH; index++)
+    {
+        port->tx.ready[index] = index;
+    }
+    port->tx.ready_num = DG_LOOP_URING_DEPTH;
+
+    /* queue all the rx buffers */
+    for (index = 0; index < DG_LOOP_URING_DEPTH; index++)
+    {
+        dg_loop_uring_prep(&port->rx, IORING_OP_RECV, sock, index, DG_LOOP_FRAME_MAX);
+    }
+
+    if (!dg_loop_uring_submit(&port->rx))
+    {
+        dg_loop_uring_exit(&port->tx);
+        dg_loop_uring_exit(&port->rx);
+        close(sock);
+        free(port);
+        return FALSE;
+    }
+
+    DG_DBG_TRACE("port=%s opened on %s with io_uring, sqpoll=%d",
+                 fd->name, fd->ifname, port->tx.b_sqpoll);
+
+    /* the rx ring fd is polled for the received data */
+    fd->tx_fd = sock;
+    fd->rx_fd = port->rx.fd;
+    fd->priv  = port;
+
+    return TRUE;
+}
+
+/*=============================================================================================*//**
+@brief close io_uring port implementation
+
+@param[in] fd - the fd
+
+@note
+- the pending requests are cancelled when the ring is closed
+- the number of skipped rx frames of other size is reported
+*//*==============================================================================================*/
+static void dg_loop_close_uring(DG_LOOP_PORT_FD_T* fd)
+{
+    DG_LOOP_URING_PORT_T* port = fd->priv;
+
+    if (port != NULL)
+    {
+        if (port->rx.skipped > 0)
+        {
+            DG_DBG_WARN("port=%s skipped %u rx frames of other size", fd->name, port->rx.skipped);
+        }
+
+        dg_loop_uring_exit(&port->tx);
+        dg_loop_uring_exit(&port->rx);
+        free(port);
+        fd->priv = NULL;
+    }
+
+    if (fd->tx_fd >= 0)
+    {
+        close(fd->tx_fd);
+    }
+
+    fd->tx_fd = -1;
+    fd->rx_fd = -1;
+}
+
+/*=============================================================================================*//**
+@brief Writes one frame through io_uring
+
+@param[in] fd             - The port fd
+@param[in] bytes_to_write - The number of bytes to write
+@param[in] data           - Data to write
+
+@return TRUE = success, FALSE = failure
+
+@note
+ - the frame is copied to a free ring buffer and queued, the completion is reaped later
+ - no syscall is needed to submit if the kernel SQ poll thread is running
+*//*==============================================================================================*/
+static BOOL dg_loop_write_uring(DG_LOOP_PORT_FD_T* fd, UINT32 bytes_to_write, UINT8* data)
+{
+    DG_LOOP_URING_PORT_T* port = fd->priv;
+    DG_LOOP_URING_T*      ring = &port->tx;
+    struct pollfd         pfd;
+    UINT32                index;
+    int                   ret;
+
+    if (bytes_to_write > DG_LOOP_FRAME_MAX)
+    {
+        DG_DBG_set_err_string("Frame is too big, port=%s, size=%u", fd->name, bytes_to_write);
+        return FALSE;
+    }
+
+    /* get a free buffer, wait the completion if all in flight */
+    while ((dg_loop_uring_reap(ring, fd->tx_fd, FALSE) >= 0) && (ring->ready_num == 0))
+    {
+        pfd.fd     = ring->fd;
+        pfd.events = POLLIN;
+        if ((ret = poll(&pfd, 1, DG_LOOP_RECV_TIMEOUT)) == 0)
+        {
+            DG_DBG_ERROR("all the tx buffers are in flight, port=%s", fd->name);
+            return FALSE;
+        }
+        else if ((ret < 0) && (errno != EINTR))
+        {
+            DG_DBG_ERROR("Failed to poll tx ring, port=%s, errno=%d(%m)", fd->name, errno);
+            return FALSE;
+        }
+    }
+
+    if (ring->ready_num == 0)
+    {
+        return FALSE;
+    }
+
+    index = ring->ready[ring->ready_head];
+    ring->ready_head = (ring->ready_head + 1) % DG_LOOP_URING_DEPTH;
+    ring->ready_num--;
+
+    memcpy(ring->buf + index * DG_LOOP_FRAME_MAX, data, bytes_to_write);
+    dg_loop_uring_prep(ring, IORING_OP_SEND, fd->tx_fd, index, bytes_to_write);
+
+    return dg_loop_uring_submit(ring);
+}
+
+/*=============================================================================================*//**
+@brief Reads one frame of the specified size through io_uring
+
+@param[in]  fd            - port fd
+@param[in]  bytes_to_read - The number of bytes to read
+@param[out] data          - Data read
+
+@return TRUE = success, FALSE = failure
+
+@note
+ - the frames of other size are skipped, counted and reported when the port is closed
+ - the buffer is queued to receive again once the frame is copied out
+ - the timeout runs from the first wait or skipped frame, so a steady flow of other frames can't
+   hold the read forever
+*//*==============================================================================================*/
+static BOOL dg_loop_read_uring(DG_LOOP_PORT_FD_T* fd, UINT32 bytes_to_read, UINT8* data)
+{
+    DG_LOOP_URING_PORT_T* port    = fd->priv;
+    DG_LOOP_URING_T*      ring    = &port->rx;
+    struct pollfd         pfd;
+    UINT32                index;
+    long                  deadline = 0;
+    int                   time_left;
+    int                   ret;
+    BOOL                  b_found  = FALSE;
+
+    while (!b_found)
+    {
+        if (ring->ready_num == 0)
+        {
+            if (dg_loop_uring_reap(ring, fd->tx_fd, TRUE) < 0)
+            {
+                return FALSE;
+            }
+
+            if (ring->ready_num == 0)
+            {
+                pfd.fd     = ring->fd;
+                pfd.events = POLLIN;
+                if (((time_left = dg_loop_recv_time_left(&deadline)) == 0) ||
+                    ((ret = poll(&pfd, 1, time_left)) == 0))
+                {
+                    DG_DBG_ERROR("read timeout occurred!");
+                    return FALSE;
+                }
+                else if ((ret < 0) && (errno != EINTR))
+                {
+                    DG_DBG_ERROR("Failed to poll rx ring, port=%s, errno=%d(%m)", fd->name, errno);
+                    return FALSE;
+                }
+            }
+            continue;
+        }
+
+        index = ring->ready[ring->ready_head];
+        if (ring->ready_len[ring->ready_head] == (int)bytes_to_read)
+        {
+            memcpy(data, ring->buf + index * DG_LOOP_FRAME_MAX, bytes_to_read);
+            b_found = TRUE;
+        }
+        else
+        {
+            ring->skipped++;
+        }
+        ring->ready_head = (ring->ready_head + 1) % DG_LOOP_URING_DEPTH;
+        ring->ready_num--;
+
+        dg_loop_uring_prep(ring, IORING_OP_RECV, fd->tx_fd, index, DG_LOOP_FRAME_MAX);
+        if (!dg_loop_uring_submit(ring))
+        {
+            return FALSE;
+        }
+
+        if (!b_found && (dg_loop_recv_time_left(&deadline) == 0))
+        {
+            DG_DBG_ERROR("read timeout occurred!");
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/*=============================================================================================*//**
+@brief clear the ring to the released state, no fd, no maps and no buffers
+
+@param[out] ring - the ring
+*//*==============================================================================================*/
+static void dg_loop_uring_reset(DG_LOOP_URING_T* ring)
+{
+    memset(ring, 0, sizeof(DG_LOOP_URING_T));
+    ring->fd     = -1;
+    ring->sq_map = MAP_FAILED;
+    ring->cq_map = MAP_FAILED;
+    ring->sqes   = MAP_FAILED;
+}
+
+/*=============================================================================================*//**
+@brief setup the io_uring and its buffers
+
+@param[out] ring - the ring
+
+@return TRUE if success
+
+@note
+- the kernel SQ poll thread is used if permitted and there are spare CPUs, otherwise
+  io_uring_enter submits the requests
+*//*==============================================================================================*/
+static BOOL dg_loop_uring_init(DG_LOOP_URING_T* ring)
+{
+    struct io_uring_params params;
+
+    dg_loop_uring_reset(ring);
+
+    /* the SQ poll thread needs its own CPU, or it steals the time of the test threads */
+    memset(&params, 0, sizeof(params));
+    params.flags          = IORING_SETUP_SQPOLL;
+    params.sq_thread_idle = DG_LOOP_URING_IDLE_MS;
+    if ((sysconf(_SC_NPROCESSORS_ONLN) > DG_LOOP_URING_SQPOLL_CPUS) &&
+        ((ring->fd = syscall(__NR_io_uring_setup, DG_LOOP_URING_DEPTH * 2, &params)) >= 0))
+    {
+        ring->b_sqpoll = TRUE;
+    }
+    else
+    {
+        memset(&params, 0, sizeof(params));
+        if ((ring->fd = syscall(__NR_io_uring_setup, DG_LOOP_URING_DEPTH * 2, &params)) < 0)
+        {
+            DG_DBG_set_err_string("Failed to setup io_uring, errno=%d(%m)", errno);
+            return FALSE;
+        }
+    }
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(UINT32);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size   = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes   = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    ring->buf    = malloc(DG_LOOP_URING_DEPTH * DG_LOOP_FRAME_MAX);
+
+    if ((ring->sq_map == MAP_FAILED) || (ring->cq_map == MAP_FAILED) ||
+        (ring->sqes == MAP_FAILED) || (ring->buf == NULL))
+    {
+        DG_DBG_set_err_string("Failed to map io_uring, errno=%d(%m)", errno);
+        return FALSE;
+    }
+
+    ring->sq_head  = (UINT32*)(ring->sq_map + params.sq_off.head);
+    ring->sq_tail  = (UINT32*)(ring->sq_map + params.sq_off.tail);
+    ring->sq_mask  = (UINT32*)(ring->sq_map + params.sq_off.ring_mask);
+    ring->sq_flags = (UINT32*)(ring->sq_map + params.sq_off.flags);
+    ring->sq_array = (UINT32*)(ring->sq_map + params.sq_off.array);
+    ring->cq_head  = (UINT32*)(ring->cq_map + params.cq_off.head);
+    ring->cq_tail  = (UINT32*)(ring->cq_map + params.cq_off.tail);
+    ring->cq_mask  = (UINT32*)(ring->cq_map + params.cq_off.ring_mask);
+    ring->cqes     = (struct io_uring_cqe*)(ring->cq_map + params.cq_off.cqes);
+
+    return TRUE;
+}
+
+/*=============================================================================================*//**
+@brief release the io_uring and its buffers
+
+@param[in] ring - the ring
+*//*==============================================================================================*/
+static void dg_loop_uring_exit(DG_LOOP_URING_T* ring)
+{
+    if (ring->sq_map != MAP_FAILED)
+    {
+        munmap(ring->sq_map, ring->sq_map_size);
+    }
+
+    if (ring->cq_map != MAP_FAILED)
+    {
+        munmap(ring->cq_map, ring->cq_map_size);
+    }
+
+    if (ring->sqes != MAP_FAILED)
+    {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+
+    if (ring->fd >= 0)
+    {
+        close(ring->fd);
+    }
+
+    free(ring->buf);
+
+    dg_loop_uring_reset(ring);
+}
+
+/*=============================================================================================*//**
+@brief queue a send/recv request of one buffer
+
+@param[in] ring   - the ring
+@param[in] opcode - IORING_OP_SEND or IORING_OP_RECV
+@param[in] sock   - the socket
+@param[in] index  - the buffer index
+@param[in] len    - the data length
+
+@note
+- the SQ never overflows, it has twice the entries of the buffers
+*//*==============================================================================================*/
+static void dg_loop_uring_prep(DG_LOOP_URING_T* ring, UINT8 opcode, int sock, UINT32 index,
+                               UINT32 len)
+{
+    UINT32               tail = *ring->sq_tail;
+    UINT32               slot = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe  = &ring->sqes[slot];
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode    = opcode;
+    sqe->fd        = sock;
+    sqe->addr      = (unsigned long)(ring->buf + index * DG_LOOP_FRAME_MAX);
+    sqe->len       = len;
+    sqe->user_data = index;
+
+    ring->sq_array[slot] = slot;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/*=============================================================================================*//**
+@brief submit the queued requests to the kernel
+
+@param[in] ring - the ring
+
+@return TRUE if success
+*//*==============================================================================================*/
+static BOOL dg_loop_uring_submit(DG_LOOP_URING_T* ring)
+{
+    UINT32 pending;
+    UINT32 flags = 0;
+
+    if (ring->b_sqpoll)
+    {
+        /* only wake up the SQ poll thread when it sleeps */
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (!(__atomic_load_n(ring->sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP))
+        {
+            return TRUE;
+        }
+
+        pending = 0;
+        flags   = IORING_ENTER_SQ_WAKEUP;
+    }
+    else
+    {
+        pending = *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    }
+
+    if (syscall(__NR_io_uring_enter, ring->fd, pending, 0, flags, NULL, 0) < 0)
+    {
+        DG_DBG_set_err_string("Failed to submit io_uring, errno=%d(%m)", errno);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*=============================================================================================*//**
+@brief reap the completions into the ready queue
+
+@param[in] ring - the ring
+@param[in] sock - the socket
+@param[in] b_rx - TRUE for the rx ring
+
+@return the reaped number, -1 if error happened
+
+@note
+- rx: the received buffers are queued in the completion order, the failed ones are queued again
+- tx: the sent buffers are free again
+*//*==============================================================================================*/
+static int dg_loop_uring_reap(DG_LOOP_URING_T* ring, int sock, BOOL b_rx)
+{
+    UINT32               head = *ring->cq_head;
+    UINT32               tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    struct io_uring_cqe* cqe;
+    int                  num  = 0;
+    int                  pos;
+    BOOL                 b_requeue = FALSE;
+
+    for (; head != tail; head++, num++)
+    {
+        cqe = &ring->cqes[head & *ring->cq_mask];
+
+        if (b_rx && (cqe->res <= 0))
+        {
+            DG_DBG_TRACE("io_uring recv failed, res=%d", cqe->res);
+            dg_loop_uring_prep(ring, IORING_OP_RECV, sock, (UINT32)cqe->user_data,
+                               DG_LOOP_FRAME_MAX);
+            b_requeue = TRUE;
+            continue;
+        }
+
+        if (!b_rx && (cqe->res < 0))
+        {
+            DG_DBG_ERROR("io_uring send failed, res=%d", cqe->res);
+        }
+
+        pos = (ring->ready_head + ring->ready_num) % DG_LOOP_URING_DEPTH;
+        ring->ready[pos]     = (UINT32)cqe->user_data;
+        ring->ready_len[pos] = cqe->res;
+        ring->ready_num++;
+    }
+
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+    if (b_requeue && !dg_loop_uring_submit(ring))
+    {
+        return -1;
+    }
+
+    return num;
+}
+
+/** @} */
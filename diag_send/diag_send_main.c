@@ -15,6 +15,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <signal.h>
+#include <time.h>
 #include <sys/types.h>
 #include <arpa/inet.h>
 #include "dg_platform_defs.h"
@@ -30,11 +31,39 @@
 #endif
 
 #define DG_SEND_ERROR(x ...) do { printf("DIAG_SEND ERROR: "x); printf("\n"); } while (0)
-#define DG_SEND_PRINT(x ...) do { printf(x); printf("\n"); fflush(stdout); } while (0)
+#define DG_SEND_PRINT(x ...) do { printf(x); printf("\n"); } while (0)
 
 /*==================================================================================================
                              LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
 ==================================================================================================*/
+/* Where the commands of a session come from */
+typedef struct
+{
+    FILE*  file;       /* the command file, NULL for the commands on the command line */
+    char** argv;       /* the commands on the command line */
+    int    argc;
+    char*  line;       /* the line buffer of the command file */
+    size_t line_size;
+} DG_SEND_INPUT_T;
+
+/* One command of a session, from the input line until its result is printed */
+typedef struct
+{
+    UINT32               seq;          /* index of the command in the session */
+    int                  socket;       /* the connection the command is sent on */
+    char*                line;         /* the command as it was read, without the '!' */
+    BOOL                 expect_fail;  /* the line started with '!' */
+    BOOL                 is_valid;     /* the command is parsed */
+    BOOL                 is_sent;      /* the request is sent */
+    BOOL                 is_done;      /* response received, or the command can't get one */
+    BOOL                 is_lost;      /* the connection broke before the response came */
+    BOOL                 is_busy;      /* the engine answered busy, it is sent again at retry_ms */
+    UINT32               retry_ms;
+    UINT32               backoff_ms;   /* backoff of the busy retries */
+    unsigned int         seed;         /* jitter of the busy retries */
+    DG_CLIENT_API_REQ_T  req;
+    DG_CLIENT_API_RSP_T* rsp;          /* NULL if there is no response */
+} DG_SEND_SESSION_CMD_T;
 
 /*==================================================================================================
                                            LOCAL CONSTANTS
@@ -43,11 +72,15 @@
 #define DG_SEND_ROOT_UID                 0
 #define DG_SEND_MAIN_DEFAULT_RSP_TIMEOUT 0      /* no timeout, let diag engine timeout */
 #define DG_SEND_DBG_MAX_DUMP_COLS        16
-#define DG_SEND_DBG_DUMP_LINE_HEADER_LEN 6
+#define DG_SEND_DBG_DUMP_LINE_HEADER_LEN 10     /* up to 8 offset digits and ": " */
 #define DG_SEND_BUFFER_LEN_MAX           1024   /* Maximum reading buffer length */
 #define DG_SEND_DIAG_OPCODE_LEN          4      /* DIAG opcode length */
 #define DG_SEND_DIAG_DATA_BYTE_LEN       2      /* string length for each data byte */
+#define DG_SEND_HEX_INVALID              0xff   /* Not a hex digit */
 #define DG_SEND_CONNECT_MAX_TRY          1      /* Number of times try to connect to diag engine*/
+#define DG_SEND_SESSION_DEPTH_MAX        64     /* Maximum number of pipelined commands */
+#define DG_SEND_JOBS_MAX                 16     /* Maximum number of parallel connections */
+#define DG_SEND_SESSION_MARK             "@@"   /* Prefix of the session marker lines */
 
 /*==================================================================================================
                                       LOCAL FUNCTION PROTOTYPES
@@ -55,8 +88,22 @@
 static BOOL dg_send_read_raw_command(char* command, UINT32 str_len, UINT16* opcode,
                                      UINT8* data, UINT32* datalen);
 static BOOL dg_send_process_raw_command(int diag_session, char* command);
+static BOOL dg_send_print_rsp(UINT16 opcode, DG_CLIENT_API_RSP_T* diag_rsp);
+static int  dg_send_session(int* diag_session, UINT32 jobs, DG_SEND_INPUT_T* input,
+                            UINT32 depth, BOOL is_marked);
+static char* dg_send_session_read(DG_SEND_INPUT_T* input);
+static BOOL dg_send_session_submit(DG_SEND_SESSION_CMD_T* cmd, char* line);
+static void dg_send_session_match(DG_SEND_SESSION_CMD_T* cmd, UINT32 size, UINT32 head,
+                                  UINT32 tail, DG_CLIENT_API_RSP_T* diag_rsp);
+static void dg_send_session_retry(DG_SEND_SESSION_CMD_T* cmd, UINT32 size, UINT32 head,
+                                  UINT32 tail);
+static void dg_send_session_lost(DG_SEND_SESSION_CMD_T* cmd, UINT32 size, UINT32 head,
+                                 UINT32 tail, int* diag_session, UINT32 jobs);
+static BOOL dg_send_session_finish(DG_SEND_SESSION_CMD_T* cmd, BOOL is_marked);
 static void dg_send_dump(UINT8* buf, UINT32 len);
+static UINT8 dg_send_hex_digit(char c);
 static void dg_send_print_output(UINT16 opcode, UINT8* buf, UINT32 len);
+static UINT32 dg_send_get_msec(void);
 
 /*==================================================================================================
                                           GLOBAL VARIABLES
@@ -65,6 +112,7 @@ static void dg_send_print_output(UINT16 opcode, UINT8* buf, UINT32 len);
 /*==================================================================================================
                                           LOCAL VARIABLES
 ==================================================================================================*/
+static const char dg_send_hex_char[] = "0123456789abcdef";
 
 /*==================================================================================================
                                           GLOBAL FUNCTIONS
@@ -80,13 +128,17 @@ int main(int argc, char* argv[])
 {
     int   ret       = 0;
     int   filein    = 0;
+    int   session   = 0;
+    int   depth     = 1;
+    int   jobs      = 1;
+    DG_SEND_INPUT_T input_cmd;
     int   argnum    = 1;
     UINT8 try_count = 1;
     int   i;
     char  buffer[DG_SEND_BUFFER_LEN_MAX];
     FILE* fp    = NULL;
     FILE* input = stdin;
-    int   diag_session;
+    int   diag_session[DG_SEND_JOBS_MAX];
     char* server_name = NULL;
 
 #if DG_SEND_CHECK_ROOT_USER
@@ -103,12 +155,21 @@ int main(int argc, char* argv[])
 
     if (argc < 2)
     {
-        DG_SEND_PRINT("Usage: %s [-l<server>] cmd1 ... cmdN | -f [file_name]", argv[0]);
+        DG_SEND_PRINT("Usage: %s [-l<server>] [-j<jobs>] cmd1 ... cmdN | -f [file_name] | "
+                      "-s[depth] [file_name]", argv[0]);
         DG_SEND_PRINT("Where:\n\t-l<server> - specify the diag server address");
         DG_SEND_PRINT("Where:\n\t cmdN     - AAAA[B...]");
         DG_SEND_PRINT("\t\tAAAA    - opcode has to be 4 hex digits (for instance 0039)");
         DG_SEND_PRINT("\t\t[B...]  - optional data payload of 1 or more hex digits");
         DG_SEND_PRINT("\t\t-f [file_name] - read commands from file (stdin if no name provided)");
+        DG_SEND_PRINT("\t\t-j<jobs> - run the commands over jobs connections at once, the "
+                      "results are printed in order");
+        DG_SEND_PRINT("\t\t-s[depth] [file_name] - session, read commands from file (stdin if no "
+                      "name provided),");
+        DG_SEND_PRINT("\t\t\tup to depth (default 1) of them in flight on each connection, "
+                      "each result ends with");
+        DG_SEND_PRINT("\t\t\t\"" DG_SEND_SESSION_MARK "END seq PASS|FAIL rsp_code\", "
+                      "a '!' in front of a command expects a failure");
         exit(1);
     }
 
@@ -125,6 +186,30 @@ int main(int argc, char* argv[])
             filein = 1;
             break;
 
+        case 's':
+            filein  = 1;
+            session = 1;
+            if (argv[argnum][2] != '\0')
+            {
+                depth = atoi(&argv[argnum][2]);
+                if ((depth < 1) || (depth > DG_SEND_SESSION_DEPTH_MAX))
+                {
+                    DG_SEND_PRINT("-- Invalid session depth '%s', 1 ~ %d",
+                                  &argv[argnum][2], DG_SEND_SESSION_DEPTH_MAX);
+                    exit(1);
+                }
+            }
+            break;
+
+        case 'j':
+            jobs = atoi(&argv[argnum][2]);
+            if ((jobs < 1) || (jobs > DG_SEND_JOBS_MAX))
+            {
+                DG_SEND_PRINT("-- Invalid jobs '%s', 1 ~ %d", &argv[argnum][2], DG_SEND_JOBS_MAX);
+                exit(1);
+            }
+            break;
+
         case 'v':
             break;
 
@@ -152,25 +237,48 @@ int main(int argc, char* argv[])
 
     DG_SEND_TRACE("+++ Establishing connection...");
 
-    while ((diag_session = DG_CLIENT_API_connect_to_server(server_name)) < 0)
+    for (i = 0; i < jobs; i++)
     {
-        DG_SEND_ERROR("Connect to diag engine try %d fails", try_count);
-        if (try_count == DG_SEND_CONNECT_MAX_TRY)
+        try_count = 1;
+        while ((diag_session[i] = DG_CLIENT_API_connect_to_server(server_name)) < 0)
         {
-            DG_SEND_PRINT(" -- Unable to establish connection with DIAG engine after try %d times",
-                          try_count);
-            exit(1);
+            DG_SEND_ERROR("Connect to diag engine try %d fails", try_count);
+            if (try_count == DG_SEND_CONNECT_MAX_TRY)
+            {
+                DG_SEND_PRINT(" -- Unable to establish connection with DIAG engine after try %d "
+                              "times", try_count);
+                exit(1);
+            }
+            else
+            {
+                /* Try to connect again, wait a bit before retry */
+                try_count++;
+                sleep(1);
+            }
+        }
+    }
+
+    DG_SEND_TRACE("+++ Processing commands...");
+    if (session || (jobs > 1))
+    {
+        memset(&input_cmd, 0, sizeof(input_cmd));
+        if (filein)
+        {
+            input_cmd.file = (fp != NULL) ? fp : stdin;
         }
         else
         {
-            /* Try to connect again, wait a bit before retry */
-            try_count++;
-            sleep(1);
+            input_cmd.argv = &argv[argnum];
+            input_cmd.argc = argc - argnum;
         }
-    }
 
-    DG_SEND_TRACE("+++ Processing commands...");
-    if (filein)
+        ret = dg_send_session(diag_session, jobs, &input_cmd, depth, session);
+        if (fp != NULL)
+        {
+            fclose(fp);
+        }
+    }
+    else if (filein)
     {
         if (fp != NULL)
         {
@@ -182,7 +290,7 @@ int main(int argc, char* argv[])
             {
                 buffer[strlen(buffer) - 1] = 0;
             }
-            if (!dg_send_process_raw_command(diag_session, buffer))
+            if (!dg_send_process_raw_command(diag_session[0], buffer))
             {
                 ret = -1;
             }
@@ -196,7 +304,7 @@ int main(int argc, char* argv[])
     {
         for (i = argnum; i < argc; i++)
         {
-            if (!dg_send_process_raw_command(diag_session, argv[i]))
+            if (!dg_send_process_raw_command(diag_session[0], argv[i]))
             {
                 ret = -1;
                 break;
@@ -207,7 +315,10 @@ int main(int argc, char* argv[])
     DG_SEND_TRACE("+++ Done");
 
     /* Disconnect from DIAGs */
-    DG_CLIENT_API_disconnect_from_server(diag_session);
+    for (i = 0; i < jobs; i++)
+    {
+        DG_CLIENT_API_disconnect_from_server(diag_session[i]);
+    }
     return ret;
 }
 
@@ -220,45 +331,53 @@ int main(int argc, char* argv[])
 @param[in]   command  - The raw command string pointer
 @param[in]   str_len  - The length of the command string
 @param[out]  opcode   - diag opcode parsed
-@param[out]  data     - diag data pointer
+@param[out]  data     - diag data pointer, at least (str_len + 1) / 2 bytes
 @param[out]  datalen  - diag data length
+
+@return TRUE if the command has a 4 digit opcode and only hex digits
+
+@note
+- an odd digit at the end is the value of the last byte
 *//*==============================================================================================*/
 BOOL dg_send_read_raw_command(char* command, UINT32 str_len, UINT16* opcode,
                               UINT8* data, UINT32* datalen)
 {
-    UINT32 bytecode;
-    char*  end;
-    char   obyte[5] = { 0 };
-    BOOL   ret      = FALSE;
+    UINT8  hi;
+    UINT8  lo;
+    UINT32 i;
+    UINT16 value = 0;
+    BOOL   ret   = FALSE;
 
     /* string length should at least larger than opcode string length */
     if (str_len >= DG_SEND_DIAG_OPCODE_LEN)
     {
-        end      = command + str_len;
+        ret      = TRUE;
         *datalen = 0;
 
         /* Retrieving the opcode bytes */
-        memcpy(obyte, command, DG_SEND_DIAG_OPCODE_LEN);
-        obyte[DG_SEND_DIAG_OPCODE_LEN] = 0;
-        command                       += DG_SEND_DIAG_OPCODE_LEN;
-        sscanf(obyte, "%x", &bytecode);
-        *opcode = (UINT16)bytecode;
+        for (i = 0; ret && (i < DG_SEND_DIAG_OPCODE_LEN); i++)
+        {
+            lo    = dg_send_hex_digit(command[i]);
+            value = (UINT16)((value << 4) | lo);
+            ret   = (lo != DG_SEND_HEX_INVALID);
+        }
+        *opcode = value;
 
         /* Retrieving the dataload */
-        while (command < end)
+        for (; ret && (i < str_len); i += DG_SEND_DIAG_DATA_BYTE_LEN)
         {
-            memcpy(obyte, command, DG_SEND_DIAG_DATA_BYTE_LEN);
-            obyte[DG_SEND_DIAG_DATA_BYTE_LEN] = 0;
-            command += DG_SEND_DIAG_DATA_BYTE_LEN;
-            sscanf(obyte, "%x", &bytecode);
-            *data++   = (UINT8)bytecode;
-            *datalen += 1;
+            hi = dg_send_hex_digit(command[i]);
+            lo = (i + 1 < str_len) ? dg_send_hex_digit(command[i + 1]) : hi;
+            if ((hi == DG_SEND_HEX_INVALID) || (lo == DG_SEND_HEX_INVALID))
+            {
+                ret = FALSE;
+            }
+            else
+            {
+                *data++   = (i + 1 < str_len) ? (UINT8)((hi << 4) | lo) : hi;
+                *datalen += 1;
+            }
         }
-        ret = TRUE;
-    }
-    else
-    {
-        DG_SEND_PRINT("Error. Input string length is too short, len is %d", str_len);
     }
 
     return ret;
@@ -281,69 +400,474 @@ BOOL dg_send_process_raw_command(int diag_session, char* command)
     DG_CLIENT_API_REQ_T  diag_req;
     DG_CLIENT_API_RSP_T* diag_rsp;
 
-    if (dg_send_read_raw_command(command, strlen(command), &opcode, data, &datalen))
+    if ((strlen(command) <= 2 * sizeof(data)) &&
+        dg_send_read_raw_command(command, strlen(command), &opcode, data, &datalen))
     {
         DG_SEND_PRINT("Sending DIAG opcode 0x%04x, time stamp = %d", opcode, timestamp);
         DG_SEND_PRINT("<- Data sent");
         dg_send_dump(data, datalen);
+        fflush(stdout);
 
         diag_req.opcode    = opcode;
         diag_req.timestamp = timestamp;
         diag_req.data_len  = datalen;
         diag_req.data_ptr  = data;
 
-        if (!DG_CLIENT_API_send_diag_req(diag_session, &diag_req))
+        /* Send and wait for a response, the request is sent again while the engine is busy */
+        diag_rsp = DG_CLIENT_API_send_recv_diag(diag_session, &diag_req,
+                                                DG_SEND_MAIN_DEFAULT_RSP_TIMEOUT);
+        is_success = dg_send_print_rsp(opcode, diag_rsp);
+
+        if (diag_rsp != NULL)
         {
-            DG_SEND_PRINT("Sending DIAG 0x%04x failed", opcode);
+            DG_CLIENT_API_diag_rsp_free(diag_rsp);
+        }
+        timestamp++;
+    }
+    else
+    {
+        DG_SEND_PRINT("Invalid DIAG command '%s'", command);
+    }
+    fflush(stdout);
+
+    return is_success;
+}
+
+/*=============================================================================================*//**
+@brief Print a diag response
+
+@param[in] opcode   - The opcode of the diag request
+@param[in] diag_rsp - The diag response, NULL if there is none
+
+@return TRUE if the response indicates a success
+*//*==============================================================================================*/
+BOOL dg_send_print_rsp(UINT16 opcode, DG_CLIENT_API_RSP_T* diag_rsp)
+{
+    BOOL is_success = FALSE;
+
+    if (diag_rsp == NULL)
+    {
+        DG_SEND_PRINT("Can't get DIAG response for opcode 0x%04x", opcode);
+    }
+    /* Determine if the response indicates a failure */
+    else if (diag_rsp->is_fail)
+    {
+        char* err_str = NULL;
+
+        DG_SEND_ERROR("DIAG response for opcode 0x%04x indicates failure, rsp_code=%d",
+                      opcode, diag_rsp->rsp_code);
+        DG_SEND_PRINT("-> Failure data received");
+        /* If response code is an ASCII error string, print out the ascii response */
+        if ((diag_rsp->rsp_code >= 0x80) &&
+            ((err_str = (char*)(diag_rsp->data_ptr)) != NULL))
+        {
+            DG_SEND_PRINT("%s", err_str);
         }
         else
         {
-            /* Wait for a response */
-            diag_rsp = DG_CLIENT_API_recv_diag_rsp(diag_session, &diag_req, FALSE,
-                                                   DG_SEND_MAIN_DEFAULT_RSP_TIMEOUT);
-            if (diag_rsp == NULL)
+            dg_send_dump(diag_rsp->data_ptr, diag_rsp->data_len);
+        }
+    }
+    else
+    {
+        DG_SEND_TRACE("DIAG 0x%04x success!", opcode);
+        dg_send_print_output(opcode, diag_rsp->data_ptr, diag_rsp->data_len);
+        is_success = TRUE;
+    }
+
+    return is_success;
+}
+
+/*=============================================================================================*//**
+@brief Run a session, send the commands of the input over the connections
+
+@param[in]     diag_session - DIAG client connection handles
+@param[in]     jobs         - The number of connections, the commands go round robin over them
+@param[in,out] input        - The command input
+@param[in]     depth        - The number of commands which can be in flight on each connection
+@param[in]     is_marked    - Print the session markers around each result
+
+@return 0 if every command got the result it expects, -1 otherwise
+
+@note
+- empty lines and lines starting with '#' are skipped
+- a command starting with '!' passes when diag reports a failure
+- the results are printed in the input order, with the markers each one is between
+  "@@BEGIN seq command" and "@@END seq PASS|FAIL rsp_code" lines, and the last line is
+  "@@DONE total passed failed"
+- diag handles the commands of one connection one by one, different connections run in
+  parallel, so the commands in flight may run in any order
+- when a connection breaks its commands in flight and the commands read for it later fail, the
+  rest of the input still runs on the other connections
+- a command the engine answers busy is sent again after the backoff of DG_CLIENT_API_busy_delay()
+*//*==============================================================================================*/
+int dg_send_session(int* diag_session, UINT32 jobs, DG_SEND_INPUT_T* input, UINT32 depth,
+                    BOOL is_marked)
+{
+    DG_SEND_SESSION_CMD_T* cmd;
+    DG_SEND_SESSION_CMD_T* oldest;
+    DG_CLIENT_API_RSP_T*   diag_rsp;
+    UINT32                 size   = jobs * depth; /* the size of the command ring */
+    UINT32                 head   = 0;            /* the next command to print */
+    UINT32                 tail   = 0;            /* the next command to read */
+    UINT32                 passed = 0;
+    UINT32                 now_ms;
+    BOOL                   is_eof = FALSE;
+    char*                  line;
+
+    if ((cmd = (DG_SEND_SESSION_CMD_T*)calloc(size, sizeof(DG_SEND_SESSION_CMD_T))) == NULL)
+    {
+        DG_SEND_PRINT("Out of memory for %u commands in flight", size);
+        return -1;
+    }
+
+    while (!is_eof || (head != tail))
+    {
+        /* Keep up to depth commands in flight on each connection */
+        while (!is_eof && (tail - head < size))
+        {
+            if ((line = dg_send_session_read(input)) == NULL)
             {
-                DG_SEND_PRINT("Can't get DIAG response for opcode 0x%04x", opcode);
+                is_eof = TRUE;
             }
-            /* Determine if the response indicates a failure */
-            else if (diag_rsp->is_fail)
+            else
             {
-                char* err_str = NULL;
-
-                DG_SEND_ERROR("DIAG response for opcode 0x%04x indicates failure, rsp_code=%d",
-                              opcode, diag_rsp->rsp_code);
-                DG_SEND_PRINT("-> Failure data received");
-                /* If response code is an ASCII error string, print out the ascii response */
-                if ((diag_rsp->rsp_code >= 0x80) &&
-                    ((err_str = (char*)(diag_rsp->data_ptr)) != NULL))
-                {
-                    DG_SEND_PRINT("%s", err_str);
-                }
-                else
-                {
-                    dg_send_dump(diag_rsp->data_ptr, diag_rsp->data_len);
-                }
+                cmd[tail % size].seq    = tail;
+                cmd[tail % size].socket = diag_session[tail % jobs];
+                dg_send_session_submit(&cmd[tail % size], line);
+                tail++;
+            }
+        }
+
+        dg_send_session_retry(cmd, size, head, tail);
+
+        /* Wait for the oldest command unless it is already done */
+        oldest = &cmd[head % size];
+        if ((head == tail) || oldest->is_done)
+        {
+            /* nothing to wait for */
+        }
+        else if (oldest->is_busy)
+        {
+            /* Nothing can be printed before it, sleep until it is sent again */
+            now_ms = dg_send_get_msec();
+            if ((INT32)(oldest->retry_ms - now_ms) > 0)
+            {
+                usleep((oldest->retry_ms - now_ms) * 1000);
+            }
+        }
+        else
+        {
+            diag_rsp = DG_CLIENT_API_recv_any_diag_rsp(oldest->socket,
+                                                       DG_SEND_MAIN_DEFAULT_RSP_TIMEOUT);
+            if (diag_rsp == NULL)
+            {
+                dg_send_session_lost(cmd, size, head, tail, diag_session, jobs);
             }
             else
             {
-                DG_SEND_TRACE("DIAG 0x%04x success!", opcode);
-                dg_send_print_output(opcode, diag_rsp->data_ptr, diag_rsp->data_len);
-                is_success = TRUE;
+                dg_send_session_match(cmd, size, head, tail, diag_rsp);
             }
+        }
+
+        /* Print the results in order */
+        while ((head != tail) && cmd[head % size].is_done)
+        {
+            passed += dg_send_session_finish(&cmd[head % size], is_marked);
+            head++;
+        }
+    }
+
+    free(input->line);
+    input->line = NULL;
+    free(cmd);
 
-            if (diag_rsp != NULL)
+    if (is_marked)
+    {
+        DG_SEND_PRINT(DG_SEND_SESSION_MARK "DONE %u %u %u", head, passed, head - passed);
+        fflush(stdout);
+    }
+
+    return (passed == head) ? 0 : -1;
+}
+
+/*=============================================================================================*//**
+@brief Read the next command of a session
+
+@param[in,out] input - The command input
+
+@return the command, NULL at the end of the input
+
+@note
+- the command is valid until the next read
+*//*==============================================================================================*/
+char* dg_send_session_read(DG_SEND_INPUT_T* input)
+{
+    char*   command = NULL;
+    ssize_t len;
+
+    if (input->file == NULL)
+    {
+        if (input->argc > 0)
+        {
+            command = *input->argv++;
+            input->argc--;
+        }
+    }
+    else
+    {
+        while ((command == NULL) &&
+               ((len = getline(&input->line, &input->line_size, input->file)) >= 0))
+        {
+            while ((len > 0) && ((input->line[len - 1] == '\n') ||
+                                 (input->line[len - 1] == '\r') || (input->line[len - 1] == ' ')))
             {
+                input->line[--len] = '\0';
+            }
+
+            if ((len > 0) && (input->line[0] != '#'))
+            {
+                command = input->line;
+            }
+        }
+    }
+
+    return command;
+}
+
+/*=============================================================================================*//**
+@brief Parse a session command and send it
+
+@param[in,out] cmd  - The command, its seq and socket are set
+@param[in]     line - The command line
+
+@return TRUE if the request is sent, otherwise the command is done without a response
+*//*==============================================================================================*/
+BOOL dg_send_session_submit(DG_SEND_SESSION_CMD_T* cmd, char* line)
+{
+    UINT32 datalen;
+
+    cmd->expect_fail = (line[0] == '!');
+    cmd->line        = strdup(cmd->expect_fail ? (line + 1) : line);
+    cmd->rsp         = NULL;
+    cmd->is_valid    = FALSE;
+    cmd->is_sent     = FALSE;
+    cmd->is_done     = TRUE;
+    cmd->is_lost     = (cmd->socket < 0);
+    cmd->is_busy     = FALSE;
+    cmd->backoff_ms  = 0;
+    cmd->seed        = dg_send_get_msec() ^ ((unsigned int)getpid() << 16) ^ cmd->seq;
+
+    /* Each hex digit pair is one data byte, the extra byte keeps an empty payload valid */
+    cmd->req.data_ptr = (cmd->line != NULL) ? (UINT8*)malloc(strlen(cmd->line) / 2 + 1) : NULL;
+
+    if (cmd->req.data_ptr == NULL)
+    {
+        DG_SEND_ERROR("Out of memory for command %u", cmd->seq);
+    }
+    else if (dg_send_read_raw_command(cmd->line, strlen(cmd->line), &cmd->req.opcode,
+                                      cmd->req.data_ptr, &datalen))
+    {
+        /* The time stamp tells the responses in flight apart */
+        cmd->req.timestamp = (UINT16)cmd->seq;
+        cmd->req.data_len  = datalen;
+        cmd->is_valid      = TRUE;
+
+        if (cmd->is_lost)
+        {
+            /* the connection of this command is broken, it fails without being sent */
+        }
+        else if (DG_CLIENT_API_send_diag_req(cmd->socket, &cmd->req))
+        {
+            cmd->is_sent = TRUE;
+            cmd->is_done = FALSE;
+        }
+    }
+
+    return cmd->is_sent;
+}
+
+/*=============================================================================================*//**
+@brief Hand a received response to the command in flight it belongs to
+
+@param[in,out] cmd      - The command ring
+@param[in]     size     - The size of the command ring
+@param[in]     head     - The oldest command in flight
+@param[in]     tail     - The next command to read
+@param[in]     diag_rsp - The received response, freed if no command takes it
+
+@note
+- a busy response is freed and its command is scheduled to be sent again
+*//*==============================================================================================*/
+void dg_send_session_match(DG_SEND_SESSION_CMD_T* cmd, UINT32 size, UINT32 head, UINT32 tail,
+                           DG_CLIENT_API_RSP_T* diag_rsp)
+{
+    DG_SEND_SESSION_CMD_T* iter;
+    UINT32                 delay_ms;
+
+    for (; head != tail; head++)
+    {
+        iter = &cmd[head % size];
+        if (!iter->is_done && !iter->is_busy && !diag_rsp->is_unsol &&
+            (diag_rsp->opcode == iter->req.opcode) && (diag_rsp->timestamp == iter->req.timestamp))
+        {
+            delay_ms = DG_CLIENT_API_busy_delay(diag_rsp, &iter->backoff_ms, &iter->seed);
+            if (delay_ms != 0)
+            {
+                DG_SEND_TRACE("DIAG 0x%04x busy, retry in %d ms", iter->req.opcode, delay_ms);
+                iter->retry_ms = dg_send_get_msec() + delay_ms;
+                iter->is_busy  = TRUE;
                 DG_CLIENT_API_diag_rsp_free(diag_rsp);
             }
+            else
+            {
+                iter->rsp     = diag_rsp;
+                iter->is_done = TRUE;
+            }
+            return;
         }
-        timestamp++;
+    }
+
+    /* Unsolicited responses and leftovers of broken commands are dropped */
+    DG_SEND_TRACE("Drop DIAG 0x%04x response, time stamp = %d",
+                  diag_rsp->opcode, diag_rsp->timestamp);
+    DG_CLIENT_API_diag_rsp_free(diag_rsp);
+}
+
+/*=============================================================================================*//**
+@brief Send the commands answered busy again once their delay is over
+
+@param[in,out] cmd  - The command ring
+@param[in]     size - The size of the command ring
+@param[in]     head - The oldest command in flight
+@param[in]     tail - The next command to read
+*//*==============================================================================================*/
+void dg_send_session_retry(DG_SEND_SESSION_CMD_T* cmd, UINT32 size, UINT32 head, UINT32 tail)
+{
+    DG_SEND_SESSION_CMD_T* iter;
+    UINT32                 now_ms = dg_send_get_msec();
+
+    for (; head != tail; head++)
+    {
+        iter = &cmd[head % size];
+        if (!iter->is_done && iter->is_busy && ((INT32)(now_ms - iter->retry_ms) >= 0))
+        {
+            iter->is_busy = FALSE;
+            if (!DG_CLIENT_API_send_diag_req(iter->socket, &iter->req))
+            {
+                iter->is_sent = FALSE;
+                iter->is_done = TRUE;
+            }
+        }
+    }
+}
+
+/*=============================================================================================*//**
+@brief Fail the commands in flight on a broken connection and close it
+
+@param[in,out] cmd          - The command ring
+@param[in]     size         - The size of the command ring
+@param[in]     head         - The oldest command in flight, its connection is broken
+@param[in]     tail         - The next command to read
+@param[in,out] diag_session - DIAG client connection handles, the broken one is set to -1
+@param[in]     jobs         - The number of connections
+*//*==============================================================================================*/
+void dg_send_session_lost(DG_SEND_SESSION_CMD_T* cmd, UINT32 size, UINT32 head, UINT32 tail,
+                          int* diag_session, UINT32 jobs)
+{
+    int    socket = cmd[head % size].socket;
+    UINT32 i;
+
+    DG_SEND_ERROR("Connection %d to diag engine is broken", socket);
+
+    for (; head != tail; head++)
+    {
+        if (!cmd[head % size].is_done && (cmd[head % size].socket == socket))
+        {
+            cmd[head % size].is_lost = TRUE;
+            cmd[head % size].is_done = TRUE;
+        }
+    }
+
+    for (i = 0; i < jobs; i++)
+    {
+        if (diag_session[i] == socket)
+        {
+            DG_CLIENT_API_disconnect_from_server(socket);
+            diag_session[i] = -1;
+        }
+    }
+}
+
+/*=============================================================================================*//**
+@brief Print the result of a session command and free it
+
+@param[in,out] cmd       - The command which is done
+@param[in]     is_marked - Print the session markers around the result
+
+@return TRUE if the command got the result it expects
+*//*==============================================================================================*/
+BOOL dg_send_session_finish(DG_SEND_SESSION_CMD_T* cmd, BOOL is_marked)
+{
+    BOOL is_success = FALSE;
+    BOOL is_pass;
+
+    if (is_marked)
+    {
+        DG_SEND_PRINT(DG_SEND_SESSION_MARK "BEGIN %u %s%s", cmd->seq,
+                      cmd->expect_fail ? "!" : "", (cmd->line != NULL) ? cmd->line : "");
+    }
+
+    if (!cmd->is_valid)
+    {
+        DG_SEND_PRINT("Invalid DIAG command '%s'", (cmd->line != NULL) ? cmd->line : "");
     }
     else
     {
-        DG_SEND_PRINT("dg_send_read_raw_command failed");
+        DG_SEND_PRINT("Sending DIAG opcode 0x%04x, time stamp = %d",
+                      cmd->req.opcode, cmd->req.timestamp);
+        DG_SEND_PRINT("<- Data sent");
+        dg_send_dump(cmd->req.data_ptr, cmd->req.data_len);
+
+        if (!cmd->is_sent)
+        {
+            DG_SEND_PRINT("Sending DIAG 0x%04x failed%s", cmd->req.opcode,
+                          cmd->is_lost ? ", the connection to diag engine is broken" : "");
+        }
+        else if (cmd->is_lost)
+        {
+            DG_SEND_PRINT("No response to DIAG 0x%04x, the connection to diag engine is broken",
+                          cmd->req.opcode);
+        }
+        else
+        {
+            is_success = dg_send_print_rsp(cmd->req.opcode, cmd->rsp);
+        }
     }
 
-    return is_success;
+    is_pass = (is_success != cmd->expect_fail);
+
+    if (!is_marked)
+    {
+        /* no marker */
+    }
+    else if (cmd->rsp != NULL)
+    {
+        DG_SEND_PRINT(DG_SEND_SESSION_MARK "END %u %s %02x", cmd->seq,
+                      is_pass ? "PASS" : "FAIL", cmd->rsp->rsp_code);
+    }
+    else
+    {
+        DG_SEND_PRINT(DG_SEND_SESSION_MARK "END %u %s --", cmd->seq, is_pass ? "PASS" : "FAIL");
+    }
+    fflush(stdout);
+
+    DG_CLIENT_API_diag_rsp_free(cmd->rsp);
+    free(cmd->req.data_ptr);
+    free(cmd->line);
+    memset(cmd, 0, sizeof(*cmd));
+
+    return is_pass;
 }
 
 /*=============================================================================================*//**
@@ -355,37 +879,60 @@ BOOL dg_send_process_raw_command(int diag_session, char* command)
 *//*==============================================================================================*/
 void dg_send_dump(UINT8* buf, UINT32 len)
 {
-    UINT8* ptr;
+    char*  ptr;
     UINT32 i, j, cur_max_col;
 
     /* Each row includes a line header 6 characters, and MAX_DUMP_COLS plus NULL */
     /* Each column takes up 3 characters */
-    UINT8 buffer[DG_SEND_DBG_DUMP_LINE_HEADER_LEN + (DG_SEND_DBG_MAX_DUMP_COLS * 3) + 1];
+    char buffer[DG_SEND_DBG_DUMP_LINE_HEADER_LEN + (DG_SEND_DBG_MAX_DUMP_COLS * 3) + 1];
 
-    for (i = 0; i <= len / DG_SEND_DBG_MAX_DUMP_COLS; i++)
+    for (i = 0; i < len; i += cur_max_col)
     {
         ptr = buffer;
 
-        /* Reset string buffer for each new row */
-        memset(buffer, 0, sizeof(buffer));
-
         /* For all rows, the number of columns is the max number, except for the last row */
-        cur_max_col = (i == len / DG_SEND_DBG_MAX_DUMP_COLS) ?
-                      (len % DG_SEND_DBG_MAX_DUMP_COLS) : DG_SEND_DBG_MAX_DUMP_COLS;
+        cur_max_col = (len - i < DG_SEND_DBG_MAX_DUMP_COLS) ? (len - i) : DG_SEND_DBG_MAX_DUMP_COLS;
 
-        if (cur_max_col > 0)
+        /* Write the line header info */
+        ptr += sprintf(ptr, "%04x: ", i);
+        for (j = 0; j < cur_max_col; j++)
         {
-            /* Write the line header info */
-            sprintf((char*)ptr, "%04x: ", (i * DG_SEND_DBG_MAX_DUMP_COLS));
-            for (j = 0; j < cur_max_col; j++)
-            {
-                sprintf((char*)ptr, "%s%02x ", buffer, *(buf + i * DG_SEND_DBG_MAX_DUMP_COLS + j));
-            }
-            DG_SEND_PRINT("%s", buffer);
+            *ptr++ = dg_send_hex_char[buf[i + j] >> 4];
+            *ptr++ = dg_send_hex_char[buf[i + j] & 0xf];
+            *ptr++ = ' ';
         }
+        *ptr = '\0';
+        DG_SEND_PRINT("%s", buffer);
     }
 }
 
+/*=============================================================================================*//**
+@brief Get the value of a hex digit
+
+@param[in] c - The hex digit
+
+@return the value 0 ~ 15, DG_SEND_HEX_INVALID if c is not a hex digit
+*//*==============================================================================================*/
+UINT8 dg_send_hex_digit(char c)
+{
+    UINT8 value = DG_SEND_HEX_INVALID;
+
+    if ((c >= '0') && (c <= '9'))
+    {
+        value = c - '0';
+    }
+    else if ((c >= 'a') && (c <= 'f'))
+    {
+        value = c - 'a' + 10;
+    }
+    else if ((c >= 'A') && (c <= 'F'))
+    {
+        value = c - 'A' + 10;
+    }
+
+    return value;
+}
+
 /*=============================================================================================*//**
 @brief Print out the output according to the opcode, please ref diag spec for output format
 
@@ -437,3 +984,15 @@ void dg_send_print_output(UINT16 opcode, UINT8* buf, UINT32 len)
     }
 }
 
+/*=============================================================================================*//**
+@brief Get the time of the monotonic clock
+
+@return the time in msec, it wraps around
+*//*==============================================================================================*/
+UINT32 dg_send_get_msec(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (UINT32)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
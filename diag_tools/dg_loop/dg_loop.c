@@ -16,6 +16,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <signal.h>
+#include <time.h>
 #include "dg_platform_defs.h"
 #include "dg_loop.h"
 #include "dg_dbg.h"
@@ -35,20 +36,36 @@ const char* argp_program_bug_address = "<SSD-SBU-JDiagDev@juniper.net>";
 
 #define DG_LOOP_CFG_MAX_BUF_SIZE 256
 
+#define DG_LOOP_BENCH_LOOPS 10000 /* how many buffers to process for each benchmark */
+
 /*==================================================================================================
                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
 ==================================================================================================*/
 /* Used by main to communicate with parse_opt. */
 typedef struct
 {
-    char* cfg_file; /* the config file */
+    char* cfg_file;  /* the config file */
+    char* topo_file; /* the detected topology cache, NULL to detect all the ports */
     int   time;
+    BOOL  bench;
+    BOOL  latency;
+    BOOL  dump;
+
+    /* the backend of each port */
+    DG_LOOP_BACKEND_T backend[DG_LOOP_PORT_NUM];
+    char*             ifname[DG_LOOP_PORT_NUM];
 
     /* pair port args */
-    int   tx_port;
-    int   rx_port;
-    int   size;
-    UINT8 pattern;
+    int               tx_port;
+    int               rx_port;
+    int               size;
+    UINT8             pattern;
+    DG_LOOP_PATTERN_T pattern_type;
+    UINT64            rate_pps;
+    UINT64            rate_bps;
+    int               burst;
+    int               imix_num;
+    DG_LOOP_IMIX_T    imix[DG_LOOP_IMIX_MAX];
 } DG_LOOP_ARG_T;
 
 typedef struct
@@ -66,9 +83,16 @@ static error_t dg_loop_arg_parse(int key, char* arg, struct argp_state* state);
 static error_t dg_loop_child_arg_parse(int key, char* arg, struct argp_state* state);
 static BOOL    dg_loop_prepare_args(int argc, char** argv, DG_LOOP_ARG_T* args);
 static BOOL    dg_loop_get_int_arg(const char* arg, long* value);
+static BOOL    dg_loop_get_rate_arg(const char* arg, UINT64* value);
+static BOOL    dg_loop_get_imix_arg(const char* arg, DG_LOOP_ARG_T* args);
+static BOOL    dg_loop_get_backend_arg(char* arg, DG_LOOP_ARG_T* args);
 static void    dg_loop_print_result(int time);
 static void    dg_loop_exit_handler(int sig);
 static void    dg_loop_dump_config();
+static void    dg_loop_benchmark(int size);
+static BOOL    dg_loop_byte_check(const UINT8* buf, const UINT8* expect, UINT32 size,
+                                  DG_LOOP_PATTERN_CHECK_T* check);
+static double  dg_loop_elapsed(const struct timespec* start);
 
 static DG_LOOP_CONFIG_T* dg_loop_read_config(const char* file);
 static DG_LOOP_CONFIG_T* dg_loop_detect_config();
@@ -118,16 +142,27 @@ static DG_LOOP_CONFIG_T dg_loop_cfg[DG_LOOP_PORT_PAIR_MAX + 1] =
 static DG_LOOP_CONFIG_T* dg_loop_cfg_settings = NULL;
 /* test control blocks */
 static DG_LOOP_TEST_T dg_loop_test[DG_LOOP_PORT_PAIR_MAX];
+/* the last result snapshots for real time rate */
+static DG_LOOP_TEST_SNAPSHOT_T dg_loop_snap[DG_LOOP_PORT_PAIR_MAX];
 
 /* default argument. */
 static DG_LOOP_ARG_T dg_loop_args =
 {
-    .cfg_file = NULL,
-    .time     = DG_LOOP_DEFAULT_RUN_TIME,
-    .tx_port  = -1,
-    .rx_port  = -1,
-    .size     = 1024,
-    .pattern  = 0x5A,
+    .cfg_file     = NULL,
+    .topo_file    = DG_LOOP_TOPO_CACHE_FILE,
+    .time         = DG_LOOP_DEFAULT_RUN_TIME,
+    .bench        = FALSE,
+    .latency      = FALSE,
+    .dump         = FALSE,
+    .tx_port      = -1,
+    .rx_port      = -1,
+    .size         = 1024,
+    .pattern      = 0x5A,
+    .pattern_type = DG_LOOP_PATTERN_FIXED,
+    .rate_pps     = 0,
+    .rate_bps     = 0,
+    .burst        = 1,
+    .imix_num     = 0,
 };
 
 /*==================================================================================================
@@ -150,12 +185,31 @@ int main(int argc, char** argv)
 
     DG_LOOP_CONFIG_T* p_cfg;
 
-    /* prepare connections */
+    if (!dg_loop_prepare_args(argc, argv, &dg_loop_args))
+    {
+        return 1;
+    }
+
+    /* set the port backends */
+    for (index = 0; index < DG_LOOP_PORT_NUM; index++)
+    {
+        if ((dg_loop_args.backend[index] != DG_LOOP_BACKEND_SIM) &&
+            !DG_LOOP_set_backend(index, dg_loop_args.backend[index], dg_loop_args.ifname[index]))
+        {
+            printf("failed to set backend of %s: %s\n",
+                   DG_LOOP_port_name(index), DG_DBG_get_err_string());
+            exit(1);
+        }
+    }
+
+    /* prepare connections, the real backends are connected by the cable */
     p_cfg = dg_loop_cfg;
     index = 0;
     while (memcmp(p_cfg, &dg_loop_cfg_end, sizeof(dg_loop_cfg_end)) != 0)
     {
-        if (!DG_LOOP_connect(p_cfg->tx_port, p_cfg->rx_port))
+        if ((dg_loop_args.backend[p_cfg->tx_port] == DG_LOOP_BACKEND_SIM) &&
+            (dg_loop_args.backend[p_cfg->rx_port] == DG_LOOP_BACKEND_SIM) &&
+            !DG_LOOP_connect(p_cfg->tx_port, p_cfg->rx_port))
         {
             printf("failed to connect port1=0x%02x port2=0x%02x: %s\n",
                    p_cfg->tx_port, p_cfg->rx_port, DG_DBG_get_err_string());
@@ -165,9 +219,16 @@ int main(int argc, char** argv)
         p_cfg++;
     }
 
-    if (!dg_loop_prepare_args(argc, argv, &dg_loop_args))
+    if (dg_loop_args.dump)
     {
-        return 1;
+        dg_loop_dump_config();
+        return 0;
+    }
+
+    if (dg_loop_args.bench)
+    {
+        dg_loop_benchmark(dg_loop_args.size);
+        return 0;
     }
 
     /* open all the port first */
@@ -211,10 +272,11 @@ int main(int argc, char** argv)
         printf("TX_PORT  = %s\n"
                "RX_PORT  = %s\n"
                "PK_SIZE  = %d\n"
-               "PATTERN  = 0x%02x\n\n",
+               "PATTERN  = 0x%02x (%s)\n\n",
                DG_LOOP_port_name(dg_loop_args.tx_port),
                DG_LOOP_port_name(dg_loop_args.rx_port),
-               dg_loop_args.size, dg_loop_args.pattern);
+               dg_loop_args.size, dg_loop_args.pattern,
+               DG_LOOP_pattern_name(dg_loop_args.pattern_type));
 
         memset(dg_loop_cfg, 0, sizeof(dg_loop_cfg));
         dg_loop_cfg[0].tx_port = dg_loop_args.tx_port;
@@ -246,11 +308,18 @@ int main(int argc, char** argv)
     index = 0;
     while (memcmp(p_cfg, &dg_loop_cfg_end, sizeof(dg_loop_cfg_end)) != 0)
     {
-        dg_loop_test[index].tx_port = p_cfg->tx_port;
-        dg_loop_test[index].rx_port = p_cfg->rx_port;
-        dg_loop_test[index].pattern = p_cfg->pattern;
-        dg_loop_test[index].size    = p_cfg->size;
-        dg_loop_test[index].number  = DG_LOOP_RUN_IFINITE;
+        dg_loop_test[index].tx_port      = p_cfg->tx_port;
+        dg_loop_test[index].rx_port      = p_cfg->rx_port;
+        dg_loop_test[index].pattern      = p_cfg->pattern;
+        dg_loop_test[index].pattern_type = dg_loop_args.pattern_type;
+        dg_loop_test[index].size         = p_cfg->size;
+        dg_loop_test[index].number       = DG_LOOP_RUN_IFINITE;
+        dg_loop_test[index].b_stamp      = dg_loop_args.latency;
+        dg_loop_test[index].rate_pps     = dg_loop_args.rate_pps;
+        dg_loop_test[index].rate_bps     = dg_loop_args.rate_bps;
+        dg_loop_test[index].burst        = dg_loop_args.burst;
+        dg_loop_test[index].imix_num     = dg_loop_args.imix_num;
+        memcpy(dg_loop_test[index].imix, dg_loop_args.imix, sizeof(dg_loop_args.imix));
 
         if (!DG_LOOP_start_test(&dg_loop_test[index]))
         {
@@ -260,6 +329,7 @@ int main(int argc, char** argv)
                    DG_DBG_get_err_string());
             ret = 1;
         }
+        DG_LOOP_get_result(&dg_loop_test[index], &dg_loop_snap[index]);
         index++;
         p_cfg++;
     }
@@ -332,7 +402,13 @@ BOOL dg_loop_prepare_args(int argc, char** argv, DG_LOOP_ARG_T* args)
         "\nthis tool is used for diag normal loopback test\n"
         "if no config file set, it will use the detected settings\n"
         "if no time argument specified, the program will run forever\n"
-        "valid ports: mgt, ha, wtb[0-1], ge_[0-15], ge_16, ge_24, xe_[0-3]";
+        "valid ports: mgt, ha, wtb[0-1], ge_[0-15], ge_16, ge_24, xe_[0-3]\n"
+        "valid pattern types: fixed, inc, random, prbs7, prbs15, prbs23, prbs31\n"
+        "rate accepts K/M/G suffix, imix is SIZE:WEIGHT list, e.g. 80:7,594:4,1518:1\n"
+        "backend is PORT=sim or PORT=packet:IFNAME or PORT=uring:IFNAME, e.g. ge0=packet:eth1\n"
+        "the topology cache is dropped when the ports or their links change, a cached pair that "
+        "no longer answers is detected again and the unconnected ports are probed on each run, "
+        "use -D or remove the cache file to detect all the ports from scratch";
 
     /* The options we understand. */
     struct argp_option dg_options[] =
@@ -341,17 +417,27 @@ BOOL dg_loop_prepare_args(int argc, char** argv, DG_LOOP_ARG_T* args)
         { "quiet",   'q', 0,      0, "Don't produce any output",                 0 },
         { "config",  'f', "FILE", 0, "Set config file for the normal loop test", 0 },
         { "dump",    'd', 0,      0, "Dump the detected settings",               0 },
+        { "cache",   'C', "FILE", 0, "Set the detected topology cache file",     0 },
+        { "detect",  'D', 0,      0, "Detect all the ports, ignore the cache",   0 },
+        { "backend", 'e', "PORT=BACKEND", 0, "Set the backend of a port",        0 },
         { "time",    't', "TIME", 0, "How long the program would run",           0 },
+        { "bench",   'b', 0,      0, "Benchmark the pattern routines and exit",  0 },
+        { "latency", 'l', 0,      0, "Stamp packets for latency, loss, reorder", 0 },
         { NULL,      0,   NULL,   0, NULL,                                       0 }
     };
 
     struct argp_option dg_child_options[] =
     {
-        { "tx",      'x', "PORT",    0, "Set the tx port",         1 },
-        { "rx",      'r', "PORT",    0, "Set the rx port",         1 },
-        { "size",    's', "SIZE",    0, "Set packet size",         2 },
-        { "pattern", 'p', "PATTERN", 0, "Set packet data pattern", 2 },
-        { NULL,      0,   NULL,      0, NULL,                      0 }
+        { "tx",      'x', "PORT",    0, "Set the tx port",                                 1 },
+        { "rx",      'r', "PORT",    0, "Set the rx port",                                 1 },
+        { "size",    's', "SIZE",    0, "Set packet size",                                 2 },
+        { "pattern", 'p', "PATTERN", 0, "Set packet data pattern",                         2 },
+        { "mode",    'm', "TYPE",    0, "Set pattern type: fixed, inc, random, prbsN",     2 },
+        { "pps",     'R', "RATE",    0, "Limit the packets per second",                    3 },
+        { "bps",     'w', "RATE",    0, "Limit the bits per second",                       3 },
+        { "burst",   'u', "NUM",     0, "Set packets sent back to back at the rate",       3 },
+        { "imix",    'i', "MIX",     0, "Set packet size mix instead of fixed size",       3 },
+        { NULL,      0,   NULL,      0, NULL,                                              0 }
     };
 
     struct argp dg_child_argp =
@@ -406,8 +492,30 @@ error_t dg_loop_arg_parse(int key, char* arg, struct argp_state* state)
         break;
 
     case 'd':
-        dg_loop_dump_config();
-        exit(0);
+        dg_arg->dump = TRUE;
+        break;
+
+    case 'e':
+        if (!dg_loop_get_backend_arg(arg, dg_arg))
+        {
+            return EINVAL;
+        }
+        break;
+
+    case 'C':
+        dg_arg->topo_file = arg;
+        break;
+
+    case 'D':
+        dg_arg->topo_file = NULL;
+        break;
+
+    case 'b':
+        dg_arg->bench = TRUE;
+        break;
+
+    case 'l':
+        dg_arg->latency = TRUE;
         break;
 
     case 't':
@@ -511,6 +619,55 @@ error_t dg_loop_child_arg_parse(int key, char* arg, struct argp_state* state)
         }
         break;
 
+    case 'm':
+        if ((value = DG_LOOP_get_pattern(arg)) < 0)
+        {
+            printf("invalid pattern type: %s\n", arg);
+            return EINVAL;
+        }
+        else
+        {
+            dg_arg->pattern_type = (DG_LOOP_PATTERN_T)value;
+        }
+        break;
+
+    case 'R':
+        if (!dg_loop_get_rate_arg(arg, &dg_arg->rate_pps))
+        {
+            return EINVAL;
+        }
+        break;
+
+    case 'w':
+        if (!dg_loop_get_rate_arg(arg, &dg_arg->rate_bps))
+        {
+            return EINVAL;
+        }
+        break;
+
+    case 'u':
+        if (!dg_loop_get_int_arg(arg, &value))
+        {
+            return EINVAL;
+        }
+        else if (value < 1)
+        {
+            printf("invalid burst: %s\n", arg);
+            return EINVAL;
+        }
+        else
+        {
+            dg_arg->burst = value;
+        }
+        break;
+
+    case 'i':
+        if (!dg_loop_get_imix_arg(arg, dg_arg))
+        {
+            return EINVAL;
+        }
+        break;
+
     case ARGP_KEY_ARG:
         printf("Too many arguments\n");
         argp_usage(state);
@@ -557,6 +714,161 @@ BOOL dg_loop_get_int_arg(const char* arg, long* value)
     return ret;
 }
 
+/*=============================================================================================*//**
+@brief convert rate arg to int
+
+@param[in]  arg   - the rate arg, K/M/G suffix means 10^3/10^6/10^9
+@param[out] value - the convert value
+
+@return TRUE if success
+*//*==============================================================================================*/
+BOOL dg_loop_get_rate_arg(const char* arg, UINT64* value)
+{
+    char*  p_ch;
+    double rate;
+
+    errno = 0;
+
+    rate = strtod(arg, &p_ch);
+    switch (*p_ch)
+    {
+    case 'k':
+    case 'K':
+        rate *= 1e3;
+        p_ch++;
+        break;
+
+    case 'm':
+    case 'M':
+        rate *= 1e6;
+        p_ch++;
+        break;
+
+    case 'g':
+    case 'G':
+        rate *= 1e9;
+        p_ch++;
+        break;
+
+    default:
+        break;
+    }
+
+    if ((errno != 0) || (p_ch == arg) || (*p_ch != '\0') || (rate < 1))
+    {
+        printf("invalid rate: %s\n", arg);
+        return FALSE;
+    }
+
+    *value = (UINT64)rate;
+
+    return TRUE;
+}
+
+/*=============================================================================================*//**
+@brief convert the size mix arg
+
+@param[in]     arg  - the size mix arg, SIZE:WEIGHT[,SIZE:WEIGHT]...
+@param[in,out] args - dg_loop own argument
+
+@return TRUE if success
+*//*==============================================================================================*/
+BOOL dg_loop_get_imix_arg(const char* arg, DG_LOOP_ARG_T* args)
+{
+    const char* p_ch = arg;
+    int         size;
+    int         weight;
+    int         len;
+
+    args->imix_num = 0;
+
+    while (*p_ch != '\0')
+    {
+        if ((sscanf(p_ch, "%d:%d%n", &size, &weight, &len) != 2) ||
+            ((p_ch[len] != ',') && (p_ch[len] != '\0')))
+        {
+            printf("invalid size mix: %s\n", arg);
+            return FALSE;
+        }
+
+        if ((size < DG_LOOP_PACKET_SIZE_MIN) || (size > DG_LOOP_PACKET_SIZE_MAX) || (weight < 1))
+        {
+            printf("out range size mix: %d:%d, min=%d, max=%d\n",
+                   size, weight, DG_LOOP_PACKET_SIZE_MIN, DG_LOOP_PACKET_SIZE_MAX);
+            return FALSE;
+        }
+
+        if (args->imix_num >= DG_LOOP_IMIX_MAX)
+        {
+            printf("too many sizes in size mix, max=%d\n", DG_LOOP_IMIX_MAX);
+            return FALSE;
+        }
+
+        args->imix[args->imix_num].size   = size;
+        args->imix[args->imix_num].weight = weight;
+        args->imix_num++;
+
+        p_ch += len;
+        if (*p_ch == ',')
+        {
+            p_ch++;
+        }
+    }
+
+    return TRUE;
+}
+
+/*=============================================================================================*//**
+@brief convert the port backend arg
+
+@param[in]     arg  - the backend arg, PORT=BACKEND[:IFNAME]
+@param[in,out] args - dg_loop own argument
+
+@return TRUE if success
+*//*==============================================================================================*/
+BOOL dg_loop_get_backend_arg(char* arg, DG_LOOP_ARG_T* args)
+{
+    char* p_backend = strchr(arg, '=');
+    char* p_ifname;
+    int   port;
+    int   backend;
+
+    if (p_backend == NULL)
+    {
+        printf("invalid backend: %s\n", arg);
+        return FALSE;
+    }
+
+    *p_backend++ = '\0';
+    if ((p_ifname = strchr(p_backend, ':')) != NULL)
+    {
+        *p_ifname++ = '\0';
+    }
+
+    if ((port = DG_LOOP_get_port(arg)) < 0)
+    {
+        printf("invalid port: %s\n", arg);
+        return FALSE;
+    }
+
+    if ((backend = DG_LOOP_get_backend(p_backend)) < 0)
+    {
+        printf("invalid backend: %s\n", p_backend);
+        return FALSE;
+    }
+
+    if ((backend != DG_LOOP_BACKEND_SIM) && (p_ifname == NULL))
+    {
+        printf("backend %s needs the interface name\n", p_backend);
+        return FALSE;
+    }
+
+    args->backend[port] = backend;
+    args->ifname[port]  = p_ifname;
+
+    return TRUE;
+}
+
 /*=============================================================================================*//**
 @brief pint out the statistic result
 @param[in] time - 0 for real time statistic of every second, other for final total statistic
@@ -569,10 +881,23 @@ void dg_loop_print_result(int time)
 
     DG_LOOP_TEST_STATISTIC_T* result;
     DG_LOOP_CONFIG_T*         p_cfg = dg_loop_cfg_settings;
+    DG_LOOP_BER_T             ber;
+    DG_LOOP_TEST_SNAPSHOT_T   snap;
+    DG_LOOP_TEST_RATE_T       rate;
 
     while (memcmp(p_cfg, &dg_loop_cfg_end, sizeof(dg_loop_cfg_end)) != 0)
     {
-        result = &dg_loop_test[index].result;
+        if (time == 0)
+        {
+            /* the test is running, read the snapshot */
+            DG_LOOP_get_result(&dg_loop_test[index], &snap);
+            result = &snap.result;
+        }
+        else
+        {
+            result = &dg_loop_test[index].result;
+        }
+
         printf("tx_port=%-5s  rx_port=%-5s  ",
                DG_LOOP_port_name(p_cfg->tx_port),
                DG_LOOP_port_name(p_cfg->rx_port));
@@ -581,16 +906,16 @@ void dg_loop_print_result(int time)
 
         if (time == 0)
         {
-            static uint64_t last[DG_LOOP_PORT_PAIR_MAX] = { 0 };
+            DG_LOOP_get_rate(&dg_loop_snap[index], &snap, &rate);
+            dg_loop_snap[index] = snap;
 
-            pps = (float)(result->total_recv - last[index]) / 1000;
-            bps = (float)(result->total_recv - last[index]) * dg_loop_test[index].size * 8 / 1000000;
-            last[index] = result->total_recv;
+            pps = rate.recv_pps / 1000;
+            bps = rate.recv_bps / 1000000;
         }
         else
         {
             pps = (float)result->total_recv / time / 1000;
-            bps = (float)result->total_recv / time * dg_loop_test[index].size * 8 / 1000000;
+            bps = (float)result->total_byte / time * 8 / 1000000;
         }
         printf("%5.2f Kpps  %6.2f Mbps ", pps, bps);
 
@@ -604,7 +929,37 @@ void dg_loop_print_result(int time)
         }
         if (result->wrong_recv)
         {
-            printf("wrong_recv=%d  ", result->wrong_recv);
+            printf("wrong_recv=%d  bit_error=%" PRIu64 "  err_offset=%d  ",
+                   result->wrong_recv, result->bit_error, result->err_offset);
+        }
+        if (result->sync_loss)
+        {
+            printf("sync_loss=%" PRIu64 "  ", result->sync_loss);
+        }
+        if (result->lost)
+        {
+            printf("lost=%" PRIu64 "  ", result->lost);
+        }
+        if (result->reorder)
+        {
+            printf("reorder=%" PRIu64 "  ", result->reorder);
+        }
+        if (dg_loop_test[index].b_stamp && (result->total_recv > 0))
+        {
+            printf("\n    latency(us): min=%.1f avg=%.1f p50=%.1f p99=%.1f max=%.1f  jitter=%.1f",
+                   result->lat_min / 1000.0,
+                   (double)result->lat_sum / result->total_recv / 1000,
+                   DG_LOOP_get_latency(result, 50) / 1000.0,
+                   DG_LOOP_get_latency(result, 99) / 1000.0,
+                   result->lat_max / 1000.0,
+                   result->jitter / 1000.0);
+        }
+        if (time != 0)
+        {
+            DG_LOOP_get_ber(result, &ber);
+            printf("\n    ber=%.2e (95%%: %.2e ~ %.2e)  error_free_sec=%d/%d",
+                   ber.ber, ber.lower, ber.upper,
+                   result->total_sec - result->error_sec, result->total_sec);
         }
         printf("\n");
         index++;
@@ -760,8 +1115,17 @@ DG_LOOP_CONFIG_T* dg_loop_detect_config()
 
     memset(dg_loop_cfg, 0, sizeof(dg_loop_cfg));
 
-    /* detect the connection */
-    if ((p_pair = DG_LOOP_auto_detect()) == NULL)
+    /* detect the connection, verify the cached topology if there is */
+    if (dg_loop_args.topo_file != NULL)
+    {
+        p_pair = DG_LOOP_cached_detect(dg_loop_args.topo_file);
+    }
+    else
+    {
+        p_pair = DG_LOOP_auto_detect();
+    }
+
+    if (p_pair == NULL)
     {
         printf("can't detect connections\n");
         return NULL;
@@ -783,3 +1147,136 @@ DG_LOOP_CONFIG_T* dg_loop_detect_config()
     return dg_loop_cfg;
 }
 
+
+/*=============================================================================================*//**
+@brief benchmark the word-wide pattern routines against the byte loop
+
+@param[in] size - the packet size
+*//*==============================================================================================*/
+void dg_loop_benchmark(int size)
+{
+    UINT8*            expect = malloc(size);
+    UINT8*            buf    = malloc(size);
+    DG_LOOP_PATTERN_T type;
+    struct timespec   start;
+    double            fill_time;
+    double            byte_time;
+    double            word_time;
+    double            prbs_time;
+    double            mbytes = (double)size * DG_LOOP_BENCH_LOOPS / 1000000;
+    int               loop;
+
+    DG_LOOP_PATTERN_CHECK_T check;
+
+    if ((expect == NULL) || (buf == NULL))
+    {
+        printf("failed to malloc benchmark buffer, size=%d\n", size);
+        free(expect);
+        free(buf);
+        return;
+    }
+
+    printf("PK_SIZE  = %d\n"
+           "LOOPS    = %d\n\n"
+           "#  pattern  fill(MB/s)  byte_check(MB/s)  word_check(MB/s)  speedup"
+           "  prbs_check(MB/s)\n",
+           size, DG_LOOP_BENCH_LOOPS);
+
+    for (type = 0; type < DG_LOOP_PATTERN_NUM; type++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (loop = 0; loop < DG_LOOP_BENCH_LOOPS; loop++)
+        {
+            DG_LOOP_fill_pattern(expect, size, type, (UINT8)loop);
+        }
+        fill_time = dg_loop_elapsed(&start);
+
+        DG_LOOP_fill_pattern(expect, size, type, 0x5A);
+        memcpy(buf, expect, size);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (loop = 0; loop < DG_LOOP_BENCH_LOOPS; loop++)
+        {
+            dg_loop_byte_check(buf, expect, size, &check);
+        }
+        byte_time = dg_loop_elapsed(&start);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (loop = 0; loop < DG_LOOP_BENCH_LOOPS; loop++)
+        {
+            DG_LOOP_check_pattern(buf, expect, size, &check);
+        }
+        word_time = dg_loop_elapsed(&start);
+
+        printf("   %-7s  %10.1f  %16.1f  %16.1f  %6.1fx",
+               DG_LOOP_pattern_name(type), mbytes / fill_time,
+               mbytes / byte_time, mbytes / word_time, byte_time / word_time);
+
+        if (DG_LOOP_is_prbs(type))
+        {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (loop = 0; loop < DG_LOOP_BENCH_LOOPS; loop++)
+            {
+                DG_LOOP_check_prbs(buf, size, type, &check);
+            }
+            prbs_time = dg_loop_elapsed(&start);
+
+            printf("  %16.1f", mbytes / prbs_time);
+        }
+        printf("\n");
+    }
+
+    free(expect);
+    free(buf);
+}
+
+/*=============================================================================================*//**
+@brief the byte loop compare used as the benchmark baseline
+
+@param[in]  buf    - the received data
+@param[in]  expect - the expected data
+@param[in]  size   - the data size
+@param[out] check  - the first mismatched offset and the number of mismatched bits
+
+@return TRUE if the data match
+*//*==============================================================================================*/
+BOOL dg_loop_byte_check(const UINT8* buf, const UINT8* expect, UINT32 size,
+                        DG_LOOP_PATTERN_CHECK_T* check)
+{
+    UINT32 offset;
+    UINT8  diff;
+
+    check->offset    = size;
+    check->bit_error = 0;
+
+    for (offset = 0; offset < size; offset++)
+    {
+        for (diff = buf[offset] ^ expect[offset]; diff != 0; diff >>= 1)
+        {
+            if (check->offset == size)
+            {
+                check->offset = offset;
+            }
+            check->bit_error += diff & 1;
+        }
+    }
+
+    return check->bit_error == 0;
+}
+
+/*=============================================================================================*//**
+@brief get the elapsed time from the start time
+
+@param[in] start - the start time got from CLOCK_MONOTONIC
+
+@return the elapsed time in seconds
+*//*==============================================================================================*/
+double dg_loop_elapsed(const struct timespec* start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
@@ -21,7 +21,7 @@ DG_INT_LOOP_INC := ../../out
 LOCAL_C_INCLUDES := $(addprefix $(LOCAL_PATH)/, $(DG_INT_LOOP_INC))
 
 LOCAL_STATIC_LIBRARIES := libdg_loop libdg_dbg
-LOCAL_LDLIBS +=
+LOCAL_LDLIBS += -lm
 
 LOCAL_REQUIRED_MODULES :=
 
@@ -88,6 +88,47 @@ BOOL DG_CMN_DRV_EEPROM_write(DG_CMN_DRV_EEPROM_ID_T   eeprom,
                              DG_CMN_DRV_EEPROM_ADDR_T addr,
                              UINT8                    data);
 
+/*=============================================================================================*//**
+@brief Gets the size of the EEPROM
+
+@param[in]  eeprom - The EEPROM
+@param[out] size   - The EEPROM size in bytes
+
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_EEPROM_get_size(DG_CMN_DRV_EEPROM_ID_T eeprom, UINT32* size);
+
+/*=============================================================================================*//**
+@brief Reads a block of data from the EEPROM
+
+@param[in]  eeprom - The EEPROM to read
+@param[in]  addr   - The start address of the EEPROM
+@param[in]  len    - The number of bytes to read, addr + len must not exceed the EEPROM size
+@param[out] data   - The read out data
+
+@note
+- the block is read with as few bus transactions as the I2C adapter allows
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_EEPROM_read_block(DG_CMN_DRV_EEPROM_ID_T   eeprom,
+                                  DG_CMN_DRV_EEPROM_ADDR_T addr,
+                                  UINT32                   len,
+                                  UINT8*                   data);
+
+/*=============================================================================================*//**
+@brief Writes a block of data to the EEPROM
+
+@param[in]  eeprom - The EEPROM to write
+@param[in]  addr   - The start address of the EEPROM
+@param[in]  len    - The number of bytes to write, addr + len must not exceed the EEPROM size
+@param[in]  data   - The data to write
+
+@note
+- the block is split at the EEPROM page boundaries, one page write per transaction
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_EEPROM_write_block(DG_CMN_DRV_EEPROM_ID_T   eeprom,
+                                   DG_CMN_DRV_EEPROM_ADDR_T addr,
+                                   UINT32                   len,
+                                   UINT8*                   data);
+
 #ifdef __cplusplus
 }
 #endif
@@ -30,6 +30,8 @@ extern "C" {
 /*==================================================================================================
                                               MACROS
 ==================================================================================================*/
+/** size of the FPGA memory BAR in bytes */
+#define DG_CMN_DRV_FPGA_MEM_BAR_SIZE 0x1000000
 
 /*==================================================================================================
                                                ENUMS
@@ -158,6 +160,27 @@ BOOL DG_CMN_DRV_FPGA_dma_send(DG_CMN_DRV_FPGA_MEM_ADDR_T addr,
                               DG_CMN_DRV_FPGA_MEM_SIZE_T write_len,
                               UINT8*                     write_data);
 
+/*=============================================================================================*//**
+@brief Get a window into the mapped FPGA memory BAR
+
+@param[in]  addr   - The FPGA memory address
+@param[in]  len    - The number of bytes the window has to cover
+@param[out] window - Pointer to the first byte of the window
+
+@note
+- the window stays valid for the life of the process, bulk transfers memcpy through it
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_get_mem_window(DG_CMN_DRV_FPGA_MEM_ADDR_T addr, UINT32 len, UINT8** window);
+
+/*=============================================================================================*//**
+@brief Write a large FPGA memory region with one bulk copy
+
+@param[in] addr - The FPGA memory address to write to
+@param[in] len  - The amount of data to write in bytes
+@param[in] buf  - The data to write to the FPGA memory
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_write_bulk(DG_CMN_DRV_FPGA_MEM_ADDR_T addr, UINT32 len, const UINT8* buf);
+
 /*=============================================================================================*//**
 @brief Execute the FPAG self-test
 
@@ -30,7 +30,9 @@ extern "C" {
 /*==================================================================================================
                                               MACROS
 ==================================================================================================*/
-
+/** flash erase sector size in bytes reported by the CFI, a streamed image must start on a
+    sector boundary */
+#define DG_CMN_DRV_FPGA_FLASH_SECTOR_SIZE 0x10000
 
 /*==================================================================================================
                                                ENUMS
@@ -57,6 +59,20 @@ typedef struct
 typedef UINT32 DG_CMN_DRV_FLASH_ADDR_T;
 typedef UINT8  DG_CMN_DRV_FLASH_LEN_T;
 
+/** progress and timing of a streamed image */
+typedef struct
+{
+    UINT32 len;             /**< image length                                 */
+    UINT32 offset;          /**< offset of the next chunk, len when complete  */
+    UINT32 sector_num;      /**< number of sectors covered by the image       */
+    UINT32 sector_skipped;  /**< sectors left alone because they are unchanged */
+    UINT32 sector_erased;   /**< sectors erased so far                        */
+    UINT32 byte_programmed; /**< bytes programmed so far                      */
+    UINT32 erase_ms;        /**< time spent erasing                           */
+    UINT32 program_ms;      /**< time spent programming                       */
+    UINT32 time_ms;         /**< time since the stream was started            */
+} DG_CMN_DRV_FPGA_FLASH_STATS_T;
+
 /*==================================================================================================
                                    GLOBAL VARIABLE DECLARATIONS
 ==================================================================================================*/
@@ -101,6 +117,87 @@ BOOL DG_CMN_DRV_FPGA_FLASH_set_mem(DG_CMN_DRV_FLASH_ADDR_T addr,
                                    DG_CMN_DRV_FLASH_LEN_T  len,
                                    UINT8*                  buf);
 
+/*=============================================================================================*//**
+@brief Start streaming an image into the FPGA flash
+
+@param[in] addr - The flash address of the image, aligned to the erase sector
+@param[in] len  - The image length in bytes
+@param[in] crc  - The CRC32 of the whole image
+
+@note
+- the sectors of the image are erased by a background thread which runs one sector ahead of
+  the written data, so an erase overlaps with the program of the previous sector
+- starting a new stream drops an unfinished one
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_FLASH_stream_begin(DG_CMN_DRV_FLASH_ADDR_T addr, UINT32 len, UINT32 crc);
+
+/*=============================================================================================*//**
+@brief Start a differential stream which only programs the changed sectors of an image
+
+@param[in]  addr       - The flash address of the image, aligned to the erase sector
+@param[in]  len        - The image length in bytes
+@param[in]  crc        - The CRC32 of the whole image
+@param[in]  sector_num - The number of sectors covered by the image
+@param[in]  sector_crc - The CRC32 of each image sector, the last one only covers the image end
+@param[out] changed    - Bitmap of the sectors to send, bit n of byte n / 8 is sector n
+
+@note
+- the sector size is the erase region of the CFI
+- the CRC32 of every sector in the flash is compared with the image, only the sectors which
+  differ are erased and expect STREAM_DATA chunks, the other sectors are skipped
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_FLASH_diff_begin(DG_CMN_DRV_FLASH_ADDR_T addr,
+                                      UINT32                  len,
+                                      UINT32                  crc,
+                                      UINT32                  sector_num,
+                                      const UINT32*           sector_crc,
+                                      UINT8*                  changed);
+
+/*=============================================================================================*//**
+@brief Program the next chunk of a streamed image
+
+@param[in] offset - The offset of the chunk in the image, must follow the previous chunk
+@param[in] len    - The chunk length in bytes
+@param[in] crc    - The CRC32 of the chunk
+@param[in] buf    - The chunk data
+
+@note
+- a chunk with a wrong CRC is rejected without touching the flash, it can be sent again
+- in a differential stream the next chunk starts at the next changed sector, and a chunk must
+  not run into a skipped sector
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_FLASH_stream_write(UINT32 offset, UINT32 len, UINT32 crc, UINT8* buf);
+
+/*=============================================================================================*//**
+@brief Finish a streamed image and verify it
+
+@param[out] crc   - The CRC32 of the image read back from the flash
+@param[out] stats - The statistics of the stream
+
+@note
+- the verify compares the CRC32 read back from the flash with the CRC32 given at the start
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_FLASH_stream_end(UINT32* crc, DG_CMN_DRV_FPGA_FLASH_STATS_T* stats);
+
+/*=============================================================================================*//**
+@brief Get the progress and statistics of the current or last stream
+
+@param[out] stats - The statistics of the stream
+
+@note
+- time_ms keeps running while the stream is active, and is frozen once the stream is finished
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_FLASH_get_stats(DG_CMN_DRV_FPGA_FLASH_STATS_T* stats);
+
+/*=============================================================================================*//**
+@brief Get the CRC32 of an FPGA flash range
+
+@param[in]  addr - The flash address
+@param[in]  len  - The number of bytes
+@param[out] crc  - The CRC32 of the range
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_FLASH_get_crc(DG_CMN_DRV_FLASH_ADDR_T addr, UINT32 len, UINT32* crc);
+
 #ifdef __cplusplus
 }
 #endif
@@ -30,6 +30,11 @@ extern "C" {
 /*==================================================================================================
                                               MACROS
 ==================================================================================================*/
+/** maximum length of one I2C message, the limit of the Linux I2C_RDWR ioctl */
+#define DG_CMN_DRV_I2C_MSG_MAX 8192
+
+/** maximum data length of one SMBus I2C block transfer */
+#define DG_CMN_DRV_I2C_SMBUS_BLOCK_MAX 32
 
 /*==================================================================================================
                                                ENUMS
@@ -45,6 +50,15 @@ enum
     DG_CMN_DRV_I2C_MUX_WTB1 = 0x14, /** PAX SMBUS MUX to WTB1 */
     DG_CMN_DRV_I2C_MUX_WTB2 = 0x15, /** PAX SMBUS MUX to WTB2 */
     DG_CMN_DRV_I2C_MUX_FEB  = 0x16, /** PAX SMBUS MUX to FEB  */
+    DG_CMN_DRV_I2C_SFP_HA   = 0x20, /** SFP HA cage I2C       */
+    DG_CMN_DRV_I2C_SFP12    = 0x21, /** SFP12 cage I2C        */
+    DG_CMN_DRV_I2C_SFP13    = 0x22, /** SFP13 cage I2C        */
+    DG_CMN_DRV_I2C_SFP14    = 0x23, /** SFP14 cage I2C        */
+    DG_CMN_DRV_I2C_SFP15    = 0x24, /** SFP15 cage I2C        */
+    DG_CMN_DRV_I2C_SFP16    = 0x25, /** SFP16 cage I2C        */
+    DG_CMN_DRV_I2C_SFP17    = 0x26, /** SFP17 cage I2C        */
+    DG_CMN_DRV_I2C_SFP18    = 0x27, /** SFP18 cage I2C        */
+    DG_CMN_DRV_I2C_SFP19    = 0x28, /** SFP19 cage I2C        */
 };
 typedef UINT8 DG_CMN_DRV_I2C_BUS_T;
 
@@ -61,6 +75,14 @@ typedef UINT8 DG_CMN_DRV_I2C_OFFSET_T;
 /** I2C operation size */
 typedef UINT8 DG_CMN_DRV_I2C_SIZE_T;
 
+/** geometry of an I2C device */
+typedef struct
+{
+    UINT32 size;       /**< device size in bytes            */
+    UINT16 page_size;  /**< write page size in bytes        */
+    UINT8  offset_len; /**< number of offset bytes, 1 or 2 */
+} DG_CMN_DRV_I2C_GEOMETRY_T;
+
 /*==================================================================================================
                                    GLOBAL VARIABLE DECLARATIONS
 ==================================================================================================*/
@@ -79,6 +101,7 @@ typedef UINT8 DG_CMN_DRV_I2C_SIZE_T;
 @param[out] read_data - The data read from the device
 
 @note
+- the number of offset bytes is taken from the device geometry
 - Read data is only valid when the function returns with a success
 *//*==============================================================================================*/
 BOOL DG_CMN_DRV_I2C_read_bus(DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T address,
@@ -93,11 +116,65 @@ BOOL DG_CMN_DRV_I2C_read_bus(DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T add
 @param[in]  offset     - The device data offset to write to
 @param[in]  write_len  - The amount of data to write in bytes
 @param[in]  write_data - The data to write to the device
+
+@note
+- the number of offset bytes is taken from the device geometry
 *//*==============================================================================================*/
 BOOL DG_CMN_DRV_I2C_write_bus(DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T address,
                               DG_CMN_DRV_I2C_OFFSET_T offset, DG_CMN_DRV_I2C_SIZE_T write_len,
                               UINT8* write_data);
 
+/*=============================================================================================*//**
+@brief Reads a block of data from a device on the given I2C bus
+
+@param[in]  bus        - The I2C bus to read from
+@param[in]  address    - The device address to read from
+@param[in]  offset     - The device data offset to read from
+@param[in]  offset_len - The number of offset bytes the device expects, 1 or 2
+@param[in]  read_len   - The amount of data to read in bytes
+@param[out] read_data  - The data read from the device
+
+@note
+- the read is split into as few bus transactions as the adapter allows: one combined I2C
+  transfer per DG_CMN_DRV_I2C_MSG_MAX bytes, one SMBus block read per
+  DG_CMN_DRV_I2C_SMBUS_BLOCK_MAX bytes, or one transaction per byte on a byte only adapter
+- Read data is only valid when the function returns with a success
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_I2C_read_block(DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T address,
+                               UINT16 offset, UINT8 offset_len, UINT32 read_len,
+                               UINT8* read_data);
+
+/*=============================================================================================*//**
+@brief Writes a block of data to a device on the given I2C bus
+
+@param[in]  bus        - The I2C bus to write to
+@param[in]  address    - The device address to write to
+@param[in]  offset     - The device data offset to write to
+@param[in]  offset_len - The number of offset bytes the device expects, 1 or 2
+@param[in]  write_len  - The amount of data to write in bytes
+@param[in]  write_data - The data to write to the device
+@param[in]  page_size  - The device write page size, 0 if the device has no pages
+
+@note
+- a transaction never crosses a page boundary, so EEPROM page writes don't roll over
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_I2C_write_block(DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T address,
+                                UINT16 offset, UINT8 offset_len, UINT32 write_len,
+                                UINT8* write_data, UINT16 page_size);
+
+/*=============================================================================================*//**
+@brief Gets the geometry of a device on the given I2C bus
+
+@param[in]  bus      - The I2C bus
+@param[in]  address  - The device address
+@param[out] geometry - The device geometry
+
+@note
+- a device which is not listed in the board table is a 24C02
+*//*==============================================================================================*/
+void DG_CMN_DRV_I2C_get_geometry(DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T address,
+                                 DG_CMN_DRV_I2C_GEOMETRY_T* geometry);
+
 #ifdef __cplusplus
 }
 #endif
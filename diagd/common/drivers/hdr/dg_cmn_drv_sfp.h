@@ -30,6 +30,11 @@ extern "C" {
 /*==================================================================================================
                                               MACROS
 ==================================================================================================*/
+/** number of SFP cages */
+#define DG_CMN_DRV_SFP_NUM (DG_CMN_DRV_SFP_ID_MAX + 1)
+
+/** length of the vendor name, part number and serial number fields in the ID page */
+#define DG_CMN_DRV_SFP_VENDOR_LEN 16
 
 /*==================================================================================================
                                                ENUMS
@@ -87,6 +92,21 @@ typedef struct
     UINT8 reg[256];
 } DG_CMN_DRV_SFP_REG_DATA_T;
 
+/** SFP inventory and DOM values of one cage, the fields follow SFF-8472 */
+typedef struct
+{
+    DG_CMN_DRV_SFP_STATUS_T status;                                 /**< cage status         */
+    UINT8                   identifier;                             /**< A0 byte 0           */
+    char                    vendor_name[DG_CMN_DRV_SFP_VENDOR_LEN]; /**< A0 bytes 20-35      */
+    char                    vendor_pn[DG_CMN_DRV_SFP_VENDOR_LEN];   /**< A0 bytes 40-55      */
+    char                    vendor_sn[DG_CMN_DRV_SFP_VENDOR_LEN];   /**< A0 bytes 68-83      */
+    INT16                   temperature;                            /**< A2 96, 1/256 C      */
+    UINT16                  vcc;                                    /**< A2 98, 100uV        */
+    UINT16                  tx_bias;                                /**< A2 100, 2uA         */
+    UINT16                  tx_power;                               /**< A2 102, 0.1uW       */
+    UINT16                  rx_power;                               /**< A2 104, 0.1uW       */
+} DG_CMN_DRV_SFP_INFO_T;
+
 /*==================================================================================================
                                    GLOBAL VARIABLE DECLARATIONS
 ==================================================================================================*/
@@ -125,6 +145,20 @@ BOOL DG_CMN_DRV_SFP_dump_register(DG_CMN_DRV_SFP_ID_T        sfp,
                                   DG_CMN_DRV_SFP_REG_T       reg,
                                   DG_CMN_DRV_SFP_REG_DATA_T* data);
 
+/*=============================================================================================*//**
+@brief Take an inventory and DOM snapshot of several SFP cages at once
+
+@param[in]  sfp_mask - bit n selects SFP ID n
+@param[out] info     - array of DG_CMN_DRV_SFP_NUM entries, indexed by SFP ID
+
+@note
+- every selected cage is read by its own thread, the cages sit on independent I2C buses
+- the ID page of a cage is cached until its presence changes, so a snapshot normally only
+  reads the DOM values
+- an absent cage only has the status filled in
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_SFP_snapshot(UINT32 sfp_mask, DG_CMN_DRV_SFP_INFO_T* info);
+
 #ifdef __cplusplus
 }
 #endif
@@ -11,7 +11,7 @@
 ====================================================================================================
                                            INCLUDE FILES
 ==================================================================================================*/
-
+#include "dg_dbg_err.h"
 
 /** @addtogroup dg_common_drivers
 @{
@@ -31,10 +31,26 @@ extern "C" {
 /*==================================================================================================
                                               MACROS
 ==================================================================================================*/
+/** default timeout in milliseconds for a command run by DG_DRV_UTIL_system() */
+#define DG_DRV_UTIL_CMD_TIMEOUT 10000
+
+/** capacity of the per thread driver error string including the NULL terminator */
+#define DG_DRV_UTIL_ERR_STRING_MAX DG_DBG_ERR_STRING_MAX
 
 /*==================================================================================================
                                                ENUMS
 ==================================================================================================*/
+/** structured driver error code, the same codes as the dg_dbg library, see DG_DBG_ERR_* */
+#define DG_DRV_UTIL_ERR_NONE          DG_DBG_ERR_NONE
+#define DG_DRV_UTIL_ERR_GENERIC       DG_DBG_ERR_GENERIC
+#define DG_DRV_UTIL_ERR_PARAM         DG_DBG_ERR_PARAM
+#define DG_DRV_UTIL_ERR_NO_MEM        DG_DBG_ERR_NO_MEM
+#define DG_DRV_UTIL_ERR_IO            DG_DBG_ERR_IO
+#define DG_DRV_UTIL_ERR_TIMEOUT       DG_DBG_ERR_TIMEOUT
+#define DG_DRV_UTIL_ERR_NOT_SUPPORTED DG_DBG_ERR_NOT_SUPPORTED
+#define DG_DRV_UTIL_ERR_HW            DG_DBG_ERR_HW
+#define DG_DRV_UTIL_ERR_NUM           DG_DBG_ERR_NUM
+typedef DG_DBG_ERR_T DG_DRV_UTIL_ERR_T;
 
 /*==================================================================================================
                                    STRUCTURES AND OTHER TYPEDEFS
@@ -52,7 +68,7 @@ extern "C" {
 @brief Initializes error string for the current driver thread
 
 @note
-- the init would only happen once for threads, please see the pthread_once manual
+- clears any error left in the per thread buffer
 *//*==============================================================================================*/
 void DG_DRV_UTIL_init_error_string();
 
@@ -63,19 +79,35 @@ void DG_DRV_UTIL_init_error_string();
 @param[in]     ...        - Variable argument, used to popluated format string
 
 @note
-- If err_string already has a string, the old one will be freed
-- Calling function responsible for freeing
+- the string is kept in a per thread buffer and truncated to DG_DRV_UTIL_ERR_STRING_MAX
+- the error code is set to DG_DRV_UTIL_ERR_GENERIC
 *//*==============================================================================================*/
 void DG_DRV_UTIL_set_error_string(const char* format, ...);
 
+/*=============================================================================================*//**
+@brief Sets a structured error for the current driver thread without formatting any text
+
+@param[in] code   - the error code, see DG_DRV_UTIL_ERR_*
+@param[in] detail - code specific detail, e.g. errno for DG_DRV_UTIL_ERR_IO
+*//*==============================================================================================*/
+void DG_DRV_UTIL_set_error(DG_DRV_UTIL_ERR_T code, int detail);
+
+/*=============================================================================================*//**
+@brief Gets the error code for the current driver thread
+
+@return - the last error code, DG_DRV_UTIL_ERR_NONE if no error was set
+*//*==============================================================================================*/
+DG_DRV_UTIL_ERR_T DG_DRV_UTIL_get_error_code();
+
 /*=============================================================================================*//**
 @brief Gets an error string for the current driver thread
 
 @return - the current driver thread error string
 
 @note
-- reteive error string from thread specific data
+- a structured error is formatted into the per thread buffer on the first request
 - If no error string was set, will return NULL
+- caller should NOT free the string, it is valid until the thread sets another error
 *//*==============================================================================================*/
 char* DG_DRV_UTIL_get_error_string();
 
@@ -89,12 +121,62 @@ char* DG_DRV_UTIL_get_error_string();
 
 @note
 - the p_out point to heap buffer for containing the string output of the command
-- when this function returns FALSE, the p_out points to the command failure out put if any
+- when this function returns FALSE, p_out is set to NULL and the error string is set
 - If there is no output p_out will be set to NULL
 - Calling function responsible for freeing p_out buffer
+- the command is run by "/bin/sh -c" and killed after DG_DRV_UTIL_CMD_TIMEOUT milliseconds
 *//*==============================================================================================*/
 BOOL DG_DRV_UTIL_system(const char* cmd, char** p_out);
 
+/*=============================================================================================*//**
+@brief Execute a program without a shell and put its standard output to a buffer
+
+@param[in]  argv       - NULL terminated argument list, argv[0] is searched in PATH
+@param[in]  timeout_ms - milliseconds to wait before the program is killed, <= 0 waits forever
+@param[out] p_out      - point to the output string buffer
+
+@return - TRUE if the program exits with status 0 before the timeout
+
+@note
+- the program is started by posix_spawnp(), no shell is involved so argv is passed verbatim
+- the output is collected in a single heap buffer which grows by doubling
+- If there is no output or the function returns FALSE, p_out will be set to NULL
+- Calling function responsible for freeing p_out buffer
+*//*==============================================================================================*/
+BOOL DG_DRV_UTIL_spawn(char* const argv[], int timeout_ms, char** p_out);
+
+/*=============================================================================================*//**
+@brief Update a CRC32 with a buffer
+
+@param[in] crc - the CRC32 of the preceding data, 0 for the first buffer
+@param[in] buf - the data
+@param[in] len - the length of the data in bytes
+
+@return - the CRC32 of the preceding data followed by buf
+
+@note
+- this is the IEEE 802.3 CRC32 used by zlib and Ethernet, so images can be checked with any
+  standard tool
+*//*==============================================================================================*/
+UINT32 DG_DRV_UTIL_crc32(UINT32 crc, const UINT8* buf, UINT32 len);
+
+/*=============================================================================================*//**
+@brief Get the monotonic time in milliseconds
+
+@return - milliseconds since an unspecified starting point
+*//*==============================================================================================*/
+INT64 DG_DRV_UTIL_time_ms();
+
+/*=============================================================================================*//**
+@brief Sleep for a number of nanoseconds
+
+@param[in] ns - nanoseconds to sleep
+
+@note
+- the sleep is resumed after a signal, so the full time always passes
+*//*==============================================================================================*/
+void DG_DRV_UTIL_sleep_ns(UINT64 ns);
+
 #ifdef __cplusplus
 }
 #endif
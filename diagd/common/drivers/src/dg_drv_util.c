@@ -11,8 +11,16 @@
 ==================================================================================================*/
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #include "dg_dbg.h"
 #include "dg_drv_util.h"
 
@@ -32,6 +40,14 @@
 /*==================================================================================================
                                            LOCAL MACROS
 ==================================================================================================*/
+/** initial size of the command output buffer */
+#define DG_DRV_UTIL_OUT_BUF_SIZE 256
+
+/** poll interval in milliseconds when reaping a command which closed its output */
+#define DG_DRV_UTIL_REAP_INTERVAL 1
+
+/** reflected IEEE 802.3 CRC32 polynomial */
+#define DG_DRV_UTIL_CRC32_POLY 0xedb88320
 
 /*==================================================================================================
                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
@@ -40,8 +56,9 @@
 /*==================================================================================================
                                      LOCAL FUNCTION PROTOTYPES
 ==================================================================================================*/
-void dg_drv_util_create_error_string_key();
-void dg_drv_util_free_error_string(void* err_str);
+static BOOL  dg_drv_util_run(const char* name, char* const argv[], int timeout_ms, char** p_out);
+static int   dg_drv_util_remain_ms(INT64 deadline);
+static void  dg_drv_util_crc32_init(void);
 
 /*==================================================================================================
                                          GLOBAL VARIABLES
@@ -50,8 +67,17 @@ void dg_drv_util_free_error_string(void* err_str);
 /*==================================================================================================
                                           LOCAL VARIABLES
 ==================================================================================================*/
-static pthread_key_t  dg_drv_util_error_string_key;
-static pthread_once_t dg_drv_util_key_once = PTHREAD_ONCE_INIT;
+/* the driver error of each thread lives in TLS, so reporting an error never touches the heap */
+static __thread char         dg_drv_util_err_buf[DG_DRV_UTIL_ERR_STRING_MAX];
+static __thread DG_DRV_UTIL_ERR_T dg_drv_util_err_code;
+static __thread int          dg_drv_util_err_detail;
+static __thread BOOL         dg_drv_util_err_b_text; /* dg_drv_util_err_buf holds the error text */
+
+/* CRC32 of every byte value, built on the first use */
+static UINT32         dg_drv_util_crc32_table[256];
+static pthread_once_t dg_drv_util_crc32_once = PTHREAD_ONCE_INIT;
+
+extern char** environ;
 
 /*==================================================================================================
                                          GLOBAL FUNCTIONS
@@ -61,16 +87,13 @@ static pthread_once_t dg_drv_util_key_once = PTHREAD_ONCE_INIT;
 @brief Initializes error string for the current driver thread
 
 @note
-- the init would only happen once for threads, please see the pthread_once manual
+- clears any error left in the per thread buffer
 *//*==============================================================================================*/
 void DG_DRV_UTIL_init_error_string()
 {
-    int ret = pthread_once(&dg_drv_util_key_once, dg_drv_util_create_error_string_key);
-
-    if (ret != 0)
-    {
-        DG_DBG_ERROR("pthread_once() for error string key failed. errno=%d(%m)", errno);
-    }
+    dg_drv_util_err_code   = DG_DRV_UTIL_ERR_NONE;
+    dg_drv_util_err_detail = 0;
+    dg_drv_util_err_b_text = FALSE;
 }
 
 
@@ -81,44 +104,52 @@ void DG_DRV_UTIL_init_error_string()
 @param[in]     ...        - Variable argument, used to populated format string
 
 @note
-- If err_string already has a string, the old one will be freed
-- Calling function responsible for freeing
+- the string is kept in a per thread buffer and truncated to DG_DRV_UTIL_ERR_STRING_MAX
+- the error code is set to DG_DRV_UTIL_ERR_GENERIC
 *//*==============================================================================================*/
 void DG_DRV_UTIL_set_error_string(const char* format, ...)
 {
-    va_list args;       /* Variable arg list */
-    char*   p_err_str;  /* pointer to the error string */
+    va_list args; /* Variable arg list */
 
-    /* Init variable arg list */
-    va_start(args, format);
-
-    if (vasprintf(&p_err_str, format, args) < 0)
+    if (dg_drv_util_err_b_text)
     {
-        DG_DBG_ERROR("vasprintf() set error string failed. errno=%d(%m)", errno);
+        DG_DBG_TRACE("Overwriting error string: %s", dg_drv_util_err_buf);
     }
-    else
-    {
-        char* old_err_str = (char*)pthread_getspecific(dg_drv_util_error_string_key);
 
-        /* Free any existing error string */
-        if (old_err_str != NULL)
-        {
-            DG_DBG_TRACE("Overwriting error string: %s", old_err_str);
-            free(old_err_str);
-        }
+    va_start(args, format);
+    DG_DBG_vformat(dg_drv_util_err_buf, sizeof(dg_drv_util_err_buf), format, args);
+    va_end(args);
 
-        /* Set new error string */
-        if (pthread_setspecific(dg_drv_util_error_string_key, p_err_str) != 0)
-        {
-            DG_DBG_ERROR("pthread_setspecific() set error string failed. errno=%d(%m)", errno);
-        }
-        else
-        {
-            DG_DBG_ERROR("Driver error string set to: %s", p_err_str);
-        }
-    }
+    dg_drv_util_err_code   = DG_DRV_UTIL_ERR_GENERIC;
+    dg_drv_util_err_detail = 0;
+    dg_drv_util_err_b_text = TRUE;
 
-    va_end(args);
+    DG_DBG_ERROR("Driver error string set to: %s", dg_drv_util_err_buf);
+}
+
+/*=============================================================================================*//**
+@brief Sets a structured error for the current driver thread without formatting any text
+
+@param[in] code   - the error code, see DG_DRV_UTIL_ERR_*
+@param[in] detail - code specific detail, e.g. errno for DG_DRV_UTIL_ERR_IO
+*//*==============================================================================================*/
+void DG_DRV_UTIL_set_error(DG_DRV_UTIL_ERR_T code, int detail)
+{
+    dg_drv_util_err_code   = code;
+    dg_drv_util_err_detail = detail;
+    dg_drv_util_err_b_text = FALSE;
+
+    DG_DBG_TRACE("Driver error code set to: %d, detail=%d", code, detail);
+}
+
+/*=============================================================================================*//**
+@brief Gets the error code for the current driver thread
+
+@return - the last error code, DG_DRV_UTIL_ERR_NONE if no error was set
+*//*==============================================================================================*/
+DG_DRV_UTIL_ERR_T DG_DRV_UTIL_get_error_code()
+{
+    return dg_drv_util_err_code;
 }
 
 /*=============================================================================================*//**
@@ -127,12 +158,25 @@ void DG_DRV_UTIL_set_error_string(const char* format, ...)
 @return - the current driver thread error string
 
 @note
-- get error string from thread specific data
+- a structured error is formatted into the per thread buffer on the first request
 - If no error string was set, will return NULL
+- caller should NOT free the string, it is valid until the thread sets another error
 *//*==============================================================================================*/
 char* DG_DRV_UTIL_get_error_string()
 {
-    return pthread_getspecific(dg_drv_util_error_string_key);
+    if (dg_drv_util_err_code == DG_DRV_UTIL_ERR_NONE)
+    {
+        return NULL;
+    }
+
+    if (!dg_drv_util_err_b_text)
+    {
+        DG_DBG_format_err(dg_drv_util_err_buf, sizeof(dg_drv_util_err_buf),
+                          dg_drv_util_err_code, dg_drv_util_err_detail);
+        dg_drv_util_err_b_text = TRUE;
+    }
+
+    return dg_drv_util_err_buf;
 }
 
 /*=============================================================================================*//**
@@ -145,118 +189,294 @@ char* DG_DRV_UTIL_get_error_string()
 
 @note
 - the p_out point to heap buffer for containing the string output of the command
-- when this function returns FALSE, the p_out points to the command failure out put if any
+- when this function returns FALSE, p_out is set to NULL and the error string is set
 - If there is no output p_out will be set to NULL
 - Calling function responsible for freeing p_out buffer
+- the command is run by "/bin/sh -c" and killed after DG_DRV_UTIL_CMD_TIMEOUT milliseconds
 *//*==============================================================================================*/
 BOOL DG_DRV_UTIL_system(const char* cmd, char** p_out)
 {
-    BOOL  ret = FALSE;
-    FILE* fp  = NULL;
-    int   sys_ret;
-    int   exit_val;
+    char* const argv[] = { "/bin/sh", "-c", (char*)cmd, NULL };
+
+    return dg_drv_util_run(cmd, argv, DG_DRV_UTIL_CMD_TIMEOUT, p_out);
+}
+
+/*=============================================================================================*//**
+@brief Execute a program without a shell and put its standard output to a buffer
+
+@param[in]  argv       - NULL terminated argument list, argv[0] is searched in PATH
+@param[in]  timeout_ms - milliseconds to wait before the program is killed, <= 0 waits forever
+@param[out] p_out      - point to the output string buffer
+
+@return - TRUE if the program exits with status 0 before the timeout
+
+@note
+- the program is started by posix_spawnp(), no shell is involved so argv is passed verbatim
+- the output is collected in a single heap buffer which grows by doubling
+- If there is no output or the function returns FALSE, p_out will be set to NULL
+- Calling function responsible for freeing p_out buffer
+*//*==============================================================================================*/
+BOOL DG_DRV_UTIL_spawn(char* const argv[], int timeout_ms, char** p_out)
+{
+    return dg_drv_util_run(argv[0], argv, timeout_ms, p_out);
+}
+
+/*=============================================================================================*//**
+@brief Update a CRC32 with a buffer
+
+@param[in] crc - the CRC32 of the preceding data, 0 for the first buffer
+@param[in] buf - the data
+@param[in] len - the length of the data in bytes
+
+@return - the CRC32 of the preceding data followed by buf
+*//*==============================================================================================*/
+UINT32 DG_DRV_UTIL_crc32(UINT32 crc, const UINT8* buf, UINT32 len)
+{
+    UINT32 i;
+
+    pthread_once(&dg_drv_util_crc32_once, dg_drv_util_crc32_init);
+
+    crc = ~crc;
+    for (i = 0; i < len; i++)
+    {
+        crc = dg_drv_util_crc32_table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+/*=============================================================================================*//**
+@brief Get the monotonic time in milliseconds
+
+@return - milliseconds since an unspecified starting point
+*//*==============================================================================================*/
+INT64 DG_DRV_UTIL_time_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (INT64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*=============================================================================================*//**
+@brief Sleep for a number of nanoseconds
+
+@param[in] ns - nanoseconds to sleep
+
+@note
+- the sleep is resumed after a signal, so the full time always passes
+*//*==============================================================================================*/
+void DG_DRV_UTIL_sleep_ns(UINT64 ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec  = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+
+    while ((nanosleep(&ts, &ts) != 0) && (errno == EINTR))
+    {
+    }
+}
+
+/*==================================================================================================
+                                          LOCAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Execute a program and put its standard output to a buffer
+
+@param[in]  name       - the command traced and reported in the error string
+@param[in]  argv       - NULL terminated argument list, argv[0] is searched in PATH
+@param[in]  timeout_ms - milliseconds to wait before the program is killed, <= 0 waits forever
+@param[out] p_out      - point to the output string buffer
+
+@return - TRUE if the program exits with status 0 before the timeout
+
+@note
+- see DG_DRV_UTIL_spawn()
+*//*==============================================================================================*/
+static BOOL dg_drv_util_run(const char* name, char* const argv[], int timeout_ms, char** p_out)
+{
+    BOOL                       ret       = FALSE;
+    BOOL                       b_timeout = FALSE;
+    int                        pipe_fd[2];
+    int                        err;
+    int                        status = 0;
+    pid_t                      pid;
+    char*                      buf      = NULL;
+    size_t                     buf_size = 0;
+    size_t                     len      = 0;
+    INT64                      deadline = -1;
+    posix_spawn_file_actions_t actions;
 
     *p_out = NULL;
 
-    DG_DBG_TRACE("Execute command: %s", cmd);
-    if ((fp = popen(cmd, "r")) == NULL)
+    DG_DBG_TRACE("Execute command: %s", name);
+    if (timeout_ms > 0)
     {
-        DG_DRV_UTIL_set_error_string("failed to run: %s, errno=%d(%m)", cmd, errno);
+        deadline = DG_DRV_UTIL_time_ms() + timeout_ms;
     }
-    else
+
+    /* close-on-exec keeps the read end out of commands spawned by other driver threads */
+    if (pipe2(pipe_fd, O_CLOEXEC) != 0)
+    {
+        DG_DRV_UTIL_set_error_string("failed to create pipe for %s, errno=%d(%m)", name, errno);
+        return FALSE;
+    }
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipe_fd[1], STDOUT_FILENO);
+    err = posix_spawnp(&pid, argv[0], &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipe_fd[1]);
+
+    if (err != 0)
     {
-        char*  line = NULL;
-        char*  buf  = NULL;
-        size_t len;
+        close(pipe_fd[0]);
+        DG_DRV_UTIL_set_error_string("failed to run: %s, errno=%d(%s)", name, err, strerror(err));
+        return FALSE;
+    }
 
-        int read       = 0;
-        int cur_pos    = 0;
-        int total_read = 1; /* alloc extra 1 byte for the \0 */
+    /* collect the output until the child closes its end of the pipe */
+    while (!b_timeout)
+    {
+        struct pollfd pfd = { pipe_fd[0], POLLIN, 0 };
+        ssize_t       read_len;
+        int           poll_ret = poll(&pfd, 1, dg_drv_util_remain_ms(deadline));
 
-        while ((read = getline(&line, &len, fp)) != -1)
+        if (poll_ret == 0)
         {
-            char* new_buf = NULL;
-            /* dump the output */
-            DG_DBG_TRACE("--> %s", line);
+            b_timeout = TRUE;
+            break;
+        }
+        else if ((poll_ret < 0) && (errno != EINTR))
+        {
+            DG_DBG_ERROR("poll() on command output failed. errno=%d(%m)", errno);
+            break;
+        }
+        else if (poll_ret < 0)
+        {
+            continue;
+        }
 
-            total_read += read;
+        /* keep one byte for the NULL terminator */
+        if (buf_size - len < 2)
+        {
+            size_t new_size = (buf_size == 0) ? DG_DRV_UTIL_OUT_BUF_SIZE : buf_size * 2;
+            char*  new_buf  = realloc(buf, new_size);
 
-            if ((new_buf = realloc(buf, total_read)) == NULL)
+            if (new_buf == NULL)
             {
-                DG_DBG_ERROR("Can't realloc command output buffer. size=%d", total_read);
-                free(buf);
-                buf = NULL;
+                DG_DBG_ERROR("Can't realloc command output buffer. size=%zu", new_size);
                 break;
             }
-            else
-            {
-                buf = new_buf;
-            }
-
-            /* append the data to buf */
-            memcpy(buf + cur_pos, line, read);
-            /* leave the last one byte */
-            cur_pos = total_read - 1;
+            buf      = new_buf;
+            buf_size = new_size;
         }
 
-        free(line);
-        sys_ret  = pclose(fp);
-        exit_val = WEXITSTATUS(sys_ret);
-        fp       = NULL;
+        read_len = read(pipe_fd[0], buf + len, buf_size - len - 1);
+        if (read_len > 0)
+        {
+            len += read_len;
+        }
+        else if (read_len == 0)
+        {
+            break;
+        }
+        else if (errno != EINTR)
+        {
+            DG_DBG_ERROR("read() command output failed. errno=%d(%m)", errno);
+            break;
+        }
+    }
+    close(pipe_fd[0]);
 
-        if (exit_val != 0)
+    /* the output may be closed before the child exits, so keep honouring the deadline */
+    while (!b_timeout && (waitpid(pid, &status, WNOHANG) == 0))
+    {
+        if (dg_drv_util_remain_ms(deadline) == 0)
+        {
+            b_timeout = TRUE;
+        }
+        else if (deadline < 0)
         {
-            DG_DRV_UTIL_set_error_string("%s, sys_ret = %d, exit_val = %d",
-                                         cmd, sys_ret, exit_val);
+            waitpid(pid, &status, 0);
+            break;
         }
         else
         {
-            DG_DBG_TRACE("Successfully Execute command: %s", cmd);
-            if (buf != NULL)
-            {
-                /* NULL terminator */
-                buf[total_read - 1] = '\0';
+            poll(NULL, 0, DG_DRV_UTIL_REAP_INTERVAL);
+        }
+    }
 
-                *p_out = buf;
-            }
-            ret = TRUE;
+    if (b_timeout)
+    {
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+        DG_DRV_UTIL_set_error_string("%s, timeout after %d ms", name, timeout_ms);
+    }
+    else if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+    {
+        DG_DRV_UTIL_set_error_string("%s, sys_ret = %d, exit_val = %d",
+                                     name, status, WEXITSTATUS(status));
+    }
+    else
+    {
+        DG_DBG_TRACE("Successfully Execute command: %s", name);
+        if (len > 0)
+        {
+            /* NULL terminator */
+            buf[len] = '\0';
+            DG_DBG_TRACE("--> %s", buf);
+
+            *p_out = buf;
+            buf    = NULL;
         }
+        ret = TRUE;
     }
 
+    free(buf);
     return ret;
 }
 
-/*==================================================================================================
-                                          LOCAL FUNCTIONS
-==================================================================================================*/
-
 /*=============================================================================================*//**
-@brief Create error string key for threads specific data
+@brief Get the milliseconds left before a deadline
 
-@note
-- this function register a free error string hanldler when thread exit
-- you should free the old error string before set a new error string
+@param[in] deadline - the deadline from DG_DRV_UTIL_time_ms(), negative means no deadline
+
+@return - the milliseconds left, 0 if the deadline passed, -1 if there is no deadline
 *//*==============================================================================================*/
-void dg_drv_util_create_error_string_key()
+static int dg_drv_util_remain_ms(INT64 deadline)
 {
-    int ret = pthread_key_create(&dg_drv_util_error_string_key, dg_drv_util_free_error_string);
+    INT64 remain;
 
-    if (ret != 0)
+    if (deadline < 0)
     {
-        DG_DBG_ERROR("pthread_key_create() for driver error string failed. errno=%d(%m)", errno);
+        return -1;
     }
+
+    remain = deadline - DG_DRV_UTIL_time_ms();
+    return (remain > 0) ? (int)remain : 0;
 }
 
 /*=============================================================================================*//**
-@brief Initializes error string for the current driver thread
-
-@note
-- when thread exit automatically call this function to free the error string
+@brief Build the CRC32 table, runs once
 *//*==============================================================================================*/
-void dg_drv_util_free_error_string(void* err_str)
+static void dg_drv_util_crc32_init(void)
 {
-    DG_DBG_TRACE("Free error string for thread %p", pthread_self());
-    free(err_str);
+    UINT32 i;
+    UINT32 j;
+    UINT32 crc;
+
+    for (i = 0; i < 256; i++)
+    {
+        crc = i;
+        for (j = 0; j < 8; j++)
+        {
+            crc = (crc & 1) ? (DG_DRV_UTIL_CRC32_POLY ^ (crc >> 1)) : (crc >> 1);
+        }
+        dg_drv_util_crc32_table[i] = crc;
+    }
 }
 
 /** @} */
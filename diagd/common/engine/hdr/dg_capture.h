@@ -0,0 +1,109 @@
+#ifndef _DG_CAPTURE_H
+#define _DG_CAPTURE_H
+/*==================================================================================================
+
+    Module Name:  dg_capture.h
+
+    General Description: This file provides the DIAG traffic capture
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include "dg_platform_defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*==================================================================================================
+                                             CONSTANTS
+==================================================================================================*/
+/*
+ * Capture file format, all the fields are in network byte order:
+ *
+ *   DG_CAPTURE_FILE_HDR_T
+ *   DG_CAPTURE_REC_HDR_T, then cap_len bytes of the frame as it was on the socket
+ *   DG_CAPTURE_REC_HDR_T, ...
+ *
+ * A frame is a DIAG request or response header followed by its data. A frame longer than the
+ * snap length is cut, the length in the frame header still tells the original length.
+ */
+#define DG_CAPTURE_MAGIC   0x44474350 /**< "DGCP" */
+#define DG_CAPTURE_VERSION 1
+
+#define DG_CAPTURE_MAX_SIZE_DEFAULT (64 * 1024 * 1024) /**< Default capture file size limit */
+
+/*==================================================================================================
+                                               MACROS
+==================================================================================================*/
+
+/*==================================================================================================
+                                TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+/** Direction of a captured frame */
+enum
+{
+    DG_CAPTURE_DIR_REQ = 0x00, /**< Request from a client */
+    DG_CAPTURE_DIR_RSP = 0x01, /**< Response to a client */
+};
+typedef UINT8 DG_CAPTURE_DIR_T;
+
+/** State of the capture */
+enum
+{
+    DG_CAPTURE_STATE_OFF   = 0x00, /**< Not capturing */
+    DG_CAPTURE_STATE_ON    = 0x01, /**< Capturing */
+    DG_CAPTURE_STATE_FULL  = 0x02, /**< The size limit is reached, new frames are dropped */
+    DG_CAPTURE_STATE_ERROR = 0x03, /**< Writing the file failed, new frames are dropped */
+};
+typedef UINT8 DG_CAPTURE_STATE_T;
+
+/** Capture file header */
+typedef struct
+{
+    UINT32 magic;        /**< DG_CAPTURE_MAGIC */
+    UINT16 version;      /**< DG_CAPTURE_VERSION */
+    UINT16 reserved;
+    UINT32 start_sec;    /**< Wall clock time the capture started */
+    UINT32 start_nsec;
+} DG_CAPTURE_FILE_HDR_T;
+
+/** Capture record header, one per frame */
+typedef struct
+{
+    UINT32 time_sec;     /**< Time since the capture started */
+    UINT32 time_nsec;
+    UINT16 client;       /**< Client socket, a socket number is reused once its client is gone */
+    UINT8  dir;          /**< DG_CAPTURE_DIR_T */
+    UINT8  reserved;
+    UINT32 cap_len;      /**< Number of frame bytes following the record header */
+} DG_CAPTURE_REC_HDR_T;
+
+/** Capture statistics */
+typedef struct
+{
+    DG_CAPTURE_STATE_T state;
+    UINT32             frames;   /**< Frames written */
+    UINT32             bytes;    /**< Size of the capture file */
+    UINT32             dropped;  /**< Frames dropped because of the size limit or an error */
+} DG_CAPTURE_STATUS_T;
+
+/*==================================================================================================
+                                        FUNCTION PROTOTYPES
+==================================================================================================*/
+BOOL DG_CAPTURE_start(UINT32 max_size, UINT32 snap_len);
+void DG_CAPTURE_stop(void);
+void DG_CAPTURE_get_status(DG_CAPTURE_STATUS_T* status);
+void DG_CAPTURE_record(int client, DG_CAPTURE_DIR_T dir, const void* hdr, UINT32 hdr_len,
+                       const void* data, UINT32 data_len);
+
+/*==================================================================================================
+                                          GLOBAL VARIABLES
+==================================================================================================*/
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,78 @@
+#ifndef _DG_CONF_H
+#define _DG_CONF_H
+/*==================================================================================================
+
+    Module Name:  dg_conf.h
+
+    General Description: Run-time configuration of the DIAG engine tunables
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include "dg_defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*==================================================================================================
+                                             CONSTANTS
+==================================================================================================*/
+/*
+ * The configuration file is read when the engine starts and again on every SIGHUP. Each line is
+ * "key = value", '#' starts a comment and the values are decimal, or hex with a 0x prefix:
+ *
+ *   sched.bulk_max = 2
+ *   timeout.0x0018 = 600000
+ *
+ * A key missing from the file keeps its compile-time default from dg_cfg.mk, a bad line is logged
+ * and skipped, so is a line longer than 255 characters. A reload replaces the whole
+ * configuration, the values are picked up the next time they are used, e.g. the socket backlog
+ * when a listening socket is opened. The file is ignored unless it is owned by root or the daemon
+ * user and only its owner can write it, a missing or ignored file gives the defaults at start-up
+ * and keeps the current configuration on a reload.
+ */
+#define DG_CONF_TIMEOUT_MAX 64 /**< Opcodes with a configured timeout */
+
+/*==================================================================================================
+                                               MACROS
+==================================================================================================*/
+
+/*==================================================================================================
+                                TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+/** Engine tunables, see dg_conf.c for their names in the file and their ranges */
+typedef enum
+{
+    DG_CONF_SCHED_BULK_MAX = 0,   /**< Handlers run at once by the bulk lane, 0 for no limit */
+    DG_CONF_SCHED_BACKGROUND_MAX, /**< Handlers run at once by the background lane */
+    DG_CONF_SCHED_INFLIGHT_MAX,   /**< Requests in flight in the engine */
+    DG_CONF_SCHED_CLIENT_MAX,     /**< Requests in flight per client, 0 for no limit */
+    DG_CONF_SCHED_OPCODE_MAX,     /**< Requests in flight per opcode, 0 for no limit */
+    DG_CONF_SOCKET_BACKLOG,       /**< Pending connections of a listening socket */
+    DG_CONF_REQ_MAX_LEN,          /**< Largest DIAG request data accepted from a client */
+    DG_CONF_LOG_LEVEL,            /**< Debug level, the platform default if not set */
+    DG_CONF_LOG_AUTOLOG_LEVEL,    /**< Autolog level, the platform default if not set */
+    DG_CONF_CACHE_VERSION,        /**< 1 to cache the version strings */
+    DG_CONF_CACHE_IFACE_ADDR,     /**< 1 to cache the local interface addresses */
+    DG_CONF_NUM
+} DG_CONF_KEY_T;
+
+/*==================================================================================================
+                                        FUNCTION PROTOTYPES
+==================================================================================================*/
+BOOL   DG_CONF_load(const char* path);
+UINT32 DG_CONF_get(DG_CONF_KEY_T key);
+BOOL   DG_CONF_is_set(DG_CONF_KEY_T key);
+UINT32 DG_CONF_get_timeout(DG_DEFS_OPCODE_T opcode, UINT32 timeout_msec);
+
+/*==================================================================================================
+                                          GLOBAL VARIABLES
+==================================================================================================*/
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -56,6 +56,15 @@ typedef enum
     DG_DEFS_MODE_ALL    = 0x08
 } DG_DEFS_MODE_T;
 
+/** Scheduling class of a DIAG handler, each class runs its handlers in its own lane */
+typedef enum
+{
+    DG_DEFS_SCHED_INTERACTIVE = 0, /**< Short polls, never queued */
+    DG_DEFS_SCHED_BULK,            /**< Long running tests, a few run at once */
+    DG_DEFS_SCHED_BACKGROUND,      /**< Flash programming and such, run one at a time */
+    DG_DEFS_SCHED_NUM
+} DG_DEFS_SCHED_CLASS_T;
+
 /** Target processor type */
 typedef enum
 {
@@ -127,6 +136,7 @@ typedef struct
     DG_DEFS_MODE_T         mode;         /**< Diag mode required for handler */
     DG_DEFS_DIAG_HANDLER_T fptr;         /**< Function pointer for opcode */
     UINT32                 timeout_msec; /**< Timeout time in msec */
+    DG_DEFS_SCHED_CLASS_T  sched_class;  /**< Lane the handler runs in */
 } DG_DEFS_OPCODE_ENTRY_T;
 
 
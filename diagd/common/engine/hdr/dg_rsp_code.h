@@ -52,6 +52,8 @@ typedef enum
     DG_RSP_CODE_CMD_TRANS_LEN_ERR    = 0x0E,     /**< Transport length error     */
     DG_RSP_CODE_CMD_RSP_IRRE_ERR     = 0x0F,     /**< Irrecoverable error        */
     DG_RSP_CODE_CMD_RSP_MUX_ERR      = 0x11,     /**< Open mux channel error     */
+    DG_RSP_CODE_CMD_RSP_BUSY         = 0x12,     /**< Engine busy, the data is the retry delay
+                                                      in msec (4 bytes) */
 
     DG_RSP_CODE_ASCII_ERR_LENGTH     = 0x80,     /**< ASCII length error         */
     DG_RSP_CODE_ASCII_ERR_MODE       = 0x83,     /**< ASCII mode error           */
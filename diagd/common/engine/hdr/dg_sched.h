@@ -0,0 +1,79 @@
+#ifndef _DG_SCHED_H
+#define _DG_SCHED_H
+/*==================================================================================================
+
+    Module Name:  dg_sched.h
+
+    General Description: Admits the DIAG requests and runs their handlers in lanes by their
+                         scheduling class
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include "dg_defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*==================================================================================================
+                                             CONSTANTS
+==================================================================================================*/
+/*
+ * Every handler still runs on its own thread, a lane only decides when the thread may call the
+ * handler:
+ *
+ *   - a lane runs at most its limit of handlers at once, the others wait in FIFO order
+ *   - a waiting request whose client got the timeout response leaves the queue without running
+ *   - the handlers of the lower classes run at a lower CPU priority
+ *
+ * So the long jobs of the bulk and background lanes can't hold more than a few threads and CPUs,
+ * while the interactive lane is never queued.
+ *
+ * Before that a request must be admitted, from its arrival until its handler thread exits it is
+ * in flight. A request over the in-flight limit of the engine, of its client or of its opcode is
+ * answered right away with DG_RSP_CODE_CMD_RSP_BUSY, so an overload costs no thread at all.
+ * A handler that timed out still counts until it returns. Once the handler has sent its response
+ * the request only counts for the engine, the client may already be sending its next one. The
+ * limits come from dg_conf.h.
+ */
+#define DG_SCHED_BUSY_RETRY_MSEC 100 /**< Retry delay suggested in a busy response */
+
+/*==================================================================================================
+                                               MACROS
+==================================================================================================*/
+
+/*==================================================================================================
+                                TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+/** Statistics of a lane */
+typedef struct
+{
+    UINT32 running;   /**< Handlers running now */
+    UINT32 queued;    /**< Requests waiting now */
+    UINT32 limit;     /**< Handlers run at once, 0 for no limit */
+    UINT32 admitted;  /**< Requests run so far */
+    UINT32 abandoned; /**< Requests timed out while waiting */
+} DG_SCHED_STATUS_T;
+
+/*==================================================================================================
+                                        FUNCTION PROTOTYPES
+==================================================================================================*/
+BOOL DG_SCHED_admit(DG_DEFS_DIAG_REQ_T* diag);
+void DG_SCHED_answered(DG_DEFS_DIAG_REQ_T* diag);
+void DG_SCHED_release(DG_DEFS_DIAG_REQ_T* diag);
+BOOL DG_SCHED_enter(DG_DEFS_SCHED_CLASS_T sched_class, DG_DEFS_DIAG_REQ_T* diag);
+void DG_SCHED_exit(DG_DEFS_SCHED_CLASS_T sched_class);
+void DG_SCHED_configure(void);
+void DG_SCHED_get_status(DG_DEFS_SCHED_CLASS_T sched_class, DG_SCHED_STATUS_T* status);
+
+/*==================================================================================================
+                                          GLOBAL VARIABLES
+==================================================================================================*/
+
+#ifdef __cplusplus
+}
+#endif
+#endif
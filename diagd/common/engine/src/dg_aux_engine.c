@@ -77,6 +77,7 @@ static int  dg_aux_engine_handle_override(int aux_id);
 static UINT16          dg_aux_engine_seq_tag        = 0;
 static int             dg_aux_engine_override_id    = DG_AUX_ENGINE_OVERRIDE_DISABLED;
 static pthread_mutex_t dg_aux_engine_override_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t dg_aux_engine_init_mutex     = PTHREAD_MUTEX_INITIALIZER;
 static pthread_t       dg_aux_engine_listener_thread_hndl[DG_CFG_AUX_NUM];
 static BOOL            dg_aux_engine_listener_run_ctrl[DG_CFG_AUX_NUM];
 
@@ -854,6 +855,9 @@ void dg_aux_engine_init_impl(int aux_id)
 {
     DG_PAL_AUX_ENGINE_INIT_T aux_status;
 
+    /* handler threads of several clients may init the same aux engine at once */
+    pthread_mutex_lock(&dg_aux_engine_init_mutex);
+
     /* Make sure the aux engine hasn't be initialized already */
     if (dg_aux_engine_listener_thread_hndl[aux_id] != 0)
     {
@@ -889,6 +893,8 @@ void dg_aux_engine_init_impl(int aux_id)
             }
         }
     }
+
+    pthread_mutex_unlock(&dg_aux_engine_init_mutex);
 }
 
 /*=============================================================================================*//**
@@ -898,6 +904,8 @@ void dg_aux_engine_init_impl(int aux_id)
 *//*==============================================================================================*/
 void dg_aux_engine_close_impl(int aux_id)
 {
+    pthread_mutex_lock(&dg_aux_engine_init_mutex);
+
     /* Make sure the aux engine has been initialized already */
     if (dg_aux_engine_listener_thread_hndl[aux_id] == 0)
     {
@@ -918,6 +926,8 @@ void dg_aux_engine_close_impl(int aux_id)
         DG_DBG_TRACE("Successfully shut down aux engine %d listener thread!", aux_id);
         dg_aux_engine_listener_thread_hndl[aux_id] = 0;
     }
+
+    pthread_mutex_unlock(&dg_aux_engine_init_mutex);
 }
 
 /*=============================================================================================*//**
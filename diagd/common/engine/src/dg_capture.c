@@ -0,0 +1,336 @@
+/*==================================================================================================
+
+    Module Name:  dg_capture.c
+
+    General Description: Records the DIAG requests and responses of all the clients into a file
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+#include "dg_platform_defs.h"
+#include "dg_dbg.h"
+#include "dg_capture.h"
+
+/*==================================================================================================
+                                          LOCAL CONSTANTS
+==================================================================================================*/
+#define DG_CAPTURE_NS_PER_SEC  1000000000ULL
+#define DG_CAPTURE_BUFFER_SIZE (64 * 1024) /**< stdio buffer, frames are written in batches */
+
+/*==================================================================================================
+                                            LOCAL MACROS
+==================================================================================================*/
+
+/*==================================================================================================
+                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+
+/*==================================================================================================
+                                     LOCAL FUNCTION PROTOTYPES
+==================================================================================================*/
+static UINT64 dg_capture_now(clockid_t clock);
+static FILE*  dg_capture_open(void);
+static BOOL   dg_capture_write(const void* buf, UINT32 len);
+
+/*==================================================================================================
+                                          LOCAL VARIABLES
+==================================================================================================*/
+static pthread_mutex_t dg_capture_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* read without the lock, so the client threads pay nothing while no capture is running */
+static volatile DG_CAPTURE_STATE_T dg_capture_state = DG_CAPTURE_STATE_OFF;
+
+static FILE*  dg_capture_file = NULL;
+static char   dg_capture_buffer[DG_CAPTURE_BUFFER_SIZE];
+static UINT64 dg_capture_start_ns;
+static UINT32 dg_capture_max_size;
+static UINT32 dg_capture_snap_len;
+static UINT32 dg_capture_frames;
+static UINT32 dg_capture_bytes;
+static UINT32 dg_capture_dropped;
+
+/*==================================================================================================
+                                          GLOBAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Starts capturing the DIAG traffic into DG_CFG_CAPTURE_FILE
+
+@param[in] max_size - Capture file size limit, 0 for DG_CAPTURE_MAX_SIZE_DEFAULT
+@param[in] snap_len - Maximum number of bytes kept from each frame, 0 to keep the whole frame
+
+@return TRUE if the capture is started, FALSE if it is already running or the file can't be
+        written
+
+@note
+- a frame is never cut shorter than its DIAG header
+*//*==============================================================================================*/
+BOOL DG_CAPTURE_start(UINT32 max_size, UINT32 snap_len)
+{
+    BOOL                  ret = FALSE;
+    DG_CAPTURE_FILE_HDR_T file_hdr;
+    UINT64                wall_ns;
+
+    pthread_mutex_lock(&dg_capture_mutex);
+
+    if (dg_capture_state != DG_CAPTURE_STATE_OFF)
+    {
+        DG_DBG_ERROR("Capture is already running");
+    }
+    else if ((dg_capture_file = dg_capture_open()) == NULL)
+    {
+        /* error is logged */
+    }
+    else
+    {
+        setvbuf(dg_capture_file, dg_capture_buffer, _IOFBF, sizeof(dg_capture_buffer));
+
+        dg_capture_start_ns = dg_capture_now(CLOCK_MONOTONIC);
+        wall_ns             = dg_capture_now(CLOCK_REALTIME);
+
+        file_hdr.magic      = htonl(DG_CAPTURE_MAGIC);
+        file_hdr.version    = htons(DG_CAPTURE_VERSION);
+        file_hdr.reserved   = 0;
+        file_hdr.start_sec  = htonl((UINT32)(wall_ns / DG_CAPTURE_NS_PER_SEC));
+        file_hdr.start_nsec = htonl((UINT32)(wall_ns % DG_CAPTURE_NS_PER_SEC));
+
+        if (fwrite(&file_hdr, sizeof(file_hdr), 1, dg_capture_file) != 1)
+        {
+            DG_DBG_ERROR("Failed to write %s, errno=%d(%m)", DG_CFG_CAPTURE_FILE, errno);
+            fclose(dg_capture_file);
+            dg_capture_file = NULL;
+        }
+        else
+        {
+            dg_capture_max_size = (max_size != 0) ? max_size : DG_CAPTURE_MAX_SIZE_DEFAULT;
+            dg_capture_snap_len = snap_len;
+            dg_capture_frames   = 0;
+            dg_capture_bytes    = sizeof(file_hdr);
+            dg_capture_dropped  = 0;
+            dg_capture_state    = DG_CAPTURE_STATE_ON;
+
+            DG_DBG_TRACE("Capture started into %s, max_size=%d, snap_len=%d",
+                         DG_CFG_CAPTURE_FILE, dg_capture_max_size, dg_capture_snap_len);
+            ret = TRUE;
+        }
+    }
+
+    pthread_mutex_unlock(&dg_capture_mutex);
+
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief Stops the capture and closes the capture file
+
+@note
+- the statistics of the last capture are kept until the next one is started
+*//*==============================================================================================*/
+void DG_CAPTURE_stop(void)
+{
+    pthread_mutex_lock(&dg_capture_mutex);
+
+    if (dg_capture_state != DG_CAPTURE_STATE_OFF)
+    {
+        dg_capture_state = DG_CAPTURE_STATE_OFF;
+        fclose(dg_capture_file);
+        dg_capture_file = NULL;
+
+        DG_DBG_TRACE("Capture stopped, frames=%d, bytes=%d, dropped=%d",
+                     dg_capture_frames, dg_capture_bytes, dg_capture_dropped);
+    }
+
+    pthread_mutex_unlock(&dg_capture_mutex);
+}
+
+/*=============================================================================================*//**
+@brief Gets the state and the statistics of the capture
+
+@param[out] status - The capture status
+*//*==============================================================================================*/
+void DG_CAPTURE_get_status(DG_CAPTURE_STATUS_T* status)
+{
+    pthread_mutex_lock(&dg_capture_mutex);
+
+    status->state   = dg_capture_state;
+    status->frames  = dg_capture_frames;
+    status->bytes   = dg_capture_bytes;
+    status->dropped = dg_capture_dropped;
+
+    pthread_mutex_unlock(&dg_capture_mutex);
+}
+
+/*=============================================================================================*//**
+@brief Records one frame if a capture is running
+
+@param[in] client   - The client socket
+@param[in] dir      - Request or response
+@param[in] hdr      - The DIAG header, in network byte order
+@param[in] hdr_len  - Length of the DIAG header
+@param[in] data     - The DIAG data
+@param[in] data_len - Length of the DIAG data
+
+@note
+- once the size limit is reached the capture stays open, the later frames are only counted as
+  dropped, so the file keeps the traffic leading up to the incident
+*//*==============================================================================================*/
+void DG_CAPTURE_record(int client, DG_CAPTURE_DIR_T dir, const void* hdr, UINT32 hdr_len,
+                       const void* data, UINT32 data_len)
+{
+    DG_CAPTURE_REC_HDR_T rec_hdr;
+    UINT32               cap_len = hdr_len + data_len;
+    UINT64               time_ns;
+
+    if (dg_capture_state == DG_CAPTURE_STATE_OFF)
+    {
+        return;
+    }
+
+    time_ns = dg_capture_now(CLOCK_MONOTONIC);
+
+    pthread_mutex_lock(&dg_capture_mutex);
+
+    if ((dg_capture_snap_len != 0) && (cap_len > dg_capture_snap_len))
+    {
+        cap_len = (dg_capture_snap_len > hdr_len) ? dg_capture_snap_len : hdr_len;
+    }
+
+    if (dg_capture_state == DG_CAPTURE_STATE_OFF)
+    {
+        /* stopped in the meantime */
+    }
+    else if (dg_capture_state == DG_CAPTURE_STATE_ERROR)
+    {
+        dg_capture_dropped++;
+    }
+    else if ((dg_capture_state == DG_CAPTURE_STATE_FULL) ||
+             (dg_capture_bytes + sizeof(rec_hdr) + cap_len > dg_capture_max_size))
+    {
+        if (dg_capture_state == DG_CAPTURE_STATE_ON)
+        {
+            DG_DBG_ERROR("Capture file is full, size=%d", dg_capture_bytes);
+            dg_capture_state = DG_CAPTURE_STATE_FULL;
+            fflush(dg_capture_file);
+        }
+        dg_capture_dropped++;
+    }
+    else
+    {
+        time_ns = (time_ns > dg_capture_start_ns) ? (time_ns - dg_capture_start_ns) : 0;
+
+        rec_hdr.time_sec  = htonl((UINT32)(time_ns / DG_CAPTURE_NS_PER_SEC));
+        rec_hdr.time_nsec = htonl((UINT32)(time_ns % DG_CAPTURE_NS_PER_SEC));
+        rec_hdr.client    = htons((UINT16)client);
+        rec_hdr.dir       = dir;
+        rec_hdr.reserved  = 0;
+        rec_hdr.cap_len   = htonl(cap_len);
+
+        if (!dg_capture_write(&rec_hdr, sizeof(rec_hdr)) ||
+            !dg_capture_write(hdr, hdr_len) ||
+            !dg_capture_write(data, cap_len - hdr_len))
+        {
+            /* the file may end with a partial frame, nothing more is written after it */
+            DG_DBG_ERROR("Failed to write %s, errno=%d(%m), size=%d",
+                         DG_CFG_CAPTURE_FILE, errno, dg_capture_bytes);
+            dg_capture_state = DG_CAPTURE_STATE_ERROR;
+            dg_capture_dropped++;
+        }
+        else
+        {
+            dg_capture_frames++;
+            dg_capture_bytes += sizeof(rec_hdr) + cap_len;
+        }
+    }
+
+    pthread_mutex_unlock(&dg_capture_mutex);
+}
+
+/*==================================================================================================
+                                           LOCAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Gets the time of a clock in nanoseconds
+
+@param[in] clock - The clock to read
+
+@return the time in nanoseconds
+*//*==============================================================================================*/
+static UINT64 dg_capture_now(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (UINT64)ts.tv_sec * DG_CAPTURE_NS_PER_SEC + ts.tv_nsec;
+}
+
+/*=============================================================================================*//**
+@brief Opens a new capture file
+
+@return the capture file, NULL if it can't be created
+
+@note
+- the file is created in DG_CFG_CAPTURE_DIR, a directory only the daemon user can write, so the
+  previous capture can be removed and the new file created without following a planted link
+*//*==============================================================================================*/
+static FILE* dg_capture_open(void)
+{
+    FILE*       file = NULL;
+    struct stat st;
+    int         fd;
+
+    if ((mkdir(DG_CFG_CAPTURE_DIR, 0700) != 0) && (errno != EEXIST))
+    {
+        DG_DBG_ERROR("Failed to create %s, errno=%d(%m)", DG_CFG_CAPTURE_DIR, errno);
+    }
+    else if (lstat(DG_CFG_CAPTURE_DIR, &st) != 0)
+    {
+        DG_DBG_ERROR("Failed to stat %s, errno=%d(%m)", DG_CFG_CAPTURE_DIR, errno);
+    }
+    else if (!S_ISDIR(st.st_mode) || (st.st_uid != geteuid()) ||
+             ((st.st_mode & (S_IWGRP | S_IWOTH)) != 0))
+    {
+        DG_DBG_ERROR("%s is not a directory only uid %d can write, mode=0%o, uid=%d",
+                     DG_CFG_CAPTURE_DIR, geteuid(), st.st_mode, st.st_uid);
+    }
+    else if ((unlink(DG_CFG_CAPTURE_FILE) != 0) && (errno != ENOENT))
+    {
+        DG_DBG_ERROR("Failed to remove %s, errno=%d(%m)", DG_CFG_CAPTURE_FILE, errno);
+    }
+    else if ((fd = open(DG_CFG_CAPTURE_FILE,
+                        O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600)) < 0)
+    {
+        DG_DBG_ERROR("Failed to open %s, errno=%d(%m)", DG_CFG_CAPTURE_FILE, errno);
+    }
+    else if ((file = fdopen(fd, "w")) == NULL)
+    {
+        DG_DBG_ERROR("Failed to open %s, errno=%d(%m)", DG_CFG_CAPTURE_FILE, errno);
+        close(fd);
+    }
+
+    return file;
+}
+
+/*=============================================================================================*//**
+@brief Writes a buffer to the capture file
+
+@param[in] buf - The data to write
+@param[in] len - Length of the data, 0 writes nothing
+
+@return TRUE if the whole buffer is written
+*//*==============================================================================================*/
+static BOOL dg_capture_write(const void* buf, UINT32 len)
+{
+    return (len == 0) || (fwrite(buf, len, 1, dg_capture_file) == 1);
+}
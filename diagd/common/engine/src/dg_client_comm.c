@@ -24,6 +24,10 @@ Xudong Huang    - xudongh    2013/12/11     xxxxx-0000   Creation
 #include <errno.h>
 #include "dg_defs.h"
 #include "dg_dbg.h"
+#include "dg_capture.h"
+#include "dg_conf.h"
+#include "dg_sched.h"
+#include "dg_shm.h"
 #include "dg_client_comm.h"
 #include "dg_aux_util.h"
 #include "dg_drv_util.h"
@@ -86,8 +90,12 @@ struct dg_client_comm_client_node_int_t
 static const DG_DEFS_OPCODE_ENTRY_T* dg_client_comm_find_diag_handler(DG_DEFS_OPCODE_T opcode);
 static void*                         dg_client_comm_diag_handler_exec(void* diag);
 static void                          dg_client_comm_diag_handler_create_thread(DG_DEFS_DIAG_REQ_T* diag);
-static DG_DEFS_DIAG_REQ_T*           dg_client_comm_read_diag_req(int fd);
+static DG_DEFS_DIAG_REQ_T*           dg_client_comm_read_diag_req(int fd, int* shm_fds);
+static BOOL                          dg_client_comm_read_hdr(int fd, DG_DEFS_DIAG_REQ_HDR_T* hdr,
+                                                             int* shm_fds);
 static BOOL                          dg_client_comm_read_fd(int fd, void* buff, int len);
+static void                          dg_client_comm_shm_attach(DG_DEFS_DIAG_REQ_T* diag,
+                                                               int* shm_fds);
 static void                          dg_client_comm_remove_client_from_list(int socket);
 static void                          dg_client_comm_notify_client_update(BOOL is_add);
 static void                          dg_client_comm_alt_timer_create_thread(DG_DEFS_DIAG_REQ_T* diag);
@@ -190,6 +198,7 @@ void* DG_CLIENT_COMM_client_connection_handler(void* socket_void)
     struct sigaction    sa;
     DG_DEFS_DIAG_REQ_T* diag   = NULL;
     int                 socket = *(int*)(&socket_void);
+    int                 shm_fds[DG_SHM_FD_NUM];
 
     DG_DBG_TRACE("Start client connection handler for socket %d", socket);
     dg_client_comm_notify_client_update(TRUE);
@@ -210,19 +219,24 @@ void* DG_CLIENT_COMM_client_connection_handler(void* socket_void)
 
     while (DG_MAIN_engine_exit_flag == FALSE)
     {
-        diag = dg_client_comm_read_diag_req(socket);
-        if (diag != NULL)
+        diag = dg_client_comm_read_diag_req(socket, shm_fds);
+        if (diag == NULL)
         {
-            dg_client_comm_diag_handler_create_thread(diag);
+            DG_DBG_ERROR("Reading DIAG request failed, exiting client thread for socket %d", socket);
+            break;
+        }
+        else if (diag->header.opcode == DG_SHM_OPCODE)
+        {
+            dg_client_comm_shm_attach(diag, shm_fds);
         }
         else
         {
-            DG_DBG_ERROR("Reading DIAG request failed, exiting client thread for socket %d", socket);
-            break;
+            dg_client_comm_diag_handler_create_thread(diag);
         }
     }
 
     dg_client_comm_remove_client_from_list(socket);
+    DG_SHM_detach(socket);
     shutdown(socket, SHUT_RDWR);
     close(socket);
     dg_client_comm_notify_client_update(FALSE);
@@ -280,9 +294,10 @@ BOOL DG_CLIENT_COMM_add_client_to_list(int socket, DG_CLIENT_COMM_CLIENT_TYPE_T
 *//*==============================================================================================*/
 BOOL DG_CLIENT_COMM_client_write(int fd, DG_DEFS_DIAG_RSP_T* rsp)
 {
-    INT32  write_len = 0;
-    BOOL   status    = FALSE;
-    UINT8* write_buff;
+    INT32             write_len = 0;
+    BOOL              status    = FALSE;
+    UINT8*            write_buff;
+    DG_SHM_CHANNEL_T* shm;
 
     DG_DBG_TRACE("DIAG opcode = 0x%04x, length = %d, fd = %d",
                  rsp->header.opcode, rsp->header.length, fd);
@@ -302,7 +317,17 @@ BOOL DG_CLIENT_COMM_client_write(int fd, DG_DEFS_DIAG_RSP_T* rsp)
         }
         DG_DBG_DUMP(write_buff, write_len);
 
-        if (write(fd, write_buff, write_len) < 0)
+        if ((shm = DG_SHM_get(fd)) != NULL)
+        {
+            status = DG_SHM_write(shm, write_buff, write_len);
+            DG_SHM_put(shm);
+        }
+        else
+        {
+            status = (write(fd, write_buff, write_len) >= 0) ? TRUE : FALSE;
+        }
+
+        if (!status)
         {
             DG_DBG_ERROR("Write data to fd = %d failed! Length attempted = %d", fd, write_len);
         }
@@ -310,7 +335,8 @@ BOOL DG_CLIENT_COMM_client_write(int fd, DG_DEFS_DIAG_RSP_T* rsp)
         {
             DG_DBG_TRACE("Sent %d byte(s) DIAG opcode = 0x%04x to fd:%d succeeded.",
                          write_len, rsp->header.opcode, fd);
-            status = TRUE;
+            DG_CAPTURE_record(fd, DG_CAPTURE_DIR_RSP, write_buff, sizeof(rsp->header),
+                              write_buff + sizeof(rsp->header), rsp->header.length);
         }
         free(write_buff);
     }
@@ -423,6 +449,10 @@ void* dg_client_comm_diag_handler_exec(void* diag_void)
                                             "DIAG Mode Error!  cur_mode=%d, desire_mode=%d",
                                             DG_ENGINE_UTIL_get_engine_mode(), diag_handler->mode);
     }
+    else if (!DG_SCHED_enter(diag_handler->sched_class, diag))
+    {
+        /* the client already got the timeout response, there is nothing left to do */
+    }
     else
     {
         /* Call the handler function for the diag, this will block until the diag is complete */
@@ -430,13 +460,14 @@ void* dg_client_comm_diag_handler_exec(void* diag_void)
                      pthread_self(), diag_handler->fptr, diag->header.opcode);
 
         /*
-         * here we got the chance to set the connection between diag rsp and pthread_self()
-         * we save this information in the thread specific data
-         * so that the driver layer could get the error string correctly for its own thread
+         * the driver error lives in thread local storage, clear it here
+         * so that the response only carries the error string of this diag
          */
         DG_DRV_UTIL_init_error_string();
 
         diag_handler->fptr(diag);
+
+        DG_SCHED_exit(diag_handler->sched_class);
     }
 
     /* Only send a response in a failure case */
@@ -467,6 +498,7 @@ void* dg_client_comm_diag_handler_exec(void* diag_void)
     }
     pthread_mutex_unlock(&(diag->delete_mutex));
     DG_DBG_TRACE("Delete DIAG request for DIAG opcode 0x%04x", diag->header.opcode);
+    DG_SCHED_release(diag);
     DG_ENGINE_UTIL_free_diag_req(diag);
 
     return NULL;
@@ -486,18 +518,27 @@ void dg_client_comm_diag_handler_create_thread(DG_DEFS_DIAG_REQ_T* diag)
 /*=============================================================================================*//**
 @brief Reads a DIAG request from the client
 
-@param[in] fd - File descriptor to read from
+@param[in]  fd      - File descriptor to read from
+@param[out] shm_fds - Shared memory fds passed along with a DG_SHM_OPCODE request, -1 if none
 
 @return The DIAG request that was read, NULL in case of error.
 
 @note
  - Calling function is responsible for freeing request using DG_ENGINE_UTIL_free_diag_req()
 *//*==============================================================================================*/
-DG_DEFS_DIAG_REQ_T* dg_client_comm_read_diag_req(int fd)
+DG_DEFS_DIAG_REQ_T* dg_client_comm_read_diag_req(int fd, int* shm_fds)
 {
-    DG_DEFS_DIAG_REQ_HDR_T diag_hdr;
-    BOOL                   is_success = FALSE;
-    DG_DEFS_DIAG_REQ_T*    diag_req   = NULL;
+    DG_DEFS_DIAG_REQ_HDR_T      diag_hdr;
+    BOOL                        is_success = FALSE;
+    DG_DEFS_DIAG_REQ_T*         diag_req   = NULL;
+    DG_DEFS_DIAG_RSP_BUILDER_T* rsp;
+    UINT32                      max_len = DG_CONF_get(DG_CONF_REQ_MAX_LEN);
+    int                         i;
+
+    for (i = 0; i < DG_SHM_FD_NUM; i++)
+    {
+        shm_fds[i] = -1;
+    }
 
     /* Allocate memory for DIAG request */
     if ((diag_req = (DG_DEFS_DIAG_REQ_T*)malloc(sizeof(DG_DEFS_DIAG_REQ_T))) == NULL)
@@ -519,7 +560,7 @@ DG_DEFS_DIAG_REQ_T* dg_client_comm_read_diag_req(int fd)
         diag_req->can_delete = FALSE;
         diag_req->is_handled = FALSE;
 
-        if (dg_client_comm_read_fd(fd, &diag_hdr, sizeof(diag_hdr)))
+        if (dg_client_comm_read_hdr(fd, &diag_hdr, shm_fds))
         {
             /* Do endian conversion */
             DG_ENGINE_UTIL_hdr_req_ntoh(&diag_hdr, &(diag_req->header));
@@ -527,7 +568,19 @@ DG_DEFS_DIAG_REQ_T* dg_client_comm_read_diag_req(int fd)
                          diag_req->header.opcode, diag_req->header.length);
 
             /* Read request data if its present */
-            if (diag_req->header.length != 0)
+            if (diag_req->header.length > max_len)
+            {
+                /* a broken client, the stream can't be resynced, so the connection is closed */
+                DG_DBG_ERROR("DIAG request length %u is over the limit %u, opcode = 0x%04x",
+                             diag_req->header.length, max_len, diag_req->header.opcode);
+                rsp = DG_ENGINE_UTIL_rsp_init();
+                DG_ENGINE_UTIL_rsp_set_error_string(rsp, DG_RSP_CODE_ASCII_ERR_LENGTH,
+                                                    "Request length %u is over the limit %u",
+                                                    diag_req->header.length, max_len);
+                DG_ENGINE_UTIL_rsp_send(rsp, diag_req);
+                DG_ENGINE_UTIL_rsp_free(rsp);
+            }
+            else if (diag_req->header.length != 0)
             {
                 if ((diag_req->data_ptr = (UINT8*)malloc(diag_req->header.length)) == NULL)
                 {
@@ -558,10 +611,61 @@ DG_DEFS_DIAG_REQ_T* dg_client_comm_read_diag_req(int fd)
         DG_ENGINE_UTIL_free_diag_req(diag_req);
         diag_req = NULL;
     }
+    else
+    {
+        DG_CAPTURE_record(fd, DG_CAPTURE_DIR_REQ, &diag_hdr, sizeof(diag_hdr),
+                          diag_req->data_ptr, diag_req->header.length);
+    }
+
+    /* fds only belong to a shared memory request, any others are dropped right away */
+    if ((diag_req == NULL) || (diag_req->header.opcode != DG_SHM_OPCODE))
+    {
+        for (i = 0; i < DG_SHM_FD_NUM; i++)
+        {
+            if (shm_fds[i] >= 0)
+            {
+                close(shm_fds[i]);
+                shm_fds[i] = -1;
+            }
+        }
+    }
 
     return diag_req;
 }
 
+/*=============================================================================================*//**
+@brief Reads a DIAG request header, keeping the fds a client may pass along with it
+
+@param[in]  fd      - File descriptor to read from
+@param[out] hdr     - The header read, in network byte order
+@param[out] shm_fds - The fds received, -1 if none
+
+@return Success/failure of read
+*//*==============================================================================================*/
+BOOL dg_client_comm_read_hdr(int fd, DG_DEFS_DIAG_REQ_HDR_T* hdr, int* shm_fds)
+{
+    BOOL              status = FALSE;
+    int               len;
+    DG_SHM_CHANNEL_T* shm;
+
+    if ((shm = DG_SHM_get(fd)) != NULL)
+    {
+        DG_SHM_put(shm);
+        status = dg_client_comm_read_fd(fd, hdr, sizeof(*hdr));
+    }
+    else if ((len = DG_SHM_recv_fds(fd, hdr, sizeof(*hdr), shm_fds)) > 0)
+    {
+        DG_DBG_DUMP(hdr, len);
+        status = dg_client_comm_read_fd(fd, (UINT8*)hdr + len, sizeof(*hdr) - len);
+    }
+    else if (len < 0)
+    {
+        DG_DBG_ERROR("Read failed on fd %d, errno=%d(%m)", fd, errno);
+    }
+
+    return status;
+}
+
 /*=============================================================================================*//**
 @brief Reads the specified number of bytes from the given file descriptor
 
@@ -573,12 +677,25 @@ DG_DEFS_DIAG_REQ_T* dg_client_comm_read_diag_req(int fd)
 *//*==============================================================================================*/
 BOOL dg_client_comm_read_fd(int fd, void* buff, int len)
 {
-    BOOL status             = TRUE;
-    int  total_bytes_read   = 0;
-    int  current_bytes_read = 0;
-    int  try_count          = 0;
+    BOOL              status             = TRUE;
+    int               total_bytes_read   = 0;
+    int               current_bytes_read = 0;
+    int               try_count          = 0;
+    DG_SHM_CHANNEL_T* shm;
 
     DG_DBG_TRACE("Attempt to read %d bytes from client fd %d", len, fd);
+
+    /* A client on shared memory never sends on its socket again */
+    if ((shm = DG_SHM_get(fd)) != NULL)
+    {
+        if (!DG_SHM_read(shm, buff, len))
+        {
+            DG_DBG_ERROR("Read failed on shared memory of fd %d, errno=%d(%m)", fd, errno);
+            status = FALSE;
+        }
+        DG_SHM_put(shm);
+        return status;
+    }
     /* Continue to read until an error occurs or we read the desired number of bytes */
     while (status && (total_bytes_read != len))
     {
@@ -609,6 +726,50 @@ BOOL dg_client_comm_read_fd(int fd, void* buff, int len)
     return status;
 }
 
+/*=============================================================================================*//**
+@brief Moves a client onto the shared memory channel it passed with a DG_SHM_OPCODE request
+
+@param[in] diag    - The DG_SHM_OPCODE request, freed here
+@param[in] shm_fds - The fds passed along with the request, taken over here
+
+@note
+- the response still goes over the socket, the channel is only attached after it, so the client
+  switches over on a success response and keeps the socket otherwise
+- a request coming over the channel carries no fds and fails, a client can't attach twice
+*//*==============================================================================================*/
+void dg_client_comm_shm_attach(DG_DEFS_DIAG_REQ_T* diag, int* shm_fds)
+{
+    DG_DEFS_DIAG_RSP_BUILDER_T* rsp = DG_ENGINE_UTIL_rsp_init();
+    DG_SHM_CHANNEL_T*           shm;
+
+    if ((shm = DG_SHM_open(diag->sender_id, shm_fds)) == NULL)
+    {
+        DG_DBG_ERROR("Failed to open shared memory of fd %d, errno=%d(%m)", diag->sender_id, errno);
+        DG_ENGINE_UTIL_rsp_set_error_string(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                            "Failed to open shared memory, errno=%d", errno);
+    }
+    else if (!DG_ENGINE_UTIL_req_len_check_equal(diag, 0, rsp))
+    {
+        DG_SHM_close(shm);
+        shm = NULL;
+    }
+    else
+    {
+        DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+    }
+
+    DG_ENGINE_UTIL_rsp_send(rsp, diag);
+    DG_ENGINE_UTIL_rsp_free(rsp);
+
+    if (shm != NULL)
+    {
+        DG_SHM_attach(shm);
+        DG_DBG_TRACE("Client fd %d moved to shared memory", diag->sender_id);
+    }
+
+    DG_ENGINE_UTIL_free_diag_req(diag);
+}
+
 /*=============================================================================================*//**
 @brief Removes the client from the connected clients list
 
@@ -687,6 +848,8 @@ void dg_client_comm_alt_timer_create_thread(DG_DEFS_DIAG_REQ_T* diag)
     struct timespec               timeout_time;
     pthread_t                     thread_id;
     BOOL                          is_client_thread_created = FALSE;
+    UINT32                        retry_msec               = DG_SCHED_BUSY_RETRY_MSEC;
+    UINT32                        timeout_msec             = 0;
 
     DG_DBG_TRACE("Creating thread for DIAG 0x%04x", diag->header.opcode);
 
@@ -700,11 +863,21 @@ void dg_client_comm_alt_timer_create_thread(DG_DEFS_DIAG_REQ_T* diag)
         DG_DBG_ERROR("Opcode 0x%04x was not found", diag->header.opcode);
         DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_PAR_ERR_OPCODE);
     }
+    else if (!DG_SCHED_admit(diag))
+    {
+        /* Shed the request before it costs a thread, tell the client when to retry */
+        if (DG_ENGINE_UTIL_rsp_data_alloc(rsp, sizeof(retry_msec)))
+        {
+            DG_ENGINE_UTIL_rsp_append_data_hton(rsp, retry_msec);
+        }
+        DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_BUSY);
+    }
     else
     {
         /* Get the current time of day */
         if (gettimeofday(&time_of_day, NULL) != 0)
         {
+            DG_SCHED_release(diag);
             DG_ENGINE_UTIL_rsp_set_error_string(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
                                                 "Failed to get time of day, errno=%d(%m)", errno);
         }
@@ -713,12 +886,15 @@ void dg_client_comm_alt_timer_create_thread(DG_DEFS_DIAG_REQ_T* diag)
             /* Add the timeout time to the time of day to get absolute timeout time */
             timeout_time.tv_sec  = time_of_day.tv_sec;
             timeout_time.tv_nsec = time_of_day.tv_usec * 1000;
-            timeout_time.tv_sec += (diag_handler->timeout_msec / 1000);
+            timeout_msec         = DG_CONF_get_timeout(diag->header.opcode,
+                                                       diag_handler->timeout_msec);
+            timeout_time.tv_sec += (timeout_msec / 1000);
 
             /* Create the thread */
             status = pthread_create(&thread_id, NULL, dg_client_comm_diag_handler_exec, (void*)diag);
             if (status != 0)
             {
+                DG_SCHED_release(diag);
                 DG_ENGINE_UTIL_rsp_set_error_string(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
                                                     "Creating handler thread failed, errno=%d(%m)",
                                                     errno);
@@ -743,7 +919,7 @@ void dg_client_comm_alt_timer_create_thread(DG_DEFS_DIAG_REQ_T* diag)
                         /* If a time out occurred, return a timeout response */
                         DG_ENGINE_UTIL_rsp_set_error_string(rsp, DG_RSP_CODE_ASCII_RSP_TIMEOUT,
                                                             "Handler thread timed out, time out=%d seconds",
-                                                            (diag_handler->timeout_msec / 1000));
+                                                            (timeout_msec / 1000));
                         break;
                     }
                     else if (status != 0)
@@ -783,6 +959,11 @@ void dg_client_comm_alt_timer_create_thread(DG_DEFS_DIAG_REQ_T* diag)
         pthread_cond_signal(&(diag->delete_cond));
         pthread_mutex_unlock(&(diag->delete_mutex));
     }
+    else
+    {
+        /* No handler thread owns the request */
+        DG_ENGINE_UTIL_free_diag_req(diag);
+    }
 }
 
 /*=============================================================================================*//**
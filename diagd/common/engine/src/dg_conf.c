@@ -0,0 +1,459 @@
+/*==================================================================================================
+
+    Module Name:  dg_conf.c
+
+    General Description: Run-time configuration of the DIAG engine tunables
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "dg_platform_defs.h"
+#include "dg_dbg.h"
+#include "dg_conf.h"
+
+/*==================================================================================================
+                                          LOCAL CONSTANTS
+==================================================================================================*/
+#define DG_CONF_LINE_MAX       256
+#define DG_CONF_TIMEOUT_PREFIX "timeout."
+#define DG_CONF_TIMEOUT_MIN    1000     /**< The timeouts are handled in seconds */
+#define DG_CONF_TIMEOUT_LIMIT  86400000 /**< One day */
+#define DG_CONF_REQ_LIMIT      0x10000000 /**< 256MB, a request is buffered whole before handling */
+
+/*==================================================================================================
+                                            LOCAL MACROS
+==================================================================================================*/
+#if (DG_CFG_SCHED_INFLIGHT_MAX <= 0)
+    #error "Error, DG_CFG_SCHED_INFLIGHT_MAX must be at least 1!"
+#endif
+#if (DG_CFG_REQ_MAX_LEN > DG_CONF_REQ_LIMIT)
+    #error "Error, DG_CFG_REQ_MAX_LEN must not be over DG_CONF_REQ_LIMIT!"
+#endif
+
+/*==================================================================================================
+                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+/** A tunable as it appears in the file */
+typedef struct
+{
+    const char* name; /**< Key in the file */
+    UINT32      def;  /**< Value if the key is not set */
+    UINT32      min;  /**< Smallest value accepted */
+    UINT32      max;  /**< Largest value accepted */
+} DG_CONF_ITEM_T;
+
+/** The timeout of an opcode, overrides the one of the handler table */
+typedef struct
+{
+    DG_DEFS_OPCODE_T opcode;
+    UINT32           timeout_msec;
+} DG_CONF_TIMEOUT_T;
+
+/** A whole configuration, a load builds a new one and then swaps it in */
+typedef struct
+{
+    UINT32            value[DG_CONF_NUM];
+    BOOL              is_set[DG_CONF_NUM];
+    DG_CONF_TIMEOUT_T timeout[DG_CONF_TIMEOUT_MAX];
+    UINT32            timeout_num;
+} DG_CONF_T;
+
+/*==================================================================================================
+                                     LOCAL FUNCTION PROTOTYPES
+==================================================================================================*/
+static void  dg_conf_set_defaults(DG_CONF_T* conf);
+static FILE* dg_conf_open(const char* path);
+static BOOL  dg_conf_parse_line(DG_CONF_T* conf, char* line, const char* path, UINT32 line_num);
+static BOOL  dg_conf_parse_value(const char* str, UINT32* value);
+static BOOL  dg_conf_set_timeout(DG_CONF_T* conf, const char* key, UINT32 value);
+
+/*==================================================================================================
+                                          LOCAL VARIABLES
+==================================================================================================*/
+static const DG_CONF_ITEM_T dg_conf_item[DG_CONF_NUM] =
+{
+    /* name                   default                      min                 max                */
+    { "sched.bulk_max",       DG_CFG_SCHED_BULK_MAX,       0,                  1024               },
+    { "sched.background_max", DG_CFG_SCHED_BACKGROUND_MAX, 0,                  1024               },
+    { "sched.inflight_max",   DG_CFG_SCHED_INFLIGHT_MAX,   1,                  4096               },
+    { "sched.client_max",     DG_CFG_SCHED_CLIENT_MAX,     0,                  4096               },
+    { "sched.opcode_max",     DG_CFG_SCHED_OPCODE_MAX,     0,                  4096               },
+    { "socket.backlog",       10,                          1,                  4096               },
+    { "req.max_len",          DG_CFG_REQ_MAX_LEN,          0,                  DG_CONF_REQ_LIMIT  },
+    { "log.level",            DG_DBG_LVL_TRACE,            DG_DBG_LVL_VERBOSE, DG_DBG_LVL_DISABLE },
+    { "log.autolog_level",    DG_DBG_LVL_DISABLE,          DG_DBG_LVL_VERBOSE, DG_DBG_LVL_DISABLE },
+    { "cache.version",        1,                           0,                  1                  },
+    { "cache.iface_addr",     1,                           0,                  1                  },
+};
+
+static pthread_mutex_t dg_conf_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DG_CONF_T       dg_conf;
+static BOOL            dg_conf_is_init = FALSE;
+
+/*==================================================================================================
+                                          GLOBAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Loads the configuration file, replacing the whole current configuration
+
+@param[in] path - The configuration file
+
+@return TRUE if the file was read without errors. A missing or refused file gives the defaults at
+        start-up and keeps the current configuration on a reload, a bad or too long line is
+        skipped, all return FALSE.
+
+@note
+- the file is refused unless it is a regular file owned by root or the daemon user, which only its
+  owner can write
+*//*==============================================================================================*/
+BOOL DG_CONF_load(const char* path)
+{
+    DG_CONF_T conf;
+    FILE*     file;
+    char      line[DG_CONF_LINE_MAX];
+    UINT32    line_num  = 0;
+    UINT32    error_num = 0;
+    BOOL      is_init;
+    int       next;
+
+    dg_conf_set_defaults(&conf);
+
+    if ((file = dg_conf_open(path)) == NULL)
+    {
+        pthread_mutex_lock(&dg_conf_mutex);
+        is_init = dg_conf_is_init;
+        pthread_mutex_unlock(&dg_conf_mutex);
+
+        /* reason is logged, a reload must not drop a working configuration */
+        if (is_init)
+        {
+            DG_DBG_ERROR("Keeping the current configuration, %s can't be loaded", path);
+            return FALSE;
+        }
+
+        DG_DBG_TRACE("Using the default configuration");
+        error_num++;
+    }
+    else
+    {
+        while (fgets(line, sizeof(line), file) != NULL)
+        {
+            line_num++;
+
+            /* a line fgets had to cut is skipped whole, its rest must not be read as a line */
+            if ((strchr(line, '\n') == NULL) && ((next = fgetc(file)) != EOF) && (next != '\n'))
+            {
+                DG_DBG_ERROR("%s:%d: line longer than %d characters", path, line_num,
+                             DG_CONF_LINE_MAX - 1);
+                while (((next = fgetc(file)) != EOF) && (next != '\n'))
+                {
+                }
+                error_num++;
+            }
+            else if (!dg_conf_parse_line(&conf, line, path, line_num))
+            {
+                error_num++;
+            }
+        }
+        fclose(file);
+
+        DG_DBG_TRACE("Loaded configuration file %s, %d line(s), %d error(s)",
+                     path, line_num, error_num);
+    }
+
+    pthread_mutex_lock(&dg_conf_mutex);
+    dg_conf         = conf;
+    dg_conf_is_init = TRUE;
+    pthread_mutex_unlock(&dg_conf_mutex);
+
+    return (error_num == 0) ? TRUE : FALSE;
+}
+
+/*=============================================================================================*//**
+@brief Gets the current value of a tunable
+
+@param[in] key - The tunable
+
+@return the value from the configuration file, else the compile-time default
+*//*==============================================================================================*/
+UINT32 DG_CONF_get(DG_CONF_KEY_T key)
+{
+    UINT32 value;
+
+    if ((UINT32)key >= DG_CONF_NUM)
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&dg_conf_mutex);
+    value = dg_conf_is_init ? dg_conf.value[key] : dg_conf_item[key].def;
+    pthread_mutex_unlock(&dg_conf_mutex);
+
+    return value;
+}
+
+/*=============================================================================================*//**
+@brief Checks if a tunable is set by the configuration file
+
+@param[in] key - The tunable
+
+@return TRUE if the file sets the tunable
+*//*==============================================================================================*/
+BOOL DG_CONF_is_set(DG_CONF_KEY_T key)
+{
+    BOOL is_set;
+
+    if ((UINT32)key >= DG_CONF_NUM)
+    {
+        return FALSE;
+    }
+
+    pthread_mutex_lock(&dg_conf_mutex);
+    is_set = dg_conf_is_init ? dg_conf.is_set[key] : FALSE;
+    pthread_mutex_unlock(&dg_conf_mutex);
+
+    return is_set;
+}
+
+/*=============================================================================================*//**
+@brief Gets the timeout of an opcode
+
+@param[in] opcode       - The DIAG opcode
+@param[in] timeout_msec - The timeout of the handler table
+
+@return the timeout in msec from the configuration file, else timeout_msec
+*//*==============================================================================================*/
+UINT32 DG_CONF_get_timeout(DG_DEFS_OPCODE_T opcode, UINT32 timeout_msec)
+{
+    UINT32 i;
+
+    pthread_mutex_lock(&dg_conf_mutex);
+
+    for (i = 0; dg_conf_is_init && (i < dg_conf.timeout_num); i++)
+    {
+        if (dg_conf.timeout[i].opcode == opcode)
+        {
+            timeout_msec = dg_conf.timeout[i].timeout_msec;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&dg_conf_mutex);
+
+    return timeout_msec;
+}
+
+/*==================================================================================================
+                                           LOCAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Sets a configuration to the compile-time defaults
+
+@param[out] conf - The configuration
+*//*==============================================================================================*/
+static void dg_conf_set_defaults(DG_CONF_T* conf)
+{
+    UINT32 i;
+
+    memset(conf, 0, sizeof(*conf));
+    for (i = 0; i < DG_CONF_NUM; i++)
+    {
+        conf->value[i]  = dg_conf_item[i].def;
+        conf->is_set[i] = FALSE;
+    }
+}
+
+/*=============================================================================================*//**
+@brief Opens the configuration file if it can be trusted
+
+@param[in] path - The configuration file
+
+@return the file, NULL if it is missing or refused
+*//*==============================================================================================*/
+static FILE* dg_conf_open(const char* path)
+{
+    FILE*       file = NULL;
+    struct stat st;
+    int         fd;
+
+    if ((fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC)) < 0)
+    {
+        DG_DBG_TRACE("No configuration file %s, errno=%d(%m)", path, errno);
+    }
+    else if (fstat(fd, &st) != 0)
+    {
+        DG_DBG_ERROR("Failed to stat %s, errno=%d(%m)", path, errno);
+        close(fd);
+    }
+    else if (!S_ISREG(st.st_mode) || ((st.st_uid != 0) && (st.st_uid != geteuid())) ||
+             ((st.st_mode & (S_IWGRP | S_IWOTH)) != 0))
+    {
+        DG_DBG_ERROR("Refused configuration file %s, mode=0%o, uid=%d",
+                     path, st.st_mode, st.st_uid);
+        close(fd);
+    }
+    else if ((file = fdopen(fd, "r")) == NULL)
+    {
+        DG_DBG_ERROR("Failed to open %s, errno=%d(%m)", path, errno);
+        close(fd);
+    }
+
+    return file;
+}
+
+/*=============================================================================================*//**
+@brief Parses one line of the configuration file
+
+@param[in,out] conf     - The configuration being loaded
+@param[in]     line     - The line, modified
+@param[in]     path     - The configuration file, for the error messages
+@param[in]     line_num - The line number, for the error messages
+
+@return FALSE if the line is bad and was skipped
+*//*==============================================================================================*/
+static BOOL  dg_conf_parse_line(DG_CONF_T* conf, char* line, const char* path, UINT32 line_num)
+{
+    char   key[64];
+    char   value_str[32];
+    char   extra;
+    char*  comment;
+    UINT32 value;
+    UINT32 i;
+
+    if ((comment = strchr(line, '#')) != NULL)
+    {
+        *comment = '\0';
+    }
+
+    /* blank or comment only */
+    if (sscanf(line, " %c", &extra) != 1)
+    {
+        return TRUE;
+    }
+
+    if (sscanf(line, " %63[^= \t\r\n] = %31s %c", key, value_str, &extra) != 2)
+    {
+        DG_DBG_ERROR("%s:%d: expected 'key = value'", path, line_num);
+        return FALSE;
+    }
+
+    if (!dg_conf_parse_value(value_str, &value))
+    {
+        DG_DBG_ERROR("%s:%d: bad value '%s' for %s", path, line_num, value_str, key);
+        return FALSE;
+    }
+
+    if (strncmp(key, DG_CONF_TIMEOUT_PREFIX, strlen(DG_CONF_TIMEOUT_PREFIX)) == 0)
+    {
+        if (!dg_conf_set_timeout(conf, key + strlen(DG_CONF_TIMEOUT_PREFIX), value))
+        {
+            DG_DBG_ERROR("%s:%d: bad timeout %s = %u, an opcode takes %d to %d msec, "
+                         "up to %d opcodes", path, line_num, key, value, DG_CONF_TIMEOUT_MIN,
+                         DG_CONF_TIMEOUT_LIMIT, DG_CONF_TIMEOUT_MAX);
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    for (i = 0; i < DG_CONF_NUM; i++)
+    {
+        if (strcmp(key, dg_conf_item[i].name) == 0)
+        {
+            if ((value < dg_conf_item[i].min) || (value > dg_conf_item[i].max))
+            {
+                DG_DBG_ERROR("%s:%d: %s = %u is out of range %u to %u", path, line_num, key,
+                             value, dg_conf_item[i].min, dg_conf_item[i].max);
+                return FALSE;
+            }
+
+            conf->value[i]  = value;
+            conf->is_set[i] = TRUE;
+            return TRUE;
+        }
+    }
+
+    DG_DBG_ERROR("%s:%d: unknown key %s", path, line_num, key);
+    return FALSE;
+}
+
+/*=============================================================================================*//**
+@brief Parses a decimal or 0x prefixed hex value
+
+@param[in]  str   - The value string
+@param[out] value - The value
+
+@return FALSE if the string is not a 32 bit unsigned number
+*//*==============================================================================================*/
+static BOOL  dg_conf_parse_value(const char* str, UINT32* value)
+{
+    unsigned long long number;
+    char*              end;
+
+    if ((*str == '-') || (*str == '+'))
+    {
+        return FALSE;
+    }
+
+    errno  = 0;
+    number = strtoull(str, &end, 0);
+    if ((errno != 0) || (end == str) || (*end != '\0') || (number > 0xFFFFFFFFULL))
+    {
+        return FALSE;
+    }
+
+    *value = (UINT32)number;
+    return TRUE;
+}
+
+/*=============================================================================================*//**
+@brief Sets the timeout of an opcode
+
+@param[in,out] conf       - The configuration being loaded
+@param[in]     opcode_str - The opcode part of the key
+@param[in]     value      - The timeout in msec
+
+@return FALSE if the opcode or the timeout is bad, or there are too many timeouts
+*//*==============================================================================================*/
+static BOOL  dg_conf_set_timeout(DG_CONF_T* conf, const char* opcode_str, UINT32 value)
+{
+    UINT32 opcode;
+    UINT32 i;
+
+    if (!dg_conf_parse_value(opcode_str, &opcode) || (opcode > 0xFFFF) ||
+        (value < DG_CONF_TIMEOUT_MIN) || (value > DG_CONF_TIMEOUT_LIMIT))
+    {
+        return FALSE;
+    }
+
+    /* a later line for the same opcode wins */
+    for (i = 0; i < conf->timeout_num; i++)
+    {
+        if (conf->timeout[i].opcode == opcode)
+        {
+            break;
+        }
+    }
+
+    if (i >= DG_CONF_TIMEOUT_MAX)
+    {
+        return FALSE;
+    }
+
+    conf->timeout[i].opcode       = (DG_DEFS_OPCODE_T)opcode;
+    conf->timeout[i].timeout_msec = value;
+    conf->timeout_num             = (i == conf->timeout_num) ? (i + 1) : conf->timeout_num;
+
+    return TRUE;
+}
@@ -31,6 +31,7 @@ Xudong Huang    - xudongh    2013/12/20     xxxxx-0002   Update diag req protoco
 #include "dg_client_comm.h"
 #include "dg_pal_util.h"
 #include "dg_pal_security.h"
+#include "dg_sched.h"
 
 /*==================================================================================================
                                           LOCAL CONSTANTS
@@ -1694,6 +1695,13 @@ void dg_engine_util_send_response(DG_DEFS_DIAG_REQ_T* diag,
             /* For solicited responses, send to client who originated the request */
             DG_DBG_TRACE("Sending res_code = 0x%02x, res_length = %d to sender_id = %d",
                          rsp.header.rsp_code, rsp.header.length, diag->sender_id);
+
+            /* Before the write, the client may answer it with its next request at once. A
+               handler that timed out may still be stuck, it keeps counting for its client */
+            if (final_rsp_code != DG_RSP_CODE_ASCII_RSP_TIMEOUT)
+            {
+                DG_SCHED_answered(diag);
+            }
             if (!DG_CLIENT_COMM_client_write(diag->sender_id, &rsp))
             {
                 DG_DBG_ERROR("Send response to fd: %d failed", diag->sender_id);
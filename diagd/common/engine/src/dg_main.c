@@ -25,6 +25,9 @@ Xudong Huang    - xudongh    2013/12/11     xxxxx-0000   Creation
 #include "dg_defs.h"
 #include "dg_dbg.h"
 #include "dg_aux_engine.h"
+#include "dg_capture.h"
+#include "dg_conf.h"
+#include "dg_sched.h"
 #include "dg_main.h"
 #include "dg_client_comm.h"
 #include "dg_pal_util.h"
@@ -44,9 +47,11 @@ Xudong Huang    - xudongh    2013/12/11     xxxxx-0000   Creation
 /*==================================================================================================
                                      LOCAL FUNCTION PROTOTYPES
 ==================================================================================================*/
-static void dg_main_exit_handler(int sig);
-static void dg_main_cleanup_engine(void);
-static void dg_main_log_exit_reason(const char* format, ...);
+static void  dg_main_exit_handler(int sig);
+static void  dg_main_load_conf(void);
+static void* dg_main_conf_reload(void* arg);
+static void  dg_main_cleanup_engine(void);
+static void  dg_main_log_exit_reason(const char* format, ...);
 
 /*==================================================================================================
                                           GLOBAL VARIABLES
@@ -56,7 +61,10 @@ BOOL DG_MAIN_engine_exit_flag = FALSE;
 /*==================================================================================================
                                           LOCAL VARIABLES
 ==================================================================================================*/
-static pthread_t dg_main_working_thread;
+static pthread_t   dg_main_working_thread;
+static const char* dg_main_conf_file = DG_CFG_CONF_FILE;
+static BOOL        dg_main_conf_is_level_set;   /* the last load set log.level */
+static BOOL        dg_main_conf_is_autolog_set; /* the last load set log.autolog_level */
 
 /*==================================================================================================
                                           GLOBAL FUNCTIONS
@@ -67,7 +75,7 @@ static pthread_t dg_main_working_thread;
 
 @param[in] handler_tbl - Pointer to the handler table
 @param[in] argc        - Number of arguments
-@param[in] argv        - Array of each argument passed
+@param[in] argv        - Array of each argument passed, "-c <file>" selects the configuration file
 
 @return Success/failure of function
 
@@ -81,10 +89,15 @@ static pthread_t dg_main_working_thread;
 BOOL DG_MAIN_start_engine(const DG_DEFS_OPCODE_ENTRY_T* handler_tbl, int argc,
                           char* argv[])
 {
-    BOOL status = FALSE;
+    BOOL      status = FALSE;
+    pthread_t conf_thread;
+    sigset_t  conf_sigset;
+
+    if ((argc > 2) && (strcmp(argv[1], "-c") == 0))
+    {
+        dg_main_conf_file = argv[2];
+    }
 
-    DG_COMPILE_UNUSED(argc);
-    DG_COMPILE_UNUSED(argv);
     /* Check to see if DIAG process is already running */
     if (DG_PAL_UTIL_is_diag_process_exist() == TRUE)
     {
@@ -105,6 +118,23 @@ BOOL DG_MAIN_start_engine(const DG_DEFS_OPCODE_ENTRY_T* handler_tbl, int argc,
         dg_dbg_level         = DG_PAL_DBG_load_dbg_lvl();
         dg_dbg_autolog_level = DG_PAL_DBG_load_autolog_lvl();
 
+        /* SIGHUP is blocked in every thread created from now on, one thread waits for it to
+           reload the configuration, so no blocking call of another thread is interrupted */
+        sigemptyset(&conf_sigset);
+        sigaddset(&conf_sigset, SIGHUP);
+        pthread_sigmask(SIG_BLOCK, &conf_sigset, NULL);
+
+        dg_main_load_conf();
+
+        if (pthread_create(&conf_thread, NULL, dg_main_conf_reload, (void*)NULL) != 0)
+        {
+            DG_DBG_ERROR("could not create configuration reload thread!");
+        }
+        else
+        {
+            pthread_detach(conf_thread);
+        }
+
         DG_AUX_ENGINE_init_available_state();
 
         DG_CLIENT_COMM_set_handler_tbl(handler_tbl);
@@ -156,11 +186,72 @@ void dg_main_exit_handler(int sig)
     pthread_kill(dg_main_working_thread, SIGUSR1);
 }
 
+/*=============================================================================================*//**
+@brief Loads the configuration file and applies the tunables that are not read at each use
+*//*==============================================================================================*/
+void dg_main_load_conf(void)
+{
+    /* a missing file or a bad line is logged by the loader, the defaults fill the rest, a reload
+       of a missing file keeps the current configuration */
+    DG_CONF_load(dg_main_conf_file);
+
+    /* the debug levels are only overridden when the file sets them, a level whose key is gone
+       since the last load goes back to the platform default */
+    if (DG_CONF_is_set(DG_CONF_LOG_LEVEL))
+    {
+        dg_dbg_level = (int)DG_CONF_get(DG_CONF_LOG_LEVEL);
+    }
+    else if (dg_main_conf_is_level_set)
+    {
+        dg_dbg_level = DG_PAL_DBG_load_dbg_lvl();
+    }
+    if (DG_CONF_is_set(DG_CONF_LOG_AUTOLOG_LEVEL))
+    {
+        dg_dbg_autolog_level = (int)DG_CONF_get(DG_CONF_LOG_AUTOLOG_LEVEL);
+    }
+    else if (dg_main_conf_is_autolog_set)
+    {
+        dg_dbg_autolog_level = DG_PAL_DBG_load_autolog_lvl();
+    }
+    dg_main_conf_is_level_set   = DG_CONF_is_set(DG_CONF_LOG_LEVEL);
+    dg_main_conf_is_autolog_set = DG_CONF_is_set(DG_CONF_LOG_AUTOLOG_LEVEL);
+
+    DG_SCHED_configure();
+}
+
+/*=============================================================================================*//**
+@brief Reloads the configuration file on every SIGHUP
+
+@param[in] arg - Ignored
+
+@return NULL returned
+*//*==============================================================================================*/
+void* dg_main_conf_reload(void* arg)
+{
+    sigset_t sigset;
+    int      sig;
+
+    DG_COMPILE_UNUSED(arg);
+
+    sigemptyset(&sigset);
+    sigaddset(&sigset, SIGHUP);
+
+    while (sigwait(&sigset, &sig) == 0)
+    {
+        DG_DBG_TRACE("Diag daemon got SIGHUP, reloading %s", dg_main_conf_file);
+        dg_main_load_conf();
+    }
+
+    DG_DBG_ERROR("Waiting for SIGHUP failed, the configuration is no longer reloaded");
+    return NULL;
+}
+
 /*=============================================================================================*//**
 @brief Cleans up the DIAG engine for shutdown
 *//*==============================================================================================*/
 void dg_main_cleanup_engine(void)
 {
+    DG_CAPTURE_stop();
     remove(DG_CFG_PID_FILE);
     remove(DG_CFG_INT_SOCKET);
     sync();
@@ -0,0 +1,480 @@
+/*==================================================================================================
+
+    Module Name:  dg_sched.c
+
+    General Description: Admits the DIAG requests and runs their handlers in lanes by their
+                         scheduling class
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "dg_platform_defs.h"
+#include "dg_dbg.h"
+#include "dg_conf.h"
+#include "dg_sched.h"
+
+/*==================================================================================================
+                                          LOCAL CONSTANTS
+==================================================================================================*/
+#define DG_SCHED_POLL_MSEC     100 /**< How often a waiting request checks for its timeout */
+#define DG_SCHED_NS_PER_MSEC   1000000
+#define DG_SCHED_NS_PER_SEC    1000000000
+
+/*==================================================================================================
+                                            LOCAL MACROS
+==================================================================================================*/
+
+/*==================================================================================================
+                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+/** A request in flight */
+typedef struct
+{
+    DG_DEFS_DIAG_REQ_T* diag;        /**< The request, NULL for a free slot */
+    int                 sender_id;   /**< Client of the request */
+    DG_DEFS_OPCODE_T    opcode;      /**< Opcode of the request */
+    BOOL                is_answered; /**< The client got the response */
+} DG_SCHED_INFLIGHT_T;
+
+/** A request waiting in a lane, lives on the stack of its handler thread */
+typedef struct DG_SCHED_WAITER_S
+{
+    pthread_cond_t            cond;        /**< Signalled when the request is admitted */
+    BOOL                      is_admitted; /**< The request may run its handler */
+    struct DG_SCHED_WAITER_S* next;        /**< Next request in the queue */
+} DG_SCHED_WAITER_T;
+
+/** A lane of one scheduling class */
+typedef struct
+{
+    pthread_mutex_t    mutex;     /**< Protects the lane */
+    UINT32             limit;     /**< Handlers run at once, 0 for no limit */
+    int                nice;      /**< Added to the nice value of the handler threads */
+    const char*        name;      /**< Name for the traces */
+    UINT32             running;   /**< Handlers running now */
+    UINT32             queued;    /**< Requests waiting now */
+    UINT32             admitted;  /**< Requests run so far */
+    UINT32             abandoned; /**< Requests timed out while waiting */
+    DG_SCHED_WAITER_T* head;      /**< Oldest waiting request */
+    DG_SCHED_WAITER_T* tail;      /**< Newest waiting request */
+} DG_SCHED_LANE_T;
+
+/*==================================================================================================
+                                     LOCAL FUNCTION PROTOTYPES
+==================================================================================================*/
+static DG_SCHED_LANE_T* dg_sched_get_lane(DG_DEFS_SCHED_CLASS_T sched_class);
+static BOOL             dg_sched_has_room(DG_SCHED_LANE_T* lane);
+static BOOL             dg_sched_is_abandoned(DG_DEFS_DIAG_REQ_T* diag);
+static void             dg_sched_admit_waiters(DG_SCHED_LANE_T* lane);
+static void             dg_sched_remove(DG_SCHED_LANE_T* lane, DG_SCHED_WAITER_T* waiter);
+
+/*==================================================================================================
+                                          LOCAL VARIABLES
+==================================================================================================*/
+static pthread_mutex_t      dg_sched_inflight_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DG_SCHED_INFLIGHT_T* dg_sched_inflight       = NULL; /**< Grows with the in-flight limit */
+static UINT32               dg_sched_inflight_size  = 0;
+static UINT32               dg_sched_busy_num       = 0;    /**< Requests refused so far */
+
+static DG_SCHED_LANE_T dg_sched_lane[DG_DEFS_SCHED_NUM] =
+{
+    /* mutex, limit until DG_SCHED_configure(), nice and name, then the counters and the queue */
+    { PTHREAD_MUTEX_INITIALIZER, 0, 0, "interactive", 0, 0, 0, 0, NULL, NULL },
+    { PTHREAD_MUTEX_INITIALIZER, DG_CFG_SCHED_BULK_MAX, 5, "bulk", 0, 0, 0, 0, NULL, NULL },
+    { PTHREAD_MUTEX_INITIALIZER, DG_CFG_SCHED_BACKGROUND_MAX, 10, "background",
+      0, 0, 0, 0, NULL, NULL },
+};
+
+/*==================================================================================================
+                                          GLOBAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Admits a request if the engine, its client and its opcode are below their in-flight limits
+
+@param[in] diag - The DIAG request
+
+@return TRUE if the request is admitted, DG_SCHED_release() must follow it. FALSE if the request
+        must be answered with DG_RSP_CODE_CMD_RSP_BUSY.
+*//*==============================================================================================*/
+BOOL DG_SCHED_admit(DG_DEFS_DIAG_REQ_T* diag)
+{
+    DG_SCHED_INFLIGHT_T* free_slot    = NULL;
+    DG_SCHED_INFLIGHT_T* inflight;
+    const char*          limit_name   = NULL;
+    UINT32               inflight_max = DG_CONF_get(DG_CONF_SCHED_INFLIGHT_MAX);
+    UINT32               client_max   = DG_CONF_get(DG_CONF_SCHED_CLIENT_MAX);
+    UINT32               opcode_max   = DG_CONF_get(DG_CONF_SCHED_OPCODE_MAX);
+    UINT32               inflight_num = 0;
+    UINT32               client_num   = 0;
+    UINT32               opcode_num   = 0;
+    UINT32               busy_num;
+    UINT32               i;
+
+    pthread_mutex_lock(&dg_sched_inflight_mutex);
+
+    /* the table only grows, a lowered limit leaves the extra slots unused */
+    if ((inflight_max > dg_sched_inflight_size) &&
+        ((inflight = (DG_SCHED_INFLIGHT_T*)realloc(dg_sched_inflight,
+                                                   inflight_max * sizeof(*inflight))) != NULL))
+    {
+        memset(&inflight[dg_sched_inflight_size], 0,
+               (inflight_max - dg_sched_inflight_size) * sizeof(*inflight));
+        dg_sched_inflight      = inflight;
+        dg_sched_inflight_size = inflight_max;
+    }
+
+    for (i = 0; i < dg_sched_inflight_size; i++)
+    {
+        if (dg_sched_inflight[i].diag == NULL)
+        {
+            free_slot = (free_slot == NULL) ? &dg_sched_inflight[i] : free_slot;
+            continue;
+        }
+
+        inflight_num++;
+        if (dg_sched_inflight[i].is_answered)
+        {
+            /* the client may send its next request before this handler thread exits */
+            continue;
+        }
+        if (dg_sched_inflight[i].sender_id == diag->sender_id)
+        {
+            client_num++;
+        }
+        if (dg_sched_inflight[i].opcode == diag->header.opcode)
+        {
+            opcode_num++;
+        }
+    }
+
+    if ((free_slot == NULL) || (inflight_num >= inflight_max))
+    {
+        limit_name = "engine";
+    }
+    else if ((client_max != 0) && (client_num >= client_max))
+    {
+        limit_name = "client";
+    }
+    else if ((opcode_max != 0) && (opcode_num >= opcode_max))
+    {
+        limit_name = "opcode";
+    }
+    else
+    {
+        free_slot->diag        = diag;
+        free_slot->sender_id   = diag->sender_id;
+        free_slot->opcode      = diag->header.opcode;
+        free_slot->is_answered = FALSE;
+    }
+
+    if (limit_name != NULL)
+    {
+        dg_sched_busy_num++;
+    }
+    busy_num = dg_sched_busy_num;
+
+    pthread_mutex_unlock(&dg_sched_inflight_mutex);
+
+    if (limit_name != NULL)
+    {
+        DG_DBG_ERROR("DIAG 0x%04x from fd %d refused, %s in-flight limit reached, busy = %d",
+                     diag->header.opcode, diag->sender_id, limit_name, busy_num);
+    }
+
+    return (limit_name == NULL) ? TRUE : FALSE;
+}
+
+/*=============================================================================================*//**
+@brief Marks a request admitted by DG_SCHED_admit() as answered
+
+@param[in] diag - The DIAG request
+
+@note
+- the request still counts for the engine until DG_SCHED_release(), but no longer for its client
+  and its opcode
+*//*==============================================================================================*/
+void DG_SCHED_answered(DG_DEFS_DIAG_REQ_T* diag)
+{
+    UINT32 i;
+
+    pthread_mutex_lock(&dg_sched_inflight_mutex);
+
+    for (i = 0; i < dg_sched_inflight_size; i++)
+    {
+        if (dg_sched_inflight[i].diag == diag)
+        {
+            dg_sched_inflight[i].is_answered = TRUE;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&dg_sched_inflight_mutex);
+}
+
+/*=============================================================================================*//**
+@brief Releases a request admitted by DG_SCHED_admit()
+
+@param[in] diag - The DIAG request
+*//*==============================================================================================*/
+void DG_SCHED_release(DG_DEFS_DIAG_REQ_T* diag)
+{
+    UINT32 i;
+
+    pthread_mutex_lock(&dg_sched_inflight_mutex);
+
+    for (i = 0; i < dg_sched_inflight_size; i++)
+    {
+        if (dg_sched_inflight[i].diag == diag)
+        {
+            dg_sched_inflight[i].diag = NULL;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&dg_sched_inflight_mutex);
+}
+
+/*=============================================================================================*//**
+@brief Waits until a request may run its handler in the lane of its class
+
+@param[in] sched_class - The scheduling class of the handler
+@param[in] diag        - The DIAG request
+
+@return TRUE if the handler may run, DG_SCHED_exit() must follow it. FALSE if the client got the
+        timeout response while the request was waiting, the handler must not run.
+
+@note
+- called on the handler thread, which keeps the lowered CPU priority until it exits
+*//*==============================================================================================*/
+BOOL DG_SCHED_enter(DG_DEFS_SCHED_CLASS_T sched_class, DG_DEFS_DIAG_REQ_T* diag)
+{
+    DG_SCHED_LANE_T*  lane = dg_sched_get_lane(sched_class);
+    DG_SCHED_WAITER_T waiter;
+    struct timespec   deadline;
+
+    pthread_mutex_lock(&lane->mutex);
+
+    if ((lane->head == NULL) && dg_sched_has_room(lane))
+    {
+        lane->running++;
+        lane->admitted++;
+        waiter.is_admitted = TRUE;
+    }
+    else
+    {
+        pthread_cond_init(&waiter.cond, NULL);
+        waiter.is_admitted = FALSE;
+        waiter.next        = NULL;
+
+        if (lane->tail == NULL)
+        {
+            lane->head = &waiter;
+        }
+        else
+        {
+            lane->tail->next = &waiter;
+        }
+        lane->tail = &waiter;
+        lane->queued++;
+
+        DG_DBG_TRACE("DIAG 0x%04x queued in %s lane, running = %d, queued = %d",
+                     diag->header.opcode, lane->name, lane->running, lane->queued);
+
+        while (!waiter.is_admitted)
+        {
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += DG_SCHED_POLL_MSEC * DG_SCHED_NS_PER_MSEC;
+            if (deadline.tv_nsec >= DG_SCHED_NS_PER_SEC)
+            {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= DG_SCHED_NS_PER_SEC;
+            }
+
+            if ((pthread_cond_timedwait(&waiter.cond, &lane->mutex, &deadline) == ETIMEDOUT) &&
+                !waiter.is_admitted && dg_sched_is_abandoned(diag))
+            {
+                dg_sched_remove(lane, &waiter);
+                lane->abandoned++;
+                DG_DBG_ERROR("DIAG 0x%04x timed out in %s lane, running = %d, queued = %d",
+                             diag->header.opcode, lane->name, lane->running, lane->queued);
+                break;
+            }
+        }
+
+        pthread_cond_destroy(&waiter.cond);
+    }
+
+    pthread_mutex_unlock(&lane->mutex);
+
+    /* the nice value belongs to the calling thread only on Linux */
+    errno = 0;
+    if (waiter.is_admitted && (lane->nice != 0) && (nice(lane->nice) == -1) && (errno != 0))
+    {
+        DG_DBG_ERROR("Failed to lower the priority of DIAG 0x%04x, errno=%d(%m)",
+                     diag->header.opcode, errno);
+    }
+
+    return waiter.is_admitted;
+}
+
+/*=============================================================================================*//**
+@brief Leaves the lane after a handler returns, the oldest waiting request is run next
+
+@param[in] sched_class - The scheduling class of the handler
+*//*==============================================================================================*/
+void DG_SCHED_exit(DG_DEFS_SCHED_CLASS_T sched_class)
+{
+    DG_SCHED_LANE_T* lane = dg_sched_get_lane(sched_class);
+
+    pthread_mutex_lock(&lane->mutex);
+
+    lane->running--;
+    dg_sched_admit_waiters(lane);
+
+    pthread_mutex_unlock(&lane->mutex);
+}
+
+/*=============================================================================================*//**
+@brief Applies the lane limits of the configuration, a raised limit runs the waiting requests
+*//*==============================================================================================*/
+void DG_SCHED_configure(void)
+{
+    DG_SCHED_LANE_T* lane;
+
+    lane = &dg_sched_lane[DG_DEFS_SCHED_BULK];
+    pthread_mutex_lock(&lane->mutex);
+    lane->limit = DG_CONF_get(DG_CONF_SCHED_BULK_MAX);
+    dg_sched_admit_waiters(lane);
+    pthread_mutex_unlock(&lane->mutex);
+
+    lane = &dg_sched_lane[DG_DEFS_SCHED_BACKGROUND];
+    pthread_mutex_lock(&lane->mutex);
+    lane->limit = DG_CONF_get(DG_CONF_SCHED_BACKGROUND_MAX);
+    dg_sched_admit_waiters(lane);
+    pthread_mutex_unlock(&lane->mutex);
+}
+
+/*=============================================================================================*//**
+@brief Gets the statistics of a lane
+
+@param[in]  sched_class - The scheduling class of the lane
+@param[out] status      - The lane statistics
+*//*==============================================================================================*/
+void DG_SCHED_get_status(DG_DEFS_SCHED_CLASS_T sched_class, DG_SCHED_STATUS_T* status)
+{
+    DG_SCHED_LANE_T* lane = dg_sched_get_lane(sched_class);
+
+    pthread_mutex_lock(&lane->mutex);
+
+    status->running   = lane->running;
+    status->queued    = lane->queued;
+    status->limit     = lane->limit;
+    status->admitted  = lane->admitted;
+    status->abandoned = lane->abandoned;
+
+    pthread_mutex_unlock(&lane->mutex);
+}
+
+/*==================================================================================================
+                                           LOCAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Gets the lane of a scheduling class
+
+@param[in] sched_class - The scheduling class
+
+@return the lane, an unknown class runs in the interactive lane
+*//*==============================================================================================*/
+static DG_SCHED_LANE_T* dg_sched_get_lane(DG_DEFS_SCHED_CLASS_T sched_class)
+{
+    return &dg_sched_lane[((UINT32)sched_class < DG_DEFS_SCHED_NUM) ? sched_class :
+                          DG_DEFS_SCHED_INTERACTIVE];
+}
+
+/*=============================================================================================*//**
+@brief Checks if a lane may run one more handler
+
+@param[in] lane - The lane, locked
+
+@return TRUE if the lane is below its limit
+*//*==============================================================================================*/
+static BOOL dg_sched_has_room(DG_SCHED_LANE_T* lane)
+{
+    return ((lane->limit == 0) || (lane->running < lane->limit)) ? TRUE : FALSE;
+}
+
+/*=============================================================================================*//**
+@brief Checks if the client thread already gave up on a request
+
+@param[in] diag - The DIAG request
+
+@return TRUE if the timeout response was sent and the request may be deleted
+*//*==============================================================================================*/
+static BOOL dg_sched_is_abandoned(DG_DEFS_DIAG_REQ_T* diag)
+{
+    BOOL is_abandoned;
+
+    pthread_mutex_lock(&diag->delete_mutex);
+    is_abandoned = diag->can_delete;
+    pthread_mutex_unlock(&diag->delete_mutex);
+
+    return is_abandoned;
+}
+
+/*=============================================================================================*//**
+@brief Runs the oldest waiting requests while the lane has room
+
+@param[in] lane - The lane, locked
+*//*==============================================================================================*/
+static void dg_sched_admit_waiters(DG_SCHED_LANE_T* lane)
+{
+    DG_SCHED_WAITER_T* waiter;
+
+    while (((waiter = lane->head) != NULL) && dg_sched_has_room(lane))
+    {
+        dg_sched_remove(lane, waiter);
+        lane->running++;
+        lane->admitted++;
+        waiter->is_admitted = TRUE;
+        pthread_cond_signal(&waiter->cond);
+    }
+}
+
+/*=============================================================================================*//**
+@brief Takes a request out of the queue of a lane
+
+@param[in] lane   - The lane, locked
+@param[in] waiter - The waiting request
+*//*==============================================================================================*/
+static void dg_sched_remove(DG_SCHED_LANE_T* lane, DG_SCHED_WAITER_T* waiter)
+{
+    DG_SCHED_WAITER_T** link = &lane->head;
+    DG_SCHED_WAITER_T*  prev = NULL;
+
+    while ((*link != NULL) && (*link != waiter))
+    {
+        prev = *link;
+        link = &(*link)->next;
+    }
+
+    if (*link != NULL)
+    {
+        *link = waiter->next;
+        if (lane->tail == waiter)
+        {
+            lane->tail = prev;
+        }
+        lane->queued--;
+    }
+}
+
@@ -29,6 +29,7 @@ Xudong Huang    - xudongh    2013/12/11     xxxxx-0000   Creation
 #include "dg_defs.h"
 #include "dg_dbg.h"
 #include "dg_client_comm.h"
+#include "dg_conf.h"
 #include "dg_main.h"
 #include "dg_pal_util.h"
 #include "dg_socket.h"
@@ -36,7 +37,7 @@ Xudong Huang    - xudongh    2013/12/11     xxxxx-0000   Creation
 /*==================================================================================================
                                           LOCAL CONSTANTS
 ==================================================================================================*/
-#define DG_SOCKET_MAX_PENDING_CONNECTION_QUEUE 10 /**< Max number of pending connections allowed */
+
 /*==================================================================================================
                                             LOCAL MACROS
 ==================================================================================================*/
@@ -235,7 +236,7 @@ void dg_socket_listen_sock(int sock, int* max_fd, fd_set* socket_set)
     {
         DG_DBG_ERROR("Error setting socket %d to non-blocking mode", sock);
     }
-    else if (listen(sock,  DG_SOCKET_MAX_PENDING_CONNECTION_QUEUE) == -1)
+    else if (listen(sock, (int)DG_CONF_get(DG_CONF_SOCKET_BACKLOG)) == -1)
     {
         DG_DBG_ERROR("Error listening on DIAG socket %d, errno=%d(%m)", sock, errno);
     }
@@ -0,0 +1,165 @@
+/*==================================================================================================
+
+    Module Name:  dg_capture_ctrl.c
+
+    General Description: Implements the CAPTURE_CTRL DIAG
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include "dg_handler_inc.h"
+#include "dg_capture.h"
+
+
+/** @addtogroup common_command_handlers
+@{
+*/
+
+/** @addtogroup CAPTURE_CTRL
+@{
+
+@par
+<b>CAPTURE_CTRL - 0x0FFC</b>
+
+@par
+This command starts and stops recording the DIAG requests and responses of all the clients into
+the capture file DG_CFG_CAPTURE_FILE. The capture can be replayed with "diagd_test p".
+*/
+
+/*==================================================================================================
+                                           LOCAL MACROS
+==================================================================================================*/
+
+/*==================================================================================================
+                            LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+/** Actions for CAPTURE_CTRL command */
+enum
+{
+    DG_CAPTURE_CTRL_START  = 0x00,
+    DG_CAPTURE_CTRL_STOP   = 0x01,
+    DG_CAPTURE_CTRL_STATUS = 0x02,
+};
+typedef UINT8 DG_CAPTURE_CTRL_ACTION_T;
+
+/*==================================================================================================
+                                          LOCAL CONSTANTS
+==================================================================================================*/
+
+/*==================================================================================================
+                                     LOCAL FUNCTION PROTOTYPES
+==================================================================================================*/
+static void dg_capture_ctrl_rsp_status(DG_DEFS_DIAG_RSP_BUILDER_T* rsp);
+
+/*==================================================================================================
+                                         GLOBAL VARIABLES
+==================================================================================================*/
+
+/*==================================================================================================
+                                          LOCAL VARIABLES
+==================================================================================================*/
+
+/*==================================================================================================
+                                         GLOBAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Handler function for the CAPTURE_CTRL command
+
+@param[in] req - DIAG request
+
+@note
+- START takes the file size limit and the snap length, 4 bytes each, 0 for the defaults
+- STOP and STATUS respond the state (1 byte), then the number of captured frames, the capture
+  file size and the number of dropped frames (4 bytes each)
+*//*==============================================================================================*/
+void DG_CAPTURE_CTRL_handler_main(DG_DEFS_DIAG_REQ_T* req)
+{
+    DG_CAPTURE_CTRL_ACTION_T    action;
+    UINT32                      max_size;
+    UINT32                      snap_len;
+    DG_DEFS_DIAG_RSP_BUILDER_T* rsp = DG_ENGINE_UTIL_rsp_init();
+
+    if (DG_ENGINE_UTIL_req_len_check_at_least(req, sizeof(action), rsp))
+    {
+        DG_ENGINE_UTIL_req_parse_data_ntoh(req, action);
+
+        switch (action)
+        {
+        case DG_CAPTURE_CTRL_START:
+            if (DG_ENGINE_UTIL_req_remain_len_check_equal(req, sizeof(max_size) + sizeof(snap_len),
+                                                          rsp))
+            {
+                DG_ENGINE_UTIL_req_parse_data_ntoh(req, max_size);
+                DG_ENGINE_UTIL_req_parse_data_ntoh(req, snap_len);
+
+                if (!DG_CAPTURE_start(max_size, snap_len))
+                {
+                    DG_ENGINE_UTIL_rsp_set_error_string(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                        "Failed to start capture into %s",
+                                                        DG_CFG_CAPTURE_FILE);
+                }
+                else
+                {
+                    DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+                }
+            }
+            break;
+
+        case DG_CAPTURE_CTRL_STOP:
+            if (DG_ENGINE_UTIL_req_remain_len_check_equal(req, 0, rsp))
+            {
+                DG_CAPTURE_stop();
+                dg_capture_ctrl_rsp_status(rsp);
+            }
+            break;
+
+        case DG_CAPTURE_CTRL_STATUS:
+            if (DG_ENGINE_UTIL_req_remain_len_check_equal(req, 0, rsp))
+            {
+                dg_capture_ctrl_rsp_status(rsp);
+            }
+            break;
+
+        default:
+            DG_ENGINE_UTIL_rsp_set_error_string(rsp, DG_RSP_CODE_ASCII_ERR_PARM,
+                                                "Invalid action 0x%02x", action);
+            break;
+        }
+    }
+
+    DG_ENGINE_UTIL_rsp_send(rsp, req);
+    DG_ENGINE_UTIL_rsp_free(rsp);
+}
+
+/*==================================================================================================
+                                          LOCAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Builds the capture status response
+
+@param[in] rsp - DIAG response builder
+*//*==============================================================================================*/
+static void dg_capture_ctrl_rsp_status(DG_DEFS_DIAG_RSP_BUILDER_T* rsp)
+{
+    DG_CAPTURE_STATUS_T status;
+
+    DG_CAPTURE_get_status(&status);
+
+    if (DG_ENGINE_UTIL_rsp_data_alloc(rsp, sizeof(status.state) + sizeof(status.frames) +
+                                      sizeof(status.bytes) + sizeof(status.dropped)))
+    {
+        DG_ENGINE_UTIL_rsp_append_data_hton(rsp, status.state);
+        DG_ENGINE_UTIL_rsp_append_data_hton(rsp, status.frames);
+        DG_ENGINE_UTIL_rsp_append_data_hton(rsp, status.bytes);
+        DG_ENGINE_UTIL_rsp_append_data_hton(rsp, status.dropped);
+        DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+    }
+}
+
+/** @} */
+/** @} */
+
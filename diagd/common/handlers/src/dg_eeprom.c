@@ -9,6 +9,7 @@
 ====================================================================================================
                                            INCLUDE FILES
 ==================================================================================================*/
+#include <stdlib.h>
 #include "dg_handler_inc.h"
 #include "dg_cmn_drv_eeprom.h"
 
@@ -25,6 +26,10 @@
 
 @par
 EEPROM READ/WRITE access.
+
+@par
+READ_BLOCK/WRITE_BLOCK move up to the whole EEPROM in one request, a READ_BLOCK length of 0 reads
+from the address to the end of the EEPROM.
 */
 
 /*==================================================================================================
@@ -37,8 +42,10 @@ EEPROM READ/WRITE access.
 /** Actions for EEPROM command */
 enum
 {
-    DG_EEPROM_ACTION_READ  = 0x00,
-    DG_EEPROM_ACTION_WRITE = 0x01,
+    DG_EEPROM_ACTION_READ        = 0x00,
+    DG_EEPROM_ACTION_WRITE       = 0x01,
+    DG_EEPROM_ACTION_READ_BLOCK  = 0x02,
+    DG_EEPROM_ACTION_WRITE_BLOCK = 0x03,
 };
 typedef UINT8 DG_EEPROM_ACTION_T;
 
@@ -51,6 +58,8 @@ typedef UINT8 DG_EEPROM_ACTION_T;
 ==================================================================================================*/
 static void dg_eeprom_read(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp);
 static void dg_eeprom_write(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp);
+static void dg_eeprom_read_block(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp);
+static void dg_eeprom_write_block(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp);
 
 /*==================================================================================================
                                          GLOBAL VARIABLES
@@ -92,6 +101,14 @@ void DG_EEPROM_handler_main(DG_DEFS_DIAG_REQ_T* req)
             dg_eeprom_write(req, rsp);
             break;
 
+        case DG_EEPROM_ACTION_READ_BLOCK:
+            dg_eeprom_read_block(req, rsp);
+            break;
+
+        case DG_EEPROM_ACTION_WRITE_BLOCK:
+            dg_eeprom_write_block(req, rsp);
+            break;
+
         default:
             DG_ENGINE_UTIL_rsp_set_error_string(rsp, DG_RSP_CODE_ASCII_ERR_PARM,
                                                 "Invalid action 0x%02x", action);
@@ -175,6 +192,103 @@ void dg_eeprom_write(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp)
     }
 }
 
+/*=============================================================================================*//**
+@brief EEPROM block read
+
+@param[in]     req     - DIAG request
+@param[in,out] rsp     - DIAG rsp builder
+
+@note
+- a length of 0 reads from the address to the end of the EEPROM
+*//*==============================================================================================*/
+void dg_eeprom_read_block(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp)
+{
+    DG_CMN_DRV_EEPROM_ID_T   eeprom;
+    DG_CMN_DRV_EEPROM_ADDR_T addr;
+    UINT16                   len;
+    UINT32                   read_len;
+    UINT32                   size;
+    UINT8*                   data;
+
+    const UINT32 req_size = sizeof(eeprom) + sizeof(addr) + sizeof(len);
+    if (DG_ENGINE_UTIL_req_remain_len_check_equal(req, req_size, rsp))
+    {
+        DG_ENGINE_UTIL_req_parse_data_ntoh(req, eeprom);
+        DG_ENGINE_UTIL_req_parse_data_ntoh(req, addr);
+        DG_ENGINE_UTIL_req_parse_data_ntoh(req, len);
+
+        if (!DG_CMN_DRV_EEPROM_get_size(eeprom, &size))
+        {
+            DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_ERR_PARM,
+                                                    "Failed to Read EEPROM");
+        }
+        else if (addr >= size)
+        {
+            DG_ENGINE_UTIL_rsp_set_error_string(rsp, DG_RSP_CODE_ASCII_ERR_PARM,
+                                                "Address 0x%04x past the EEPROM size 0x%04x",
+                                                addr, size);
+        }
+        else
+        {
+            read_len = (len == 0) ? (size - addr) : len;
+            data     = DG_ENGINE_UTIL_alloc_mem(read_len, rsp);
+
+            if (data != NULL)
+            {
+                if (!DG_CMN_DRV_EEPROM_read_block(eeprom, addr, read_len, data))
+                {
+                    DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                            "Failed to Read EEPROM");
+                }
+                else if (DG_ENGINE_UTIL_rsp_data_alloc(rsp, read_len))
+                {
+                    DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+                    DG_ENGINE_UTIL_rsp_append_buf(rsp, data, read_len);
+                }
+
+                free(data);
+            }
+        }
+    }
+}
+
+/*=============================================================================================*//**
+@brief EEPROM block write
+
+@param[in]     req     - DIAG request
+@param[in,out] rsp     - DIAG rsp builder
+
+*//*==============================================================================================*/
+void dg_eeprom_write_block(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp)
+{
+    DG_CMN_DRV_EEPROM_ID_T   eeprom;
+    DG_CMN_DRV_EEPROM_ADDR_T addr;
+    UINT16                   len;
+
+    const UINT32 req_size = sizeof(eeprom) + sizeof(addr) + sizeof(len);
+    if (DG_ENGINE_UTIL_req_remain_len_check_at_least(req, req_size, rsp))
+    {
+        DG_ENGINE_UTIL_req_parse_data_ntoh(req, eeprom);
+        DG_ENGINE_UTIL_req_parse_data_ntoh(req, addr);
+        DG_ENGINE_UTIL_req_parse_data_ntoh(req, len);
+
+        if (DG_ENGINE_UTIL_req_remain_len_check_equal(req, len, rsp))
+        {
+            UINT8* data = DG_ENGINE_UTIL_req_get_remain_data_ptr(req);
+
+            if (!DG_CMN_DRV_EEPROM_write_block(eeprom, addr, len, data))
+            {
+                DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                        "Failed to Write EEPROM");
+            }
+            else
+            {
+                DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+            }
+        }
+    }
+}
+
 /** @} */
 /** @} */
 
@@ -31,6 +31,8 @@ FPGA related test.
 /*==================================================================================================
                                            LOCAL MACROS
 ==================================================================================================*/
+/** data size of one streamed bulk read response */
+#define DG_FPGA_BULK_CHUNK_SIZE 0x10000
 
 /*==================================================================================================
                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
@@ -38,15 +40,17 @@ FPGA related test.
 /** Actions for FPGA command */
 enum
 {
-    DG_FPGA_ACTION_READ_REG  = 0x00,
-    DG_FPGA_ACTION_WRITE_REG = 0x01,
-    DG_FPGA_ACTION_READ_MEM  = 0x02,
-    DG_FPGA_ACTION_WRITE_MEM = 0x03,
-    DG_FPGA_ACTION_DMA_RECV  = 0x04,
-    DG_FPGA_ACTION_DMA_SEND  = 0x05,
-    DG_FPGA_ACTION_SELF_TEST = 0x06,
-    DG_FPGA_ACTION_SET_MODE  = 0x07,
-    DG_FPGA_ACTION_DOWNLOAD  = 0x08
+    DG_FPGA_ACTION_READ_REG   = 0x00,
+    DG_FPGA_ACTION_WRITE_REG  = 0x01,
+    DG_FPGA_ACTION_READ_MEM   = 0x02,
+    DG_FPGA_ACTION_WRITE_MEM  = 0x03,
+    DG_FPGA_ACTION_DMA_RECV   = 0x04,
+    DG_FPGA_ACTION_DMA_SEND   = 0x05,
+    DG_FPGA_ACTION_SELF_TEST  = 0x06,
+    DG_FPGA_ACTION_SET_MODE   = 0x07,
+    DG_FPGA_ACTION_DOWNLOAD   = 0x08,
+    DG_FPGA_ACTION_READ_BULK  = 0x09,
+    DG_FPGA_ACTION_WRITE_BULK = 0x0A
 };
 typedef UINT8 DG_FPGA_ACTION_T;
 
@@ -66,6 +70,8 @@ static void dg_fpga_dma_send(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T
 static void dg_fpga_self_test(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp);
 static void dg_fpga_set_mode(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp);
 static void dg_fpga_download(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp);
+static void dg_fpga_read_bulk(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp);
+static void dg_fpga_write_bulk(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp);
 
 
 /*==================================================================================================
@@ -137,6 +143,14 @@ void DG_FPGA_handler_main(DG_DEFS_DIAG_REQ_T* req)
             dg_fpga_download(req, rsp);
             break;
 
+        case DG_FPGA_ACTION_READ_BULK:
+            dg_fpga_read_bulk(req, rsp);
+            break;
+
+        case DG_FPGA_ACTION_WRITE_BULK:
+            dg_fpga_write_bulk(req, rsp);
+            break;
+
         default:
             DG_ENGINE_UTIL_rsp_set_error_string(rsp, DG_RSP_CODE_ASCII_ERR_PARM,
                                                 "Invalid action 0x%02x", action);
@@ -233,24 +247,16 @@ void dg_fpga_read_mem(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp)
         DG_ENGINE_UTIL_req_parse_data_ntoh(req, addr);
         DG_ENGINE_UTIL_req_parse_data_ntoh(req, read_len);
 
-        read_data = (UINT8*)DG_ENGINE_UTIL_alloc_mem(read_len, rsp);
-        if (read_data != NULL)
+        /* Copy straight from the mapped memory into the response */
+        if (!DG_CMN_DRV_FPGA_get_mem_window(addr, read_len, &read_data))
         {
-            if (!DG_CMN_DRV_FPGA_read_mem(addr, read_len, read_data))
-            {
-                DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
-                                                        "Failed to read FPGA memory");
-            }
-            else
-            {
-                /* Allocate memory for read memory response */
-                if (DG_ENGINE_UTIL_rsp_data_alloc(rsp, read_len))
-                {
-                    DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
-                    DG_ENGINE_UTIL_rsp_append_buf(rsp, read_data, read_len);
-                }
-            }
-            free(read_data);
+            DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                    "Failed to read FPGA memory");
+        }
+        else if (DG_ENGINE_UTIL_rsp_data_alloc(rsp, read_len))
+        {
+            DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+            DG_ENGINE_UTIL_rsp_append_buf(rsp, read_data, read_len);
         }
     }
 }
@@ -313,24 +319,16 @@ void dg_fpga_dma_recv(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp)
         DG_ENGINE_UTIL_req_parse_data_ntoh(req, addr);
         DG_ENGINE_UTIL_req_parse_data_ntoh(req, read_len);
 
-        read_data = (UINT8*)DG_ENGINE_UTIL_alloc_mem(read_len, rsp);
-        if (read_data != NULL)
+        /* Copy straight from the mapped memory into the response */
+        if (!DG_CMN_DRV_FPGA_get_mem_window(addr, read_len, &read_data))
         {
-            if (!DG_CMN_DRV_FPGA_dma_recv(addr, read_len, read_data))
-            {
-                DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
-                                                        "Failed to DMA recv FPGA memory");
-            }
-            else
-            {
-                /* Allocate memory for DMA receive response */
-                if (DG_ENGINE_UTIL_rsp_data_alloc(rsp, read_len))
-                {
-                    DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
-                    DG_ENGINE_UTIL_rsp_append_buf(rsp, read_data, read_len);
-                }
-            }
-            free(read_data);
+            DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                    "Failed to DMA recv FPGA memory");
+        }
+        else if (DG_ENGINE_UTIL_rsp_data_alloc(rsp, read_len))
+        {
+            DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+            DG_ENGINE_UTIL_rsp_append_buf(rsp, read_data, read_len);
         }
     }
 }
@@ -452,6 +450,115 @@ void dg_fpga_download(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp)
     }
 }
 
+/*=============================================================================================*//**
+@brief Read a large FPGA memory region, streamed back in chunks
+
+@param[in]     req     - DIAG request
+@param[in,out] rsp     - DIAG rsp builder
+
+@note
+- the first response carries the length and the number of chunks, each chunk follows as an
+  unsolicited response with its offset and up to DG_FPGA_BULK_CHUNK_SIZE bytes of data
+- every chunk is copied straight from the mapped memory, the region is never buffered whole
+*//*==============================================================================================*/
+void dg_fpga_read_bulk(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp)
+{
+    DG_CMN_DRV_FPGA_MEM_ADDR_T addr;
+    UINT32                     len;
+    UINT32                     chunk_num;
+    UINT32                     offset;
+    UINT32                     chunk;
+    UINT8*                     window;
+
+    const UINT32 min_len = sizeof(addr) + sizeof(len);
+
+    if (DG_ENGINE_UTIL_req_remain_len_check_equal(req, min_len, rsp))
+    {
+        DG_ENGINE_UTIL_req_parse_data_ntoh(req, addr);
+        DG_ENGINE_UTIL_req_parse_data_ntoh(req, len);
+
+        chunk_num = (len + DG_FPGA_BULK_CHUNK_SIZE - 1) / DG_FPGA_BULK_CHUNK_SIZE;
+
+        if (len == 0)
+        {
+            DG_ENGINE_UTIL_rsp_set_error_string(rsp, DG_RSP_CODE_ASCII_ERR_PARM,
+                                                "Invalid bulk read length 0");
+        }
+        else if (!DG_CMN_DRV_FPGA_get_mem_window(addr, len, &window))
+        {
+            DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                    "Failed to bulk read FPGA memory");
+        }
+        else if (DG_ENGINE_UTIL_rsp_data_alloc(rsp, sizeof(offset) + DG_FPGA_BULK_CHUNK_SIZE))
+        {
+            DG_DBG_TRACE("Bulk read FPGA memory address=0x%08x, length=0x%x, chunks=%d",
+                         addr, len, chunk_num);
+
+            /* Send the first response to tell the client what follows */
+            DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+            DG_ENGINE_UTIL_rsp_append_data_hton(rsp, len);
+            DG_ENGINE_UTIL_rsp_append_data_hton(rsp, chunk_num);
+            DG_ENGINE_UTIL_rsp_send(rsp, req);
+
+            DG_ENGINE_UTIL_rsp_set_flag(rsp, DG_DEFS_RSP_FLAG_UNSOL);
+            for (offset = 0; offset < len; offset += chunk)
+            {
+                chunk = len - offset;
+                if (chunk > DG_FPGA_BULK_CHUNK_SIZE)
+                {
+                    chunk = DG_FPGA_BULK_CHUNK_SIZE;
+                }
+
+                DG_ENGINE_UTIL_rsp_set_len_zero(rsp);
+                DG_ENGINE_UTIL_rsp_append_data_hton(rsp, offset);
+                DG_ENGINE_UTIL_rsp_append_buf(rsp, window + offset, chunk);
+
+                /* Don't send out the last chunk here, let the main rsp_send take care of it */
+                if (offset + chunk < len)
+                {
+                    DG_ENGINE_UTIL_rsp_send(rsp, req);
+                }
+            }
+        }
+    }
+}
+
+/*=============================================================================================*//**
+@brief Write a large FPGA memory region with one bulk copy
+
+@param[in]     req     - DIAG request
+@param[in,out] rsp     - DIAG rsp builder
+*//*==============================================================================================*/
+void dg_fpga_write_bulk(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp)
+{
+    DG_CMN_DRV_FPGA_MEM_ADDR_T addr;
+    UINT32                     len;
+    UINT8*                     write_data = NULL;
+
+    const UINT32 min_len = sizeof(addr) + sizeof(len);
+
+    if (DG_ENGINE_UTIL_req_remain_len_check_at_least(req, min_len, rsp))
+    {
+        DG_ENGINE_UTIL_req_parse_data_ntoh(req, addr);
+        DG_ENGINE_UTIL_req_parse_data_ntoh(req, len);
+
+        if (DG_ENGINE_UTIL_req_remain_len_check_equal(req, len, rsp))
+        {
+            write_data = DG_ENGINE_UTIL_req_get_remain_data_ptr(req);
+
+            if (!DG_CMN_DRV_FPGA_write_bulk(addr, len, write_data))
+            {
+                DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                        "Failed to bulk write FPGA memory");
+            }
+            else
+            {
+                DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+            }
+        }
+    }
+}
+
 /** @} */
 /** @} */
 
@@ -26,12 +26,23 @@
 
 @par
 Allows generic read and write access to the FPGA FLASH information, CFI and memory.
+
+@par
+An image is programmed by STREAM_BEGIN with the image CRC32, one STREAM_DATA per chunk with the
+chunk CRC32, and STREAM_END which verifies the image CRC32 read back from the flash. The sectors
+are erased in the background while the previous sector is programmed.
+
+@par
+DIFF_BEGIN starts the same stream with the CRC32 of every image sector, the sector size comes from
+GET_CFI. The response tells which sectors differ from the flash, and only those sectors are
+erased and sent with STREAM_DATA. GET_STATS reports the progress and timing of a stream.
 */
 
 /*==================================================================================================
                                            LOCAL MACROS
 ==================================================================================================*/
-
+/** number of UINT32 fields in DG_CMN_DRV_FPGA_FLASH_STATS_T */
+#define DG_FPGA_FLASH_STATS_FIELD_NUM 9
 
 /*==================================================================================================
                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
@@ -39,10 +50,16 @@ Allows generic read and write access to the FPGA FLASH information, CFI and memo
 /** Actions for FPGA_FLASH command */
 enum
 {
-    DG_FPGA_FLASH_ACTION_GET_INFO = 0x00,
-    DG_FPGA_FLASH_ACTION_GET_CFI  = 0x01,
-    DG_FPGA_FLASH_ACTION_GET_MEM  = 0x02,
-    DG_FPGA_FLASH_ACTION_SET_MEM  = 0x03,
+    DG_FPGA_FLASH_ACTION_GET_INFO     = 0x00,
+    DG_FPGA_FLASH_ACTION_GET_CFI      = 0x01,
+    DG_FPGA_FLASH_ACTION_GET_MEM      = 0x02,
+    DG_FPGA_FLASH_ACTION_SET_MEM      = 0x03,
+    DG_FPGA_FLASH_ACTION_STREAM_BEGIN = 0x04,
+    DG_FPGA_FLASH_ACTION_STREAM_DATA  = 0x05,
+    DG_FPGA_FLASH_ACTION_STREAM_END   = 0x06,
+    DG_FPGA_FLASH_ACTION_GET_CRC      = 0x07,
+    DG_FPGA_FLASH_ACTION_DIFF_BEGIN   = 0x08,
+    DG_FPGA_FLASH_ACTION_GET_STATS    = 0x09,
 };
 typedef UINT8 DG_FPGA_FLASH_ACTION_T;
 
@@ -53,6 +70,8 @@ typedef UINT8 DG_FPGA_FLASH_ACTION_T;
 /*==================================================================================================
                                      LOCAL FUNCTION PROTOTYPES
 ==================================================================================================*/
+static void dg_fpga_flash_append_stats(DG_DEFS_DIAG_RSP_BUILDER_T*          rsp,
+                                       const DG_CMN_DRV_FPGA_FLASH_STATS_T* stats);
 
 /*==================================================================================================
                                          GLOBAL VARIABLES
@@ -79,6 +98,16 @@ void DG_FPGA_FLASH_handler_main(DG_DEFS_DIAG_REQ_T* req)
     DG_CMN_DRV_FLASH_ADDR_T     addr;
     DG_CMN_DRV_FLASH_LEN_T      len;
     UINT8*                      buf = NULL;
+    UINT32                      image_len;
+    UINT32                      offset;
+    UINT32                      crc;
+    UINT32                      sector_num;
+    UINT32                      changed_num;
+    UINT32*                     sector_crc;
+    UINT8*                      changed;
+    UINT32                      i;
+
+    DG_CMN_DRV_FPGA_FLASH_STATS_T stats;
     DG_DEFS_DIAG_RSP_BUILDER_T* rsp = DG_ENGINE_UTIL_rsp_init();
 
     DG_DBG_TRACE("In DG_FPGA_FLASH_handler_main begin to parse Request");
@@ -180,6 +209,161 @@ void DG_FPGA_FLASH_handler_main(DG_DEFS_DIAG_REQ_T* req)
             }
             break;
 
+        case DG_FPGA_FLASH_ACTION_STREAM_BEGIN:
+            if (DG_ENGINE_UTIL_req_remain_len_check_equal(req, sizeof(addr) + sizeof(image_len) +
+                                                          sizeof(crc), rsp))
+            {
+                DG_ENGINE_UTIL_req_parse_data_ntoh(req, addr);
+                DG_ENGINE_UTIL_req_parse_data_ntoh(req, image_len);
+                DG_ENGINE_UTIL_req_parse_data_ntoh(req, crc);
+                if (!DG_CMN_DRV_FPGA_FLASH_stream_begin(addr, image_len, crc))
+                {
+                    DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                            "Failed to start FPGA flash stream");
+                }
+                else
+                {
+                    DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+                }
+            }
+            break;
+
+        case DG_FPGA_FLASH_ACTION_STREAM_DATA:
+            if (DG_ENGINE_UTIL_req_remain_len_check_at_least(req, sizeof(offset) + sizeof(crc) + 1,
+                                                             rsp))
+            {
+                DG_ENGINE_UTIL_req_parse_data_ntoh(req, offset);
+                DG_ENGINE_UTIL_req_parse_data_ntoh(req, crc);
+                if (!DG_CMN_DRV_FPGA_FLASH_stream_write(offset,
+                                                        DG_ENGINE_UTIL_req_get_remain_len(req),
+                                                        crc,
+                                                        DG_ENGINE_UTIL_req_get_remain_data_ptr(req)))
+                {
+                    DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                            "Failed to write FPGA flash stream");
+                }
+                else
+                {
+                    DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+                }
+            }
+            break;
+
+        case DG_FPGA_FLASH_ACTION_STREAM_END:
+            if (DG_ENGINE_UTIL_req_remain_len_check_equal(req, 0, rsp))
+            {
+                if (!DG_CMN_DRV_FPGA_FLASH_stream_end(&crc, &stats))
+                {
+                    DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                            "Failed to finish FPGA flash stream");
+                }
+                else
+                {
+                    if (DG_ENGINE_UTIL_rsp_data_alloc(rsp, sizeof(crc) +
+                                                      DG_FPGA_FLASH_STATS_FIELD_NUM *
+                                                      sizeof(UINT32)))
+                    {
+                        DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+                        DG_ENGINE_UTIL_rsp_append_data_hton(rsp, crc);
+                        dg_fpga_flash_append_stats(rsp, &stats);
+                    }
+                }
+            }
+            break;
+
+        case DG_FPGA_FLASH_ACTION_GET_CRC:
+            if (DG_ENGINE_UTIL_req_remain_len_check_equal(req, sizeof(addr) + sizeof(image_len),
+                                                          rsp))
+            {
+                DG_ENGINE_UTIL_req_parse_data_ntoh(req, addr);
+                DG_ENGINE_UTIL_req_parse_data_ntoh(req, image_len);
+                if (!DG_CMN_DRV_FPGA_FLASH_get_crc(addr, image_len, &crc))
+                {
+                    DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                            "Failed to get FPGA flash CRC");
+                }
+                else
+                {
+                    if (DG_ENGINE_UTIL_rsp_data_alloc(rsp, sizeof(crc)))
+                    {
+                        DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+                        DG_ENGINE_UTIL_rsp_append_data_hton(rsp, crc);
+                    }
+                }
+            }
+            break;
+
+        case DG_FPGA_FLASH_ACTION_DIFF_BEGIN:
+            if (DG_ENGINE_UTIL_req_remain_len_check_at_least(req, sizeof(addr) + sizeof(image_len) +
+                                                             sizeof(crc) + sizeof(UINT32), rsp))
+            {
+                DG_ENGINE_UTIL_req_parse_data_ntoh(req, addr);
+                DG_ENGINE_UTIL_req_parse_data_ntoh(req, image_len);
+                DG_ENGINE_UTIL_req_parse_data_ntoh(req, crc);
+                sector_num = DG_ENGINE_UTIL_req_get_remain_len(req) / sizeof(UINT32);
+
+                if (DG_ENGINE_UTIL_req_remain_len_check_equal(req, sector_num * sizeof(UINT32),
+                                                              rsp))
+                {
+                    sector_crc = (UINT32*)DG_ENGINE_UTIL_alloc_mem(sector_num * sizeof(UINT32),
+                                                                   rsp);
+                    changed    = (UINT8*)DG_ENGINE_UTIL_alloc_mem((sector_num + 7) / 8, rsp);
+                    if ((sector_crc != NULL) && (changed != NULL))
+                    {
+                        for (i = 0; i < sector_num; i++)
+                        {
+                            DG_ENGINE_UTIL_req_parse_data_ntoh(req, sector_crc[i]);
+                        }
+
+                        if (!DG_CMN_DRV_FPGA_FLASH_diff_begin(addr, image_len, crc, sector_num,
+                                                              sector_crc, changed))
+                        {
+                            DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp,
+                                                                    DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                                    "Failed to start FPGA flash "
+                                                                    "differential stream");
+                        }
+                        else if (DG_ENGINE_UTIL_rsp_data_alloc(rsp, sizeof(sector_num) +
+                                                               sizeof(changed_num) +
+                                                               (sector_num + 7) / 8))
+                        {
+                            changed_num = 0;
+                            for (i = 0; i < sector_num; i++)
+                            {
+                                changed_num += (changed[i / 8] >> (i % 8)) & 1;
+                            }
+
+                            DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+                            DG_ENGINE_UTIL_rsp_append_data_hton(rsp, sector_num);
+                            DG_ENGINE_UTIL_rsp_append_data_hton(rsp, changed_num);
+                            DG_ENGINE_UTIL_rsp_append_buf(rsp, changed, (sector_num + 7) / 8);
+                        }
+                    }
+                    free(sector_crc);
+                    free(changed);
+                }
+            }
+            break;
+
+        case DG_FPGA_FLASH_ACTION_GET_STATS:
+            if (DG_ENGINE_UTIL_req_remain_len_check_equal(req, 0, rsp))
+            {
+                if (!DG_CMN_DRV_FPGA_FLASH_get_stats(&stats))
+                {
+                    DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                            "Failed to get FPGA flash statistics");
+                }
+                else
+                {
+                    if (DG_ENGINE_UTIL_rsp_data_alloc(rsp, DG_FPGA_FLASH_STATS_FIELD_NUM *
+                                                      sizeof(UINT32)))
+                    {
+                        DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+                        dg_fpga_flash_append_stats(rsp, &stats);
+                    }
+                }
+            }
+            break;
 
         default:
             DG_ENGINE_UTIL_rsp_set_error_string(rsp, DG_RSP_CODE_ASCII_ERR_PARM,
@@ -196,6 +380,26 @@ void DG_FPGA_FLASH_handler_main(DG_DEFS_DIAG_REQ_T* req)
                                           LOCAL FUNCTIONS
 ==================================================================================================*/
 
+/*=============================================================================================*//**
+@brief Append the statistics of a flash stream to a response
+
+@param[in] rsp   - The response builder
+@param[in] stats - The statistics of the stream
+*//*==============================================================================================*/
+static void dg_fpga_flash_append_stats(DG_DEFS_DIAG_RSP_BUILDER_T*          rsp,
+                                       const DG_CMN_DRV_FPGA_FLASH_STATS_T* stats)
+{
+    DG_ENGINE_UTIL_rsp_append_data_hton(rsp, stats->len);
+    DG_ENGINE_UTIL_rsp_append_data_hton(rsp, stats->offset);
+    DG_ENGINE_UTIL_rsp_append_data_hton(rsp, stats->sector_num);
+    DG_ENGINE_UTIL_rsp_append_data_hton(rsp, stats->sector_skipped);
+    DG_ENGINE_UTIL_rsp_append_data_hton(rsp, stats->sector_erased);
+    DG_ENGINE_UTIL_rsp_append_data_hton(rsp, stats->byte_programmed);
+    DG_ENGINE_UTIL_rsp_append_data_hton(rsp, stats->erase_ms);
+    DG_ENGINE_UTIL_rsp_append_data_hton(rsp, stats->program_ms);
+    DG_ENGINE_UTIL_rsp_append_data_hton(rsp, stats->time_ms);
+}
+
 /** @} */
 /** @} */
 
@@ -26,6 +26,11 @@
 
 @par
 Allows generic read/write access to the I2C bus.
+
+@par
+READ_BLOCK/WRITE_BLOCK take a 2 byte length and use as few bus transactions as the adapter
+allows, WRITE_BLOCK splits the data at the given device page size. The device gets as many offset
+bytes as its geometry needs, the offset of the request is the low byte.
 */
 
 /*==================================================================================================
@@ -38,8 +43,10 @@ Allows generic read/write access to the I2C bus.
 /** Actions for I2C command */
 enum
 {
-    DG_I2C_ACTION_READ  = 0x00,
-    DG_I2C_ACTION_WRITE = 0x01,
+    DG_I2C_ACTION_READ        = 0x00,
+    DG_I2C_ACTION_WRITE       = 0x01,
+    DG_I2C_ACTION_READ_BLOCK  = 0x02,
+    DG_I2C_ACTION_WRITE_BLOCK = 0x03,
 };
 typedef UINT8 DG_I2C_ACTION_T;
 
@@ -58,6 +65,14 @@ static void dg_i2c_write_bus(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T
                              DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T address,
                              DG_CMN_DRV_I2C_OFFSET_T offset);
 
+static void dg_i2c_read_block(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp,
+                              DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T address,
+                              DG_CMN_DRV_I2C_OFFSET_T offset);
+
+static void dg_i2c_write_block(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp,
+                               DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T address,
+                               DG_CMN_DRV_I2C_OFFSET_T offset);
+
 /*==================================================================================================
                                          GLOBAL VARIABLES
 ==================================================================================================*/
@@ -106,6 +121,14 @@ void DG_I2C_handler_main(DG_DEFS_DIAG_REQ_T* req)
             dg_i2c_write_bus(req, rsp, bus, address, offset);
             break;
 
+        case DG_I2C_ACTION_READ_BLOCK:
+            dg_i2c_read_block(req, rsp, bus, address, offset);
+            break;
+
+        case DG_I2C_ACTION_WRITE_BLOCK:
+            dg_i2c_write_block(req, rsp, bus, address, offset);
+            break;
+
         default:
             DG_ENGINE_UTIL_rsp_set_error_string(rsp, DG_RSP_CODE_ASCII_ERR_PARM,
                                                 "Invalid action 0x%02x", action);
@@ -200,6 +223,94 @@ void dg_i2c_write_bus(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp,
     }
 }
 
+/*=============================================================================================*//**
+@brief Read a block from the bus
+
+@param[in]     req     - DIAG request
+@param[in,out] rsp     - DIAG rsp builder
+@param[in]     bus     - I2C bus number in the system
+@param[in]     address - slave device address
+@param[in]     offset  - device data offset
+*//*==============================================================================================*/
+void dg_i2c_read_block(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp,
+                       DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T address,
+                       DG_CMN_DRV_I2C_OFFSET_T offset)
+{
+    UINT16                    read_length = 0;
+    UINT8*                    read_data   = NULL;
+    DG_CMN_DRV_I2C_GEOMETRY_T geometry;
+
+    if (DG_ENGINE_UTIL_req_remain_len_check_equal(req, sizeof(read_length), rsp))
+    {
+        DG_ENGINE_UTIL_req_parse_data_ntoh(req, read_length);
+
+        read_data = (UINT8*)DG_ENGINE_UTIL_alloc_mem(read_length, rsp);
+
+        if (read_data != NULL)
+        {
+            DG_CMN_DRV_I2C_get_geometry(bus, address, &geometry);
+
+            if (!DG_CMN_DRV_I2C_read_block(bus, address, offset, geometry.offset_len, read_length,
+                                           read_data))
+            {
+                DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                        "Failed to Read I2C block");
+            }
+            else if (DG_ENGINE_UTIL_rsp_data_alloc(rsp, read_length))
+            {
+                DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+                DG_ENGINE_UTIL_rsp_append_buf(rsp, read_data, read_length);
+            }
+
+            free(read_data);
+        }
+    }
+}
+
+/*=============================================================================================*//**
+@brief Write a block to the bus
+
+@param[in]     req     - DIAG request
+@param[in,out] rsp     - DIAG rsp builder
+@param[in]     bus     - I2C bus number in the system
+@param[in]     address - slave device address
+@param[in]     offset  - device data offset
+*//*==============================================================================================*/
+void dg_i2c_write_block(DG_DEFS_DIAG_REQ_T* req, DG_DEFS_DIAG_RSP_BUILDER_T* rsp,
+                        DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T address,
+                        DG_CMN_DRV_I2C_OFFSET_T offset)
+{
+    UINT8                     page_size    = 0;
+    UINT16                    write_length = 0;
+    UINT8*                    write_data   = NULL;
+    DG_CMN_DRV_I2C_GEOMETRY_T geometry;
+
+    if (DG_ENGINE_UTIL_req_remain_len_check_at_least(req, sizeof(page_size) + sizeof(write_length),
+                                                     rsp))
+    {
+        DG_ENGINE_UTIL_req_parse_data_ntoh(req, page_size);
+        DG_ENGINE_UTIL_req_parse_data_ntoh(req, write_length);
+
+        if (DG_ENGINE_UTIL_req_remain_len_check_equal(req, write_length, rsp))
+        {
+            write_data = DG_ENGINE_UTIL_req_get_remain_data_ptr(req);
+
+            DG_CMN_DRV_I2C_get_geometry(bus, address, &geometry);
+
+            if (!DG_CMN_DRV_I2C_write_block(bus, address, offset, geometry.offset_len,
+                                            write_length, write_data, page_size))
+            {
+                DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                        "Failed to Write I2C block");
+            }
+            else
+            {
+                DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+            }
+        }
+    }
+}
+
 /** @} */
 /** @} */
 
@@ -30,6 +30,11 @@ SFP test handler.
 /*==================================================================================================
                                            LOCAL MACROS
 ==================================================================================================*/
+/** SFP ID which selects every cage in a snapshot */
+#define DG_SFP_ID_ALL 0xff
+
+/** response size of one cage in a snapshot */
+#define DG_SFP_SNAPSHOT_ENTRY_LEN (3 + 3 * DG_CMN_DRV_SFP_VENDOR_LEN + 5 * sizeof(UINT16))
 
 /*==================================================================================================
                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
@@ -40,6 +45,7 @@ enum
     DG_SFP_ACTION_GET_STATUS = 0x00,
     DG_SFP_ACTION_TX_CONFIG  = 0x01,
     DG_SFP_ACTION_DUMP_REG   = 0x02,
+    DG_SFP_ACTION_SNAPSHOT   = 0x03,
 };
 typedef UINT8 DG_SFP_ACTION_T;
 
@@ -149,6 +155,68 @@ void DG_SFP_handler_main(DG_DEFS_DIAG_REQ_T* req)
             }
             break;
 
+        case DG_SFP_ACTION_SNAPSHOT:
+            if (DG_ENGINE_UTIL_req_remain_len_check_equal(req, 0, rsp))
+            {
+                DG_CMN_DRV_SFP_INFO_T info[DG_CMN_DRV_SFP_NUM];
+                UINT32                mask = 0;
+                UINT8                 num  = 0;
+                DG_CMN_DRV_SFP_ID_T   id;
+
+                if (sfp == DG_SFP_ID_ALL)
+                {
+                    mask = (1U << DG_CMN_DRV_SFP_NUM) - 1;
+                }
+                else if (sfp <= DG_CMN_DRV_SFP_ID_MAX)
+                {
+                    mask = 1U << sfp;
+                }
+
+                for (id = 0; id < DG_CMN_DRV_SFP_NUM; id++)
+                {
+                    num += (mask >> id) & 1;
+                }
+
+                if (mask == 0)
+                {
+                    DG_ENGINE_UTIL_rsp_set_error_string(rsp, DG_RSP_CODE_ASCII_ERR_PARM,
+                                                        "Invalid sfp=%d", sfp);
+                }
+                else if (!DG_CMN_DRV_SFP_snapshot(mask, info))
+                {
+                    DG_ENGINE_UTIL_rsp_set_error_string_drv(rsp, DG_RSP_CODE_ASCII_RSP_GEN_FAIL,
+                                                            "Failed to take SFP snapshot");
+                }
+                else if (DG_ENGINE_UTIL_rsp_data_alloc(rsp, sizeof(num) +
+                                                       num * DG_SFP_SNAPSHOT_ENTRY_LEN))
+                {
+                    DG_ENGINE_UTIL_rsp_set_code(rsp, DG_RSP_CODE_CMD_RSP_GENERIC);
+                    DG_ENGINE_UTIL_rsp_append_data_hton(rsp, num);
+
+                    for (id = 0; id < DG_CMN_DRV_SFP_NUM; id++)
+                    {
+                        if (((mask >> id) & 1) != 0)
+                        {
+                            DG_ENGINE_UTIL_rsp_append_data_hton(rsp, id);
+                            DG_ENGINE_UTIL_rsp_append_data_hton(rsp, info[id].status);
+                            DG_ENGINE_UTIL_rsp_append_data_hton(rsp, info[id].identifier);
+                            DG_ENGINE_UTIL_rsp_append_buf(rsp, (UINT8*)info[id].vendor_name,
+                                                          DG_CMN_DRV_SFP_VENDOR_LEN);
+                            DG_ENGINE_UTIL_rsp_append_buf(rsp, (UINT8*)info[id].vendor_pn,
+                                                          DG_CMN_DRV_SFP_VENDOR_LEN);
+                            DG_ENGINE_UTIL_rsp_append_buf(rsp, (UINT8*)info[id].vendor_sn,
+                                                          DG_CMN_DRV_SFP_VENDOR_LEN);
+                            DG_ENGINE_UTIL_rsp_append_data_hton(rsp, info[id].temperature);
+                            DG_ENGINE_UTIL_rsp_append_data_hton(rsp, info[id].vcc);
+                            DG_ENGINE_UTIL_rsp_append_data_hton(rsp, info[id].tx_bias);
+                            DG_ENGINE_UTIL_rsp_append_data_hton(rsp, info[id].tx_power);
+                            DG_ENGINE_UTIL_rsp_append_data_hton(rsp, info[id].rx_power);
+                        }
+                    }
+                }
+            }
+            break;
+
         default:
             DG_ENGINE_UTIL_rsp_set_error_string(rsp, DG_RSP_CODE_ASCII_ERR_PARM,
                                                 "Invalid action 0x%02x", action);
@@ -13,9 +13,37 @@ DG_CFG_DEFINES += DG_CFG_AUX_NUM=2
 ### Diag daemon pid file
 DG_CFG_DEFINES += DG_CFG_PID_FILE=\"/tmp/diagd.pid\"
 
+### Diag daemon configuration file, read at start-up and on SIGHUP, see dg_conf.h
+### The request length and the scheduler limits below are only the defaults of its tunables
+DG_CFG_DEFINES += DG_CFG_CONF_FILE=\"/etc/diagd.conf\"
+
 ### Diag daemon internel socket file
 DG_CFG_DEFINES += DG_CFG_INT_SOCKET=\"/tmp/diagd_local_socket\"
 
+### Largest DIAG request accepted from a client, the whole request is buffered before handling
+DG_CFG_DEFINES += DG_CFG_REQ_MAX_LEN=0x2000000U
+
+### Handlers run at once by the bulk and the background scheduling classes, 0 for no limit
+DG_CFG_DEFINES += DG_CFG_SCHED_BULK_MAX=4
+DG_CFG_DEFINES += DG_CFG_SCHED_BACKGROUND_MAX=1
+
+### DIAG requests in flight in the engine, per client and per opcode, over them a request is
+### answered busy, 0 for no per client or per opcode limit
+DG_CFG_DEFINES += DG_CFG_SCHED_INFLIGHT_MAX=64
+DG_CFG_DEFINES += DG_CFG_SCHED_CLIENT_MAX=4
+DG_CFG_DEFINES += DG_CFG_SCHED_OPCODE_MAX=16
+
+### FPGA memory BAR, a UIO map (/dev/uioN) or a PCI resource file
+### (/sys/bus/pci/devices/<bdf>/resourceN) and the offset of the memory in it, leave the path
+### empty to simulate the BAR
+DG_CFG_DEFINES += DG_CFG_FPGA_MEM_BAR=\"\"
+DG_CFG_DEFINES += DG_CFG_FPGA_MEM_BAR_OFFSET=0
+
+### Diag traffic capture file, its directory is created if missing and must be writable only by
+### the daemon user
+DG_CFG_DEFINES += DG_CFG_CAPTURE_DIR=\"/var/lib/diagd\"
+DG_CFG_DEFINES += DG_CFG_CAPTURE_FILE=DG_CFG_CAPTURE_DIR\"/diagd.cap\"
+
 
 DG_CFG_FLAGS := $(addprefix -D, $(DG_CFG_DEFINES))
 
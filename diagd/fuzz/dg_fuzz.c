@@ -0,0 +1,418 @@
+/*==================================================================================================
+
+    Module Name:  dg_fuzz.c
+
+    General Description: In-process fuzz harness for the DIAG request framing and the handlers
+
+    IMPORTANT NOTE: This code is not intended to be included in target release.
+                    This is only meant to be used to test the DIAG engine
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <pthread.h>
+#include "dg_handler_inc.h"
+#include "dg_client_comm.h"
+#include "dg_aux_engine.h"
+#include "dg_handler_table.h"
+
+/*==================================================================================================
+                                          LOCAL CONSTANTS
+==================================================================================================*/
+#define DG_FUZZ_SLOW_MS_DEFAULT 1000              /**< Input time reported as slow, in msec */
+#define DG_FUZZ_TIMEOUT_MSEC    2000              /**< Handler timeout used while fuzzing */
+#define DG_FUZZ_INPUT_MAX       (4 * 1024 * 1024) /**< Largest input file read */
+#define DG_FUZZ_NS_PER_MS       1000000ULL
+
+/*==================================================================================================
+                                            LOCAL MACROS
+==================================================================================================*/
+
+/*==================================================================================================
+                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+
+/*==================================================================================================
+                                     LOCAL FUNCTION PROTOTYPES
+==================================================================================================*/
+static void   dg_fuzz_init(void);
+static UINT64 dg_fuzz_run(const UINT8* data, size_t size);
+static void*  dg_fuzz_drain_thread(void* arg);
+static UINT64 dg_fuzz_now(void);
+#ifndef DG_FUZZ_LIBFUZZER
+static int    dg_fuzz_run_path(const char* path, UINT64 slow_ns, UINT32* count);
+static int    dg_fuzz_run_file(const char* path, UINT64 slow_ns);
+#endif
+
+/*==================================================================================================
+                                          GLOBAL VARIABLES
+==================================================================================================*/
+int LLVMFuzzerTestOneInput(const UINT8* data, size_t size);
+
+/*==================================================================================================
+                                          LOCAL VARIABLES
+==================================================================================================*/
+static pthread_once_t dg_fuzz_once = PTHREAD_ONCE_INIT;
+
+/* handler table with the fuzz timeout, the opcodes below are left out */
+static DG_DEFS_OPCODE_ENTRY_T* dg_fuzz_handler_tbl = NULL;
+
+/* opcodes which wait or change the daemon by design, they would only show up as noise */
+static const DG_DEFS_OPCODE_T dg_fuzz_skip_opcode[] =
+{
+    0x000F, /* BUTTON, waits for a button press       */
+    0x0101, /* RESET                                  */
+    0x0FFC, /* CAPTURE_CTRL, writes the capture file  */
+    0x0FFD, /* DEBUG_LEVEL, changes the log level     */
+    0x0FFE, /* TEST_ENGINE, delays as long as asked   */
+};
+
+static UINT64 dg_fuzz_slow_ns = DG_FUZZ_SLOW_MS_DEFAULT * DG_FUZZ_NS_PER_MS;
+
+/*==================================================================================================
+                                          GLOBAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief libFuzzer entry, also used by the AFL and the corpus drivers
+
+@param[in] data - The bytes a client sends, any number of DIAG requests
+@param[in] size - Number of bytes
+
+@return 0 always
+
+@note
+- an input slower than DG_FUZZ_SLOW_MS aborts, so the fuzzer keeps it like a crash
+*//*==============================================================================================*/
+int LLVMFuzzerTestOneInput(const UINT8* data, size_t size)
+{
+    UINT64 elapsed;
+
+    pthread_once(&dg_fuzz_once, dg_fuzz_init);
+
+    elapsed = dg_fuzz_run(data, size);
+    if (elapsed > dg_fuzz_slow_ns)
+    {
+        fprintf(stderr, "Slow input: %llu ms, limit %llu ms\n",
+                (unsigned long long)(elapsed / DG_FUZZ_NS_PER_MS),
+                (unsigned long long)(dg_fuzz_slow_ns / DG_FUZZ_NS_PER_MS));
+        abort();
+    }
+
+    return 0;
+}
+
+#ifndef DG_FUZZ_LIBFUZZER
+/*=============================================================================================*//**
+@brief Main function of the AFL and corpus drivers
+
+@param[in] argc - Number of arguments
+@param[in] argv - Array of each argument passed
+
+@return 0 if no input was slow
+
+@note
+- diagd_fuzz [-s SLOW_MS] FILE|DIR ... runs every input once and reports the slow ones
+- without a file the input is read from stdin, the way AFL runs it
+*//*==============================================================================================*/
+int main(int argc, char** argv)
+{
+    static UINT8 input[DG_FUZZ_INPUT_MAX];
+    size_t       size;
+    UINT64       slow_ns = 0;
+    UINT32       count   = 0;
+    int          slow    = 0;
+    int          opt;
+
+    while ((opt = getopt(argc, argv, "s:")) != -1)
+    {
+        switch (opt)
+        {
+        case 's':
+            slow_ns = strtoull(optarg, NULL, 0) * DG_FUZZ_NS_PER_MS;
+            break;
+
+        default:
+            fprintf(stderr, "usage: diagd_fuzz [-s SLOW_MS] [FILE|DIR ...]\n");
+            return -1;
+        }
+    }
+
+    pthread_once(&dg_fuzz_once, dg_fuzz_init);
+    if (slow_ns == 0)
+    {
+        slow_ns = dg_fuzz_slow_ns;
+    }
+    dg_fuzz_slow_ns = slow_ns;
+
+    if (optind == argc)
+    {
+#ifdef __AFL_LOOP
+        while (__AFL_LOOP(1000))
+#endif
+        {
+            size = fread(input, 1, sizeof(input), stdin);
+            LLVMFuzzerTestOneInput(input, size);
+        }
+        return 0;
+    }
+
+    for (; optind < argc; optind++)
+    {
+        slow += dg_fuzz_run_path(argv[optind], slow_ns, &count);
+    }
+
+    printf("%u inputs, %d slow\n", count, slow);
+
+    return (slow > 0) ? 1 : 0;
+}
+#endif
+
+/*==================================================================================================
+                                           LOCAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Sets up the engine the way DG_MAIN_start_engine does, without the listener
+*//*==============================================================================================*/
+static void dg_fuzz_init(void)
+{
+    const char* env;
+    UINT32      num = 0;
+    UINT32      tbl_i;
+    UINT32      skip_i;
+
+    /* a closed socket must not kill the harness */
+    signal(SIGPIPE, SIG_IGN);
+
+    if ((env = getenv("DG_FUZZ_SLOW_MS")) != NULL)
+    {
+        dg_fuzz_slow_ns = strtoull(env, NULL, 0) * DG_FUZZ_NS_PER_MS;
+    }
+
+    dg_dbg_level = (getenv("DG_FUZZ_DEBUG") != NULL) ? DG_DBG_LVL_TRACE : DG_DBG_LVL_DISABLE;
+
+    while (DG_HANDLER_TABLE_data[num].opcode != DG_DEFS_HANDLER_TABLE_OPCODE_END)
+    {
+        num++;
+    }
+
+    dg_fuzz_handler_tbl = (DG_DEFS_OPCODE_ENTRY_T*)malloc((num + 1) * sizeof(*dg_fuzz_handler_tbl));
+    if (dg_fuzz_handler_tbl == NULL)
+    {
+        fprintf(stderr, "Failed to allocate the handler table\n");
+        abort();
+    }
+
+    num = 0;
+    for (tbl_i = 0; DG_HANDLER_TABLE_data[tbl_i].opcode != DG_DEFS_HANDLER_TABLE_OPCODE_END; tbl_i++)
+    {
+        for (skip_i = 0; skip_i < DG_ARRAY_SIZE(dg_fuzz_skip_opcode); skip_i++)
+        {
+            if (DG_HANDLER_TABLE_data[tbl_i].opcode == dg_fuzz_skip_opcode[skip_i])
+            {
+                break;
+            }
+        }
+
+        if (skip_i == DG_ARRAY_SIZE(dg_fuzz_skip_opcode))
+        {
+            dg_fuzz_handler_tbl[num]              = DG_HANDLER_TABLE_data[tbl_i];
+            dg_fuzz_handler_tbl[num].timeout_msec = DG_FUZZ_TIMEOUT_MSEC;
+            num++;
+        }
+    }
+    /* the end entry forwards the unknown opcodes to the aux engines */
+    dg_fuzz_handler_tbl[num]              = DG_HANDLER_TABLE_data[tbl_i];
+    dg_fuzz_handler_tbl[num].timeout_msec = DG_FUZZ_TIMEOUT_MSEC;
+
+    DG_AUX_ENGINE_init_available_state();
+    DG_CLIENT_COMM_set_handler_tbl(dg_fuzz_handler_tbl);
+}
+
+/*=============================================================================================*//**
+@brief Feeds one input to a client connection handler over a socket pair
+
+@param[in] data - The bytes a client sends
+@param[in] size - Number of bytes
+
+@return the time until the connection handler is done, in nanoseconds
+*//*==============================================================================================*/
+static UINT64 dg_fuzz_run(const UINT8* data, size_t size)
+{
+    int       sv[2];
+    pthread_t conn_thread;
+    pthread_t drain_thread;
+    UINT64    begin;
+    size_t    offset = 0;
+    ssize_t   len;
+
+    /* every input starts in test mode, so all the handlers can be reached */
+    DG_ENGINE_UTIL_set_engine_mode(DG_DEFS_MODE_TEST);
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+    {
+        fprintf(stderr, "socketpair failed: %s\n", strerror(errno));
+        abort();
+    }
+
+    begin = dg_fuzz_now();
+
+    if ((pthread_create(&conn_thread, NULL, DG_CLIENT_COMM_client_connection_handler,
+                        (void*)(intptr_t)sv[0]) != 0) ||
+        (pthread_create(&drain_thread, NULL, dg_fuzz_drain_thread, (void*)(intptr_t)sv[1]) != 0))
+    {
+        fprintf(stderr, "pthread_create failed\n");
+        abort();
+    }
+
+    /* the handler closes its end once it can't parse the stream, the rest is not sent */
+    while (offset < size)
+    {
+        len = write(sv[1], data + offset, size - offset);
+        if (len > 0)
+        {
+            offset += len;
+        }
+        else if (errno != EINTR)
+        {
+            break;
+        }
+    }
+    shutdown(sv[1], SHUT_WR);
+
+    /* the connection handler closes sv[0] when it's done, then the drain sees the end */
+    pthread_join(conn_thread, NULL);
+    pthread_join(drain_thread, NULL);
+    close(sv[1]);
+
+    return dg_fuzz_now() - begin;
+}
+
+/*=============================================================================================*//**
+@brief Reads and drops the responses, so the handlers never block on a full socket
+
+@param[in] arg - The client end of the socket pair
+
+@return NULL always
+*//*==============================================================================================*/
+static void* dg_fuzz_drain_thread(void* arg)
+{
+    int     fd = (int)(intptr_t)arg;
+    UINT8   buf[4096];
+    ssize_t len;
+
+    while (((len = read(fd, buf, sizeof(buf))) > 0) || ((len < 0) && (errno == EINTR)))
+    {
+    }
+
+    return NULL;
+}
+
+/*=============================================================================================*//**
+@brief Gets the monotonic time
+
+@return the time in nanoseconds
+*//*==============================================================================================*/
+static UINT64 dg_fuzz_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT64)ts.tv_sec * 1000 * DG_FUZZ_NS_PER_MS + ts.tv_nsec;
+}
+
+#ifndef DG_FUZZ_LIBFUZZER
+/*=============================================================================================*//**
+@brief Runs an input file, or every file in a directory
+
+@param[in]  path    - File or directory
+@param[in]  slow_ns - Input time reported as slow
+@param[out] count   - Incremented for each input run
+
+@return the number of slow inputs
+*//*==============================================================================================*/
+static int dg_fuzz_run_path(const char* path, UINT64 slow_ns, UINT32* count)
+{
+    struct stat    st;
+    struct dirent* entry;
+    DIR*           dir;
+    char           file[PATH_MAX];
+    int            slow = 0;
+
+    if (stat(path, &st) != 0)
+    {
+        fprintf(stderr, "Failed to stat %s: %s\n", path, strerror(errno));
+    }
+    else if (!S_ISDIR(st.st_mode))
+    {
+        slow += dg_fuzz_run_file(path, slow_ns);
+        (*count)++;
+    }
+    else if ((dir = opendir(path)) == NULL)
+    {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+    }
+    else
+    {
+        while ((entry = readdir(dir)) != NULL)
+        {
+            if (entry->d_name[0] != '.')
+            {
+                snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+                slow += dg_fuzz_run_path(file, slow_ns, count);
+            }
+        }
+        closedir(dir);
+    }
+
+    return slow;
+}
+
+/*=============================================================================================*//**
+@brief Runs one input file
+
+@param[in] path    - The input file
+@param[in] slow_ns - Input time reported as slow
+
+@return 1 if the input is slow, 0 otherwise
+*//*==============================================================================================*/
+static int dg_fuzz_run_file(const char* path, UINT64 slow_ns)
+{
+    static UINT8 input[DG_FUZZ_INPUT_MAX];
+    FILE*        in;
+    size_t       size;
+    UINT64       elapsed;
+
+    if ((in = fopen(path, "r")) == NULL)
+    {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return 0;
+    }
+    size = fread(input, 1, sizeof(input), in);
+    fclose(in);
+
+    elapsed = dg_fuzz_run(input, size);
+    if (elapsed > slow_ns)
+    {
+        printf("SLOW %s: %llu ms\n", path, (unsigned long long)(elapsed / DG_FUZZ_NS_PER_MS));
+        return 1;
+    }
+
+    return 0;
+}
+#endif
+
@@ -36,17 +36,20 @@ DG_DIAG_INC := \
 
 LOCAL_C_INCLUDES :=  $(addprefix $(LOCAL_PATH)/, $(DG_DIAG_INC))
 
-LOCAL_STATIC_LIBRARIES := libdg_client_api
+LOCAL_STATIC_LIBRARIES := libdg_client_api libdg_dbg
 LOCAL_LDLIBS +=
 
 #Common Engine
 DG_ENGINE_SRC := \
   common/engine/src/dg_aux_engine.c \
   common/engine/src/dg_aux_util.c \
+  common/engine/src/dg_capture.c \
   common/engine/src/dg_client_comm.c \
+  common/engine/src/dg_conf.c \
   common/engine/src/dg_dbg.c \
   common/engine/src/dg_engine_util.c \
   common/engine/src/dg_main.c \
+  common/engine/src/dg_sched.c \
   common/engine/src/dg_socket.c
 
 #Engine for specific platform
@@ -62,6 +65,7 @@ DG_ENGINE_PLAT_SRC := \
 DG_HANDLERS_CMN_SRC := \
   common/handlers/src/dg_bios.c \
   common/handlers/src/dg_button.c \
+  common/handlers/src/dg_capture_ctrl.c \
   common/handlers/src/dg_clock.c \
   common/handlers/src/dg_cpld.c \
   common/handlers/src/dg_debug_level.c \
@@ -136,7 +140,9 @@ DG_DRIVERS_PLAT_SRC := \
   platform/drivers/src/dg_cmn_drv_tpm.c \
   platform/drivers/src/dg_cmn_drv_usb.c \
   platform/drivers/src/dg_cmn_drv_version.c \
-  platform/drivers/src/dg_cmn_drv_voltage.c
+  platform/drivers/src/dg_cmn_drv_voltage.c \
+  platform/drivers/src/dg_flash_sim.c \
+  platform/drivers/src/dg_i2c_sim.c
 
 LOCAL_SRC_FILES := \
   $(DG_ENGINE_SRC) \
@@ -148,3 +154,32 @@ LOCAL_SRC_FILES := \
 
 include $(BUILD_EXECUTABLE)
 
+#===================================================
+# DIAG FUZZ HARNESS
+#===================================================
+# the daemon without its main task, driven in-process by fuzz/dg_fuzz.c
+# libFuzzer: make CC=clang CXX=clang++ DG_FUZZ_FLAGS="-fsanitize=fuzzer-no-link,address \
+#            -DDG_FUZZ_LIBFUZZER" DG_FUZZ_LDFLAGS="-fsanitize=fuzzer,address"
+# AFL:       make CC=afl-clang-fast CXX=afl-clang-fast++
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := diagd_fuzz
+
+LOCAL_CFLAGS := $(DG_FLAGS) $(DG_FUZZ_FLAGS)
+
+LOCAL_LDFLAGS := $(DG_FUZZ_LDFLAGS)
+
+LOCAL_C_INCLUDES :=  $(addprefix $(LOCAL_PATH)/, $(DG_DIAG_INC))
+
+LOCAL_STATIC_LIBRARIES := libdg_client_api libdg_dbg
+
+LOCAL_SRC_FILES := \
+  fuzz/dg_fuzz.c \
+  $(DG_ENGINE_SRC) \
+  $(filter-out platform/engine/src/dg_main_task.c, $(DG_ENGINE_PLAT_SRC)) \
+  $(DG_HANDLERS_CMN_SRC) \
+  $(DG_HANDLERS_PLAT_SRC) \
+  $(DG_DRIVERS_CMN_SRC) \
+  $(DG_DRIVERS_PLAT_SRC)
+
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,124 @@
+#ifndef _DG_FLASH_SIM_H_
+#define _DG_FLASH_SIM_H_
+/*==================================================================================================
+
+    Module Name:  dg_flash_sim.h
+
+    General Description: This file provides the simulated NOR flash model
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+
+/** @addtogroup dg_platform_drivers
+@{
+*/
+
+/** @addtogroup FLASH_sim
+@{
+
+@par
+Simulated NOR flash behind the FPGA, so the flash drivers can be exercised and timed without
+hardware.
+
+@par
+The flash covers the whole 32 bit address space. Sectors are only backed by memory once they are
+programmed, an erased sector reads 0xff. Programming can only clear bits, like a real NOR cell.
+
+@par
+The flash has DG_FLASH_SIM_BANK_NUM banks, interleaved by sector, and each bank can run one
+operation at a time. An erase holds its bank for DG_FLASH_SIM_ERASE_US, a program holds the bank
+for DG_FLASH_SIM_PROGRAM_US per page and a read for DG_FLASH_SIM_READ_NS per byte. Operations on
+different banks run in parallel, so a sector can be erased while its neighbour is programmed.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*==================================================================================================
+                                              MACROS
+==================================================================================================*/
+/** erase sector size in bytes */
+#define DG_FLASH_SIM_SECTOR_SIZE 0x10000
+
+/** program page size in bytes */
+#define DG_FLASH_SIM_PAGE_SIZE 256
+
+/** number of banks, sector n is in bank n % DG_FLASH_SIM_BANK_NUM */
+#define DG_FLASH_SIM_BANK_NUM 2
+
+/** sector erase time in microseconds */
+#define DG_FLASH_SIM_ERASE_US 150000
+
+/** page program time in microseconds */
+#define DG_FLASH_SIM_PROGRAM_US 700
+
+/** read time per byte in nanoseconds */
+#define DG_FLASH_SIM_READ_NS 20
+
+/*==================================================================================================
+                                               ENUMS
+==================================================================================================*/
+
+/*==================================================================================================
+                                   STRUCTURES AND OTHER TYPEDEFS
+==================================================================================================*/
+
+/*==================================================================================================
+                                   GLOBAL VARIABLE DECLARATIONS
+==================================================================================================*/
+
+/*==================================================================================================
+                                        FUNCTION PROTOTYPES
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Read the simulated flash
+
+@param[in]  addr - The flash address
+@param[in]  len  - The number of bytes to read
+@param[out] buf  - The read data
+
+@return TRUE on success
+
+@note
+- the read wraps at the end of the address space
+*//*==============================================================================================*/
+BOOL DG_FLASH_SIM_read(UINT32 addr, UINT32 len, UINT8* buf);
+
+/*=============================================================================================*//**
+@brief Program the simulated flash
+
+@param[in] addr - The flash address
+@param[in] len  - The number of bytes to program
+@param[in] buf  - The data to program
+
+@return TRUE on success
+
+@note
+- each byte is ANDed into the flash, so only erased bytes take the new data
+- the data is split at page boundaries, every touched page costs one page program time
+*//*==============================================================================================*/
+BOOL DG_FLASH_SIM_program(UINT32 addr, UINT32 len, const UINT8* buf);
+
+/*=============================================================================================*//**
+@brief Erase one sector of the simulated flash
+
+@param[in] addr - Any address in the sector
+
+@return TRUE on success
+*//*==============================================================================================*/
+BOOL DG_FLASH_SIM_erase(UINT32 addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+/** @} */
+
+#endif /* _DG_FLASH_SIM_H_  */
+
@@ -0,0 +1,104 @@
+#ifndef _DG_I2C_SIM_H_
+#define _DG_I2C_SIM_H_
+/*==================================================================================================
+
+    Module Name:  dg_i2c_sim.h
+
+    General Description: This file provides the simulated I2C device model
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+
+/** @addtogroup dg_platform_drivers
+@{
+*/
+
+/** @addtogroup I2C_sim
+@{
+
+@par
+Simulated I2C devices which behave like 24Cxx serial EEPROMs, so the I2C based drivers can be
+exercised and timed without hardware.
+
+@par
+Every address on every bus answers. A device keeps an address pointer which is loaded from the
+first offset bytes of a write message, written data rolls over inside the device page and read
+data rolls over at the end of the device. Each transfer holds its bus for the time the bus would
+need at DG_I2C_SIM_BIT_NS per bit, and a write adds the EEPROM write cycle time.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*==================================================================================================
+                                              MACROS
+==================================================================================================*/
+/** simulated bus bit time in nanoseconds, 2500ns is a 400KHz fast mode bus */
+#define DG_I2C_SIM_BIT_NS 2500
+
+/** simulated EEPROM write cycle time in microseconds */
+#define DG_I2C_SIM_WRITE_CYCLE_US 5000
+
+/*==================================================================================================
+                                               ENUMS
+==================================================================================================*/
+
+/*==================================================================================================
+                                   STRUCTURES AND OTHER TYPEDEFS
+==================================================================================================*/
+
+/** statistics of one simulated bus */
+typedef struct
+{
+    UINT32 xfer_num;  /**< number of transfers on the bus          */
+    UINT32 byte_num;  /**< number of data bytes moved on the bus    */
+    UINT64 busy_ns;   /**< simulated time the bus has been occupied */
+} DG_I2C_SIM_STATS_T;
+
+/*==================================================================================================
+                                   GLOBAL VARIABLE DECLARATIONS
+==================================================================================================*/
+
+/*==================================================================================================
+                                        FUNCTION PROTOTYPES
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Run one combined transfer on a simulated I2C device
+
+@param[in]  bus     - The I2C bus
+@param[in]  address - The 7 bit device address
+@param[in]  w_buf   - The write message, starts with the device offset bytes
+@param[in]  w_len   - The length of the write message, 0 reads from the current address
+@param[out] r_buf   - The buffer for the read message
+@param[in]  r_len   - The length of the read message, 0 for a write only transfer
+
+@return TRUE if the device acknowledged the transfer
+
+@note
+- transfers on the same bus are serialized, different buses run in parallel
+*//*==============================================================================================*/
+BOOL DG_I2C_SIM_xfer(UINT8 bus, UINT8 address, const UINT8* w_buf, UINT32 w_len,
+                     UINT8* r_buf, UINT32 r_len);
+
+/*=============================================================================================*//**
+@brief Get the statistics of a simulated I2C bus
+
+@param[in]  bus   - The I2C bus
+@param[out] stats - The bus statistics
+*//*==============================================================================================*/
+void DG_I2C_SIM_get_stats(UINT8 bus, DG_I2C_SIM_STATS_T* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+/** @} */
+
+#endif /* _DG_I2C_SIM_H_  */
+
@@ -11,6 +11,7 @@
 ==================================================================================================*/
 #include "dg_handler_inc.h"
 #include "dg_drv_util.h"
+#include "dg_cmn_drv_i2c.h"
 #include "dg_cmn_drv_eeprom.h"
 
 
@@ -34,10 +35,20 @@ implementation of the EEPROM driver
 /*==================================================================================================
                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
 ==================================================================================================*/
+/** where an EEPROM sits, its part comes from DG_CMN_DRV_I2C_get_geometry() */
+typedef struct
+{
+    DG_CMN_DRV_I2C_BUS_T  bus;
+    DG_CMN_DRV_I2C_ADDR_T address;
+} dg_cmn_drv_eeprom_dev_t;
 
 /*==================================================================================================
                                      LOCAL FUNCTION PROTOTYPES
 ==================================================================================================*/
+static const dg_cmn_drv_eeprom_dev_t* dg_cmn_drv_eeprom_get_dev(DG_CMN_DRV_EEPROM_ID_T     eeprom,
+                                                                DG_CMN_DRV_EEPROM_ADDR_T   addr,
+                                                                UINT32                     len,
+                                                                DG_CMN_DRV_I2C_GEOMETRY_T* geom);
 
 /*==================================================================================================
                                          GLOBAL VARIABLES
@@ -46,6 +57,18 @@ implementation of the EEPROM driver
 /*==================================================================================================
                                           LOCAL VARIABLES
 ==================================================================================================*/
+/** EEPROM table, indexed by the EEPROM SELECTION ID */
+static const dg_cmn_drv_eeprom_dev_t dg_cmn_drv_eeprom_dev[] =
+{
+    { DG_CMN_DRV_I2C_MUX_CPU,  0x50 }, /* CB     */
+    { DG_CMN_DRV_I2C_MUX_CPU,  0x51 }, /* CB_LOG */
+    { DG_CMN_DRV_I2C_MUX_FEB,  0x50 }, /* FEB    */
+    { DG_CMN_DRV_I2C_MUX_WTB1, 0x50 }, /* WTB0   */
+    { DG_CMN_DRV_I2C_MUX_WTB2, 0x50 }, /* WTB1   */
+    { DG_CMN_DRV_I2C_MUX_WBP,  0x50 }, /* BPB    */
+    { DG_CMN_DRV_I2C_MUX_PSU0, 0x50 }, /* PSU0   */
+    { DG_CMN_DRV_I2C_MUX_PSU1, 0x50 }, /* PSU1   */
+};
 
 /*==================================================================================================
                                          GLOBAL FUNCTIONS
@@ -63,31 +86,7 @@ BOOL DG_CMN_DRV_EEPROM_read(DG_CMN_DRV_EEPROM_ID_T   eeprom,
                             DG_CMN_DRV_EEPROM_ADDR_T addr,
                             UINT8*                   data)
 {
-    BOOL ret = FALSE;
-
-    switch (eeprom)
-    {
-    case DG_CMN_DRV_EEPROM_CB:
-    case DG_CMN_DRV_EEPROM_CB_LOG:
-    case DG_CMN_DRV_EEPROM_FEB:
-    case DG_CMN_DRV_EEPROM_WTB0:
-    case DG_CMN_DRV_EEPROM_WTB1:
-    case DG_CMN_DRV_EEPROM_BPB:
-    case DG_CMN_DRV_EEPROM_PSU0:
-    case DG_CMN_DRV_EEPROM_PSU1:
-
-        *data = eeprom;
-        DG_DBG_TRACE("Read EEPROM: EEPROM_ID=%d, Offset=0x%04x, Data=0x%02x", eeprom, addr, *data);
-        ret = TRUE;
-        break;
-
-    default:
-        DG_DRV_UTIL_set_error_string("Read EEPROM failed: EEPROM_ID=%d, Offset=0x%04x",
-                                     eeprom, addr);
-        break;
-    }
-
-    return ret;
+    return DG_CMN_DRV_EEPROM_read_block(eeprom, addr, sizeof(*data), data);
 }
 
 /*=============================================================================================*//**
@@ -102,27 +101,88 @@ BOOL DG_CMN_DRV_EEPROM_write(DG_CMN_DRV_EEPROM_ID_T   eeprom,
                              DG_CMN_DRV_EEPROM_ADDR_T addr,
                              UINT8                    data)
 {
-    BOOL ret = FALSE;
+    return DG_CMN_DRV_EEPROM_write_block(eeprom, addr, sizeof(data), &data);
+}
+
+/*=============================================================================================*//**
+@brief Gets the size of the EEPROM
+
+@param[in]  eeprom - The EEPROM
+@param[out] size   - The EEPROM size in bytes
+
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_EEPROM_get_size(DG_CMN_DRV_EEPROM_ID_T eeprom, UINT32* size)
+{
+    DG_CMN_DRV_I2C_GEOMETRY_T geometry;
 
-    switch (eeprom)
+    if (dg_cmn_drv_eeprom_get_dev(eeprom, 0, 0, &geometry) == NULL)
     {
-    case DG_CMN_DRV_EEPROM_CB:
-    case DG_CMN_DRV_EEPROM_CB_LOG:
-    case DG_CMN_DRV_EEPROM_FEB:
-    case DG_CMN_DRV_EEPROM_WTB0:
-    case DG_CMN_DRV_EEPROM_WTB1:
-    case DG_CMN_DRV_EEPROM_BPB:
-    case DG_CMN_DRV_EEPROM_PSU0:
-    case DG_CMN_DRV_EEPROM_PSU1:
-
-        DG_DBG_TRACE("Write EEPROM: EEPROM_ID=%d, Offset=0x%04x, Data=0x%02x", eeprom, addr, data);
-        ret = TRUE;
-        break;
-
-    default:
-        DG_DRV_UTIL_set_error_string("Write EEPROM failed: EEPROM_ID=%d, Offset=0x%04x",
-                                     eeprom, addr);
-        break;
+        return FALSE;
+    }
+
+    *size = geometry.size;
+    return TRUE;
+}
+
+/*=============================================================================================*//**
+@brief Reads a block of data from the EEPROM
+
+@param[in]  eeprom - The EEPROM to read
+@param[in]  addr   - The start address of the EEPROM
+@param[in]  len    - The number of bytes to read, addr + len must not exceed the EEPROM size
+@param[out] data   - The read out data
+
+@note
+- the block is read with as few bus transactions as the I2C adapter allows
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_EEPROM_read_block(DG_CMN_DRV_EEPROM_ID_T   eeprom,
+                                  DG_CMN_DRV_EEPROM_ADDR_T addr,
+                                  UINT32                   len,
+                                  UINT8*                   data)
+{
+    BOOL                           ret = FALSE;
+    DG_CMN_DRV_I2C_GEOMETRY_T      geometry;
+    const dg_cmn_drv_eeprom_dev_t* dev = dg_cmn_drv_eeprom_get_dev(eeprom, addr, len, &geometry);
+
+    if (dev != NULL)
+    {
+        ret = DG_CMN_DRV_I2C_read_block(dev->bus, dev->address, addr, geometry.offset_len, len,
+                                        data);
+        if (ret)
+        {
+            DG_DBG_TRACE("Read EEPROM: EEPROM_ID=%d, Offset=0x%04x, Len=%d", eeprom, addr, len);
+            DG_DBG_DUMP(data, len);
+        }
+    }
+
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief Writes a block of data to the EEPROM
+
+@param[in]  eeprom - The EEPROM to write
+@param[in]  addr   - The start address of the EEPROM
+@param[in]  len    - The number of bytes to write, addr + len must not exceed the EEPROM size
+@param[in]  data   - The data to write
+
+@note
+- the block is split at the EEPROM page boundaries, one page write per transaction
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_EEPROM_write_block(DG_CMN_DRV_EEPROM_ID_T   eeprom,
+                                   DG_CMN_DRV_EEPROM_ADDR_T addr,
+                                   UINT32                   len,
+                                   UINT8*                   data)
+{
+    BOOL                           ret = FALSE;
+    DG_CMN_DRV_I2C_GEOMETRY_T      geometry;
+    const dg_cmn_drv_eeprom_dev_t* dev = dg_cmn_drv_eeprom_get_dev(eeprom, addr, len, &geometry);
+
+    if (dev != NULL)
+    {
+        DG_DBG_TRACE("Write EEPROM: EEPROM_ID=%d, Offset=0x%04x, Len=%d", eeprom, addr, len);
+        ret = DG_CMN_DRV_I2C_write_block(dev->bus, dev->address, addr, geometry.offset_len, len,
+                                         data, geometry.page_size);
     }
 
     return ret;
@@ -132,6 +192,42 @@ BOOL DG_CMN_DRV_EEPROM_write(DG_CMN_DRV_EEPROM_ID_T   eeprom,
                                           LOCAL FUNCTIONS
 ==================================================================================================*/
 
+/*=============================================================================================*//**
+@brief Look up an EEPROM and check the access range
+
+@param[in]  eeprom - The EEPROM
+@param[in]  addr   - The start address of the access
+@param[in]  len    - The length of the access
+@param[out] geom   - The EEPROM geometry
+
+@return the EEPROM, NULL if the EEPROM or the range is invalid
+*//*==============================================================================================*/
+static const dg_cmn_drv_eeprom_dev_t* dg_cmn_drv_eeprom_get_dev(DG_CMN_DRV_EEPROM_ID_T     eeprom,
+                                                                DG_CMN_DRV_EEPROM_ADDR_T   addr,
+                                                                UINT32                     len,
+                                                                DG_CMN_DRV_I2C_GEOMETRY_T* geom)
+{
+    const dg_cmn_drv_eeprom_dev_t* dev;
+
+    if (eeprom >= sizeof(dg_cmn_drv_eeprom_dev) / sizeof(dg_cmn_drv_eeprom_dev[0]))
+    {
+        DG_DRV_UTIL_set_error_string("Invalid EEPROM: EEPROM_ID=%d, Offset=0x%04x",
+                                     eeprom, addr);
+        return NULL;
+    }
+
+    dev = &dg_cmn_drv_eeprom_dev[eeprom];
+    DG_CMN_DRV_I2C_get_geometry(dev->bus, dev->address, geom);
+    if ((UINT32)addr + len > geom->size)
+    {
+        DG_DRV_UTIL_set_error_string("EEPROM access out of range: EEPROM_ID=%d, Offset=0x%04x, "
+                                     "Len=%d, Size=%d", eeprom, addr, len, geom->size);
+        return NULL;
+    }
+
+    return dev;
+}
+
 /** @} */
 /** @} */
 
@@ -10,6 +10,12 @@
                                            INCLUDE FILES
 ==================================================================================================*/
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "dg_handler_inc.h"
 #include "dg_drv_util.h"
 #include "dg_cmn_drv_fpga.h"
@@ -32,7 +38,15 @@ implementation of the FPGA driver
                                            LOCAL MACROS
 ==================================================================================================*/
 #define DG_CMN_DRV_FPGA_MAX_REG 64
-#define DG_CMN_DRV_FPGA_MAX_MEM 1024
+
+/** memory BAR of the FPGA from dg_cfg.mk, an empty path simulates the BAR in anonymous memory */
+#define DG_CMN_DRV_FPGA_MEM_BAR_PATH   DG_CFG_FPGA_MEM_BAR
+#define DG_CMN_DRV_FPGA_MEM_BAR_OFFSET DG_CFG_FPGA_MEM_BAR_OFFSET
+#define DG_CMN_DRV_FPGA_MEM_BAR_SIM    (DG_CMN_DRV_FPGA_MEM_BAR_PATH[0] == '\0')
+
+/** checks that a memory range is inside the memory BAR */
+#define DG_CMN_DRV_FPGA_MEM_IN_BAR(addr, len) \
+    ((UINT64)(addr) + (len) <= DG_CMN_DRV_FPGA_MEM_BAR_SIZE)
 
 /*==================================================================================================
                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
@@ -41,6 +55,9 @@ implementation of the FPGA driver
 /*==================================================================================================
                                      LOCAL FUNCTION PROTOTYPES
 ==================================================================================================*/
+static UINT8* dg_cmn_drv_fpga_get_mem_bar(void);
+static void   dg_cmn_drv_fpga_map_mem_bar(void);
+static int    dg_cmn_drv_fpga_open_mem_bar(void);
 
 /*==================================================================================================
                                          GLOBAL VARIABLES
@@ -52,8 +69,10 @@ implementation of the FPGA driver
 /* simulate the FPGA register set */
 static DG_CMN_DRV_FPGA_REG_VALUE_T dg_cmn_drv_fpga_reg[DG_CMN_DRV_FPGA_MAX_REG];
 
-/* simulate the FPGA memory set */
-static UINT8 dg_cmn_drv_fpga_mem[DG_CMN_DRV_FPGA_MAX_MEM];
+/* the mapped memory BAR, NULL if the mapping failed */
+static UINT8*         dg_cmn_drv_fpga_mem_bar;
+static int            dg_cmn_drv_fpga_mem_bar_errno;
+static pthread_once_t dg_cmn_drv_fpga_mem_bar_once = PTHREAD_ONCE_INIT;
 
 /*==================================================================================================
                                          GLOBAL FUNCTIONS
@@ -126,30 +145,20 @@ BOOL DG_CMN_DRV_FPGA_read_mem(DG_CMN_DRV_FPGA_MEM_ADDR_T addr,
                               DG_CMN_DRV_FPGA_MEM_SIZE_T read_len,
                               UINT8*                     read_data)
 {
-    BOOL ret = FALSE;
-
-    DG_CMN_DRV_FPGA_MEM_SIZE_T len = 0;
-
-    while (addr < DG_CMN_DRV_FPGA_MAX_MEM)
-    {
-        if (len == read_len)
-        {
-            DG_DBG_TRACE("Read FPGA memory address=0x%08x, length=0x%04x", addr, read_len);
-            ret = TRUE;
-            break;
-        }
-        *read_data = dg_cmn_drv_fpga_mem[addr];
-
-        addr++;
-        read_data++;
-        len++;
-    }
+    BOOL   ret = FALSE;
+    UINT8* window;
 
-    if (!ret)
+    if (!DG_CMN_DRV_FPGA_get_mem_window(addr, read_len, &window))
     {
         DG_DRV_UTIL_set_error_string("Read FPGA memory failed: address=0x%08x, length=0x%04x",
                                      addr, read_len);
     }
+    else
+    {
+        memcpy(read_data, window, read_len);
+        DG_DBG_TRACE("Read FPGA memory address=0x%08x, length=0x%04x", addr, read_len);
+        ret = TRUE;
+    }
 
     return ret;
 }
@@ -165,30 +174,20 @@ BOOL DG_CMN_DRV_FPGA_write_mem(DG_CMN_DRV_FPGA_MEM_ADDR_T addr,
                                DG_CMN_DRV_FPGA_MEM_SIZE_T write_len,
                                UINT8*                     write_data)
 {
-    BOOL ret = FALSE;
-
-    DG_CMN_DRV_FPGA_MEM_SIZE_T len = 0;
+    BOOL   ret = FALSE;
+    UINT8* window;
 
-    while (addr < DG_CMN_DRV_FPGA_MAX_MEM)
-    {
-        if (len == write_len)
-        {
-            DG_DBG_TRACE("Write FPGA memory address=0x%08x, length=0x%04x", addr, write_len);
-            ret = TRUE;
-            break;
-        }
-        dg_cmn_drv_fpga_mem[addr] = *write_data;
-
-        addr++;
-        write_data++;
-        len++;
-    }
-
-    if (!ret)
+    if (!DG_CMN_DRV_FPGA_get_mem_window(addr, write_len, &window))
     {
         DG_DRV_UTIL_set_error_string("Write FPGA memory failed: address=0x%08x, length=0x%04x",
                                      addr, write_len);
     }
+    else
+    {
+        memcpy(window, write_data, write_len);
+        DG_DBG_TRACE("Write FPGA memory address=0x%08x, length=0x%04x", addr, write_len);
+        ret = TRUE;
+    }
 
     return ret;
 }
@@ -207,18 +206,19 @@ BOOL DG_CMN_DRV_FPGA_dma_recv(DG_CMN_DRV_FPGA_MEM_ADDR_T addr,
                               DG_CMN_DRV_FPGA_MEM_SIZE_T read_len,
                               UINT8*                     read_data)
 {
-    BOOL ret = FALSE;
+    BOOL   ret = FALSE;
+    UINT8* window;
 
-    if ((addr + read_len) < DG_CMN_DRV_FPGA_MAX_MEM)
+    if (!DG_CMN_DRV_FPGA_get_mem_window(addr, read_len, &window))
     {
-        DG_DBG_TRACE("DMA recv FPGA memory address=0x%08x, length=0x%04x", addr, read_len);
-        memcpy(read_data, &dg_cmn_drv_fpga_mem[addr], read_len);
-        ret = TRUE;
+        DG_DRV_UTIL_set_error_string("DMA recv FPGA memory failed: address=0x%08x, length=0x%04x",
+                                     addr, read_len);
     }
     else
     {
-        DG_DRV_UTIL_set_error_string("DMA recv FPGA memory failed: address=0x%08x, length=0x%04x",
-                                     addr, read_len);
+        DG_DBG_TRACE("DMA recv FPGA memory address=0x%08x, length=0x%04x", addr, read_len);
+        memcpy(read_data, window, read_len);
+        ret = TRUE;
     }
 
     return ret;
@@ -235,18 +235,60 @@ BOOL DG_CMN_DRV_FPGA_dma_send(DG_CMN_DRV_FPGA_MEM_ADDR_T addr,
                               DG_CMN_DRV_FPGA_MEM_SIZE_T write_len,
                               UINT8*                     write_data)
 {
-    BOOL ret = FALSE;
+    return DG_CMN_DRV_FPGA_write_bulk(addr, write_len, write_data);
+}
 
-    if ((addr + write_len) < DG_CMN_DRV_FPGA_MAX_MEM)
+/*=============================================================================================*//**
+@brief Get a window into the mapped FPGA memory BAR
+
+@param[in]  addr   - The FPGA memory address
+@param[in]  len    - The number of bytes the window has to cover
+@param[out] window - Pointer to the first byte of the window
+
+@note
+- the window stays valid for the life of the process, bulk transfers memcpy through it
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_get_mem_window(DG_CMN_DRV_FPGA_MEM_ADDR_T addr, UINT32 len, UINT8** window)
+{
+    BOOL   ret = FALSE;
+    UINT8* bar = dg_cmn_drv_fpga_get_mem_bar();
+
+    if (bar == NULL)
     {
-        DG_DBG_TRACE("DMA send FPGA memory address=0x%08x, length=0x%04x", addr, write_len);
-        memcpy(&dg_cmn_drv_fpga_mem[addr], write_data, write_len);
-        ret = TRUE;
+        /* error string is set */
+    }
+    else if (!DG_CMN_DRV_FPGA_MEM_IN_BAR(addr, len))
+    {
+        DG_DRV_UTIL_set_error_string("FPGA memory range out of BAR: address=0x%08x, "
+                                     "length=0x%x, BAR size=0x%x",
+                                     addr, len, DG_CMN_DRV_FPGA_MEM_BAR_SIZE);
     }
     else
     {
-        DG_DRV_UTIL_set_error_string("DMA send FPGA memory failed: address=0x%08x, length=0x%04x",
-                                     addr, write_len);
+        *window = bar + addr;
+        ret     = TRUE;
+    }
+
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief Write a large FPGA memory region with one bulk copy
+
+@param[in] addr - The FPGA memory address to write to
+@param[in] len  - The amount of data to write in bytes
+@param[in] buf  - The data to write to the FPGA memory
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_write_bulk(DG_CMN_DRV_FPGA_MEM_ADDR_T addr, UINT32 len, const UINT8* buf)
+{
+    BOOL   ret = FALSE;
+    UINT8* window;
+
+    if (DG_CMN_DRV_FPGA_get_mem_window(addr, len, &window))
+    {
+        DG_DBG_TRACE("Bulk write FPGA memory address=0x%08x, length=0x%x", addr, len);
+        memcpy(window, buf, len);
+        ret = TRUE;
     }
 
     return ret;
@@ -341,6 +383,108 @@ BOOL DG_CMN_DRV_FPGA_download_image(DG_CMN_DRV_FPGA_IMAGE_T image)
                                           LOCAL FUNCTIONS
 ==================================================================================================*/
 
+/*=============================================================================================*//**
+@brief Get the mapped memory BAR, the BAR is mapped on the first use
+
+@return the start of the BAR, NULL if it can't be mapped
+*//*==============================================================================================*/
+static UINT8* dg_cmn_drv_fpga_get_mem_bar(void)
+{
+    pthread_once(&dg_cmn_drv_fpga_mem_bar_once, dg_cmn_drv_fpga_map_mem_bar);
+
+    if (dg_cmn_drv_fpga_mem_bar == NULL)
+    {
+        DG_DRV_UTIL_set_error_string("Failed to map FPGA memory BAR %s: %s",
+                                     DG_CMN_DRV_FPGA_MEM_BAR_SIM ? "(simulated)" :
+                                     DG_CMN_DRV_FPGA_MEM_BAR_PATH,
+                                     strerror(dg_cmn_drv_fpga_mem_bar_errno));
+    }
+
+    return dg_cmn_drv_fpga_mem_bar;
+}
+
+/*=============================================================================================*//**
+@brief Map the memory BAR, runs once
+*//*==============================================================================================*/
+static void dg_cmn_drv_fpga_map_mem_bar(void)
+{
+    void* bar;
+    int   fd;
+
+    fd = dg_cmn_drv_fpga_open_mem_bar();
+    if (fd < 0)
+    {
+        dg_cmn_drv_fpga_mem_bar_errno = errno;
+    }
+    else
+    {
+        bar = mmap(NULL, DG_CMN_DRV_FPGA_MEM_BAR_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd, DG_CMN_DRV_FPGA_MEM_BAR_OFFSET);
+        if (bar == MAP_FAILED)
+        {
+            dg_cmn_drv_fpga_mem_bar_errno = errno;
+        }
+        else
+        {
+            dg_cmn_drv_fpga_mem_bar = (UINT8*)bar;
+            DG_DBG_TRACE("Mapped FPGA memory BAR %s, size=0x%x",
+                         DG_CMN_DRV_FPGA_MEM_BAR_SIM ? "(simulated)" : DG_CMN_DRV_FPGA_MEM_BAR_PATH,
+                         DG_CMN_DRV_FPGA_MEM_BAR_SIZE);
+        }
+
+        /* the mapping stays valid after the descriptor is closed */
+        close(fd);
+    }
+}
+
+/*=============================================================================================*//**
+@brief Open the memory BAR to map
+
+@return the descriptor, -1 with errno set on failure
+
+@note
+- the configured path is a UIO map or a PCI resource file, it is never created nor resized and a
+  symbolic link is refused
+- a simulated BAR is an anonymous memory file no other process can reach
+*//*==============================================================================================*/
+static int dg_cmn_drv_fpga_open_mem_bar(void)
+{
+    struct stat st;
+    int         fd;
+
+    if (DG_CMN_DRV_FPGA_MEM_BAR_SIM)
+    {
+        fd = memfd_create("dg_fpga_mem_bar", MFD_CLOEXEC);
+        if ((fd >= 0) &&
+            (ftruncate(fd, DG_CMN_DRV_FPGA_MEM_BAR_OFFSET + DG_CMN_DRV_FPGA_MEM_BAR_SIZE) != 0))
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    else
+    {
+        fd = open(DG_CMN_DRV_FPGA_MEM_BAR_PATH, O_RDWR | O_NOFOLLOW | O_CLOEXEC);
+        if ((fd >= 0) && (fstat(fd, &st) != 0))
+        {
+            close(fd);
+            fd = -1;
+        }
+        else if ((fd >= 0) &&
+                 (!(S_ISCHR(st.st_mode) || S_ISREG(st.st_mode)) ||
+                  (S_ISREG(st.st_mode) &&
+                   (st.st_size < DG_CMN_DRV_FPGA_MEM_BAR_OFFSET + DG_CMN_DRV_FPGA_MEM_BAR_SIZE))))
+        {
+            /* a resource file is as large as the BAR, a UIO map is a character device */
+            close(fd);
+            fd    = -1;
+            errno = ENXIO;
+        }
+    }
+
+    return fd;
+}
+
 /** @} */
 /** @} */
 
@@ -9,9 +9,12 @@
 ====================================================================================================
                                            INCLUDE FILES
 ==================================================================================================*/
+#include <stdlib.h>
+#include <pthread.h>
 #include "dg_handler_inc.h"
 #include "dg_drv_util.h"
 #include "dg_cmn_drv_fpga_flash.h"
+#include "dg_flash_sim.h"
 
 
 /** @addtogroup dg_common_drivers
@@ -30,14 +33,59 @@ implementation of the FPGA_FLASH driver
 /*==================================================================================================
                                            LOCAL MACROS
 ==================================================================================================*/
+/** size of the flash in bytes, 2^n with n the CFI device size */
+#define DG_CMN_DRV_FPGA_FLASH_SIZE 0x100000000ULL
+
+/** size of the buffer used to read back the flash for a CRC */
+#define DG_CMN_DRV_FPGA_FLASH_CRC_BUF_SIZE 4096
+
+/** CFI fields, as indexes into DG_CMN_DRV_FLASH_CFI_T which starts at CFI address 0x10 */
+#define DG_CMN_DRV_FPGA_FLASH_CFI_DEV_SIZE      (0x27 - 0x10) /* device size is 2^n bytes     */
+#define DG_CMN_DRV_FPGA_FLASH_CFI_BUF_SIZE      (0x2a - 0x10) /* write buffer is 2^n bytes    */
+#define DG_CMN_DRV_FPGA_FLASH_CFI_REGION_NUM    (0x2c - 0x10) /* number of erase regions      */
+#define DG_CMN_DRV_FPGA_FLASH_CFI_REGION_BLOCKS (0x2d - 0x10) /* region 1 sectors - 1, 16 bit */
+#define DG_CMN_DRV_FPGA_FLASH_CFI_REGION_SIZE   (0x2f - 0x10) /* region 1 sector / 256, 16 bit */
+
+/** test bit n of a sector bitmap */
+#define DG_CMN_DRV_FPGA_FLASH_IS_CHANGED(map, n) \
+    (((map) == NULL) || (((map)[(n) / 8] & (1 << ((n) % 8))) != 0))
 
 /*==================================================================================================
                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
 ==================================================================================================*/
+/** state of the streamed image */
+typedef struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;        /* signalled on every erase and write progress               */
+    BOOL            b_active;    /* a stream is started                                       */
+    BOOL            b_abort;     /* the stream is dropped, the erase thread has to stop       */
+    BOOL            b_failed;    /* an erase or program failed                                */
+    pthread_t       eraser;
+    UINT32          session;     /* incremented by every started stream                       */
+    UINT32          addr;        /* flash address of the image                                */
+    UINT32          len;         /* image length                                              */
+    UINT32          crc;         /* CRC32 of the image given by the client                    */
+    UINT32          sector_size; /* erase sector size from the CFI                            */
+    UINT32          sector_num;  /* number of sectors covered by the image                    */
+    UINT8*          changed;     /* bitmap of the sectors to program, NULL for all sectors    */
+    UINT32          offset;      /* offset of the next chunk                                  */
+    UINT32          erased_end;  /* sectors below this one are erased or skipped              */
+    UINT32          writing;     /* image sector which is written, the eraser stays one ahead */
+    UINT32          writer_num;  /* number of chunks being programmed                         */
+    INT64           start_ms;
+    DG_CMN_DRV_FPGA_FLASH_STATS_T stats;
+} dg_cmn_drv_fpga_flash_stream_t;
 
 /*==================================================================================================
                                      LOCAL FUNCTION PROTOTYPES
 ==================================================================================================*/
+static BOOL   dg_cmn_drv_fpga_flash_get_sector_size(UINT32* sector_size);
+static BOOL   dg_cmn_drv_fpga_flash_stream_start(DG_CMN_DRV_FLASH_ADDR_T addr, UINT32 len,
+                                                 UINT32 crc, UINT32 sector_size, UINT8* changed);
+static void   dg_cmn_drv_fpga_flash_skip(dg_cmn_drv_fpga_flash_stream_t* stream);
+static void*  dg_cmn_drv_fpga_flash_erase_job(void* arg);
+static void   dg_cmn_drv_fpga_flash_stream_stop(void);
 
 /*==================================================================================================
                                          GLOBAL VARIABLES
@@ -46,6 +94,14 @@ implementation of the FPGA_FLASH driver
 /*==================================================================================================
                                           LOCAL VARIABLES
 ==================================================================================================*/
+static dg_cmn_drv_fpga_flash_stream_t dg_cmn_drv_fpga_flash_stream =
+{
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond  = PTHREAD_COND_INITIALIZER,
+};
+
+/* serializes starting and finishing streams, so only one erase thread exists at a time */
+static pthread_mutex_t dg_cmn_drv_fpga_flash_ctrl_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /*==================================================================================================
                                          GLOBAL FUNCTIONS
@@ -87,6 +143,18 @@ BOOL DG_CMN_DRV_FPGA_FLASH_get_cfi(DG_CMN_DRV_FLASH_CFI_T* cfi)
     cfi->val[1] = 'R';
     cfi->val[2] = 'Y';
 
+    /* geometry of the simulated flash, one uniform erase region */
+    cfi->val[DG_CMN_DRV_FPGA_FLASH_CFI_DEV_SIZE]          = 32;
+    cfi->val[DG_CMN_DRV_FPGA_FLASH_CFI_BUF_SIZE]          = 8;
+    cfi->val[DG_CMN_DRV_FPGA_FLASH_CFI_BUF_SIZE + 1]      = 0;
+    cfi->val[DG_CMN_DRV_FPGA_FLASH_CFI_REGION_NUM]        = 1;
+    cfi->val[DG_CMN_DRV_FPGA_FLASH_CFI_REGION_BLOCKS]     = 0xff;
+    cfi->val[DG_CMN_DRV_FPGA_FLASH_CFI_REGION_BLOCKS + 1] = 0xff;
+    cfi->val[DG_CMN_DRV_FPGA_FLASH_CFI_REGION_SIZE]       =
+        (DG_CMN_DRV_FPGA_FLASH_SECTOR_SIZE / 256) & 0xff;
+    cfi->val[DG_CMN_DRV_FPGA_FLASH_CFI_REGION_SIZE + 1]   =
+        (DG_CMN_DRV_FPGA_FLASH_SECTOR_SIZE / 256) >> 8;
+
     DG_DBG_TRACE("Get FPGA flash CFI");
     DG_DBG_DUMP(cfi->val, sizeof(cfi->val));
 
@@ -104,16 +172,12 @@ BOOL DG_CMN_DRV_FPGA_FLASH_get_mem(DG_CMN_DRV_FLASH_ADDR_T addr,
                                    DG_CMN_DRV_FLASH_LEN_T  len,
                                    UINT8*                  buf)
 {
-    UINT32 i;
+    BOOL ret = DG_FLASH_SIM_read(addr, len, buf);
 
-    for (i = 0; i < len; i++)
-    {
-        *buf++ = (UINT8)(addr + i);
-    }
     DG_DBG_TRACE("Get FPGA flash memory address %x, length %d, buffer %p", addr, len, buf);
     DG_DBG_DUMP(buf, len);
 
-    return TRUE;
+    return ret;
 }
 
 /*=============================================================================================*//**
@@ -130,13 +194,582 @@ BOOL DG_CMN_DRV_FPGA_FLASH_set_mem(DG_CMN_DRV_FLASH_ADDR_T addr,
     DG_DBG_TRACE("Set FPGA flash memory address %x, length %d, buffer %p", addr, len, buf);
     DG_DBG_DUMP(buf, len);
 
+    return DG_FLASH_SIM_program(addr, len, buf);
+}
+
+/*=============================================================================================*//**
+@brief Start streaming an image into the FPGA flash
+
+@param[in] addr - The flash address of the image, aligned to the erase sector
+@param[in] len  - The image length in bytes
+@param[in] crc  - The CRC32 of the whole image
+
+@note
+- the sectors of the image are erased by a background thread which runs one sector ahead of
+  the written data, so an erase overlaps with the program of the previous sector
+- starting a new stream drops an unfinished one
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_FLASH_stream_begin(DG_CMN_DRV_FLASH_ADDR_T addr, UINT32 len, UINT32 crc)
+{
+    BOOL   ret = FALSE;
+    UINT32 sector_size;
+
+    if (dg_cmn_drv_fpga_flash_get_sector_size(&sector_size))
+    {
+        ret = dg_cmn_drv_fpga_flash_stream_start(addr, len, crc, sector_size, NULL);
+    }
+
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief Start a differential stream which only programs the changed sectors of an image
+
+@param[in]  addr       - The flash address of the image, aligned to the erase sector
+@param[in]  len        - The image length in bytes
+@param[in]  crc        - The CRC32 of the whole image
+@param[in]  sector_num - The number of sectors covered by the image
+@param[in]  sector_crc - The CRC32 of each image sector, the last one only covers the image end
+@param[out] changed    - Bitmap of the sectors to send, bit n of byte n / 8 is sector n
+
+@note
+- the sector size is the erase region of the CFI
+- the CRC32 of every sector in the flash is compared with the image, only the sectors which
+  differ are erased and expect STREAM_DATA chunks, the other sectors are skipped
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_FLASH_diff_begin(DG_CMN_DRV_FLASH_ADDR_T addr,
+                                      UINT32                  len,
+                                      UINT32                  crc,
+                                      UINT32                  sector_num,
+                                      const UINT32*           sector_crc,
+                                      UINT8*                  changed)
+{
+    BOOL   ret = FALSE;
+    UINT32 sector_size;
+    UINT32 sector;
+    UINT32 sector_len;
+    UINT32 flash_crc;
+    UINT8* map;
+
+    if (!dg_cmn_drv_fpga_flash_get_sector_size(&sector_size))
+    {
+        /* error string is set */
+    }
+    else if ((len == 0) || (sector_num != (len - 1) / sector_size + 1))
+    {
+        DG_DRV_UTIL_set_error_string("Image of 0x%x bytes covers %d sectors of 0x%x, got %d "
+                                     "sector CRCs", len, len == 0 ? 0 : (len - 1) / sector_size + 1,
+                                     sector_size, sector_num);
+    }
+    else if ((map = (UINT8*)calloc((sector_num + 7) / 8, 1)) == NULL)
+    {
+        DG_DRV_UTIL_set_error(DG_DRV_UTIL_ERR_NO_MEM, (sector_num + 7) / 8);
+    }
+    else
+    {
+        ret = TRUE;
+        for (sector = 0; ret && (sector < sector_num); sector++)
+        {
+            sector_len = len - sector * sector_size;
+            sector_len = (sector_len < sector_size) ? sector_len : sector_size;
+
+            ret = DG_CMN_DRV_FPGA_FLASH_get_crc(addr + sector * sector_size, sector_len,
+                                                &flash_crc);
+            if (ret && (flash_crc != sector_crc[sector]))
+            {
+                map[sector / 8] |= 1 << (sector % 8);
+            }
+        }
+
+        if (ret)
+        {
+            memcpy(changed, map, (sector_num + 7) / 8);
+
+            /* the stream owns the bitmap from here */
+            ret = dg_cmn_drv_fpga_flash_stream_start(addr, len, crc, sector_size, map);
+        }
+        else
+        {
+            free(map);
+        }
+    }
+
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief Program the next chunk of a streamed image
+
+@param[in] offset - The offset of the chunk in the image, must follow the previous chunk
+@param[in] len    - The chunk length in bytes
+@param[in] crc    - The CRC32 of the chunk
+@param[in] buf    - The chunk data
+
+@note
+- a chunk with a wrong CRC is rejected without touching the flash, it can be sent again
+- in a differential stream the next chunk starts at the next changed sector, and a chunk must
+  not run into a skipped sector
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_FLASH_stream_write(UINT32 offset, UINT32 len, UINT32 crc, UINT8* buf)
+{
+    BOOL                            ret    = FALSE;
+    dg_cmn_drv_fpga_flash_stream_t* stream = &dg_cmn_drv_fpga_flash_stream;
+    UINT32                          session;
+    UINT32                          chunk_crc;
+    UINT32                          first;
+    UINT32                          last;
+    INT64                           start_ms;
+
+    pthread_mutex_lock(&stream->mutex);
+    session = stream->session;
+
+    if (!stream->b_active)
+    {
+        DG_DRV_UTIL_set_error_string("No flash stream is started");
+    }
+    else if (offset != stream->offset)
+    {
+        DG_DRV_UTIL_set_error_string("Unexpected chunk offset 0x%x, expected 0x%x",
+                                     offset, stream->offset);
+    }
+    else if ((len == 0) || (len > stream->len - offset))
+    {
+        DG_DRV_UTIL_set_error_string("Invalid chunk length 0x%x at offset 0x%x of 0x%x",
+                                     len, offset, stream->len);
+    }
+    else if ((chunk_crc = DG_DRV_UTIL_crc32(0, buf, len)) != crc)
+    {
+        DG_DRV_UTIL_set_error_string("Chunk CRC mismatch at offset 0x%x: got 0x%08x, "
+                                     "expected 0x%08x", offset, chunk_crc, crc);
+    }
+    else
+    {
+        first = offset / stream->sector_size;
+        last  = (offset + len - 1) / stream->sector_size;
+        while ((first < last) && DG_CMN_DRV_FPGA_FLASH_IS_CHANGED(stream->changed, first + 1))
+        {
+            first++;
+        }
+
+        if (first != last)
+        {
+            DG_DRV_UTIL_set_error_string("Chunk at offset 0x%x runs into unchanged sector %d",
+                                         offset, first + 1);
+        }
+        else
+        {
+            /* let the eraser run one sector past this chunk, then wait for the chunk sectors */
+            stream->writing = last;
+            pthread_cond_broadcast(&stream->cond);
+
+            while ((stream->session == session) && !stream->b_abort && !stream->b_failed &&
+                   (stream->erased_end <= last))
+            {
+                pthread_cond_wait(&stream->cond, &stream->mutex);
+            }
+
+            if ((stream->session != session) || stream->b_abort)
+            {
+                DG_DRV_UTIL_set_error_string("Flash stream was dropped");
+            }
+            else if (stream->b_failed)
+            {
+                DG_DRV_UTIL_set_error_string("Flash stream failed before offset 0x%x", offset);
+            }
+            else
+            {
+                /* claim the range, then program it without blocking the eraser */
+                stream->offset += len;
+                dg_cmn_drv_fpga_flash_skip(stream);
+                stream->writer_num++;
+                pthread_mutex_unlock(&stream->mutex);
+
+                start_ms = DG_DRV_UTIL_time_ms();
+                ret      = DG_FLASH_SIM_program(stream->addr + offset, len, buf);
+
+                pthread_mutex_lock(&stream->mutex);
+                stream->writer_num--;
+                stream->stats.program_ms += (UINT32)(DG_DRV_UTIL_time_ms() - start_ms);
+                if (ret)
+                {
+                    stream->stats.byte_programmed += len;
+                }
+                else
+                {
+                    stream->b_failed = TRUE;
+                }
+                pthread_cond_broadcast(&stream->cond);
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&stream->mutex);
+
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief Finish a streamed image and verify it
+
+@param[out] crc   - The CRC32 of the image read back from the flash
+@param[out] stats - The statistics of the stream
+
+@note
+- the verify compares the CRC32 read back from the flash with the CRC32 given at the start
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_FLASH_stream_end(UINT32* crc, DG_CMN_DRV_FPGA_FLASH_STATS_T* stats)
+{
+    BOOL                            ret    = FALSE;
+    dg_cmn_drv_fpga_flash_stream_t* stream = &dg_cmn_drv_fpga_flash_stream;
+    BOOL                            b_failed;
+
+    pthread_mutex_lock(&dg_cmn_drv_fpga_flash_ctrl_mutex);
+    pthread_mutex_lock(&stream->mutex);
+
+    if (!stream->b_active)
+    {
+        DG_DRV_UTIL_set_error_string("No flash stream is started");
+        pthread_mutex_unlock(&stream->mutex);
+    }
+    else if (stream->offset != stream->len)
+    {
+        DG_DRV_UTIL_set_error_string("Flash stream is incomplete, next offset 0x%x of 0x%x",
+                                     stream->offset, stream->len);
+        pthread_mutex_unlock(&stream->mutex);
+    }
+    else
+    {
+        while (stream->writer_num > 0)
+        {
+            pthread_cond_wait(&stream->cond, &stream->mutex);
+        }
+
+        dg_cmn_drv_fpga_flash_stream_stop();
+        b_failed = stream->b_failed;
+        pthread_mutex_unlock(&stream->mutex);
+
+        if (b_failed)
+        {
+            DG_DRV_UTIL_set_error_string("Flash stream failed");
+        }
+        else if (DG_CMN_DRV_FPGA_FLASH_get_crc(stream->addr, stream->len, crc))
+        {
+            pthread_mutex_lock(&stream->mutex);
+            stream->stats.offset  = stream->offset;
+            stream->stats.time_ms = (UINT32)(DG_DRV_UTIL_time_ms() - stream->start_ms);
+            *stats                = stream->stats;
+            pthread_mutex_unlock(&stream->mutex);
+
+            if (*crc != stream->crc)
+            {
+                DG_DRV_UTIL_set_error_string("Flash image CRC mismatch: read 0x%08x, "
+                                             "expected 0x%08x", *crc, stream->crc);
+            }
+            else
+            {
+                DG_DBG_TRACE("Flash stream at 0x%08x verified, length 0x%x, %d of %d sectors "
+                             "skipped, %d ms", stream->addr, stream->len,
+                             stats->sector_skipped, stats->sector_num, stats->time_ms);
+                ret = TRUE;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&dg_cmn_drv_fpga_flash_ctrl_mutex);
+
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief Get the progress and statistics of the current or last stream
+
+@param[out] stats - The statistics of the stream
+
+@note
+- time_ms keeps running while the stream is active, and is frozen once the stream is finished
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_FLASH_get_stats(DG_CMN_DRV_FPGA_FLASH_STATS_T* stats)
+{
+    dg_cmn_drv_fpga_flash_stream_t* stream = &dg_cmn_drv_fpga_flash_stream;
+
+    pthread_mutex_lock(&stream->mutex);
+
+    if (stream->b_active)
+    {
+        stream->stats.time_ms = (UINT32)(DG_DRV_UTIL_time_ms() - stream->start_ms);
+    }
+    stream->stats.offset = stream->offset;
+    *stats               = stream->stats;
+
+    pthread_mutex_unlock(&stream->mutex);
+
     return TRUE;
 }
 
+/*=============================================================================================*//**
+@brief Get the CRC32 of an FPGA flash range
+
+@param[in]  addr - The flash address
+@param[in]  len  - The number of bytes
+@param[out] crc  - The CRC32 of the range
+
+@note
+- a range which runs past the end of the flash is rejected
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_FPGA_FLASH_get_crc(DG_CMN_DRV_FLASH_ADDR_T addr, UINT32 len, UINT32* crc)
+{
+    BOOL   ret = TRUE;
+    UINT8  buf[DG_CMN_DRV_FPGA_FLASH_CRC_BUF_SIZE];
+    UINT32 chunk;
+
+    if ((UINT64)addr + len > DG_CMN_DRV_FPGA_FLASH_SIZE)
+    {
+        DG_DRV_UTIL_set_error_string("Flash range 0x%x at 0x%08x runs past the end of flash",
+                                     len, addr);
+        return FALSE;
+    }
+
+    *crc = 0;
+    while (ret && (len > 0))
+    {
+        chunk = (len < sizeof(buf)) ? len : sizeof(buf);
+        ret   = DG_FLASH_SIM_read(addr, chunk, buf);
+        if (ret)
+        {
+            *crc  = DG_DRV_UTIL_crc32(*crc, buf, chunk);
+            addr += chunk;
+            len  -= chunk;
+        }
+    }
+
+    return ret;
+}
+
 /*==================================================================================================
                                           LOCAL FUNCTIONS
 ==================================================================================================*/
 
+/*=============================================================================================*//**
+@brief Get the erase sector size from the CFI
+
+@param[out] sector_size - The size of the sectors in the first erase region
+*//*==============================================================================================*/
+static BOOL dg_cmn_drv_fpga_flash_get_sector_size(UINT32* sector_size)
+{
+    BOOL                   ret = FALSE;
+    DG_CMN_DRV_FLASH_CFI_T cfi;
+
+    if (!DG_CMN_DRV_FPGA_FLASH_get_cfi(&cfi))
+    {
+        /* error string is set */
+    }
+    else if ((cfi.val[0] != 'Q') || (cfi.val[1] != 'R') || (cfi.val[2] != 'Y') ||
+             (cfi.val[DG_CMN_DRV_FPGA_FLASH_CFI_REGION_NUM] == 0))
+    {
+        DG_DRV_UTIL_set_error_string("FPGA flash CFI has no erase region");
+    }
+    else
+    {
+        *sector_size = ((cfi.val[DG_CMN_DRV_FPGA_FLASH_CFI_REGION_SIZE + 1] << 8) |
+                        cfi.val[DG_CMN_DRV_FPGA_FLASH_CFI_REGION_SIZE]) * 256;
+        ret          = TRUE;
+    }
+
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief Start a stream and its erase thread
+
+@param[in] addr        - The flash address of the image, aligned to the erase sector
+@param[in] len         - The image length in bytes
+@param[in] crc         - The CRC32 of the whole image
+@param[in] sector_size - The erase sector size
+@param[in] changed     - Heap bitmap of the sectors to program, NULL for all, owned by the stream
+*//*==============================================================================================*/
+static BOOL dg_cmn_drv_fpga_flash_stream_start(DG_CMN_DRV_FLASH_ADDR_T addr, UINT32 len,
+                                               UINT32 crc, UINT32 sector_size, UINT8* changed)
+{
+    BOOL                            ret    = FALSE;
+    dg_cmn_drv_fpga_flash_stream_t* stream = &dg_cmn_drv_fpga_flash_stream;
+    UINT32                          sector;
+
+    if ((sector_size == 0) || ((addr % sector_size) != 0))
+    {
+        DG_DRV_UTIL_set_error_string("Flash image address 0x%08x is not aligned to the 0x%x "
+                                     "sector", addr, sector_size);
+        free(changed);
+    }
+    else if ((len == 0) || ((UINT64)addr + len > DG_CMN_DRV_FPGA_FLASH_SIZE))
+    {
+        DG_DRV_UTIL_set_error_string("Invalid flash image length 0x%x at 0x%08x", len, addr);
+        free(changed);
+    }
+    else
+    {
+        pthread_mutex_lock(&dg_cmn_drv_fpga_flash_ctrl_mutex);
+        pthread_mutex_lock(&stream->mutex);
+
+        if (stream->b_active)
+        {
+            DG_DBG_TRACE("Drop unfinished flash stream at 0x%08x, 0x%x of 0x%x bytes written",
+                         stream->addr, stream->offset, stream->len);
+            dg_cmn_drv_fpga_flash_stream_stop();
+        }
+
+        free(stream->changed);
+
+        stream->session++;
+        stream->b_abort     = FALSE;
+        stream->b_failed    = FALSE;
+        stream->addr        = addr;
+        stream->len         = len;
+        stream->crc         = crc;
+        stream->sector_size = sector_size;
+        stream->sector_num  = (len - 1) / sector_size + 1;
+        stream->changed     = changed;
+        stream->offset      = 0;
+        stream->erased_end  = 0;
+        stream->writing     = 0;
+        stream->start_ms    = DG_DRV_UTIL_time_ms();
+
+        memset(&stream->stats, 0, sizeof(stream->stats));
+        stream->stats.len        = len;
+        stream->stats.sector_num = stream->sector_num;
+        for (sector = 0; sector < stream->sector_num; sector++)
+        {
+            if (!DG_CMN_DRV_FPGA_FLASH_IS_CHANGED(changed, sector))
+            {
+                stream->stats.sector_skipped++;
+            }
+        }
+
+        dg_cmn_drv_fpga_flash_skip(stream);
+
+        if (pthread_create(&stream->eraser, NULL, dg_cmn_drv_fpga_flash_erase_job, stream) != 0)
+        {
+            DG_DRV_UTIL_set_error_string("Failed to start the flash erase thread");
+        }
+        else
+        {
+            stream->b_active = TRUE;
+            ret              = TRUE;
+
+            DG_DBG_TRACE("Start flash stream at 0x%08x, length 0x%x, crc 0x%08x, %d of %d "
+                         "sectors skipped", addr, len, crc, stream->stats.sector_skipped,
+                         stream->sector_num);
+        }
+
+        pthread_mutex_unlock(&stream->mutex);
+        pthread_mutex_unlock(&dg_cmn_drv_fpga_flash_ctrl_mutex);
+    }
+
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief Move the next chunk offset past the unchanged sectors
+
+@param[in,out] stream - The stream, locked by the caller
+*//*==============================================================================================*/
+static void dg_cmn_drv_fpga_flash_skip(dg_cmn_drv_fpga_flash_stream_t* stream)
+{
+    UINT32 sector;
+
+    while (stream->offset < stream->len)
+    {
+        sector = stream->offset / stream->sector_size;
+        if (DG_CMN_DRV_FPGA_FLASH_IS_CHANGED(stream->changed, sector))
+        {
+            break;
+        }
+
+        stream->offset = (sector + 1) * stream->sector_size;
+        if (stream->offset > stream->len)
+        {
+            stream->offset = stream->len;
+        }
+    }
+}
+
+/*=============================================================================================*//**
+@brief Erase thread of a stream, erases the changed sectors one sector ahead of the writer
+
+@param[in] arg - the dg_cmn_drv_fpga_flash_stream_t
+*//*==============================================================================================*/
+static void* dg_cmn_drv_fpga_flash_erase_job(void* arg)
+{
+    dg_cmn_drv_fpga_flash_stream_t* stream = (dg_cmn_drv_fpga_flash_stream_t*)arg;
+    BOOL                            b_ok   = TRUE;
+    BOOL                            b_prev = FALSE; /* a sector has been erased */
+    UINT32                          prev   = 0;     /* the last erased sector   */
+    UINT32                          sector;
+    INT64                           start_ms;
+
+    pthread_mutex_lock(&stream->mutex);
+
+    for (sector = 0; b_ok && (sector < stream->sector_num); sector++)
+    {
+        if (!DG_CMN_DRV_FPGA_FLASH_IS_CHANGED(stream->changed, sector))
+        {
+            continue;
+        }
+
+        /* erase the next changed sector once the writer reached the previous one */
+        while (!stream->b_abort && b_prev && (stream->writing < prev))
+        {
+            pthread_cond_wait(&stream->cond, &stream->mutex);
+        }
+
+        if (stream->b_abort)
+        {
+            break;
+        }
+
+        pthread_mutex_unlock(&stream->mutex);
+        start_ms = DG_DRV_UTIL_time_ms();
+        b_ok     = DG_FLASH_SIM_erase(stream->addr + sector * stream->sector_size);
+        pthread_mutex_lock(&stream->mutex);
+
+        stream->stats.erase_ms += (UINT32)(DG_DRV_UTIL_time_ms() - start_ms);
+        if (b_ok)
+        {
+            stream->stats.sector_erased++;
+            stream->erased_end = sector + 1;
+            b_prev             = TRUE;
+            prev               = sector;
+        }
+        else
+        {
+            stream->b_failed = TRUE;
+        }
+        pthread_cond_broadcast(&stream->cond);
+    }
+
+    pthread_mutex_unlock(&stream->mutex);
+
+    return NULL;
+}
+
+/*=============================================================================================*//**
+@brief Stop the stream and join its erase thread
+
+@note
+- called with the stream mutex and the control mutex held
+*//*==============================================================================================*/
+static void dg_cmn_drv_fpga_flash_stream_stop(void)
+{
+    dg_cmn_drv_fpga_flash_stream_t* stream = &dg_cmn_drv_fpga_flash_stream;
+
+    stream->b_active = FALSE;
+    stream->b_abort  = TRUE;
+    pthread_cond_broadcast(&stream->cond);
+
+    pthread_mutex_unlock(&stream->mutex);
+    pthread_join(stream->eraser, NULL);
+    pthread_mutex_lock(&stream->mutex);
+}
+
 /** @} */
 /** @} */
 
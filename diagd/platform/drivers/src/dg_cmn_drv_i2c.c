@@ -9,9 +9,11 @@
 ====================================================================================================
                                            INCLUDE FILES
 ==================================================================================================*/
+#include <stdlib.h>
 #include "dg_handler_inc.h"
 #include "dg_drv_util.h"
 #include "dg_cmn_drv_i2c.h"
+#include "dg_i2c_sim.h"
 
 
 /** @addtogroup dg_common_drivers
@@ -30,14 +32,37 @@ implementation of the I2C driver
 /*==================================================================================================
                                            LOCAL MACROS
 ==================================================================================================*/
+/** geometry of a device which is not listed in the board table, a 24C02 */
+#define DG_CMN_DRV_I2C_DEFAULT_SIZE       256
+#define DG_CMN_DRV_I2C_DEFAULT_PAGE_SIZE  8
+#define DG_CMN_DRV_I2C_DEFAULT_OFFSET_LEN 1
 
 /*==================================================================================================
                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
 ==================================================================================================*/
+/** transfer capability of an I2C adapter */
+enum
+{
+    DG_CMN_DRV_I2C_FUNC_BYTE        = 0x00, /** SMBus byte data transfers only      */
+    DG_CMN_DRV_I2C_FUNC_SMBUS_BLOCK = 0x01, /** SMBus I2C block transfers           */
+    DG_CMN_DRV_I2C_FUNC_I2C         = 0x02, /** plain I2C combined transfers         */
+};
+typedef UINT8 DG_CMN_DRV_I2C_FUNC_T;
+
+/** geometry of a device on the board */
+typedef struct
+{
+    DG_CMN_DRV_I2C_BUS_T      bus;
+    DG_CMN_DRV_I2C_ADDR_T     address;
+    DG_CMN_DRV_I2C_GEOMETRY_T geometry;
+} dg_cmn_drv_i2c_dev_t;
 
 /*==================================================================================================
                                      LOCAL FUNCTION PROTOTYPES
 ==================================================================================================*/
+static BOOL   dg_cmn_drv_i2c_get_func(DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_FUNC_T* func);
+static UINT32 dg_cmn_drv_i2c_xfer_max(DG_CMN_DRV_I2C_FUNC_T func, UINT8 offset_len);
+static void   dg_cmn_drv_i2c_set_offset(UINT8* buf, UINT32 offset, UINT8 offset_len);
 
 /*==================================================================================================
                                          GLOBAL VARIABLES
@@ -46,6 +71,13 @@ implementation of the I2C driver
 /*==================================================================================================
                                           LOCAL VARIABLES
 ==================================================================================================*/
+/** devices on the board which are not a 24C02, shared by the EEPROM driver and the simulation */
+static const dg_cmn_drv_i2c_dev_t dg_cmn_drv_i2c_board[] =
+{
+    { DG_CMN_DRV_I2C_MUX_CPU, 0x50, { 8192,  32, 2 } }, /* 24C64 CPU board ID EEPROM   */
+    { DG_CMN_DRV_I2C_MUX_CPU, 0x51, { 32768, 64, 2 } }, /* 24C256 CPU board log EEPROM */
+    { DG_CMN_DRV_I2C_MUX_WBP, 0x50, { 8192,  32, 2 } }, /* 24C64 back plane ID EEPROM  */
+};
 
 /*==================================================================================================
                                          GLOBAL FUNCTIONS
@@ -61,37 +93,19 @@ implementation of the I2C driver
 @param[out] read_data - The data read from the device
 
 @note
+- the number of offset bytes is taken from the device geometry
 - Read data is only valid when the function returns with a success
 *//*==============================================================================================*/
 BOOL DG_CMN_DRV_I2C_read_bus(DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T address,
                              DG_CMN_DRV_I2C_OFFSET_T offset, DG_CMN_DRV_I2C_SIZE_T read_len,
                              UINT8* read_data)
 {
-    BOOL ret = FALSE;
+    DG_CMN_DRV_I2C_GEOMETRY_T geometry;
 
-    switch (bus)
-    {
-    case DG_CMN_DRV_I2C_PCH_SMB:
-    case DG_CMN_DRV_I2C_MUX_CPU:
-    case DG_CMN_DRV_I2C_MUX_PSU0:
-    case DG_CMN_DRV_I2C_MUX_PSU1:
-    case DG_CMN_DRV_I2C_MUX_WBP:
-    case DG_CMN_DRV_I2C_MUX_WTB1:
-    case DG_CMN_DRV_I2C_MUX_WTB2:
-    case DG_CMN_DRV_I2C_MUX_FEB:
-        memset(read_data, address, read_len);
-        DG_DBG_TRACE("Read I2C bus=0x%02x, address=0x%02x, offset=0x%02x, read_len=0x%02x",
-                     bus, address, offset, read_len);
-        ret = TRUE;
-        break;
+    DG_CMN_DRV_I2C_get_geometry(bus, address, &geometry);
 
-    default:
-        DG_DRV_UTIL_set_error_string("Invalid I2C bus: bus=0x%02x", bus);
-        break;
-
-    }
-
-    return ret;
+    return DG_CMN_DRV_I2C_read_block(bus, address, offset, geometry.offset_len, read_len,
+                                     read_data);
 }
 
 /*=============================================================================================*//**
@@ -102,41 +116,287 @@ BOOL DG_CMN_DRV_I2C_read_bus(DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T add
 @param[in]  offset     - The device data offset to write to
 @param[in]  write_len  - The amount of data to write in bytes
 @param[in]  write_data - The data to write to the device
+
+@note
+- the number of offset bytes is taken from the device geometry
 *//*==============================================================================================*/
 BOOL DG_CMN_DRV_I2C_write_bus(DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T address,
                               DG_CMN_DRV_I2C_OFFSET_T offset, DG_CMN_DRV_I2C_SIZE_T write_len,
                               UINT8* write_data)
 {
-    BOOL ret = FALSE;
+    DG_CMN_DRV_I2C_GEOMETRY_T geometry;
+
+    DG_CMN_DRV_I2C_get_geometry(bus, address, &geometry);
+
+    return DG_CMN_DRV_I2C_write_block(bus, address, offset, geometry.offset_len, write_len,
+                                      write_data, 0);
+}
+
+/*=============================================================================================*//**
+@brief Reads a block of data from a device on the given I2C bus
+
+@param[in]  bus        - The I2C bus to read from
+@param[in]  address    - The device address to read from
+@param[in]  offset     - The device data offset to read from
+@param[in]  offset_len - The number of offset bytes the device expects, 1 or 2
+@param[in]  read_len   - The amount of data to read in bytes
+@param[out] read_data  - The data read from the device
+
+@note
+- the read is split into as few bus transactions as the adapter allows: one combined I2C
+  transfer per DG_CMN_DRV_I2C_MSG_MAX bytes, one SMBus block read per
+  DG_CMN_DRV_I2C_SMBUS_BLOCK_MAX bytes, or one transaction per byte on a byte only adapter
+- Read data is only valid when the function returns with a success
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_I2C_read_block(DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T address,
+                               UINT16 offset, UINT8 offset_len, UINT32 read_len,
+                               UINT8* read_data)
+{
+    DG_CMN_DRV_I2C_FUNC_T func;
+    UINT8                 offset_buf[sizeof(offset)];
+    UINT32                xfer_max;
+    UINT32                done = 0;
+
+    if (!dg_cmn_drv_i2c_get_func(bus, &func))
+    {
+        return FALSE;
+    }
+
+    if ((offset_len < 1) || (offset_len > sizeof(offset)))
+    {
+        DG_DRV_UTIL_set_error_string("Invalid I2C offset length: offset_len=%d", offset_len);
+        return FALSE;
+    }
+
+    DG_DBG_TRACE("Read I2C bus=0x%02x, address=0x%02x, offset=0x%04x, read_len=%d",
+                 bus, address, offset, read_len);
+
+    xfer_max = dg_cmn_drv_i2c_xfer_max(func, offset_len);
+    while (done < read_len)
+    {
+        UINT32 len = read_len - done;
+
+        if (len > xfer_max)
+        {
+            len = xfer_max;
+        }
+
+        dg_cmn_drv_i2c_set_offset(offset_buf, offset + done, offset_len);
+        if (!DG_I2C_SIM_xfer(bus, address, offset_buf, offset_len, read_data + done, len))
+        {
+            return FALSE;
+        }
+
+        done += len;
+    }
+
+    return TRUE;
+}
+
+/*=============================================================================================*//**
+@brief Writes a block of data to a device on the given I2C bus
+
+@param[in]  bus        - The I2C bus to write to
+@param[in]  address    - The device address to write to
+@param[in]  offset     - The device data offset to write to
+@param[in]  offset_len - The number of offset bytes the device expects, 1 or 2
+@param[in]  write_len  - The amount of data to write in bytes
+@param[in]  write_data - The data to write to the device
+@param[in]  page_size  - The device write page size, 0 if the device has no pages
+
+@note
+- a transaction never crosses a page boundary, so EEPROM page writes don't roll over
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_I2C_write_block(DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T address,
+                                UINT16 offset, UINT8 offset_len, UINT32 write_len,
+                                UINT8* write_data, UINT16 page_size)
+{
+    BOOL                  ret = FALSE;
+    DG_CMN_DRV_I2C_FUNC_T func;
+    UINT8*                buf;
+    UINT32                xfer_max;
+    UINT32                done = 0;
+
+    if (!dg_cmn_drv_i2c_get_func(bus, &func))
+    {
+        return FALSE;
+    }
+
+    if ((offset_len < 1) || (offset_len > sizeof(offset)))
+    {
+        DG_DRV_UTIL_set_error_string("Invalid I2C offset length: offset_len=%d", offset_len);
+        return FALSE;
+    }
+
+    DG_DBG_TRACE("Write I2C bus=0x%02x, address=0x%02x, offset=0x%04x, write_len=%d, page=%d",
+                 bus, address, offset, write_len, page_size);
+    DG_DBG_DUMP(write_data, write_len);
+
+    xfer_max = dg_cmn_drv_i2c_xfer_max(func, offset_len);
+    if ((xfer_max > write_len) && (write_len > 0))
+    {
+        xfer_max = write_len;
+    }
+
+    /* one message buffer for the offset bytes and the data of a transaction */
+    buf = (UINT8*)malloc(offset_len + xfer_max);
+    if (buf == NULL)
+    {
+        DG_DRV_UTIL_set_error(DG_DRV_UTIL_ERR_NO_MEM, offset_len + xfer_max);
+        return FALSE;
+    }
+
+    ret = TRUE;
+    while (ret && (done < write_len))
+    {
+        UINT32 pos = offset + done;
+        UINT32 len = write_len - done;
+
+        if (len > xfer_max)
+        {
+            len = xfer_max;
+        }
+
+        /* stop at the end of the page */
+        if ((page_size != 0) && (len > page_size - (pos % page_size)))
+        {
+            len = page_size - (pos % page_size);
+        }
+
+        dg_cmn_drv_i2c_set_offset(buf, pos, offset_len);
+        memcpy(buf + offset_len, write_data + done, len);
+
+        ret   = DG_I2C_SIM_xfer(bus, address, buf, offset_len + len, NULL, 0);
+        done += len;
+    }
+
+    free(buf);
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief Gets the geometry of a device on the given I2C bus
+
+@param[in]  bus      - The I2C bus
+@param[in]  address  - The device address
+@param[out] geometry - The device geometry
+
+@note
+- a device which is not listed in the board table is a 24C02
+*//*==============================================================================================*/
+void DG_CMN_DRV_I2C_get_geometry(DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_ADDR_T address,
+                                 DG_CMN_DRV_I2C_GEOMETRY_T* geometry)
+{
+    UINT32 i;
+
+    geometry->size       = DG_CMN_DRV_I2C_DEFAULT_SIZE;
+    geometry->page_size  = DG_CMN_DRV_I2C_DEFAULT_PAGE_SIZE;
+    geometry->offset_len = DG_CMN_DRV_I2C_DEFAULT_OFFSET_LEN;
+
+    for (i = 0; i < sizeof(dg_cmn_drv_i2c_board) / sizeof(dg_cmn_drv_i2c_board[0]); i++)
+    {
+        if ((dg_cmn_drv_i2c_board[i].bus == bus) && (dg_cmn_drv_i2c_board[i].address == address))
+        {
+            *geometry = dg_cmn_drv_i2c_board[i].geometry;
+            break;
+        }
+    }
+}
+
+/*==================================================================================================
+                                          LOCAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Get the transfer capability of the adapter behind an I2C bus
+
+@param[in]  bus  - The I2C bus
+@param[out] func - The adapter capability
+*//*==============================================================================================*/
+static BOOL dg_cmn_drv_i2c_get_func(DG_CMN_DRV_I2C_BUS_T bus, DG_CMN_DRV_I2C_FUNC_T* func)
+{
+    BOOL ret = TRUE;
 
     switch (bus)
     {
     case DG_CMN_DRV_I2C_PCH_SMB:
-    case DG_CMN_DRV_I2C_MUX_CPU:
+        *func = DG_CMN_DRV_I2C_FUNC_SMBUS_BLOCK;
+        break;
+
     case DG_CMN_DRV_I2C_MUX_PSU0:
     case DG_CMN_DRV_I2C_MUX_PSU1:
+        /* the PSU side is a PMBus segment which only takes byte transfers */
+        *func = DG_CMN_DRV_I2C_FUNC_BYTE;
+        break;
+
+    case DG_CMN_DRV_I2C_MUX_CPU:
     case DG_CMN_DRV_I2C_MUX_WBP:
     case DG_CMN_DRV_I2C_MUX_WTB1:
     case DG_CMN_DRV_I2C_MUX_WTB2:
     case DG_CMN_DRV_I2C_MUX_FEB:
-        DG_DBG_TRACE("Write I2C bus=0x%02x, address=0x%02x, offset=0x%02x, write_len=0x%02x",
-                     bus, address, offset, write_len);
-        DG_DBG_DUMP(write_data, write_len);
-        ret = TRUE;
+    case DG_CMN_DRV_I2C_SFP_HA:
+    case DG_CMN_DRV_I2C_SFP12:
+    case DG_CMN_DRV_I2C_SFP13:
+    case DG_CMN_DRV_I2C_SFP14:
+    case DG_CMN_DRV_I2C_SFP15:
+    case DG_CMN_DRV_I2C_SFP16:
+    case DG_CMN_DRV_I2C_SFP17:
+    case DG_CMN_DRV_I2C_SFP18:
+    case DG_CMN_DRV_I2C_SFP19:
+        *func = DG_CMN_DRV_I2C_FUNC_I2C;
         break;
 
     default:
         DG_DRV_UTIL_set_error_string("Invalid I2C bus: bus=0x%02x", bus);
+        ret = FALSE;
         break;
-
     }
 
     return ret;
 }
 
-/*==================================================================================================
-                                          LOCAL FUNCTIONS
-==================================================================================================*/
+/*=============================================================================================*//**
+@brief Get the maximum data length of one transaction
+
+@param[in] func       - The adapter capability
+@param[in] offset_len - The number of offset bytes the device expects
+
+@return the maximum number of data bytes in one transaction
+*//*==============================================================================================*/
+static UINT32 dg_cmn_drv_i2c_xfer_max(DG_CMN_DRV_I2C_FUNC_T func, UINT8 offset_len)
+{
+    UINT32 xfer_max = 1;
+
+    if (func == DG_CMN_DRV_I2C_FUNC_I2C)
+    {
+        xfer_max = DG_CMN_DRV_I2C_MSG_MAX - offset_len;
+    }
+    else if ((func == DG_CMN_DRV_I2C_FUNC_SMBUS_BLOCK) && (offset_len == 1))
+    {
+        /* the offset is sent as the SMBus command byte */
+        xfer_max = DG_CMN_DRV_I2C_SMBUS_BLOCK_MAX;
+    }
+
+    return xfer_max;
+}
+
+/*=============================================================================================*//**
+@brief Put the device offset into a message buffer, most significant byte first
+
+@param[out] buf        - The message buffer
+@param[in]  offset     - The device offset
+@param[in]  offset_len - The number of offset bytes
+*//*==============================================================================================*/
+static void dg_cmn_drv_i2c_set_offset(UINT8* buf, UINT32 offset, UINT8 offset_len)
+{
+    int i;
+
+    for (i = offset_len - 1; i >= 0; i--)
+    {
+        buf[i]   = (UINT8)offset;
+        offset >>= 8;
+    }
+}
 
 /** @} */
 /** @} */
@@ -9,8 +9,10 @@
 ====================================================================================================
                                            INCLUDE FILES
 ==================================================================================================*/
+#include <pthread.h>
 #include "dg_handler_inc.h"
 #include "dg_drv_util.h"
+#include "dg_cmn_drv_i2c.h"
 #include "dg_cmn_drv_sfp.h"
 
 
@@ -30,14 +32,46 @@ implementation of the SFP driver
 /*==================================================================================================
                                            LOCAL MACROS
 ==================================================================================================*/
+/** SFF-8472 two wire addresses of the ID page and the diagnostic page */
+#define DG_CMN_DRV_SFP_ADDR_A0 0x50
+#define DG_CMN_DRV_SFP_ADDR_A2 0x51
+
+/** SFF-8472 field offsets used by the snapshot */
+#define DG_CMN_DRV_SFP_A0_IDENTIFIER  0
+#define DG_CMN_DRV_SFP_A0_VENDOR_NAME 20
+#define DG_CMN_DRV_SFP_A0_VENDOR_PN   40
+#define DG_CMN_DRV_SFP_A0_VENDOR_SN   68
+#define DG_CMN_DRV_SFP_A2_DOM         96
+#define DG_CMN_DRV_SFP_A2_DOM_LEN     10
 
 /*==================================================================================================
                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
 ==================================================================================================*/
+/** cached ID page of one cage */
+typedef struct
+{
+    pthread_mutex_t mutex;
+    BOOL            b_valid;
+    UINT8           a0[sizeof(((DG_CMN_DRV_SFP_REG_DATA_T*)0)->reg)];
+} dg_cmn_drv_sfp_cache_t;
+
+/** work of one snapshot thread */
+typedef struct
+{
+    DG_CMN_DRV_SFP_ID_T    sfp;
+    DG_CMN_DRV_SFP_INFO_T* info;
+    BOOL                   ret;
+    char                   err[DG_DRV_UTIL_ERR_STRING_MAX];
+} dg_cmn_drv_sfp_job_t;
 
 /*==================================================================================================
                                      LOCAL FUNCTION PROTOTYPES
 ==================================================================================================*/
+static void  dg_cmn_drv_sfp_cache_init(void);
+static BOOL  dg_cmn_drv_sfp_read_page(DG_CMN_DRV_SFP_ID_T sfp, UINT8 address, UINT8 offset,
+                                      UINT32 len, UINT8* data);
+static BOOL  dg_cmn_drv_sfp_read_info(DG_CMN_DRV_SFP_ID_T sfp, DG_CMN_DRV_SFP_INFO_T* info);
+static void* dg_cmn_drv_sfp_job(void* arg);
 
 /*==================================================================================================
                                          GLOBAL VARIABLES
@@ -46,6 +80,8 @@ implementation of the SFP driver
 /*==================================================================================================
                                           LOCAL VARIABLES
 ==================================================================================================*/
+static dg_cmn_drv_sfp_cache_t dg_cmn_drv_sfp_cache[DG_CMN_DRV_SFP_NUM];
+static pthread_once_t         dg_cmn_drv_sfp_cache_once = PTHREAD_ONCE_INIT;
 
 /*==================================================================================================
                                          GLOBAL FUNCTIONS
@@ -136,10 +172,11 @@ BOOL DG_CMN_DRV_SFP_dump_register(DG_CMN_DRV_SFP_ID_T        sfp,
     {
         DG_DRV_UTIL_set_error_string("SFP register set is not valid. reg=%d", reg);
     }
-    else
+    else if (dg_cmn_drv_sfp_read_page(sfp,
+                                      reg == DG_CMN_DRV_SFP_REG_A0 ?
+                                      DG_CMN_DRV_SFP_ADDR_A0 : DG_CMN_DRV_SFP_ADDR_A2,
+                                      0, sizeof(data->reg), data->reg))
     {
-        memset(data->reg, reg, sizeof(data->reg));
-
         DG_DBG_TRACE("SFP ID %d dump %s registers", sfp,
                      reg == DG_CMN_DRV_SFP_REG_A0 ? "A0" : "A2");
 
@@ -151,10 +188,196 @@ BOOL DG_CMN_DRV_SFP_dump_register(DG_CMN_DRV_SFP_ID_T        sfp,
     return ret;
 }
 
+/*=============================================================================================*//**
+@brief Take an inventory and DOM snapshot of several SFP cages at once
+
+@param[in]  sfp_mask - bit n selects SFP ID n
+@param[out] info     - array of DG_CMN_DRV_SFP_NUM entries, indexed by SFP ID
+
+@note
+- every selected cage is read by its own thread, the cages sit on independent I2C buses
+- the ID page of a cage is cached until its presence changes, so a snapshot normally only
+  reads the DOM values
+- an absent cage only has the status filled in
+*//*==============================================================================================*/
+BOOL DG_CMN_DRV_SFP_snapshot(UINT32 sfp_mask, DG_CMN_DRV_SFP_INFO_T* info)
+{
+    BOOL                 ret = TRUE;
+    dg_cmn_drv_sfp_job_t job[DG_CMN_DRV_SFP_NUM];
+    pthread_t            thread[DG_CMN_DRV_SFP_NUM];
+    BOOL                 b_thread[DG_CMN_DRV_SFP_NUM];
+    DG_CMN_DRV_SFP_ID_T  sfp;
+
+    if ((sfp_mask == 0) || ((sfp_mask >> DG_CMN_DRV_SFP_NUM) != 0))
+    {
+        DG_DRV_UTIL_set_error_string("Invalid sfp mask=0x%x", sfp_mask);
+        return FALSE;
+    }
+
+    memset(info, 0, sizeof(DG_CMN_DRV_SFP_INFO_T) * DG_CMN_DRV_SFP_NUM);
+
+    for (sfp = 0; sfp < DG_CMN_DRV_SFP_NUM; sfp++)
+    {
+        b_thread[sfp] = FALSE;
+
+        if ((sfp_mask & (1U << sfp)) != 0)
+        {
+            job[sfp].sfp    = sfp;
+            job[sfp].info   = &info[sfp];
+            job[sfp].ret    = FALSE;
+            job[sfp].err[0] = '\0';
+
+            if (pthread_create(&thread[sfp], NULL, dg_cmn_drv_sfp_job, &job[sfp]) == 0)
+            {
+                b_thread[sfp] = TRUE;
+            }
+            else
+            {
+                /* no thread left, read this cage here */
+                dg_cmn_drv_sfp_job(&job[sfp]);
+            }
+        }
+    }
+
+    for (sfp = 0; sfp < DG_CMN_DRV_SFP_NUM; sfp++)
+    {
+        if (b_thread[sfp])
+        {
+            pthread_join(thread[sfp], NULL);
+        }
+
+        /* report the error of the first failed cage, error strings are per thread */
+        if (((sfp_mask & (1U << sfp)) != 0) && !job[sfp].ret && ret)
+        {
+            DG_DRV_UTIL_set_error_string("SFP ID %d: %s", sfp, job[sfp].err);
+            ret = FALSE;
+        }
+    }
+
+    return ret;
+}
+
 /*==================================================================================================
                                           LOCAL FUNCTIONS
 ==================================================================================================*/
 
+/*=============================================================================================*//**
+@brief Initialize the ID page cache, runs once
+*//*==============================================================================================*/
+static void dg_cmn_drv_sfp_cache_init(void)
+{
+    DG_CMN_DRV_SFP_ID_T sfp;
+
+    for (sfp = 0; sfp < DG_CMN_DRV_SFP_NUM; sfp++)
+    {
+        pthread_mutex_init(&dg_cmn_drv_sfp_cache[sfp].mutex, NULL);
+        dg_cmn_drv_sfp_cache[sfp].b_valid = FALSE;
+    }
+}
+
+/*=============================================================================================*//**
+@brief Read bytes of an SFP page through the cage I2C bus
+
+@param[in]  sfp     - selected SFP
+@param[in]  address - two wire address of the page
+@param[in]  offset  - first byte to read
+@param[in]  len     - number of bytes to read
+@param[out] data    - the read bytes
+*//*==============================================================================================*/
+static BOOL dg_cmn_drv_sfp_read_page(DG_CMN_DRV_SFP_ID_T sfp, UINT8 address, UINT8 offset,
+                                     UINT32 len, UINT8* data)
+{
+    return DG_CMN_DRV_I2C_read_block(DG_CMN_DRV_I2C_SFP_HA + sfp, address, offset, 1, len, data);
+}
+
+/*=============================================================================================*//**
+@brief Read the inventory and DOM values of one cage
+
+@param[in]  sfp  - selected SFP
+@param[out] info - the cage information
+
+@note
+- the ID page is read only if the cache is not valid, the cache is dropped when the cage is
+  found empty
+*//*==============================================================================================*/
+static BOOL dg_cmn_drv_sfp_read_info(DG_CMN_DRV_SFP_ID_T sfp, DG_CMN_DRV_SFP_INFO_T* info)
+{
+    BOOL                    ret   = FALSE;
+    dg_cmn_drv_sfp_cache_t* cache = &dg_cmn_drv_sfp_cache[sfp];
+    UINT8                   dom[DG_CMN_DRV_SFP_A2_DOM_LEN];
+
+    pthread_mutex_lock(&cache->mutex);
+
+    if (!DG_CMN_DRV_SFP_get_status(sfp, &info->status))
+    {
+        /* error string is set */
+    }
+    else if ((info->status & DG_CMN_DRV_SFP_STATUS_PRESENT_BIT) == 0)
+    {
+        cache->b_valid = FALSE;
+        ret            = TRUE;
+    }
+    else if (!cache->b_valid &&
+             !dg_cmn_drv_sfp_read_page(sfp, DG_CMN_DRV_SFP_ADDR_A0, 0, sizeof(cache->a0),
+                                       cache->a0))
+    {
+        /* error string is set */
+    }
+    else
+    {
+        cache->b_valid = TRUE;
+
+        info->identifier = cache->a0[DG_CMN_DRV_SFP_A0_IDENTIFIER];
+        memcpy(info->vendor_name, &cache->a0[DG_CMN_DRV_SFP_A0_VENDOR_NAME],
+               DG_CMN_DRV_SFP_VENDOR_LEN);
+        memcpy(info->vendor_pn, &cache->a0[DG_CMN_DRV_SFP_A0_VENDOR_PN],
+               DG_CMN_DRV_SFP_VENDOR_LEN);
+        memcpy(info->vendor_sn, &cache->a0[DG_CMN_DRV_SFP_A0_VENDOR_SN],
+               DG_CMN_DRV_SFP_VENDOR_LEN);
+
+        if (dg_cmn_drv_sfp_read_page(sfp, DG_CMN_DRV_SFP_ADDR_A2, DG_CMN_DRV_SFP_A2_DOM,
+                                     sizeof(dom), dom))
+        {
+            /* DOM values are big endian */
+            info->temperature = (INT16)((dom[0] << 8) | dom[1]);
+            info->vcc         = (UINT16)((dom[2] << 8) | dom[3]);
+            info->tx_bias     = (UINT16)((dom[4] << 8) | dom[5]);
+            info->tx_power    = (UINT16)((dom[6] << 8) | dom[7]);
+            info->rx_power    = (UINT16)((dom[8] << 8) | dom[9]);
+
+            ret = TRUE;
+        }
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief Thread routine of a snapshot, reads one cage
+
+@param[in,out] arg - the dg_cmn_drv_sfp_job_t of the cage
+*//*==============================================================================================*/
+static void* dg_cmn_drv_sfp_job(void* arg)
+{
+    dg_cmn_drv_sfp_job_t* job = (dg_cmn_drv_sfp_job_t*)arg;
+    char*                 err;
+
+    pthread_once(&dg_cmn_drv_sfp_cache_once, dg_cmn_drv_sfp_cache_init);
+
+    DG_DRV_UTIL_init_error_string();
+
+    job->ret = dg_cmn_drv_sfp_read_info(job->sfp, job->info);
+    if (!job->ret)
+    {
+        err = DG_DRV_UTIL_get_error_string();
+        snprintf(job->err, sizeof(job->err), "%s", err == NULL ? "unknown error" : err);
+    }
+
+    return NULL;
+}
+
 /** @} */
 /** @} */
 
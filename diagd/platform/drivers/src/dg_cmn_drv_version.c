@@ -13,7 +13,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
 #include "dg_handler_inc.h"
+#include "dg_conf.h"
 #include "dg_drv_util.h"
 #include "dg_cmn_drv_version.h"
 #include "diag_version.h"
@@ -35,15 +37,31 @@ implementation of the VERSION driver
 /*==================================================================================================
                                            LOCAL MACROS
 ==================================================================================================*/
+/** number of version types which are cached */
+#define DG_CMN_DRV_VERSION_TYPE_NUM (DG_CMN_DRV_VERSION_FPGA + 1)
+
+/** timeout in milliseconds for running the SW version command */
+#define DG_CMN_DRV_VERSION_CMD_TIMEOUT 2000
 
 /*==================================================================================================
                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
 ==================================================================================================*/
+/** the cached result of one version lookup */
+typedef struct
+{
+    BOOL  b_done;                          /* the lookup finished, ret/str/err are valid */
+    BOOL  b_busy;                          /* a thread is collecting the version         */
+    BOOL  ret;                             /* the result of the lookup                   */
+    char* str;                             /* the version string if ret is TRUE          */
+    char  err[DG_DRV_UTIL_ERR_STRING_MAX]; /* the error string if ret is FALSE           */
+} DG_CMN_DRV_VERSION_CACHE_T;
 
 /*==================================================================================================
                                      LOCAL FUNCTION PROTOTYPES
 ==================================================================================================*/
 static BOOL dg_cmn_drv_version_copy(char** pp_str, const char* version_str);
+static void dg_cmn_drv_version_collect(DG_CMN_DRV_VERSION_TYPE_T   type,
+                                       DG_CMN_DRV_VERSION_CACHE_T* p_entry);
 static BOOL dg_cmn_drv_version_diag(char** pp_str);
 static BOOL dg_cmn_drv_version_sw(char** pp_str);
 static BOOL dg_cmn_drv_version_hw(char** pp_str);
@@ -56,6 +74,10 @@ static BOOL dg_cmn_drv_version_fpga(char** pp_str);
 /*==================================================================================================
                                           LOCAL VARIABLES
 ==================================================================================================*/
+/** version strings never change at runtime, so each one is only collected once by default */
+static DG_CMN_DRV_VERSION_CACHE_T dg_cmn_drv_version_cache[DG_CMN_DRV_VERSION_TYPE_NUM];
+static pthread_mutex_t            dg_cmn_drv_version_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t             dg_cmn_drv_version_cond  = PTHREAD_COND_INITIALIZER;
 
 /*==================================================================================================
                                          GLOBAL FUNCTIONS
@@ -67,35 +89,66 @@ static BOOL dg_cmn_drv_version_fpga(char** pp_str);
 @param[in]  type  - what kind of version to get
 @param[out] pp_str - the version string pointer
 
-@note the caller of the function is responsible to free the version string
+@note
+- the caller of the function is responsible to free the version string
+- the version is collected on the first request and served from a cache afterwards, unless the
+  cache.version tunable is 0
+- a failed lookup is cached too, its error string is set again on every request
+- the cache lock is not held while the version is collected, the other requests of the same
+  type wait for the result instead of collecting it again
 *//*==============================================================================================*/
 BOOL DG_CMN_DRV_VERSION_get(DG_CMN_DRV_VERSION_TYPE_T type, char** pp_str)
 {
-    BOOL ret = FALSE;
+    BOOL                        ret = FALSE;
+    DG_CMN_DRV_VERSION_CACHE_T* p_entry;
 
-    switch (type)
+    if (type >= DG_CMN_DRV_VERSION_TYPE_NUM)
     {
-    case DG_CMN_DRV_VERSION_DIAG:
-        ret = dg_cmn_drv_version_diag(pp_str);
-        break;
+        DG_DRV_UTIL_set_error_string("Invalid version type. type=%d", type);
+        return FALSE;
+    }
 
-    case DG_CMN_DRV_VERSION_SW:
-        ret = dg_cmn_drv_version_sw(pp_str);
-        break;
+    p_entry = &dg_cmn_drv_version_cache[type];
 
-    case DG_CMN_DRV_VERSION_HW:
-        ret = dg_cmn_drv_version_hw(pp_str);
-        break;
+    pthread_mutex_lock(&dg_cmn_drv_version_mutex);
 
-    case DG_CMN_DRV_VERSION_FPGA:
-        ret = dg_cmn_drv_version_fpga(pp_str);
-        break;
+    while (p_entry->b_busy)
+    {
+        pthread_cond_wait(&dg_cmn_drv_version_cond, &dg_cmn_drv_version_mutex);
+    }
 
-    default:
-        DG_DRV_UTIL_set_error_string("Invalid version type. type=%d", type);
-        break;
+    /* with the cache turned off every request collects the version again */
+    if ((DG_CONF_get(DG_CONF_CACHE_VERSION) == 0) && p_entry->b_done)
+    {
+        free(p_entry->str);
+        p_entry->str    = NULL;
+        p_entry->b_done = FALSE;
+    }
+
+    if (!p_entry->b_done)
+    {
+        p_entry->b_busy = TRUE;
+        pthread_mutex_unlock(&dg_cmn_drv_version_mutex);
+
+        dg_cmn_drv_version_collect(type, p_entry);
+
+        pthread_mutex_lock(&dg_cmn_drv_version_mutex);
+        p_entry->b_busy = FALSE;
+        p_entry->b_done = TRUE;
+        pthread_cond_broadcast(&dg_cmn_drv_version_cond);
     }
 
+    if (p_entry->ret)
+    {
+        ret = dg_cmn_drv_version_copy(pp_str, p_entry->str);
+    }
+    else
+    {
+        DG_DRV_UTIL_set_error_string("%s", p_entry->err);
+    }
+
+    pthread_mutex_unlock(&dg_cmn_drv_version_mutex);
+
     return ret;
 }
 
@@ -120,7 +173,7 @@ BOOL dg_cmn_drv_version_copy(char** pp_str, const char* version_str)
     DG_DBG_TRACE("version string: %s", version_str);
     if (str_buf == NULL)
     {
-        DG_DRV_UTIL_set_error_string("failed to malloc version string");
+        DG_DRV_UTIL_set_error(DG_DRV_UTIL_ERR_NO_MEM, str_len);
     }
     else
     {
@@ -131,6 +184,55 @@ BOOL dg_cmn_drv_version_copy(char** pp_str, const char* version_str)
     return ret;
 }
 
+/*=============================================================================================*//**
+@brief Collect the version string into a cache entry
+
+@param[in]  type    - what kind of version to get
+@param[out] p_entry - the cache entry, ret and str or err are set
+
+@note
+- only the thread which marked the entry busy calls it, without holding the cache lock
+*//*==============================================================================================*/
+void dg_cmn_drv_version_collect(DG_CMN_DRV_VERSION_TYPE_T   type,
+                                DG_CMN_DRV_VERSION_CACHE_T* p_entry)
+{
+    char* p_str = NULL;
+    char* p_err;
+
+    p_entry->ret = FALSE;
+
+    switch (type)
+    {
+    case DG_CMN_DRV_VERSION_DIAG:
+        p_entry->ret = dg_cmn_drv_version_diag(&p_str);
+        break;
+
+    case DG_CMN_DRV_VERSION_SW:
+        p_entry->ret = dg_cmn_drv_version_sw(&p_str);
+        break;
+
+    case DG_CMN_DRV_VERSION_HW:
+        p_entry->ret = dg_cmn_drv_version_hw(&p_str);
+        break;
+
+    case DG_CMN_DRV_VERSION_FPGA:
+        p_entry->ret = dg_cmn_drv_version_fpga(&p_str);
+        break;
+    }
+
+    if (p_entry->ret)
+    {
+        p_entry->str = p_str;
+    }
+    else
+    {
+        free(p_str);
+        p_err = DG_DRV_UTIL_get_error_string();
+        snprintf(p_entry->err, sizeof(p_entry->err), "%s",
+                 (p_err != NULL) ? p_err : "Failed to get the version");
+    }
+}
+
 /*=============================================================================================*//**
 @brief Get the version string for diag
 
@@ -148,11 +250,11 @@ BOOL dg_cmn_drv_version_diag(char** pp_str)
 *//*==============================================================================================*/
 BOOL dg_cmn_drv_version_sw(char** pp_str)
 {
-    BOOL        ret       = FALSE;
-    const char* shell_cmd = "uname -srm"; /* just print out the content of "uname -srm"*/
-    char*       p_out     = NULL;
+    BOOL        ret    = FALSE;
+    char* const argv[] = { "uname", "-srm", NULL }; /* just print out the content of "uname -srm"*/
+    char*       p_out  = NULL;
 
-    if (DG_DRV_UTIL_system(shell_cmd, &p_out))
+    if (DG_DRV_UTIL_spawn(argv, DG_CMN_DRV_VERSION_CMD_TIMEOUT, &p_out))
     {
         if (p_out != NULL)
         {
@@ -165,6 +267,10 @@ BOOL dg_cmn_drv_version_sw(char** pp_str)
 
             ret = TRUE;
         }
+        else
+        {
+            DG_DRV_UTIL_set_error_string("%s printed no version", argv[0]);
+        }
 
         *pp_str = p_out;
     }
@@ -0,0 +1,228 @@
+/*==================================================================================================
+
+    Module Name:  dg_flash_sim.c
+
+    General Description: Implements the simulated NOR flash model
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include <stdlib.h>
+#include <pthread.h>
+#include "dg_handler_inc.h"
+#include "dg_drv_util.h"
+#include "dg_flash_sim.h"
+
+
+/** @addtogroup dg_platform_drivers
+@{
+*/
+
+/** @addtogroup FLASH_sim
+@{
+implementation of the simulated NOR flash
+*/
+
+/*==================================================================================================
+                                          LOCAL CONSTANTS
+==================================================================================================*/
+
+/*==================================================================================================
+                                           LOCAL MACROS
+==================================================================================================*/
+/** number of sectors in the 32 bit address space */
+#define DG_FLASH_SIM_SECTOR_NUM (0x100000000ULL / DG_FLASH_SIM_SECTOR_SIZE)
+
+/** sector index of an address */
+#define DG_FLASH_SIM_SECTOR(addr) ((addr) / DG_FLASH_SIM_SECTOR_SIZE)
+
+/** value of an erased byte */
+#define DG_FLASH_SIM_ERASED 0xff
+
+/*==================================================================================================
+                            LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+
+/*==================================================================================================
+                                     LOCAL FUNCTION PROTOTYPES
+==================================================================================================*/
+static UINT32 dg_flash_sim_span(UINT32 addr, UINT32 len, UINT32 unit);
+
+/*==================================================================================================
+                                         GLOBAL VARIABLES
+==================================================================================================*/
+
+/*==================================================================================================
+                                          LOCAL VARIABLES
+==================================================================================================*/
+/* programmed sectors, NULL for an erased sector */
+static UINT8* dg_flash_sim_sector[DG_FLASH_SIM_SECTOR_NUM];
+
+/* one lock per bank, held for the simulated busy time of an operation */
+static pthread_mutex_t dg_flash_sim_bank[DG_FLASH_SIM_BANK_NUM] =
+{
+    PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_MUTEX_INITIALIZER,
+};
+
+/*==================================================================================================
+                                         GLOBAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Read the simulated flash
+
+@param[in]  addr - The flash address
+@param[in]  len  - The number of bytes to read
+@param[out] buf  - The read data
+
+@return TRUE on success
+
+@note
+- the read wraps at the end of the address space
+*//*==============================================================================================*/
+BOOL DG_FLASH_SIM_read(UINT32 addr, UINT32 len, UINT8* buf)
+{
+    UINT32 sector;
+    UINT32 chunk;
+
+    while (len > 0)
+    {
+        sector = DG_FLASH_SIM_SECTOR(addr);
+        chunk  = dg_flash_sim_span(addr, len, DG_FLASH_SIM_SECTOR_SIZE);
+
+        pthread_mutex_lock(&dg_flash_sim_bank[sector % DG_FLASH_SIM_BANK_NUM]);
+
+        if (dg_flash_sim_sector[sector] == NULL)
+        {
+            memset(buf, DG_FLASH_SIM_ERASED, chunk);
+        }
+        else
+        {
+            memcpy(buf, &dg_flash_sim_sector[sector][addr % DG_FLASH_SIM_SECTOR_SIZE], chunk);
+        }
+        DG_DRV_UTIL_sleep_ns((UINT64)chunk * DG_FLASH_SIM_READ_NS);
+
+        pthread_mutex_unlock(&dg_flash_sim_bank[sector % DG_FLASH_SIM_BANK_NUM]);
+
+        addr += chunk;
+        buf  += chunk;
+        len  -= chunk;
+    }
+
+    return TRUE;
+}
+
+/*=============================================================================================*//**
+@brief Program the simulated flash
+
+@param[in] addr - The flash address
+@param[in] len  - The number of bytes to program
+@param[in] buf  - The data to program
+
+@return TRUE on success
+
+@note
+- each byte is ANDed into the flash, so only erased bytes take the new data
+- the data is split at page boundaries, every touched page costs one page program time
+*//*==============================================================================================*/
+BOOL DG_FLASH_SIM_program(UINT32 addr, UINT32 len, const UINT8* buf)
+{
+    BOOL   ret = TRUE;
+    UINT32 sector;
+    UINT32 chunk;
+    UINT8* mem;
+    UINT32 i;
+
+    while (ret && (len > 0))
+    {
+        sector = DG_FLASH_SIM_SECTOR(addr);
+        chunk  = dg_flash_sim_span(addr, len, DG_FLASH_SIM_PAGE_SIZE);
+
+        pthread_mutex_lock(&dg_flash_sim_bank[sector % DG_FLASH_SIM_BANK_NUM]);
+
+        mem = dg_flash_sim_sector[sector];
+        if (mem == NULL)
+        {
+            mem = (UINT8*)malloc(DG_FLASH_SIM_SECTOR_SIZE);
+            if (mem == NULL)
+            {
+                DG_DRV_UTIL_set_error(DG_DRV_UTIL_ERR_NO_MEM, DG_FLASH_SIM_SECTOR_SIZE);
+                ret = FALSE;
+            }
+            else
+            {
+                memset(mem, DG_FLASH_SIM_ERASED, DG_FLASH_SIM_SECTOR_SIZE);
+                dg_flash_sim_sector[sector] = mem;
+            }
+        }
+
+        if (ret)
+        {
+            mem += addr % DG_FLASH_SIM_SECTOR_SIZE;
+            for (i = 0; i < chunk; i++)
+            {
+                mem[i] &= buf[i];
+            }
+            DG_DRV_UTIL_sleep_ns(DG_FLASH_SIM_PROGRAM_US * 1000ULL);
+        }
+
+        pthread_mutex_unlock(&dg_flash_sim_bank[sector % DG_FLASH_SIM_BANK_NUM]);
+
+        addr += chunk;
+        buf  += chunk;
+        len  -= chunk;
+    }
+
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief Erase one sector of the simulated flash
+
+@param[in] addr - Any address in the sector
+
+@return TRUE on success
+*//*==============================================================================================*/
+BOOL DG_FLASH_SIM_erase(UINT32 addr)
+{
+    UINT32 sector = DG_FLASH_SIM_SECTOR(addr);
+
+    pthread_mutex_lock(&dg_flash_sim_bank[sector % DG_FLASH_SIM_BANK_NUM]);
+
+    free(dg_flash_sim_sector[sector]);
+    dg_flash_sim_sector[sector] = NULL;
+    DG_DRV_UTIL_sleep_ns(DG_FLASH_SIM_ERASE_US * 1000ULL);
+
+    pthread_mutex_unlock(&dg_flash_sim_bank[sector % DG_FLASH_SIM_BANK_NUM]);
+
+    DG_DBG_TRACE("Simulated flash erased sector 0x%08x", sector * DG_FLASH_SIM_SECTOR_SIZE);
+
+    return TRUE;
+}
+
+/*==================================================================================================
+                                          LOCAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Get the number of bytes from an address to the end of its unit
+
+@param[in] addr - The flash address
+@param[in] len  - The number of bytes left
+@param[in] unit - The unit size, a power of 2
+
+@return the number of bytes which can be handled in one step, at most len
+*//*==============================================================================================*/
+static UINT32 dg_flash_sim_span(UINT32 addr, UINT32 len, UINT32 unit)
+{
+    UINT32 span = unit - (addr % unit);
+
+    return (span < len) ? span : len;
+}
+
+/** @} */
+/** @} */
+
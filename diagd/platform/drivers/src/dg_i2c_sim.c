@@ -0,0 +1,307 @@
+/*==================================================================================================
+
+    Module Name:  dg_i2c_sim.c
+
+    General Description: Implements the simulated I2C device model
+
+====================================================================================================
+
+====================================================================================================
+                                           INCLUDE FILES
+==================================================================================================*/
+#include <stdlib.h>
+#include <pthread.h>
+#include "dg_handler_inc.h"
+#include "dg_drv_util.h"
+#include "dg_cmn_drv_i2c.h"
+#include "dg_i2c_sim.h"
+
+
+/** @addtogroup dg_platform_drivers
+@{
+*/
+
+/** @addtogroup I2C_sim
+@{
+implementation of the simulated I2C devices
+*/
+
+/*==================================================================================================
+                                          LOCAL CONSTANTS
+==================================================================================================*/
+
+/*==================================================================================================
+                                           LOCAL MACROS
+==================================================================================================*/
+/** number of buses, the bus id is one byte */
+#define DG_I2C_SIM_BUS_NUM 256
+
+/** number of 7 bit device addresses on a bus */
+#define DG_I2C_SIM_ADDR_NUM 128
+
+/** bits of one byte on the bus, including the ACK bit */
+#define DG_I2C_SIM_BYTE_BITS 9
+
+/*==================================================================================================
+                            LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
+==================================================================================================*/
+/** one simulated device */
+typedef struct
+{
+    UINT8* mem;
+    UINT32 size;
+    UINT16 page_size;
+    UINT8  offset_len;
+    UINT32 ptr;        /* the device address pointer */
+} dg_i2c_sim_dev_t;
+
+/** one simulated bus */
+typedef struct
+{
+    pthread_mutex_t    mutex;
+    dg_i2c_sim_dev_t*  dev[DG_I2C_SIM_ADDR_NUM];
+    DG_I2C_SIM_STATS_T stats;
+} dg_i2c_sim_bus_t;
+
+/*==================================================================================================
+                                     LOCAL FUNCTION PROTOTYPES
+==================================================================================================*/
+static dg_i2c_sim_bus_t* dg_i2c_sim_get_bus(UINT8 bus);
+static dg_i2c_sim_dev_t* dg_i2c_sim_get_dev(dg_i2c_sim_bus_t* p_bus, UINT8 bus, UINT8 address);
+
+/*==================================================================================================
+                                         GLOBAL VARIABLES
+==================================================================================================*/
+
+/*==================================================================================================
+                                          LOCAL VARIABLES
+==================================================================================================*/
+static dg_i2c_sim_bus_t* dg_i2c_sim_bus[DG_I2C_SIM_BUS_NUM];
+static pthread_mutex_t   dg_i2c_sim_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*==================================================================================================
+                                         GLOBAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Run one combined transfer on a simulated I2C device
+
+@param[in]  bus     - The I2C bus
+@param[in]  address - The 7 bit device address
+@param[in]  w_buf   - The write message, starts with the device offset bytes
+@param[in]  w_len   - The length of the write message, 0 reads from the current address
+@param[out] r_buf   - The buffer for the read message
+@param[in]  r_len   - The length of the read message, 0 for a write only transfer
+
+@return TRUE if the device acknowledged the transfer
+
+@note
+- transfers on the same bus are serialized, different buses run in parallel
+*//*==============================================================================================*/
+BOOL DG_I2C_SIM_xfer(UINT8 bus, UINT8 address, const UINT8* w_buf, UINT32 w_len,
+                     UINT8* r_buf, UINT32 r_len)
+{
+    BOOL              ret   = FALSE;
+    dg_i2c_sim_bus_t* p_bus = dg_i2c_sim_get_bus(bus);
+    dg_i2c_sim_dev_t* dev;
+    UINT64            busy_ns;
+    UINT32            i;
+
+    if (p_bus == NULL)
+    {
+        return FALSE;
+    }
+
+    if (address >= DG_I2C_SIM_ADDR_NUM)
+    {
+        DG_DRV_UTIL_set_error_string("Invalid I2C address: bus=0x%02x, address=0x%02x",
+                                     bus, address);
+        return FALSE;
+    }
+
+    pthread_mutex_lock(&p_bus->mutex);
+
+    dev = dg_i2c_sim_get_dev(p_bus, bus, address);
+    if (dev == NULL)
+    {
+        /* error string is set */
+    }
+    else if ((w_len > 0) && (w_len < dev->offset_len))
+    {
+        DG_DRV_UTIL_set_error_string("I2C device NACK on offset: bus=0x%02x, address=0x%02x, "
+                                     "w_len=%d", bus, address, w_len);
+    }
+    else
+    {
+        busy_ns = 0;
+
+        if (w_len > 0)
+        {
+            UINT32 offset = 0;
+
+            for (i = 0; i < dev->offset_len; i++)
+            {
+                offset = (offset << 8) | w_buf[i];
+            }
+            dev->ptr = offset % dev->size;
+
+            /* written data rolls over inside the page */
+            for (i = dev->offset_len; i < w_len; i++)
+            {
+                UINT32 page = dev->ptr - (dev->ptr % dev->page_size);
+
+                dev->mem[dev->ptr] = w_buf[i];
+                dev->ptr           = page + ((dev->ptr + 1) % dev->page_size);
+            }
+
+            if (w_len > dev->offset_len)
+            {
+                busy_ns += DG_I2C_SIM_WRITE_CYCLE_US * 1000ULL;
+            }
+
+            /* START, address byte and the write message */
+            busy_ns += (1 + DG_I2C_SIM_BYTE_BITS * (1 + w_len)) * (UINT64)DG_I2C_SIM_BIT_NS;
+        }
+
+        /* read data rolls over at the end of the device */
+        for (i = 0; i < r_len; i++)
+        {
+            r_buf[i] = dev->mem[dev->ptr];
+            dev->ptr = (dev->ptr + 1) % dev->size;
+        }
+
+        if (r_len > 0)
+        {
+            /* (repeated) START, address byte and the read message */
+            busy_ns += (1 + DG_I2C_SIM_BYTE_BITS * (1 + r_len)) * (UINT64)DG_I2C_SIM_BIT_NS;
+        }
+
+        /* STOP */
+        busy_ns += DG_I2C_SIM_BIT_NS;
+
+        p_bus->stats.xfer_num++;
+        p_bus->stats.byte_num += w_len + r_len;
+        p_bus->stats.busy_ns  += busy_ns;
+
+        /* the bus is occupied for the whole transfer */
+        DG_DRV_UTIL_sleep_ns(busy_ns);
+
+        ret = TRUE;
+    }
+
+    pthread_mutex_unlock(&p_bus->mutex);
+
+    return ret;
+}
+
+/*=============================================================================================*//**
+@brief Get the statistics of a simulated I2C bus
+
+@param[in]  bus   - The I2C bus
+@param[out] stats - The bus statistics
+*//*==============================================================================================*/
+void DG_I2C_SIM_get_stats(UINT8 bus, DG_I2C_SIM_STATS_T* stats)
+{
+    dg_i2c_sim_bus_t* p_bus = dg_i2c_sim_get_bus(bus);
+
+    memset(stats, 0, sizeof(*stats));
+
+    if (p_bus != NULL)
+    {
+        pthread_mutex_lock(&p_bus->mutex);
+        *stats = p_bus->stats;
+        pthread_mutex_unlock(&p_bus->mutex);
+    }
+}
+
+/*==================================================================================================
+                                          LOCAL FUNCTIONS
+==================================================================================================*/
+
+/*=============================================================================================*//**
+@brief Get a simulated bus, the bus is created on the first use
+
+@param[in] bus - The I2C bus
+
+@return the bus, NULL if it can't be created
+*//*==============================================================================================*/
+static dg_i2c_sim_bus_t* dg_i2c_sim_get_bus(UINT8 bus)
+{
+    dg_i2c_sim_bus_t* p_bus;
+
+    pthread_mutex_lock(&dg_i2c_sim_mutex);
+
+    p_bus = dg_i2c_sim_bus[bus];
+    if (p_bus == NULL)
+    {
+        p_bus = (dg_i2c_sim_bus_t*)calloc(1, sizeof(dg_i2c_sim_bus_t));
+        if (p_bus == NULL)
+        {
+            DG_DRV_UTIL_set_error(DG_DRV_UTIL_ERR_NO_MEM, sizeof(dg_i2c_sim_bus_t));
+        }
+        else
+        {
+            pthread_mutex_init(&p_bus->mutex, NULL);
+            dg_i2c_sim_bus[bus] = p_bus;
+        }
+    }
+
+    pthread_mutex_unlock(&dg_i2c_sim_mutex);
+
+    return p_bus;
+}
+
+/*=============================================================================================*//**
+@brief Get a simulated device, the device is created on the first access
+
+@param[in] p_bus   - The simulated bus, locked by the caller
+@param[in] bus     - The I2C bus
+@param[in] address - The 7 bit device address
+
+@return the device, NULL if it can't be created
+
+@note
+- the device has the geometry of the board device, see DG_CMN_DRV_I2C_get_geometry()
+- a new device is filled with its address byte
+*//*==============================================================================================*/
+static dg_i2c_sim_dev_t* dg_i2c_sim_get_dev(dg_i2c_sim_bus_t* p_bus, UINT8 bus, UINT8 address)
+{
+    dg_i2c_sim_dev_t*         dev = p_bus->dev[address];
+    DG_CMN_DRV_I2C_GEOMETRY_T geometry;
+
+    if (dev != NULL)
+    {
+        return dev;
+    }
+
+    dev = (dg_i2c_sim_dev_t*)calloc(1, sizeof(dg_i2c_sim_dev_t));
+    if (dev == NULL)
+    {
+        DG_DRV_UTIL_set_error(DG_DRV_UTIL_ERR_NO_MEM, sizeof(dg_i2c_sim_dev_t));
+        return NULL;
+    }
+
+    DG_CMN_DRV_I2C_get_geometry(bus, address, &geometry);
+    dev->size       = geometry.size;
+    dev->page_size  = geometry.page_size;
+    dev->offset_len = geometry.offset_len;
+
+    dev->mem = (UINT8*)malloc(dev->size);
+    if (dev->mem == NULL)
+    {
+        DG_DRV_UTIL_set_error(DG_DRV_UTIL_ERR_NO_MEM, dev->size);
+        free(dev);
+        return NULL;
+    }
+    memset(dev->mem, address, dev->size);
+
+    DG_DBG_TRACE("Simulated I2C device: bus=0x%02x, address=0x%02x, size=%d, page=%d",
+                 bus, address, dev->size, dev->page_size);
+
+    p_bus->dev[address] = dev;
+    return dev;
+}
+
+/** @} */
+/** @} */
+
@@ -28,16 +28,20 @@ Xudong Huang    - xudongh    2013/12/11     xxxxx-0000   Creation
 #include <net/if.h>
 #include <arpa/inet.h>
 #include <netinet/tcp.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 #include <signal.h>
 #include "dg_defs.h"
 #include "dg_dbg.h"
 #include "dg_aux_engine.h"
+#include "dg_conf.h"
 #include "dg_pal_util.h"
 
 /*==================================================================================================
                                            LOCAL CONSTANTS
 ==================================================================================================*/
 #define DG_PAL_UTIL_CLIENT_TCPIP_PORT 11000         /**< DIAG TCP/IP Port Number */
+#define DG_PAL_UTIL_IFACE_ADDR_MAX    32            /**< Cached interface addresses */
 
 /*==================================================================================================
                                             LOCAL MACROS
@@ -49,6 +53,13 @@ Xudong Huang    - xudongh    2013/12/11     xxxxx-0000   Creation
 /*==================================================================================================
                              LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
 ==================================================================================================*/
+/** A local IPv4 address, as SIOCGIFCONF lists it */
+typedef struct
+{
+    int            index;          /**< Interface index */
+    struct in_addr addr;           /**< Local address */
+    char           name[IFNAMSIZ]; /**< Interface name, or the address label of an alias */
+} DG_PAL_UTIL_IFACE_ADDR_T;
 
 /*==================================================================================================
                                       LOCAL FUNCTION PROTOTYPES
@@ -58,6 +69,14 @@ static int   dg_pal_util_read_pid_file(const char* pid_file);
 static BOOL  dg_pal_util_get_ext_ip_address(int* sock, struct sockaddr_in* addr);
 static char* dg_pal_util_get_ext_itfc_name(void);
 
+static DG_PAL_UTIL_SOCKET_UPDATE_T dg_pal_util_parse_rtm_msg(struct nlmsghdr* nlmsg, int len);
+
+static BOOL                      dg_pal_util_iface_addr_load(int sock);
+static DG_PAL_UTIL_IFACE_ADDR_T* dg_pal_util_iface_addr_find(int index, struct in_addr addr);
+static void                      dg_pal_util_iface_addr_add(int index, struct in_addr addr,
+                                                            const char* name);
+static void                      dg_pal_util_iface_addr_del(int index, struct in_addr addr);
+
 /*==================================================================================================
                                           GLOBAL VARIABLES
 ==================================================================================================*/
@@ -65,6 +84,12 @@ static char* dg_pal_util_get_ext_itfc_name(void);
 /*==================================================================================================
                                           LOCAL VARIABLES
 ==================================================================================================*/
+/* Local address cache for DG_PAL_UTIL_is_socket_allowed(). Only the listener thread accepts the
+   connections and reads the update socket, so the cache needs no lock */
+static DG_PAL_UTIL_IFACE_ADDR_T dg_pal_util_iface_addr[DG_PAL_UTIL_IFACE_ADDR_MAX];
+static int                      dg_pal_util_iface_addr_num   = 0;
+static BOOL                     dg_pal_util_iface_addr_valid = FALSE; /**< Loaded, not stale */
+static BOOL                     dg_pal_util_iface_addr_live  = FALSE; /**< Kept by netlink */
 
 /*==================================================================================================
                                           GLOBAL FUNCTIONS
@@ -212,26 +237,21 @@ void DG_PAL_UTIL_panic(const char* reason, ...)
 
 @note
  - This function shall return FALSE on any failures
+ - The local address is looked up in the interface address cache.  While the update socket keeps
+   the cache current no ioctl is done, otherwise or with the cache.iface_addr tunable at 0 the
+   cache is reloaded for every check
 *//*==============================================================================================*/
 BOOL DG_PAL_UTIL_is_socket_allowed(int socket)
 {
     struct sockaddr_storage sock_addr;
     socklen_t               sock_addr_len = sizeof(sock_addr);
     BOOL                    is_allowed    = FALSE;
-    int                     i;
-    int                     is_iface_match;
-    int                     num_iface; /* Number of interfaces */
 
     struct sockaddr_storage peer_addr;
     struct sockaddr_in*     in_peer_addr  = (struct sockaddr_in*)&peer_addr;
     socklen_t               peer_addr_len = sizeof(peer_addr);
 
-    /* Fixed size of 32 is taken arbitrary but checked with TAPI team and 32 should be more than
-       enough for DIAG*/
-    unsigned char buff[sizeof(struct ifreq) * 32];
-
-    struct ifconf       ifc;
-    struct sockaddr_in* iface_addr;
+    DG_PAL_UTIL_IFACE_ADDR_T* iface;
 
     /* Get local address of socket */
     if ((getsockname(socket, (struct sockaddr*)&sock_addr, &sock_addr_len)) != 0)
@@ -256,59 +276,44 @@ BOOL DG_PAL_UTIL_is_socket_allowed(int socket)
 
         DG_DBG_TRACE("Socket name %s", inet_ntoa(serv_addr_iface->sin_addr));
 
-        ifc.ifc_buf = (char*)buff;
-        ifc.ifc_len = sizeof(buff);
-
-        /* Get list of interfaces from the OS */
         if ((iface_name = dg_pal_util_get_ext_itfc_name()) == NULL)
         {
             DG_DBG_TRACE("external peer is allowed to connect");
             is_allowed = TRUE;
         }
-        else if ((ioctl(socket, SIOCGIFCONF, (caddr_t)&ifc) != 0))
-        {
-            DG_DBG_ERROR("failed to SIOCGIFCONF");
-        }
         else
         {
-            /* Number of interfaces returned by the OS */
-
-            num_iface = ifc.ifc_len / sizeof(struct ifreq);
-            DG_DBG_TRACE("Looking through %d interfaces (ifc_len=%d)...", num_iface, ifc.ifc_len);
-            for (i = 0; i < num_iface; i++)
+            /* Get list of interfaces from the OS, unless the update socket keeps it */
+            if ((!dg_pal_util_iface_addr_live || !dg_pal_util_iface_addr_valid ||
+                 (DG_CONF_get(DG_CONF_CACHE_IFACE_ADDR) == 0)) &&
+                !dg_pal_util_iface_addr_load(socket))
             {
-                iface_addr = (struct sockaddr_in*)&ifc.ifc_req[i].ifr_addr;
-
-                /* Does local address of socket match this interface? */
-                is_iface_match = (iface_addr->sin_addr.s_addr == serv_addr_iface->sin_addr.s_addr);
-                DG_DBG_TRACE("...Interface %s at %s%s", ifc.ifc_req[i].ifr_name, inet_ntoa(iface_addr->sin_addr),
-                             is_iface_match ? " (match)" : "(no match found)");
-
-                /* exit if one match is found */
-                if (is_iface_match == 1)
-                {
-                    /* Ensure connection is on the USB interface */
-                    if (strcmp(ifc.ifc_req[i].ifr_name, iface_name) != 0)
-                    {
-                        DG_DBG_TRACE("Interface %s not allowed", ifc.ifc_req[i].ifr_name);
-                    }
-                    /* Get IP address of peer, ensure peer & host addresses are not the same */
-                    else if (getpeername(socket, (struct sockaddr*)&peer_addr, &peer_addr_len) != 0)
-                    {
-                        DG_DBG_ERROR("getpeername failed, errno=%d(%m)", errno);
-                    }
-                    else if (in_peer_addr->sin_addr.s_addr == serv_addr_iface->sin_addr.s_addr)
-                    {
-                        DG_DBG_TRACE("Host address (%s) and peer address (%s) the same, not allowed",
-                                     inet_ntoa(serv_addr_iface->sin_addr),
-                                     inet_ntoa(in_peer_addr->sin_addr));
-                    }
-                    else
-                    {
-                        is_allowed = TRUE;
-                    }
-                    break;
-                }
+                DG_DBG_ERROR("failed to SIOCGIFCONF");
+            }
+            /* Does local address of socket match an interface? */
+            else if ((iface = dg_pal_util_iface_addr_find(-1, serv_addr_iface->sin_addr)) == NULL)
+            {
+                DG_DBG_TRACE("No interface at %s", inet_ntoa(serv_addr_iface->sin_addr));
+            }
+            /* Ensure connection is on the USB interface */
+            else if (strcmp(iface->name, iface_name) != 0)
+            {
+                DG_DBG_TRACE("Interface %s not allowed", iface->name);
+            }
+            /* Get IP address of peer, ensure peer & host addresses are not the same */
+            else if (getpeername(socket, (struct sockaddr*)&peer_addr, &peer_addr_len) != 0)
+            {
+                DG_DBG_ERROR("getpeername failed, errno=%d(%m)", errno);
+            }
+            else if (in_peer_addr->sin_addr.s_addr == serv_addr_iface->sin_addr.s_addr)
+            {
+                DG_DBG_TRACE("Host address (%s) and peer address (%s) the same, not allowed",
+                             inet_ntoa(serv_addr_iface->sin_addr),
+                             inet_ntoa(in_peer_addr->sin_addr));
+            }
+            else
+            {
+                is_allowed = TRUE;
             }
 
             free(iface_name);
@@ -430,8 +435,6 @@ BOOL DG_PAL_UTIL_create_ext_diag_listen_sock(int* sock)
 *//*==============================================================================================*/
 BOOL DG_PAL_UTIL_create_update_sock(int* sock)
 {
-#if 0
-    int                fd = -1;
     struct sockaddr_nl sa_nl;
     int                on = 1;
 
@@ -456,13 +459,15 @@ BOOL DG_PAL_UTIL_create_update_sock(int* sock)
             close(*sock);
             *sock = -1;
         }
+        else
+        {
+            /* Subscribed before the cache is loaded, so no address change can be missed */
+            dg_pal_util_iface_addr_live  = TRUE;
+            dg_pal_util_iface_addr_valid = FALSE;
+        }
     }
 
     return TRUE;
-#else
-    DG_COMPILE_UNUSED(sock);
-    return FALSE;
-#endif
 }
 
 /*=============================================================================================*//**
@@ -476,8 +481,8 @@ BOOL DG_PAL_UTIL_create_update_sock(int* sock)
 DG_PAL_UTIL_SOCKET_UPDATE_T DG_PAL_UTIL_handle_update_sock_event(int fd)
 {
     DG_PAL_UTIL_SOCKET_UPDATE_T status = DG_PAL_UTIL_SOCKET_UPDATE_NOOP;
+    DG_PAL_UTIL_SOCKET_UPDATE_T msg_status;
 
-#if 0
     struct sockaddr_nl sock_nl;
     char               nl_buf[8192]; /* arbitary size */
     struct iovec       iov = { nl_buf, sizeof(nl_buf) };
@@ -488,7 +493,13 @@ DG_PAL_UTIL_SOCKET_UPDATE_T DG_PAL_UTIL_handle_update_sock_event(int fd)
 
     /* Read the netlink socket, do not block */
     bytes_read = recvmsg(fd, &hdr, MSG_DONTWAIT);
-    if (bytes_read > 0)
+    if ((bytes_read < 0) && (errno == ENOBUFS))
+    {
+        /* Events were dropped, the cache is reloaded on the next check */
+        DG_DBG_ERROR("NL - Update socket overrun, interface address cache dropped");
+        dg_pal_util_iface_addr_valid = FALSE;
+    }
+    else if (bytes_read > 0)
     {
         struct cmsghdr* cmsg;
         struct ucred*   cred;
@@ -537,18 +548,21 @@ DG_PAL_UTIL_SOCKET_UPDATE_T DG_PAL_UTIL_handle_update_sock_event(int fd)
                     else
                     {
                         /* Parse any RTM new link messages */
-                        status = dg_pal_util_parse_rtm_msg(nlmsg, (nlmsg->nlmsg_len - sizeof(*nlmsg)));
+                        msg_status = dg_pal_util_parse_rtm_msg(nlmsg,
+                                                               (nlmsg->nlmsg_len - sizeof(*nlmsg)));
+                        if (msg_status != DG_PAL_UTIL_SOCKET_UPDATE_NOOP)
+                        {
+                            status = msg_status;
+                        }
 
-                        /* Intentionally do not break here.  Want to continue for loop in case there was
-                           another message in queue */
+                        /* Intentionally do not break here.  Want to continue for loop in case
+                           there was another message in queue */
                     }
                 }
             }
         }
     }
-#else
-    DG_COMPILE_UNUSED(fd);
-#endif
+
     return status;
 }
 
@@ -644,121 +658,151 @@ BOOL dg_pal_util_lock_process(const char* pid_file)
 
 @return The network event which occurred, if the feature is not supported or there was an error,
 #DG_PAL_UTIL_SOCKET_UPDATE_NOOP should be returned.
+
+@note
+ - Address messages also update the interface address cache, whichever interface they are for
 *//*==============================================================================================*/
-#if 0
 DG_PAL_UTIL_SOCKET_UPDATE_T dg_pal_util_parse_rtm_msg(struct nlmsghdr* nlmsg, int len)
 {
     DG_PAL_UTIL_SOCKET_UPDATE_T status     = DG_PAL_UTIL_SOCKET_UPDATE_NOOP;
     int                         attrib_len = 0;
     struct rtattr*              attrib     = NULL;
-    char*                       iface_name;
+    char*                       iface_name = dg_pal_util_get_ext_itfc_name();
 
-    if ((iface_name = dg_pal_util_get_ext_itfc_name()) == NULL)
+    switch (nlmsg->nlmsg_type)
     {
-        DG_DBG_ERROR("Failed to get interface name while parsing rtm msg");
-    }
-    else
-    {
-        switch (nlmsg->nlmsg_type)
+    case RTM_NEWLINK:
+        DG_DBG_TRACE("NL - message type is RTM_NEWLINK");
+        /* Ensure the interface info is present */
+        if ((size_t)len >= sizeof(struct ifinfomsg))
         {
-        case RTM_NEWLINK:
-            DG_DBG_TRACE("NL - message type is RTM_NEWLINK");
-            /* Ensure the interface info is present */
-            if ((size_t)len >= sizeof(struct ifinfomsg))
-            {
-                struct ifinfomsg* ifi = NLMSG_DATA(nlmsg);
+            struct ifinfomsg* ifi = NLMSG_DATA(nlmsg);
+            char              name[IFNAMSIZ];
+            int               i;
 
-                /* Get the pointer to the start of the attributes */
-                attrib = IFLA_RTA(ifi);
+            /* Get the pointer to the start of the attributes */
+            attrib = IFLA_RTA(ifi);
 
-                /* Get the length of all of the attributes */
-                attrib_len = IFLA_PAYLOAD(nlmsg);
+            /* Get the length of all of the attributes */
+            attrib_len = IFLA_PAYLOAD(nlmsg);
 
-                /* Loop through all of the attributes, looking for the one we care about */
-                while (RTA_OK(attrib, attrib_len))
+            /* Loop through all of the attributes, looking for the one we care about */
+            while (RTA_OK(attrib, attrib_len))
+            {
+                /* Check for the interface name */
+                if (attrib->rta_type == IFLA_IFNAME)
                 {
-                    /* Check for the interface name */
-                    if (attrib->rta_type == IFLA_IFNAME)
+                    /* A renamed interface takes its address labels along, reload them */
+                    snprintf(name, sizeof(name), "%s", (char*)RTA_DATA(attrib));
+                    for (i = 0; i < dg_pal_util_iface_addr_num; i++)
+                    {
+                        if ((dg_pal_util_iface_addr[i].index == ifi->ifi_index) &&
+                            (strncmp(dg_pal_util_iface_addr[i].name, name, strlen(name)) != 0))
+                        {
+                            DG_DBG_TRACE("NL - Interface %d renamed to %s", ifi->ifi_index, name);
+                            dg_pal_util_iface_addr_valid = FALSE;
+                        }
+                    }
+
+                    /* Ensure it is usblan interface */
+                    if ((iface_name != NULL) && (strcmp(name, iface_name) == 0))
                     {
-                        /* Ensure it is usblan interface */
-                        if (strcmp(RTA_DATA(attrib), iface_name) == 0)
+                        if ((ifi->ifi_flags & (IFF_UP | IFF_RUNNING)) &&
+                            (ifi->ifi_change & (IFF_UP | IFF_RUNNING)))
                         {
-                            if ((ifi->ifi_flags & (IFF_UP | IFF_RUNNING)) &&
-                                (ifi->ifi_change & (IFF_UP | IFF_RUNNING)))
-                            {
-                                DG_DBG_TRACE("TCP Available!");
-                                status = DG_PAL_UTIL_SOCKET_UPDATE_EXT_ADD;
-                                break;
-                            }
-                            else if (((ifi->ifi_flags & (IFF_UP | IFF_RUNNING)) == 0) &&
-                                     (ifi->ifi_change & (IFF_UP | IFF_RUNNING)))
-                            {
-                                DG_DBG_TRACE("TCP Removed!");
-                                status = DG_PAL_UTIL_SOCKET_UPDATE_EXT_REMOVE;
-                                break;
-                            }
+                            DG_DBG_TRACE("TCP Available!");
+                            status = DG_PAL_UTIL_SOCKET_UPDATE_EXT_ADD;
+                            break;
+                        }
+                        else if (((ifi->ifi_flags & (IFF_UP | IFF_RUNNING)) == 0) &&
+                                 (ifi->ifi_change & (IFF_UP | IFF_RUNNING)))
+                        {
+                            DG_DBG_TRACE("TCP Removed!");
+                            status = DG_PAL_UTIL_SOCKET_UPDATE_EXT_REMOVE;
+                            break;
                         }
                     }
-                    attrib = RTA_NEXT(attrib, attrib_len);
                 }
+                attrib = RTA_NEXT(attrib, attrib_len);
             }
-            break;
+        }
+        break;
+
+    case RTM_NEWADDR:
+    case RTM_DELADDR:
+        DG_DBG_TRACE("NL - message type is %s",
+                     (nlmsg->nlmsg_type == RTM_NEWADDR) ? "RTM_NEWADDR" : "RTM_DELADDR");
+        /* Ensure the interface address is present */
+        if ((size_t)len >= sizeof(struct ifaddrmsg))
+        {
+            struct ifaddrmsg* ifa      = NLMSG_DATA(nlmsg);
+            struct in_addr*   local    = NULL;
+            char*             label    = NULL;
+            char              name[IFNAMSIZ];
 
-        case RTM_NEWADDR:
-            DG_DBG_TRACE("NL - message type is RTM_NEWADDR");
-            /* Ensure the interface address is present */
-            if ((size_t)len >= sizeof(struct ifaddrmsg))
-            {
-                struct ifaddrmsg* ifa = NLMSG_DATA(nlmsg);
+            /* Get the pointer to the start of the attributes */
+            attrib = IFA_RTA(ifa);
 
-                /* Get the pointer to the start of the attributes */
-                attrib = IFA_RTA(ifa);
+            /* Get the length of all of the attributes */
+            attrib_len = IFA_PAYLOAD(nlmsg);
 
-                /* Get the length of all of the attributes */
-                attrib_len = IFA_PAYLOAD(nlmsg);
+            /* Loop through all of the attributes, looking for the ones we care about */
+            while (RTA_OK(attrib, attrib_len))
+            {
+                if ((attrib->rta_type == IFA_LOCAL) &&
+                    (RTA_PAYLOAD(attrib) >= sizeof(struct in_addr)))
+                {
+                    local = (struct in_addr*)RTA_DATA(attrib);
+                }
+                else if ((attrib->rta_type == IFA_LABEL) && (RTA_PAYLOAD(attrib) > 0))
+                {
+                    label = (char*)RTA_DATA(attrib);
+                }
+                attrib = RTA_NEXT(attrib, attrib_len);
+            }
 
-                /* Loop through all of the attributes, looking for the one we care about */
-                while (RTA_OK(attrib, attrib_len))
+            if ((ifa->ifa_family == AF_INET) && (local != NULL))
+            {
+                /* SIOCGIFCONF names an alias by its label, the cache does the same */
+                if (label != NULL)
                 {
-                    /* Check for the interface name */
-                    if (attrib->rta_type == IFA_LOCAL)
-                    {
-                        /* Ensure it is usblan interface */
-                        uint32_t ipaddr = htonl(*((uint32_t*)RTA_DATA(attrib)));
-                        char     name[IFNAMSIZ];
+                    snprintf(name, sizeof(name), "%.*s", (int)(sizeof(name) - 1), label);
+                }
+                else if (if_indextoname(ifa->ifa_index, name) == NULL)
+                {
+                    name[0] = '\0';
+                }
 
-                        if_indextoname(ifa->ifa_index, name);
+                if (nlmsg->nlmsg_type == RTM_NEWADDR)
+                {
+                    dg_pal_util_iface_addr_add(ifa->ifa_index, *local, name);
+                }
+                else
+                {
+                    dg_pal_util_iface_addr_del(ifa->ifa_index, *local);
+                }
 
-                        if (strcmp(name, iface_name) == 0)
-                        {
-                            DG_DBG_TRACE("TCP Updated!");
-                            DG_DBG_TRACE("%s is now %d.%d.%d.%d\n",
-                                         name,
-                                         (ipaddr >> 24) & 0xff,
-                                         (ipaddr >> 16) & 0xff,
-                                         (ipaddr >> 8) & 0xff,
-                                         ipaddr & 0xff);
-                            status = DG_PAL_UTIL_SOCKET_UPDATE_EXT_UPDATE;
-                            break;
-                        }
-                    }
-                    attrib = RTA_NEXT(attrib, attrib_len);
+                /* Ensure it is usblan interface */
+                if ((nlmsg->nlmsg_type == RTM_NEWADDR) && (iface_name != NULL) &&
+                    (strcmp(name, iface_name) == 0))
+                {
+                    DG_DBG_TRACE("TCP Updated!");
+                    DG_DBG_TRACE("%s is now %s", name, inet_ntoa(*local));
+                    status = DG_PAL_UTIL_SOCKET_UPDATE_EXT_UPDATE;
                 }
             }
-
-            break;
-
-        default:
-            DG_DBG_TRACE("NL - ignore NL message, type = %d", nlmsg->nlmsg_type);
-            /* just ignore other RTM msg */
-            break;
         }
+        break;
 
-        free(iface_name);
+    default:
+        DG_DBG_TRACE("NL - ignore NL message, type = %d", nlmsg->nlmsg_type);
+        /* just ignore other RTM msg */
+        break;
     }
+
+    free(iface_name);
     return status;
 }
-#endif
 
 /*=============================================================================================*//**
 @brief Finds the IP address to use for external clients
@@ -839,6 +883,135 @@ char* dg_pal_util_get_ext_itfc_name(void)
     return NULL;
 }
 
+/*=============================================================================================*//**
+@brief Loads the interface address cache from the OS
+
+@param[in] sock - Socket to use to get interface list
+
+@return TRUE = Success
+
+@note
+ - The interface index is only needed to apply the netlink updates, it is not looked up while
+   the cache is reloaded for every check
+*//*==============================================================================================*/
+BOOL dg_pal_util_iface_addr_load(int sock)
+{
+    /* Fixed size of 32 is taken arbitrary but checked with TAPI team and 32 should be more than
+       enough for DIAG*/
+    unsigned char       buff[sizeof(struct ifreq) * DG_PAL_UTIL_IFACE_ADDR_MAX];
+    struct ifconf       ifc;
+    struct sockaddr_in* iface_addr;
+    int                 num_iface;
+    int                 i;
+    BOOL                is_success = FALSE;
+
+    ifc.ifc_buf = (char*)buff;
+    ifc.ifc_len = sizeof(buff);
+
+    if ((ioctl(sock, SIOCGIFCONF, (caddr_t)&ifc) != 0))
+    {
+        DG_DBG_ERROR("Failed to SIOCGIFCONF, errno=%d(%m)", errno);
+    }
+    else
+    {
+        /* Number of interfaces returned by the OS */
+        num_iface                  = ifc.ifc_len / sizeof(struct ifreq);
+        dg_pal_util_iface_addr_num = 0;
+        DG_DBG_TRACE("Looking through %d interfaces (ifc_len=%d)...", num_iface, ifc.ifc_len);
+
+        for (i = 0; i < num_iface; i++)
+        {
+            if (ifc.ifc_req[i].ifr_addr.sa_family == AF_INET)
+            {
+                iface_addr = (struct sockaddr_in*)&ifc.ifc_req[i].ifr_addr;
+                dg_pal_util_iface_addr_add(dg_pal_util_iface_addr_live ?
+                                           (int)if_nametoindex(ifc.ifc_req[i].ifr_name) : 0,
+                                           iface_addr->sin_addr, ifc.ifc_req[i].ifr_name);
+            }
+        }
+
+        dg_pal_util_iface_addr_valid = TRUE;
+        is_success                   = TRUE;
+    }
+
+    return is_success;
+}
+
+/*=============================================================================================*//**
+@brief Finds an address in the interface address cache
+
+@param[in] index - Interface index, -1 for any interface
+@param[in] addr  - Local address
+
+@return The cache entry, NULL if not found
+*//*==============================================================================================*/
+DG_PAL_UTIL_IFACE_ADDR_T* dg_pal_util_iface_addr_find(int index, struct in_addr addr)
+{
+    DG_PAL_UTIL_IFACE_ADDR_T* iface = NULL;
+    int                       i;
+
+    for (i = 0; i < dg_pal_util_iface_addr_num; i++)
+    {
+        if ((dg_pal_util_iface_addr[i].addr.s_addr == addr.s_addr) &&
+            ((index == -1) || (dg_pal_util_iface_addr[i].index == index)))
+        {
+            iface = &dg_pal_util_iface_addr[i];
+            break;
+        }
+    }
+
+    return iface;
+}
+
+/*=============================================================================================*//**
+@brief Adds an address to the interface address cache, or renames it if it is there already
+
+@param[in] index - Interface index
+@param[in] addr  - Local address
+@param[in] name  - Interface name or address label
+*//*==============================================================================================*/
+void dg_pal_util_iface_addr_add(int index, struct in_addr addr, const char* name)
+{
+    DG_PAL_UTIL_IFACE_ADDR_T* iface;
+
+    if ((iface = dg_pal_util_iface_addr_find(index, addr)) == NULL)
+    {
+        if (dg_pal_util_iface_addr_num == DG_PAL_UTIL_IFACE_ADDR_MAX)
+        {
+            DG_DBG_ERROR("Interface address cache full, %s at %s dropped", name, inet_ntoa(addr));
+        }
+        else
+        {
+            iface        = &dg_pal_util_iface_addr[dg_pal_util_iface_addr_num++];
+            iface->index = index;
+            iface->addr  = addr;
+        }
+    }
+
+    if (iface != NULL)
+    {
+        snprintf(iface->name, sizeof(iface->name), "%s", name);
+        DG_DBG_TRACE("Interface %s (%d) at %s", iface->name, index, inet_ntoa(addr));
+    }
+}
+
+/*=============================================================================================*//**
+@brief Removes an address from the interface address cache
+
+@param[in] index - Interface index
+@param[in] addr  - Local address
+*//*==============================================================================================*/
+void dg_pal_util_iface_addr_del(int index, struct in_addr addr)
+{
+    DG_PAL_UTIL_IFACE_ADDR_T* iface;
+
+    if ((iface = dg_pal_util_iface_addr_find(index, addr)) != NULL)
+    {
+        DG_DBG_TRACE("Interface %s (%d) at %s removed", iface->name, index, inet_ntoa(addr));
+        *iface = dg_pal_util_iface_addr[--dg_pal_util_iface_addr_num];
+    }
+}
+
 /** @} */
 /** @} */
 
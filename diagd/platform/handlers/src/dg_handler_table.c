@@ -38,6 +38,11 @@ engine
 ==================================================================================================*/
 #define DG_HANDLER_TABLE_DEFAULT_TIMEOUT 10000 /**< Default timeout used for DIAGs */
 
+/** Table entry with the default timeout, mode is ALL or TEST, sched is the DG_DEFS_SCHED_ class */
+#define DG_HANDLER_TABLE_ENTRY(opcode, mode, handler, sched) \
+    { opcode, DG_DEFS_MODE_##mode, handler, DG_HANDLER_TABLE_DEFAULT_TIMEOUT, \
+      DG_DEFS_SCHED_##sched }
+
 /*==================================================================================================
                             LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
 ==================================================================================================*/
@@ -54,43 +59,45 @@ engine
     DG_DEFS_HANDLER_TABLE_OPCODE_END */
 const DG_DEFS_OPCODE_ENTRY_T DG_HANDLER_TABLE_data[] =
 {
-    { 0x0000, DG_DEFS_MODE_ALL,  DG_VERSION_handler_main,     DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0001, DG_DEFS_MODE_ALL,  DG_LED_handler_main,         DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0002, DG_DEFS_MODE_ALL,  DG_FAN_handler_main,         DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0003, DG_DEFS_MODE_ALL,  DG_TEMP_handler_main,        DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0004, DG_DEFS_MODE_TEST, DG_EEPROM_handler_main,      DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0005, DG_DEFS_MODE_TEST, DG_VOLTAGE_handler_main,     DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0006, DG_DEFS_MODE_TEST, DG_SFP_handler_main,         DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0007, DG_DEFS_MODE_TEST, DG_CLOCK_handler_main,       DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0008, DG_DEFS_MODE_ALL,  DG_DIMM_handler_main,        DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0009, DG_DEFS_MODE_TEST, DG_PTTM_handler_main,        DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x000A, DG_DEFS_MODE_TEST, DG_PSU_handler_main,         DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x000B, DG_DEFS_MODE_TEST, DG_PHY_handler_main,         DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x000D, DG_DEFS_MODE_TEST, DG_FPGA_handler_main,        DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x000E, DG_DEFS_MODE_TEST, DG_CPLD_handler_main,        DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x000F, DG_DEFS_MODE_TEST, DG_BUTTON_handler_main,      DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0010, DG_DEFS_MODE_TEST, DG_I2C_handler_main,         DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0011, DG_DEFS_MODE_ALL,  DG_USB_handler_main,         DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0012, DG_DEFS_MODE_ALL,  DG_SSD_handler_main,         DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0013, DG_DEFS_MODE_ALL,  DG_PCI_handler_main,         DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0014, DG_DEFS_MODE_ALL,  DG_TPM_handler_main,         DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0015, DG_DEFS_MODE_TEST, DG_BIOS_handler_main,        DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0016, DG_DEFS_MODE_ALL,  DG_RTC_handler_main,         DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0017, DG_DEFS_MODE_TEST, DG_GPIO_handler_main,        DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0018, DG_DEFS_MODE_TEST, DG_FPGA_FLASH_handler_main,  DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0019, DG_DEFS_MODE_TEST, DG_PORT_LED_handler_main,    DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0020, DG_DEFS_MODE_TEST, DG_PRBS_handler_main,        DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0021, DG_DEFS_MODE_TEST, DG_INT_LOOP_handler_main,    DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0022, DG_DEFS_MODE_TEST, DG_EXT_LOOP_handler_main,    DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0023, DG_DEFS_MODE_TEST, DG_LOOP_handler_main,        DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0100, DG_DEFS_MODE_ALL,  DG_SUSPEND_handler_main,     DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0101, DG_DEFS_MODE_TEST, DG_RESET_handler_main,       DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0FFD, DG_DEFS_MODE_ALL,  DG_DEBUG_LEVEL_handler_main, DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0FFE, DG_DEFS_MODE_ALL,  DG_TEST_ENGINE_handler_main, DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
-    { 0x0FFF, DG_DEFS_MODE_ALL,  DG_PING_handler_main,        DG_HANDLER_TABLE_DEFAULT_TIMEOUT },
+    DG_HANDLER_TABLE_ENTRY(0x0000, ALL,  DG_VERSION_handler_main,      INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0001, ALL,  DG_LED_handler_main,          INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0002, ALL,  DG_FAN_handler_main,          INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0003, ALL,  DG_TEMP_handler_main,         INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0004, TEST, DG_EEPROM_handler_main,       INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0005, TEST, DG_VOLTAGE_handler_main,      INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0006, TEST, DG_SFP_handler_main,          INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0007, TEST, DG_CLOCK_handler_main,        INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0008, ALL,  DG_DIMM_handler_main,         INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0009, TEST, DG_PTTM_handler_main,         INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x000A, TEST, DG_PSU_handler_main,          INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x000B, TEST, DG_PHY_handler_main,          INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x000D, TEST, DG_FPGA_handler_main,         INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x000E, TEST, DG_CPLD_handler_main,         INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x000F, TEST, DG_BUTTON_handler_main,       INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0010, TEST, DG_I2C_handler_main,          INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0011, ALL,  DG_USB_handler_main,          INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0012, ALL,  DG_SSD_handler_main,          INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0013, ALL,  DG_PCI_handler_main,          INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0014, ALL,  DG_TPM_handler_main,          INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0015, TEST, DG_BIOS_handler_main,         INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0016, ALL,  DG_RTC_handler_main,          INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0017, TEST, DG_GPIO_handler_main,         INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0018, TEST, DG_FPGA_FLASH_handler_main,   BACKGROUND),
+    DG_HANDLER_TABLE_ENTRY(0x0019, TEST, DG_PORT_LED_handler_main,     INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0020, TEST, DG_PRBS_handler_main,         BULK),
+    DG_HANDLER_TABLE_ENTRY(0x0021, TEST, DG_INT_LOOP_handler_main,     BULK),
+    DG_HANDLER_TABLE_ENTRY(0x0022, TEST, DG_EXT_LOOP_handler_main,     BULK),
+    DG_HANDLER_TABLE_ENTRY(0x0023, TEST, DG_LOOP_handler_main,         BULK),
+    DG_HANDLER_TABLE_ENTRY(0x0100, ALL,  DG_SUSPEND_handler_main,      INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0101, TEST, DG_RESET_handler_main,        INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0FFC, ALL,  DG_CAPTURE_CTRL_handler_main, INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0FFD, ALL,  DG_DEBUG_LEVEL_handler_main,  INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0FFE, ALL,  DG_TEST_ENGINE_handler_main,  INTERACTIVE),
+    DG_HANDLER_TABLE_ENTRY(0x0FFF, ALL,  DG_PING_handler_main,         INTERACTIVE),
 
     /* IMPORTANT: This must be the last line! */
-    { DG_DEFS_HANDLER_TABLE_OPCODE_END, DG_DEFS_MODE_ALL, DG_AUX_CMD_handler_main, 60000 }
+    { DG_DEFS_HANDLER_TABLE_OPCODE_END, DG_DEFS_MODE_ALL, DG_AUX_CMD_handler_main, 60000,
+      DG_DEFS_SCHED_INTERACTIVE }
 
 };
 
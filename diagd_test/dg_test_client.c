@@ -13,6 +13,7 @@
                                             INCLUDE FILES
 ==================================================================================================*/
 #include <time.h>
+#include <errno.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -22,6 +23,9 @@
 #include <arpa/inet.h>
 #include <dg_platform_defs.h>
 #include <dg_client_api.h>
+#include <dg_defs.h>
+#include <dg_capture.h>
+#include <dg_shm.h>
 
 /*==================================================================================================
                                            LOCAL CONSTANTS
@@ -51,9 +55,150 @@
 #define DG_TEST_CLIENT_MASS_CONNECT_LOOP_SLEEP           2
 #define DG_TEST_CLIENT_MASS_CONNECT_NUM_LOOPS            4
 
+/* Benchmark settings */
+#define DG_TEST_CLIENT_BENCH_MIX_MAX     8    /* Maximum number of entries in an opcode mix */
+#define DG_TEST_CLIENT_BENCH_SEQ_MAX     1024 /* Maximum sum of the opcode mix weights */
+#define DG_TEST_CLIENT_BENCH_CLIENTS_MAX 256  /* Maximum number of concurrent clients */
+#define DG_TEST_CLIENT_BENCH_DATA_MAX    4000 /* Maximum request/response payload size */
+#define DG_TEST_CLIENT_BENCH_RSP_TIMEOUT 5000 /* Response timeout in msec, counts as an error */
+#define DG_TEST_CLIENT_BENCH_HIST_SUB    16   /* Latency buckets in each power of two ns */
+#define DG_TEST_CLIENT_BENCH_HIST_NUM    640  /* Latency buckets, up to 2^40 ns */
+#define DG_TEST_CLIENT_BENCH_NS_PER_SEC  1000000000ULL
+#define DG_TEST_CLIENT_BENCH_NS_PER_MSEC 1000000ULL
+#define DG_TEST_CLIENT_BENCH_DEFAULT_MIX "echo/64:1"
+
+/* Replay settings */
+#define DG_TEST_CLIENT_REPLAY_OPS_MAX     64     /* Maximum number of opcodes in a capture */
+#define DG_TEST_CLIENT_REPLAY_CTRL_OPCODE 0x0ffc /* CAPTURE_CTRL, not replayed */
+
 /*==================================================================================================
                              LOCAL TYPEDEFS (STRUCTURES, UNIONS, ENUMS)
 ==================================================================================================*/
+/* Benchmark operation, one of the requests the opcode mix is built from */
+typedef struct
+{
+    const char* name;
+    UINT16      opcode;
+    BOOL        has_action;  /* TEST_ENGINE requests start with a 4 byte action */
+    UINT32      action;
+    UINT32      default_arg;
+} DG_TEST_CLIENT_BENCH_OP_T;
+
+/* One entry of the opcode mix, NAME/ARG:WEIGHT on the command line */
+typedef struct
+{
+    const DG_TEST_CLIENT_BENCH_OP_T* op;
+    UINT32                           arg;      /* payload size, delay msec or response size */
+    UINT32                           weight;
+    UINT8*                           req_data; /* prebuilt request data */
+    UINT32                           req_len;
+    UINT32                           rsp_len;  /* expected response data length */
+} DG_TEST_CLIENT_BENCH_MIX_T;
+
+/* Latency and count statistics, one per mix entry in each client */
+typedef struct
+{
+    UINT64 requests;
+    UINT64 errors;
+    UINT64 busy;     /* busy responses, the request was sent again */
+    UINT64 lat_sum;
+    UINT64 lat_min;
+    UINT64 lat_max;
+    UINT32 hist[DG_TEST_CLIENT_BENCH_HIST_NUM];
+} DG_TEST_CLIENT_BENCH_STAT_T;
+
+/* One benchmark client, a thread with its own connection */
+typedef struct
+{
+    struct DG_TEST_CLIENT_BENCH_S* bench;
+    UINT32                         id;
+    pthread_t                      thread;
+    int                            connect_fail;
+    unsigned int                   seed;      /* jitter of the busy retries */
+    UINT64                         last_done; /* time the last measured request completed */
+    DG_TEST_CLIENT_BENCH_STAT_T    stat[DG_TEST_CLIENT_BENCH_MIX_MAX];
+} DG_TEST_CLIENT_BENCH_CLIENT_T;
+
+/* Benchmark run, shared by all the clients */
+typedef struct DG_TEST_CLIENT_BENCH_S
+{
+    const char*                 label;
+    const char*                 mix_str;
+    const char*                 out_file;
+    UINT32                      clients;
+    double                      rate;        /* requests per second, 0 for the closed loop */
+    double                      duration;    /* measured seconds */
+    double                      warmup;      /* seconds before the measurement starts */
+    UINT64                      num;         /* maximum number of requests, 0 for no limit */
+    int                         mix_num;
+    DG_TEST_CLIENT_BENCH_MIX_T  mix[DG_TEST_CLIENT_BENCH_MIX_MAX];
+    int                         seq_num;
+    UINT8                       seq[DG_TEST_CLIENT_BENCH_SEQ_MAX];
+    UINT64                      start;       /* CLOCK_MONOTONIC ns */
+    UINT64                      measure;     /* start of the measurement */
+    UINT64                      end;         /* no request is started from here on */
+    UINT64                      next;        /* index of the next request, shared */
+} DG_TEST_CLIENT_BENCH_T;
+
+/* Captured request with its captured response */
+typedef struct
+{
+    UINT64 time;        /* ns from the capture start */
+    UINT64 rsp_time;
+    UINT16 opcode;
+    UINT16 seq_tag;
+    int    op;          /* index of the opcode in the replay */
+    UINT32 data_len;
+    UINT8* data;
+    UINT8* frame;       /* the captured request frame, data points into it */
+    BOOL   has_rsp;
+    UINT8  rsp_code;
+    UINT32 rsp_len;     /* response data length */
+    UINT32 rsp_cap_len; /* captured bytes of the response data, less than rsp_len if cut */
+    UINT8* rsp_data;
+    UINT8* rsp_frame;
+} DG_TEST_CLIENT_REPLAY_REQ_T;
+
+/* Replay statistics of one opcode */
+typedef struct
+{
+    DG_TEST_CLIENT_BENCH_STAT_T stat;
+    UINT64                      mismatches; /* responses different from the captured ones */
+} DG_TEST_CLIENT_REPLAY_STAT_T;
+
+/* One captured client, replayed by a thread with its own connection */
+typedef struct
+{
+    struct DG_TEST_CLIENT_REPLAY_S* replay;
+    UINT16                          id;      /* client socket in the capture */
+    pthread_t                       thread;
+    int                             connect_fail;
+    UINT32                          req_num;
+    UINT32                          req_max;
+    DG_TEST_CLIENT_REPLAY_REQ_T*    req;
+    int                             pending; /* request waiting for its captured response */
+    UINT64                          last_done;
+    DG_TEST_CLIENT_REPLAY_STAT_T*   stat;    /* one per opcode */
+} DG_TEST_CLIENT_REPLAY_CLIENT_T;
+
+/* Replay run, shared by all the clients */
+typedef struct DG_TEST_CLIENT_REPLAY_S
+{
+    const char*                    label;
+    const char*                    file;
+    const char*                    out_file;
+    BOOL                           fast;     /* as fast as possible instead of the capture pace */
+    UINT32                         clients;
+    DG_TEST_CLIENT_REPLAY_CLIENT_T client[DG_TEST_CLIENT_BENCH_CLIENTS_MAX];
+    int                            op_num;
+    UINT16                         opcode[DG_TEST_CLIENT_REPLAY_OPS_MAX];
+    DG_TEST_CLIENT_BENCH_STAT_T    captured[DG_TEST_CLIENT_REPLAY_OPS_MAX];
+    UINT64                         requests; /* requests to replay */
+    UINT64                         skipped;  /* requests cut by the snap length or not replayed */
+    UINT64                         first;    /* time of the first request in the capture */
+    UINT64                         last;     /* time of the last frame in the capture */
+    UINT64                         start;    /* CLOCK_MONOTONIC ns */
+} DG_TEST_CLIENT_REPLAY_T;
 
 /*==================================================================================================
                                       LOCAL FUNCTION PROTOTYPES
@@ -72,6 +217,32 @@ BOOL   dg_test_client_mass_connection_test(void);
 BOOL   dg_test_client_multi_aux_test(void);
 void*  dg_test_client_multi_aux_test_thread(void*);
 UINT8* dg_test_client_create_random_data(UINT32* diag_req_data_len);
+int    dg_test_client_bench(int argc, char** argv);
+BOOL   dg_test_client_bench_parse_mix(DG_TEST_CLIENT_BENCH_T* bench, const char* mix_str);
+BOOL   dg_test_client_bench_build_req(DG_TEST_CLIENT_BENCH_MIX_T* mix);
+void   dg_test_client_bench_build_seq(DG_TEST_CLIENT_BENCH_T* bench);
+void*  dg_test_client_bench_thread(void* p);
+BOOL   dg_test_client_bench_check_rsp(DG_TEST_CLIENT_BENCH_MIX_T* mix, DG_CLIENT_API_RSP_T* rsp);
+void   dg_test_client_bench_report(DG_TEST_CLIENT_BENCH_T*        bench,
+                                   DG_TEST_CLIENT_BENCH_CLIENT_T* client, FILE* out);
+void   dg_test_client_bench_report_stat(const DG_TEST_CLIENT_BENCH_STAT_T* stat, FILE* out);
+void   dg_test_client_bench_merge_stat(DG_TEST_CLIENT_BENCH_STAT_T*       to,
+                                       const DG_TEST_CLIENT_BENCH_STAT_T* from);
+void   dg_test_client_bench_record(DG_TEST_CLIENT_BENCH_STAT_T* stat, UINT64 latency, BOOL ok,
+                                   UINT32 busy);
+UINT64 dg_test_client_bench_get_latency(const DG_TEST_CLIENT_BENCH_STAT_T* stat, double percent);
+int    dg_test_client_bench_bucket(UINT64 value);
+UINT64 dg_test_client_bench_bucket_upper(int bucket);
+UINT64 dg_test_client_bench_now(void);
+void   dg_test_client_bench_sleep_until(UINT64 deadline);
+int    dg_test_client_replay(int argc, char** argv);
+BOOL   dg_test_client_replay_load(DG_TEST_CLIENT_REPLAY_T* replay);
+BOOL   dg_test_client_replay_add_frame(DG_TEST_CLIENT_REPLAY_T* replay,
+                                       DG_CAPTURE_REC_HDR_T* rec_hdr, UINT8* frame);
+void*  dg_test_client_replay_thread(void* p);
+BOOL   dg_test_client_replay_check_rsp(DG_TEST_CLIENT_REPLAY_REQ_T* req, DG_CLIENT_API_RSP_T* rsp);
+void   dg_test_client_replay_report(DG_TEST_CLIENT_REPLAY_T* replay, FILE* out);
+void   dg_test_client_replay_free(DG_TEST_CLIENT_REPLAY_T* replay);
 
 /*==================================================================================================
                                           GLOBAL VARIABLES
@@ -83,6 +254,15 @@ UINT8* dg_test_client_create_random_data(UINT32* diag_req_data_len);
 static int dg_test_client_server_cs = -1;
 static int dg_test_client_timestamp = 0;
 
+/* Operations a benchmark opcode mix can use */
+static const DG_TEST_CLIENT_BENCH_OP_T dg_test_client_bench_ops[] =
+{
+    { "echo",  0x0ffe, TRUE,  0x00000000, 64 }, /* TEST_ENGINE ECHO, ARG is the payload size */
+    { "delay", 0x0ffe, TRUE,  0x00000002, 1  }, /* TEST_ENGINE DELAY, ARG is the delay msec  */
+    { "fixed", 0x0ffe, TRUE,  0x00000004, 64 }, /* TEST_ENGINE FIXED_RSP, ARG is the size    */
+    { "ping",  0x0fff, FALSE, 0,          64 }, /* PING, ARG is the payload size             */
+};
+
 /*==================================================================================================
                                           GLOBAL FUNCTIONS
 ==================================================================================================*/
@@ -109,6 +289,14 @@ int main(int argc, char** argv)
                 }
             }
         }
+        else if (argv[1][0] == 'b')
+        {
+            ret_val = dg_test_client_bench(argc - 1, argv + 1);
+        }
+        else if (argv[1][0] == 'p')
+        {
+            ret_val = dg_test_client_replay(argc - 1, argv + 1);
+        }
         else
         {
             ret_val = dg_test_sub_test(argv[1][0]);
@@ -273,6 +461,17 @@ int dg_test_sub_test(char sub_test)
         }
         break;
 
+    case 'b':
+        if (dg_test_client_bench(0, NULL) == 0)
+        {
+            printf("Benchmark passed!!!\n");
+        }
+        else
+        {
+            printf("Benchmark failed!!!\n");
+        }
+        break;
+
     case '9':
         ret_val = -1;
         break;
@@ -299,6 +498,7 @@ int dg_test_client_menu(void)
     printf("4) Client API Timeout Test\n");
     printf("5) Mass Connection Test\n");
     printf("6) Multiple Aux Engine Test\n");
+    printf("b) Benchmark with the default settings\n");
     printf("9) Exit\n");
     printf("\n");
     printf("Enter your choice: ");
@@ -909,3 +1109,1225 @@ UINT8* dg_test_client_create_random_data(UINT32* diag_req_data_len)
     return req_data;
 }
 
+/*
+ * Benchmark mode: diagd_test b [-c CLIENTS] [-r RATE] [-t SEC] [-w SEC] [-n NUM] [-m MIX]
+ *                             [-l LABEL] [-o FILE]
+ *
+ * Without -r it is a closed loop: each of the CLIENTS connections sends its next request as soon
+ * as the previous response is in. With -r it is an open loop: request i is due at i / RATE
+ * seconds, whichever connection is free sends it, and its latency is counted from the due time,
+ * so a stalled daemon shows up in the latency instead of just slowing the load down.
+ *
+ * MIX is a NAME[/ARG]:WEIGHT list, e.g. echo/64:70,ping/16:20,fixed/512:8,delay/1:2. The
+ * requests are interleaved in smooth weighted round robin, the same sequence on every run.
+ *
+ * The result is one JSON line on stdout, appended to FILE as well with -o.
+ */
+int dg_test_client_bench(int argc, char** argv)
+{
+    static DG_TEST_CLIENT_BENCH_T bench;
+    DG_TEST_CLIENT_BENCH_CLIENT_T* client = NULL;
+    FILE*                          out;
+    UINT32                         index;
+    UINT32                         started = 0;
+    int                            opt;
+    int                            ret_val = 0;
+
+    memset(&bench, 0, sizeof(bench));
+    bench.label    = "";
+    bench.mix_str  = DG_TEST_CLIENT_BENCH_DEFAULT_MIX;
+    bench.clients  = 4;
+    bench.duration = 5;
+
+    optind = 1;
+    while ((argc > 1) && ((opt = getopt(argc, argv, "c:r:t:w:n:m:l:o:")) != -1))
+    {
+        switch (opt)
+        {
+        case 'c':
+            bench.clients = strtoul(optarg, NULL, 0);
+            break;
+
+        case 'r':
+            bench.rate = strtod(optarg, NULL);
+            break;
+
+        case 't':
+            bench.duration = strtod(optarg, NULL);
+            break;
+
+        case 'w':
+            bench.warmup = strtod(optarg, NULL);
+            break;
+
+        case 'n':
+            bench.num = strtoull(optarg, NULL, 0);
+            break;
+
+        case 'm':
+            bench.mix_str = optarg;
+            break;
+
+        case 'l':
+            bench.label = optarg;
+            break;
+
+        case 'o':
+            bench.out_file = optarg;
+            break;
+
+        default:
+            fprintf(stderr, "usage: diagd_test b [-c CLIENTS] [-r RATE] [-t SEC] [-w SEC] "
+                    "[-n NUM] [-m MIX] [-l LABEL] [-o FILE]\n");
+            return -1;
+        }
+    }
+
+    if ((bench.clients == 0) || (bench.clients > DG_TEST_CLIENT_BENCH_CLIENTS_MAX))
+    {
+        fprintf(stderr, "Error: Invalid number of clients %d\n", bench.clients);
+        ret_val = -1;
+    }
+    else if ((bench.rate < 0) || (bench.duration <= 0) || (bench.warmup < 0))
+    {
+        fprintf(stderr, "Error: Invalid rate, duration or warmup\n");
+        ret_val = -1;
+    }
+    else if (!dg_test_client_bench_parse_mix(&bench, bench.mix_str))
+    {
+        ret_val = -1;
+    }
+    else if ((client = (DG_TEST_CLIENT_BENCH_CLIENT_T*)calloc(bench.clients,
+                                                              sizeof(*client))) == NULL)
+    {
+        fprintf(stderr, "Error: Failed to allocate %d clients\n", bench.clients);
+        ret_val = -1;
+    }
+    else
+    {
+        dg_test_client_bench_build_seq(&bench);
+
+        bench.start   = dg_test_client_bench_now();
+        bench.measure = bench.start + (UINT64)(bench.warmup * DG_TEST_CLIENT_BENCH_NS_PER_SEC);
+        bench.end     = bench.measure + (UINT64)(bench.duration * DG_TEST_CLIENT_BENCH_NS_PER_SEC);
+
+        for (index = 0; index < bench.clients; index++)
+        {
+            client[index].bench = &bench;
+            client[index].id    = index;
+            client[index].seed  = (unsigned int)(bench.start ^ (index << 16));
+            if (pthread_create(&client[index].thread, NULL, dg_test_client_bench_thread,
+                               &client[index]) != 0)
+            {
+                fprintf(stderr, "Error: Error creating client thread #%d\n", index);
+                ret_val = -1;
+                /* stop the started clients */
+                bench.end = 0;
+                break;
+            }
+            started++;
+        }
+
+        for (index = 0; index < started; index++)
+        {
+            pthread_join(client[index].thread, NULL);
+            if (client[index].connect_fail)
+            {
+                fprintf(stderr, "Error: Client #%d failed to connect\n", index);
+                ret_val = -1;
+            }
+        }
+
+        if (ret_val == 0)
+        {
+            dg_test_client_bench_report(&bench, client, stdout);
+
+            if (bench.out_file != NULL)
+            {
+                if ((out = fopen(bench.out_file, "a")) == NULL)
+                {
+                    fprintf(stderr, "Error: Failed to open %s: %s\n",
+                            bench.out_file, strerror(errno));
+                    ret_val = -1;
+                }
+                else
+                {
+                    dg_test_client_bench_report(&bench, client, out);
+                    fclose(out);
+                }
+            }
+
+            for (index = 0; index < bench.clients; index++)
+            {
+                for (opt = 0; opt < bench.mix_num; opt++)
+                {
+                    if (client[index].stat[opt].errors > 0)
+                    {
+                        ret_val = -1;
+                    }
+                }
+            }
+        }
+
+        free(client);
+    }
+
+    for (opt = 0; opt < bench.mix_num; opt++)
+    {
+        free(bench.mix[opt].req_data);
+    }
+
+    return ret_val;
+}
+
+BOOL dg_test_client_bench_parse_mix(DG_TEST_CLIENT_BENCH_T* bench, const char* mix_str)
+{
+    char                        entry[64];
+    const char*                 cur = mix_str;
+    const char*                 comma;
+    char*                       arg;
+    char*                       weight;
+    DG_TEST_CLIENT_BENCH_MIX_T* mix;
+    UINT32                      total = 0;
+    size_t                      len;
+    size_t                      op_i;
+
+    while (*cur != '\0')
+    {
+        comma = strchr(cur, ',');
+        len   = (comma != NULL) ? (size_t)(comma - cur) : strlen(cur);
+
+        if ((len == 0) || (len >= sizeof(entry)) ||
+            (bench->mix_num >= DG_TEST_CLIENT_BENCH_MIX_MAX))
+        {
+            fprintf(stderr, "Error: Invalid opcode mix \"%s\"\n", mix_str);
+            return FALSE;
+        }
+
+        memcpy(entry, cur, len);
+        entry[len] = '\0';
+        cur       += (comma != NULL) ? (len + 1) : len;
+
+        mix = &bench->mix[bench->mix_num];
+
+        weight = strchr(entry, ':');
+        if (weight != NULL)
+        {
+            *weight++ = '\0';
+        }
+        arg = strchr(entry, '/');
+        if (arg != NULL)
+        {
+            *arg++ = '\0';
+        }
+
+        mix->op = NULL;
+        for (op_i = 0;
+             op_i < sizeof(dg_test_client_bench_ops) / sizeof(dg_test_client_bench_ops[0]); op_i++)
+        {
+            if (strcmp(entry, dg_test_client_bench_ops[op_i].name) == 0)
+            {
+                mix->op = &dg_test_client_bench_ops[op_i];
+            }
+        }
+
+        if (mix->op == NULL)
+        {
+            fprintf(stderr, "Error: Unknown operation \"%s\", use echo, delay, fixed or ping\n",
+                    entry);
+            return FALSE;
+        }
+
+        mix->arg    = (arg != NULL) ? strtoul(arg, NULL, 0) : mix->op->default_arg;
+        mix->weight = (weight != NULL) ? strtoul(weight, NULL, 0) : 1;
+        total      += mix->weight;
+
+        if ((mix->weight == 0) || (total > DG_TEST_CLIENT_BENCH_SEQ_MAX) ||
+            !dg_test_client_bench_build_req(mix))
+        {
+            fprintf(stderr, "Error: Invalid opcode mix entry \"%s\"\n", entry);
+            return FALSE;
+        }
+
+        bench->mix_num++;
+    }
+
+    if (bench->mix_num == 0)
+    {
+        fprintf(stderr, "Error: Empty opcode mix\n");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOL dg_test_client_bench_build_req(DG_TEST_CLIENT_BENCH_MIX_T* mix)
+{
+    UINT32 action = htonl(mix->op->action);
+    UINT32 arg    = htonl(mix->arg);
+    UINT32 index;
+
+    mix->req_len = mix->op->has_action ? sizeof(action) : 0;
+
+    if (mix->op->action == 0x00000002)
+    {
+        /* DELAY, the delay is the request payload and there is no response data */
+        mix->req_len += sizeof(arg);
+        mix->rsp_len  = 0;
+    }
+    else if (mix->op->action == 0x00000004)
+    {
+        /* FIXED_RSP, the response size is the request payload */
+        mix->req_len += sizeof(arg);
+        mix->rsp_len  = mix->arg;
+    }
+    else
+    {
+        /* ECHO and PING, the payload comes back */
+        mix->req_len += mix->arg;
+        mix->rsp_len  = mix->arg;
+    }
+
+    if (mix->rsp_len > DG_TEST_CLIENT_BENCH_DATA_MAX)
+    {
+        return FALSE;
+    }
+
+    /* one extra byte so an empty request still has a buffer */
+    if ((mix->req_data = (UINT8*)malloc(mix->req_len + 1)) == NULL)
+    {
+        return FALSE;
+    }
+
+    index = 0;
+    if (mix->op->has_action)
+    {
+        memcpy(mix->req_data, &action, sizeof(action));
+        index += sizeof(action);
+    }
+
+    if ((mix->op->action == 0x00000002) || (mix->op->action == 0x00000004))
+    {
+        memcpy(mix->req_data + index, &arg, sizeof(arg));
+    }
+    else
+    {
+        for (; index < mix->req_len; index++)
+        {
+            mix->req_data[index] = (UINT8)index;
+        }
+    }
+
+    return TRUE;
+}
+
+void dg_test_client_bench_build_seq(DG_TEST_CLIENT_BENCH_T* bench)
+{
+    int current[DG_TEST_CLIENT_BENCH_MIX_MAX] = { 0 };
+    int total = 0;
+    int best;
+    int i;
+
+    for (i = 0; i < bench->mix_num; i++)
+    {
+        total += bench->mix[i].weight;
+    }
+
+    /* smooth weighted round robin, 7:2:1 gives a mixed sequence rather than runs */
+    for (bench->seq_num = 0; bench->seq_num < total; bench->seq_num++)
+    {
+        best = 0;
+        for (i = 0; i < bench->mix_num; i++)
+        {
+            current[i] += bench->mix[i].weight;
+            if (current[i] > current[best])
+            {
+                best = i;
+            }
+        }
+        current[best]             -= total;
+        bench->seq[bench->seq_num] = (UINT8)best;
+    }
+}
+
+void* dg_test_client_bench_thread(void* p)
+{
+    DG_TEST_CLIENT_BENCH_CLIENT_T* client = (DG_TEST_CLIENT_BENCH_CLIENT_T*)p;
+    DG_TEST_CLIENT_BENCH_T*        bench  = client->bench;
+    DG_TEST_CLIENT_BENCH_MIX_T*    mix;
+    UINT64                         index;
+    UINT64                         begin;
+    UINT64                         done;
+    BOOL                           sent;
+    BOOL                           ok;
+    UINT32                         busy;
+    UINT32                         backoff_ms;
+    UINT32                         delay_ms;
+    int                            diag_cs;
+
+    DG_CLIENT_API_REQ_T  diag_req;
+    DG_CLIENT_API_RSP_T* diag_rsp;
+
+    if ((diag_cs = DG_CLIENT_API_connect_to_server(NULL)) < 0)
+    {
+        client->connect_fail = 1;
+        return NULL;
+    }
+
+    while (1)
+    {
+        index = __atomic_fetch_add(&bench->next, 1, __ATOMIC_RELAXED);
+        if ((bench->num > 0) && (index >= bench->num))
+        {
+            break;
+        }
+
+        if (bench->rate > 0)
+        {
+            /* open loop, the request is due at its slot whether or not a client was free */
+            begin = bench->start + (UINT64)(index * DG_TEST_CLIENT_BENCH_NS_PER_SEC / bench->rate);
+            if (begin >= bench->end)
+            {
+                break;
+            }
+            dg_test_client_bench_sleep_until(begin);
+        }
+        else
+        {
+            begin = dg_test_client_bench_now();
+            if (begin >= bench->end)
+            {
+                break;
+            }
+        }
+
+        mix = &bench->mix[bench->seq[index % bench->seq_num]];
+
+        /* the aux engines match responses by opcode and the low byte of the time stamp, a
+           client has one request outstanding, so the client id keeps them apart */
+        diag_req.opcode    = mix->op->opcode;
+        diag_req.timestamp = (UINT16)client->id;
+        diag_req.data_len  = mix->req_len;
+        diag_req.data_ptr  = mix->req_data;
+
+        ok         = FALSE;
+        busy       = 0;
+        backoff_ms = 0;
+        while ((sent = DG_CLIENT_API_send_diag_req(diag_cs, &diag_req)))
+        {
+            diag_rsp = DG_CLIENT_API_recv_diag_rsp(diag_cs, &diag_req, FALSE,
+                                                   DG_TEST_CLIENT_BENCH_RSP_TIMEOUT);
+            if (diag_rsp == NULL)
+            {
+                break;
+            }
+
+            /* a busy engine is load shedding, not a failure, the retries are in the latency
+               until the response timeout, then the last busy response fails the request */
+            delay_ms = DG_CLIENT_API_busy_delay(diag_rsp, &backoff_ms, &client->seed);
+            if ((delay_ms == 0) ||
+                (dg_test_client_bench_now() + delay_ms * DG_TEST_CLIENT_BENCH_NS_PER_MSEC >
+                 begin + DG_TEST_CLIENT_BENCH_RSP_TIMEOUT * DG_TEST_CLIENT_BENCH_NS_PER_MSEC))
+            {
+                ok = dg_test_client_bench_check_rsp(mix, diag_rsp);
+                DG_CLIENT_API_diag_rsp_free(diag_rsp);
+                break;
+            }
+
+            DG_CLIENT_API_diag_rsp_free(diag_rsp);
+            busy++;
+            dg_test_client_bench_sleep_until(dg_test_client_bench_now() +
+                                             delay_ms * DG_TEST_CLIENT_BENCH_NS_PER_MSEC);
+        }
+        done = dg_test_client_bench_now();
+
+        /* requests started in the warmup are not measured */
+        if (begin >= bench->measure)
+        {
+            dg_test_client_bench_record(&client->stat[mix - bench->mix], done - begin, ok, busy);
+            client->last_done = done;
+        }
+
+        if (!sent)
+        {
+            /* the daemon is gone, this client is done */
+            break;
+        }
+        else if (!ok)
+        {
+            /* the connection may be out of sync, start over */
+            DG_CLIENT_API_disconnect_from_server(diag_cs);
+            if ((diag_cs = DG_CLIENT_API_connect_to_server(NULL)) < 0)
+            {
+                client->connect_fail = 1;
+                return NULL;
+            }
+        }
+    }
+
+    DG_CLIENT_API_disconnect_from_server(diag_cs);
+    return NULL;
+}
+
+BOOL dg_test_client_bench_check_rsp(DG_TEST_CLIENT_BENCH_MIX_T* mix, DG_CLIENT_API_RSP_T* rsp)
+{
+    UINT32 offset = mix->op->has_action ? sizeof(UINT32) : 0;
+    UINT32 aux_id = 0;
+
+    /* +1 for aux id when PING is answered by an aux engine */
+    if (!mix->op->has_action && (rsp->data_len == mix->rsp_len + 1))
+    {
+        aux_id = 1;
+    }
+
+    if (rsp->is_fail || (rsp->data_len != mix->rsp_len + aux_id))
+    {
+        return FALSE;
+    }
+
+    /* ECHO and PING carry the request payload back */
+    if ((mix->op->action != 0x00000002) && (mix->op->action != 0x00000004) &&
+        (memcmp(rsp->data_ptr + aux_id, mix->req_data + offset, mix->rsp_len) != 0))
+    {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void dg_test_client_bench_report(DG_TEST_CLIENT_BENCH_T*        bench,
+                                 DG_TEST_CLIENT_BENCH_CLIENT_T* client, FILE* out)
+{
+    static DG_TEST_CLIENT_BENCH_STAT_T total;
+    static DG_TEST_CLIENT_BENCH_STAT_T entry;
+    UINT64                             last_done = bench->measure;
+    double                             elapsed;
+    UINT32                             index;
+    int                                mix_i;
+
+    memset(&total, 0, sizeof(total));
+    for (index = 0; index < bench->clients; index++)
+    {
+        for (mix_i = 0; mix_i < bench->mix_num; mix_i++)
+        {
+            dg_test_client_bench_merge_stat(&total, &client[index].stat[mix_i]);
+        }
+        if (client[index].last_done > last_done)
+        {
+            last_done = client[index].last_done;
+        }
+    }
+
+    elapsed = (double)(last_done - bench->measure) / DG_TEST_CLIENT_BENCH_NS_PER_SEC;
+
+    fprintf(out, "{\"label\":\"%s\",\"model\":\"%s\",\"clients\":%u,\"rate\":%.1f,"
+            "\"warmup_s\":%.3f,\"elapsed_s\":%.3f,\"mix\":\"%s\",",
+            bench->label, (bench->rate > 0) ? "open" : "closed", bench->clients, bench->rate,
+            bench->warmup, elapsed, bench->mix_str);
+    fprintf(out, "\"throughput_rps\":%.1f,",
+            (elapsed > 0) ? (total.requests - total.errors) / elapsed : 0.0);
+    dg_test_client_bench_report_stat(&total, out);
+
+    fprintf(out, ",\"ops\":[");
+    for (mix_i = 0; mix_i < bench->mix_num; mix_i++)
+    {
+        memset(&entry, 0, sizeof(entry));
+        for (index = 0; index < bench->clients; index++)
+        {
+            dg_test_client_bench_merge_stat(&entry, &client[index].stat[mix_i]);
+        }
+
+        fprintf(out, "%s{\"op\":\"%s\",\"opcode\":\"0x%04x\",\"arg\":%u,\"weight\":%u,",
+                (mix_i > 0) ? "," : "", bench->mix[mix_i].op->name,
+                bench->mix[mix_i].op->opcode, bench->mix[mix_i].arg, bench->mix[mix_i].weight);
+        dg_test_client_bench_report_stat(&entry, out);
+        fprintf(out, "}");
+    }
+    fprintf(out, "]}\n");
+    fflush(out);
+}
+
+void dg_test_client_bench_report_stat(const DG_TEST_CLIENT_BENCH_STAT_T* stat, FILE* out)
+{
+    UINT64 ok = stat->requests - stat->errors;
+
+    fprintf(out, "\"requests\":%llu,\"errors\":%llu,\"busy\":%llu,\"latency_us\":{\"min\":%.1f,"
+            "\"mean\":%.1f,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f}",
+            (unsigned long long)stat->requests, (unsigned long long)stat->errors,
+            (unsigned long long)stat->busy,
+            stat->lat_min / 1000.0, (ok > 0) ? (double)stat->lat_sum / ok / 1000.0 : 0.0,
+            dg_test_client_bench_get_latency(stat, 50) / 1000.0,
+            dg_test_client_bench_get_latency(stat, 90) / 1000.0,
+            dg_test_client_bench_get_latency(stat, 99) / 1000.0,
+            dg_test_client_bench_get_latency(stat, 99.9) / 1000.0,
+            stat->lat_max / 1000.0);
+}
+
+void dg_test_client_bench_merge_stat(DG_TEST_CLIENT_BENCH_STAT_T*       to,
+                                     const DG_TEST_CLIENT_BENCH_STAT_T* from)
+{
+    int bucket;
+
+    if (from->requests - from->errors > 0)
+    {
+        if ((to->requests - to->errors == 0) || (from->lat_min < to->lat_min))
+        {
+            to->lat_min = from->lat_min;
+        }
+        if (from->lat_max > to->lat_max)
+        {
+            to->lat_max = from->lat_max;
+        }
+    }
+
+    to->requests += from->requests;
+    to->errors   += from->errors;
+    to->busy     += from->busy;
+    to->lat_sum  += from->lat_sum;
+
+    for (bucket = 0; bucket < DG_TEST_CLIENT_BENCH_HIST_NUM; bucket++)
+    {
+        to->hist[bucket] += from->hist[bucket];
+    }
+}
+
+void dg_test_client_bench_record(DG_TEST_CLIENT_BENCH_STAT_T* stat, UINT64 latency, BOOL ok,
+                                 UINT32 busy)
+{
+    stat->requests++;
+    stat->busy += busy;
+
+    /* failed requests are counted, but their latency would hide the timeouts in the tail */
+    if (!ok)
+    {
+        stat->errors++;
+        return;
+    }
+
+    if ((stat->requests - stat->errors == 1) || (latency < stat->lat_min))
+    {
+        stat->lat_min = latency;
+    }
+    if (latency > stat->lat_max)
+    {
+        stat->lat_max = latency;
+    }
+    stat->lat_sum += latency;
+    stat->hist[dg_test_client_bench_bucket(latency)]++;
+}
+
+/* the percentile is the upper bound of its bucket, at most 1/16 above the sample */
+UINT64 dg_test_client_bench_get_latency(const DG_TEST_CLIENT_BENCH_STAT_T* stat, double percent)
+{
+    UINT64 total = stat->requests - stat->errors;
+    UINT64 count = 0;
+    UINT64 latency;
+    double target;
+    int    bucket;
+
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    target = total * percent / 100;
+
+    for (bucket = 0; bucket < DG_TEST_CLIENT_BENCH_HIST_NUM - 1; bucket++)
+    {
+        count += stat->hist[bucket];
+        if ((count > 0) && (count >= target))
+        {
+            break;
+        }
+    }
+
+    latency = dg_test_client_bench_bucket_upper(bucket);
+
+    return (latency > stat->lat_max) ? stat->lat_max : latency;
+}
+
+/* DG_TEST_CLIENT_BENCH_HIST_SUB buckets in each power of two */
+int dg_test_client_bench_bucket(UINT64 value)
+{
+    int msb;
+    int bucket;
+
+    if (value < DG_TEST_CLIENT_BENCH_HIST_SUB)
+    {
+        return (int)value;
+    }
+
+    /* the power of two, then the next 4 bits below the MSB */
+    msb    = 63 - __builtin_clzll(value);
+    bucket = (msb - 3) * DG_TEST_CLIENT_BENCH_HIST_SUB + (int)((value >> (msb - 4)) & 0xf);
+
+    return (bucket < DG_TEST_CLIENT_BENCH_HIST_NUM) ? bucket : (DG_TEST_CLIENT_BENCH_HIST_NUM - 1);
+}
+
+UINT64 dg_test_client_bench_bucket_upper(int bucket)
+{
+    int msb;
+    int sub;
+
+    if (bucket < DG_TEST_CLIENT_BENCH_HIST_SUB)
+    {
+        return (UINT64)bucket + 1;
+    }
+
+    msb = bucket / DG_TEST_CLIENT_BENCH_HIST_SUB + 3;
+    sub = bucket % DG_TEST_CLIENT_BENCH_HIST_SUB;
+
+    return (UINT64)(DG_TEST_CLIENT_BENCH_HIST_SUB + sub + 1) << (msb - 4);
+}
+
+UINT64 dg_test_client_bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UINT64)ts.tv_sec * DG_TEST_CLIENT_BENCH_NS_PER_SEC + ts.tv_nsec;
+}
+
+void dg_test_client_bench_sleep_until(UINT64 deadline)
+{
+    struct timespec ts;
+
+    ts.tv_sec  = deadline / DG_TEST_CLIENT_BENCH_NS_PER_SEC;
+    ts.tv_nsec = deadline % DG_TEST_CLIENT_BENCH_NS_PER_SEC;
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+    }
+}
+
+/*
+ * diagd_test p [-a] [-l LABEL] [-o FILE] CAPTURE
+ *
+ * Replays a capture taken with the CAPTURE_CTRL command against the running daemon. Every
+ * captured client gets its own thread and connection and sends its requests in the captured
+ * order, at the captured pace, or back to back with -a.
+ *
+ * Each response is compared with the captured one, the rsp_code and the captured bytes of the
+ * data must be the same. The captured latency is the time the daemon took from reading the
+ * request to writing the response, the replayed one also includes the client side, so a
+ * replay against the same build is a little slower than its capture.
+ *
+ * The result is one JSON line on stdout, appended to FILE as well with -o.
+ */
+int dg_test_client_replay(int argc, char** argv)
+{
+    static DG_TEST_CLIENT_REPLAY_T  replay;
+    DG_TEST_CLIENT_REPLAY_CLIENT_T* client;
+    FILE*                           out;
+    UINT32                          index;
+    UINT32                          started = 0;
+    int                             opt;
+    int                             ret_val = 0;
+
+    memset(&replay, 0, sizeof(replay));
+    replay.label = "";
+
+    optind = 1;
+    while ((argc > 1) && ((opt = getopt(argc, argv, "al:o:")) != -1))
+    {
+        switch (opt)
+        {
+        case 'a':
+            replay.fast = TRUE;
+            break;
+
+        case 'l':
+            replay.label = optarg;
+            break;
+
+        case 'o':
+            replay.out_file = optarg;
+            break;
+
+        default:
+            optind = argc;
+            break;
+        }
+    }
+
+    if (optind != argc - 1)
+    {
+        fprintf(stderr, "usage: diagd_test p [-a] [-l LABEL] [-o FILE] CAPTURE\n");
+        return -1;
+    }
+    replay.file = argv[optind];
+
+    if (!dg_test_client_replay_load(&replay))
+    {
+        ret_val = -1;
+    }
+    else
+    {
+        replay.start = dg_test_client_bench_now();
+
+        for (index = 0; index < replay.clients; index++)
+        {
+            client = &replay.client[index];
+            client->stat = (DG_TEST_CLIENT_REPLAY_STAT_T*)calloc(replay.op_num,
+                                                                 sizeof(*client->stat));
+            if (client->stat == NULL)
+            {
+                fprintf(stderr, "Error: Failed to allocate the statistics\n");
+                ret_val = -1;
+                break;
+            }
+            if (pthread_create(&client->thread, NULL, dg_test_client_replay_thread, client) != 0)
+            {
+                fprintf(stderr, "Error: Error creating client thread #%d\n", index);
+                ret_val = -1;
+                break;
+            }
+            started++;
+        }
+
+        for (index = 0; index < started; index++)
+        {
+            pthread_join(replay.client[index].thread, NULL);
+            if (replay.client[index].connect_fail)
+            {
+                fprintf(stderr, "Error: Client %d failed to connect\n", replay.client[index].id);
+                ret_val = -1;
+            }
+        }
+
+        if (ret_val == 0)
+        {
+            dg_test_client_replay_report(&replay, stdout);
+
+            if (replay.out_file != NULL)
+            {
+                if ((out = fopen(replay.out_file, "a")) == NULL)
+                {
+                    fprintf(stderr, "Error: Failed to open %s: %s\n",
+                            replay.out_file, strerror(errno));
+                    ret_val = -1;
+                }
+                else
+                {
+                    dg_test_client_replay_report(&replay, out);
+                    fclose(out);
+                }
+            }
+
+            for (index = 0; index < replay.clients; index++)
+            {
+                for (opt = 0; opt < replay.op_num; opt++)
+                {
+                    if ((replay.client[index].stat[opt].stat.errors > 0) ||
+                        (replay.client[index].stat[opt].mismatches > 0))
+                    {
+                        ret_val = -1;
+                    }
+                }
+            }
+        }
+    }
+
+    dg_test_client_replay_free(&replay);
+
+    return ret_val;
+}
+
+BOOL dg_test_client_replay_load(DG_TEST_CLIENT_REPLAY_T* replay)
+{
+    DG_CAPTURE_FILE_HDR_T file_hdr;
+    DG_CAPTURE_REC_HDR_T  rec_hdr;
+    UINT8*                frame;
+    FILE*                 in;
+    BOOL                  ret = TRUE;
+
+    if ((in = fopen(replay->file, "r")) == NULL)
+    {
+        fprintf(stderr, "Error: Failed to open %s: %s\n", replay->file, strerror(errno));
+        return FALSE;
+    }
+
+    if ((fread(&file_hdr, sizeof(file_hdr), 1, in) != 1) ||
+        (ntohl(file_hdr.magic) != DG_CAPTURE_MAGIC) ||
+        (ntohs(file_hdr.version) != DG_CAPTURE_VERSION))
+    {
+        fprintf(stderr, "Error: %s is not a DIAG capture\n", replay->file);
+        ret = FALSE;
+    }
+
+    while (ret && (fread(&rec_hdr, sizeof(rec_hdr), 1, in) == 1))
+    {
+        rec_hdr.time_sec  = ntohl(rec_hdr.time_sec);
+        rec_hdr.time_nsec = ntohl(rec_hdr.time_nsec);
+        rec_hdr.client    = ntohs(rec_hdr.client);
+        rec_hdr.cap_len   = ntohl(rec_hdr.cap_len);
+
+        if ((frame = (UINT8*)malloc(rec_hdr.cap_len)) == NULL)
+        {
+            fprintf(stderr, "Error: Failed to allocate a frame of %u bytes\n", rec_hdr.cap_len);
+            ret = FALSE;
+        }
+        else if (fread(frame, 1, rec_hdr.cap_len, in) != rec_hdr.cap_len)
+        {
+            /* the daemon was killed in the middle of writing the capture */
+            fprintf(stderr, "Warning: %s is truncated\n", replay->file);
+            free(frame);
+            break;
+        }
+        else if (!dg_test_client_replay_add_frame(replay, &rec_hdr, frame))
+        {
+            ret = FALSE;
+        }
+    }
+
+    fclose(in);
+
+    if (ret && (replay->requests == 0))
+    {
+        fprintf(stderr, "Error: No request to replay in %s\n", replay->file);
+        ret = FALSE;
+    }
+
+    return ret;
+}
+
+/* the frame is owned by the replay from here on, even when FALSE is returned */
+BOOL dg_test_client_replay_add_frame(DG_TEST_CLIENT_REPLAY_T* replay,
+                                     DG_CAPTURE_REC_HDR_T* rec_hdr, UINT8* frame)
+{
+    DG_TEST_CLIENT_REPLAY_CLIENT_T* client = NULL;
+    DG_TEST_CLIENT_REPLAY_REQ_T*    req;
+    DG_DEFS_DIAG_REQ_HDR_T          req_hdr;
+    DG_DEFS_DIAG_RSP_HDR_T          rsp_hdr;
+    UINT64                          time;
+    UINT32                          index;
+    int                             op;
+
+    time = (UINT64)rec_hdr->time_sec * DG_TEST_CLIENT_BENCH_NS_PER_SEC + rec_hdr->time_nsec;
+    if (time > replay->last)
+    {
+        replay->last = time;
+    }
+
+    for (index = 0; index < replay->clients; index++)
+    {
+        if (replay->client[index].id == rec_hdr->client)
+        {
+            client = &replay->client[index];
+            break;
+        }
+    }
+
+    if (rec_hdr->dir == DG_CAPTURE_DIR_REQ)
+    {
+        if (client == NULL)
+        {
+            if (replay->clients == DG_TEST_CLIENT_BENCH_CLIENTS_MAX)
+            {
+                fprintf(stderr, "Error: More than %d clients in the capture\n",
+                        DG_TEST_CLIENT_BENCH_CLIENTS_MAX);
+                free(frame);
+                return FALSE;
+            }
+            client          = &replay->client[replay->clients++];
+            client->replay  = replay;
+            client->id      = rec_hdr->client;
+            client->pending = -1;
+        }
+        client->pending = -1;
+
+        if (rec_hdr->cap_len >= sizeof(req_hdr))
+        {
+            memcpy(&req_hdr, frame, sizeof(req_hdr));
+        }
+
+        /* a request cut by the snap length can't be sent again */
+        if ((rec_hdr->cap_len < sizeof(req_hdr)) ||
+            (rec_hdr->cap_len - sizeof(req_hdr) < ntohl(req_hdr.length)) ||
+            (ntohs(req_hdr.opcode) == DG_TEST_CLIENT_REPLAY_CTRL_OPCODE) ||
+            (ntohs(req_hdr.opcode) == DG_SHM_OPCODE))
+        {
+            replay->skipped++;
+            free(frame);
+            return TRUE;
+        }
+
+        for (op = 0; op < replay->op_num; op++)
+        {
+            if (replay->opcode[op] == ntohs(req_hdr.opcode))
+            {
+                break;
+            }
+        }
+        if (op == replay->op_num)
+        {
+            if (replay->op_num == DG_TEST_CLIENT_REPLAY_OPS_MAX)
+            {
+                fprintf(stderr, "Error: More than %d opcodes in the capture\n",
+                        DG_TEST_CLIENT_REPLAY_OPS_MAX);
+                free(frame);
+                return FALSE;
+            }
+            replay->opcode[replay->op_num++] = ntohs(req_hdr.opcode);
+        }
+
+        if (client->req_num == client->req_max)
+        {
+            client->req_max = (client->req_max == 0) ? 64 : client->req_max * 2;
+            req = (DG_TEST_CLIENT_REPLAY_REQ_T*)realloc(client->req,
+                                                        client->req_max * sizeof(*req));
+            if (req == NULL)
+            {
+                fprintf(stderr, "Error: Failed to allocate %u requests\n", client->req_max);
+                free(frame);
+                return FALSE;
+            }
+            client->req = req;
+        }
+
+        if (replay->requests++ == 0)
+        {
+            replay->first = time;
+        }
+
+        req = &client->req[client->req_num];
+        memset(req, 0, sizeof(*req));
+        req->time     = time;
+        req->opcode   = ntohs(req_hdr.opcode);
+        req->seq_tag  = ntohs(req_hdr.seq_tag);
+        req->op       = op;
+        req->data_len = ntohl(req_hdr.length);
+        req->data     = frame + sizeof(req_hdr);
+        req->frame    = frame;
+
+        client->pending = client->req_num++;
+    }
+    else
+    {
+        /* a connection handles one request at a time, so a response is for the last request
+           of its client, the rest is unsolicited or for a request which is not replayed */
+        req = NULL;
+        if ((client != NULL) && (client->pending >= 0) && (rec_hdr->cap_len >= sizeof(rsp_hdr)))
+        {
+            memcpy(&rsp_hdr, frame, sizeof(rsp_hdr));
+            req = &client->req[client->pending];
+            if ((rsp_hdr.unsol_rsp_flag != 0) || (ntohs(rsp_hdr.opcode) != req->opcode) ||
+                (ntohs(rsp_hdr.seq_tag) != req->seq_tag))
+            {
+                req = NULL;
+            }
+        }
+
+        if (req == NULL)
+        {
+            free(frame);
+        }
+        else
+        {
+            req->has_rsp     = TRUE;
+            req->rsp_time    = time;
+            req->rsp_code    = rsp_hdr.rsp_code;
+            req->rsp_len     = ntohl(rsp_hdr.length);
+            req->rsp_cap_len = rec_hdr->cap_len - sizeof(rsp_hdr);
+            req->rsp_data    = frame + sizeof(rsp_hdr);
+            req->rsp_frame   = frame;
+
+            client->pending = -1;
+            dg_test_client_bench_record(&replay->captured[req->op],
+                                        (time > req->time) ? (time - req->time) : 0, TRUE, 0);
+        }
+    }
+
+    return TRUE;
+}
+
+void* dg_test_client_replay_thread(void* p)
+{
+    DG_TEST_CLIENT_REPLAY_CLIENT_T* client = (DG_TEST_CLIENT_REPLAY_CLIENT_T*)p;
+    DG_TEST_CLIENT_REPLAY_T*        replay = client->replay;
+    DG_TEST_CLIENT_REPLAY_REQ_T*    req;
+    UINT32                          index;
+    UINT64                          begin;
+    BOOL                            sent;
+    BOOL                            ok;
+    int                             diag_cs;
+
+    DG_CLIENT_API_REQ_T  diag_req;
+    DG_CLIENT_API_RSP_T* diag_rsp;
+
+    if ((diag_cs = DG_CLIENT_API_connect_to_server(NULL)) < 0)
+    {
+        client->connect_fail = 1;
+        return NULL;
+    }
+
+    for (index = 0; index < client->req_num; index++)
+    {
+        req = &client->req[index];
+
+        if (!replay->fast)
+        {
+            /* a request the daemon is late for is sent right away */
+            dg_test_client_bench_sleep_until(replay->start + (req->time - replay->first));
+        }
+
+        /* the captured sequence tag keeps the aux engine matching as it was */
+        diag_req.opcode    = req->opcode;
+        diag_req.timestamp = req->seq_tag;
+        diag_req.data_len  = req->data_len;
+        diag_req.data_ptr  = req->data;
+
+        ok       = FALSE;
+        diag_rsp = NULL;
+        begin    = dg_test_client_bench_now();
+        sent     = DG_CLIENT_API_send_diag_req(diag_cs, &diag_req);
+        if (sent)
+        {
+            diag_rsp = DG_CLIENT_API_recv_diag_rsp(diag_cs, &diag_req, FALSE,
+                                                   DG_TEST_CLIENT_BENCH_RSP_TIMEOUT);
+        }
+        client->last_done = dg_test_client_bench_now();
+
+        if (diag_rsp != NULL)
+        {
+            ok = TRUE;
+            if (!dg_test_client_replay_check_rsp(req, diag_rsp))
+            {
+                client->stat[req->op].mismatches++;
+            }
+            DG_CLIENT_API_diag_rsp_free(diag_rsp);
+        }
+        dg_test_client_bench_record(&client->stat[req->op].stat, client->last_done - begin, ok,
+                                    0);
+
+        if (!sent)
+        {
+            /* the daemon is gone, this client is done */
+            break;
+        }
+        else if (!ok)
+        {
+            /* the connection may be out of sync, start over */
+            DG_CLIENT_API_disconnect_from_server(diag_cs);
+            if ((diag_cs = DG_CLIENT_API_connect_to_server(NULL)) < 0)
+            {
+                client->connect_fail = 1;
+                return NULL;
+            }
+        }
+    }
+
+    DG_CLIENT_API_disconnect_from_server(diag_cs);
+    return NULL;
+}
+
+BOOL dg_test_client_replay_check_rsp(DG_TEST_CLIENT_REPLAY_REQ_T* req, DG_CLIENT_API_RSP_T* rsp)
+{
+    /* nothing to compare with if the response was not captured */
+    if (!req->has_rsp)
+    {
+        return TRUE;
+    }
+
+    if ((rsp->rsp_code != req->rsp_code) || (rsp->data_len != req->rsp_len) ||
+        (memcmp(rsp->data_ptr, req->rsp_data, req->rsp_cap_len) != 0))
+    {
+        TRACE("Replayed response of opcode 0x%04x differs from the capture, rsp_code %d/%d, "
+              "length %u/%u", req->opcode, rsp->rsp_code, req->rsp_code, rsp->data_len,
+              req->rsp_len);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void dg_test_client_replay_report(DG_TEST_CLIENT_REPLAY_T* replay, FILE* out)
+{
+    static DG_TEST_CLIENT_BENCH_STAT_T total;
+    static DG_TEST_CLIENT_BENCH_STAT_T entry;
+    UINT64                             last_done   = replay->start;
+    UINT64                             mismatches  = 0;
+    UINT64                             op_mismatch;
+    UINT32                             index;
+    int                                op;
+
+    for (index = 0; index < replay->clients; index++)
+    {
+        if (replay->client[index].last_done > last_done)
+        {
+            last_done = replay->client[index].last_done;
+        }
+        for (op = 0; op < replay->op_num; op++)
+        {
+            mismatches += replay->client[index].stat[op].mismatches;
+        }
+    }
+
+    fprintf(out, "{\"label\":\"%s\",\"capture\":\"%s\",\"pacing\":\"%s\",\"clients\":%u,"
+            "\"requests\":%llu,\"skipped\":%llu,\"capture_s\":%.3f,\"elapsed_s\":%.3f,"
+            "\"mismatches\":%llu,",
+            replay->label, replay->file, replay->fast ? "fast" : "original", replay->clients,
+            (unsigned long long)replay->requests, (unsigned long long)replay->skipped,
+            (double)(replay->last - replay->first) / DG_TEST_CLIENT_BENCH_NS_PER_SEC,
+            (double)(last_done - replay->start) / DG_TEST_CLIENT_BENCH_NS_PER_SEC,
+            (unsigned long long)mismatches);
+
+    memset(&total, 0, sizeof(total));
+    for (op = 0; op < replay->op_num; op++)
+    {
+        dg_test_client_bench_merge_stat(&total, &replay->captured[op]);
+    }
+    fprintf(out, "\"captured\":{");
+    dg_test_client_bench_report_stat(&total, out);
+
+    memset(&total, 0, sizeof(total));
+    for (index = 0; index < replay->clients; index++)
+    {
+        for (op = 0; op < replay->op_num; op++)
+        {
+            dg_test_client_bench_merge_stat(&total, &replay->client[index].stat[op].stat);
+        }
+    }
+    fprintf(out, "},\"replayed\":{");
+    dg_test_client_bench_report_stat(&total, out);
+
+    fprintf(out, "},\"ops\":[");
+    for (op = 0; op < replay->op_num; op++)
+    {
+        memset(&entry, 0, sizeof(entry));
+        op_mismatch = 0;
+        for (index = 0; index < replay->clients; index++)
+        {
+            dg_test_client_bench_merge_stat(&entry, &replay->client[index].stat[op].stat);
+            op_mismatch += replay->client[index].stat[op].mismatches;
+        }
+
+        fprintf(out, "%s{\"opcode\":\"0x%04x\",\"mismatches\":%llu,\"captured\":{",
+                (op > 0) ? "," : "", replay->opcode[op], (unsigned long long)op_mismatch);
+        dg_test_client_bench_report_stat(&replay->captured[op], out);
+        fprintf(out, "},\"replayed\":{");
+        dg_test_client_bench_report_stat(&entry, out);
+        fprintf(out, "}}");
+    }
+    fprintf(out, "]}\n");
+    fflush(out);
+}
+
+void dg_test_client_replay_free(DG_TEST_CLIENT_REPLAY_T* replay)
+{
+    DG_TEST_CLIENT_REPLAY_CLIENT_T* client;
+    UINT32                          index;
+    UINT32                          req_i;
+
+    for (index = 0; index < replay->clients; index++)
+    {
+        client = &replay->client[index];
+        for (req_i = 0; req_i < client->req_num; req_i++)
+        {
+            free(client->req[req_i].frame);
+            free(client->req[req_i].rsp_frame);
+        }
+        free(client->req);
+        free(client->stat);
+    }
+}
@@ -5,7 +5,7 @@ LOCAL_MODULE := diagd_test
 
 LOCAL_CFLAGS := -DDG_DEBUG=1
 
-LOCAL_C_INCLUDES :=
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../diagd/common/engine/hdr
 
 LOCAL_STATIC_LIBRARIES := libdg_client_api
 
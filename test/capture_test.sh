@@ -0,0 +1,62 @@
+#!/bin/bash
+
+CUR_PATH=$(dirname $0)
+
+SEC_NAME="CAPTURE Test"
+OPCODE=0ffc
+
+START=00
+STOP=01
+STATUS=02
+
+DEFAULT_SIZE=00000000
+MAX_SIZE=00100000
+SNAP_LEN=00000040
+
+
+echo "#-----------------------$SEC_NAME-----------------------"
+
+#Define array for command and description: following Diag and DVT Spec
+
+#command array
+array_command[0]="$OPCODE""$STATUS"
+array_command[1]="$OPCODE""$START""$DEFAULT_SIZE""00000000"
+array_command[2]="$OPCODE""$STATUS"
+array_command[3]="$OPCODE""$STOP"
+array_command[4]="$OPCODE""$STOP"
+array_command[5]="$OPCODE""$START""$MAX_SIZE""$SNAP_LEN"
+
+#command description array, need match with command array above.
+array_des[0]="Get capture status"
+array_des[1]="Start capture with the default size"
+array_des[2]="Get capture status"
+array_des[3]="Stop capture"
+array_des[4]="Stop capture which is not running"
+array_des[5]="Start capture with 1MB size and 64 bytes snap length"
+
+array_command_fail[0]="$OPCODE""$START""$MAX_SIZE""$SNAP_LEN"
+array_command_fail[1]="$OPCODE""$START""$MAX_SIZE"
+array_command_fail[2]="$OPCODE""$STATUS"00
+array_command_fail[3]="$OPCODE"05
+
+array_des_fail[0]="Start capture which is running"
+array_des_fail[1]="Start capture without snap length"
+array_des_fail[2]="Get capture status with extra data"
+array_des_fail[3]="Capture invalid action"
+
+array_command_stop[0]="$OPCODE""$STOP"
+
+array_des_stop[0]="Stop capture"
+
+. $CUR_PATH/diag_verify.sh
+
+diag_verify true array_command[@] array_des[@]
+
+diag_verify false array_command_fail[@] array_des_fail[@]
+
+diag_verify true array_command_stop[@] array_des_stop[@]
+
+echo -e '\n\n'
+echo "#-------------------$SEC_NAME passed!-------------------"
+echo -e '\n\n'
+exit 0
@@ -31,12 +31,31 @@ fi
 if [ ! -e $CLI_PID_FILE ]; then
   $CUR_PATH/cli_server.sh &
   echo $$ > $CLI_PID_FILE
-  sleep 1
 fi
 
+#wait for the server to create the pipes
+while [ ! -p $DIAG_OUT ]; do
+  sleep 0.1
+done
+
 echo $@ > $DIAG_IN
 
 exec 3<$DIAG_OUT
-timeout=10
-while read -t $timeout -u 3 line; do echo "$line";timeout=0.1; done
+#the session ends each result with "@@END seq PASS|FAIL rsp_code"
+while read -t 10 -u 3 line; do
+  case "$line" in
+  @@BEGIN*)
+    ;;
+  @@END*PASS*)
+    exit 0
+    ;;
+  @@END*)
+    exit 1
+    ;;
+  *)
+    echo "$line"
+    ;;
+  esac
+done
+exit 1
 
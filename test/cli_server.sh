@@ -14,4 +14,4 @@ if [ ! -p $DIAG_OUT ]; then
   mkfifo -m 777 $DIAG_OUT
 fi
 
-while (true); do cat $DIAG_IN; done | $DIAG_CMD -l$DIAG_SERVER -f > $DIAG_OUT
+while (true); do cat $DIAG_IN; done | $DIAG_CMD -l$DIAG_SERVER -s > $DIAG_OUT
@@ -0,0 +1,94 @@
+#!/bin/bash
+
+CUR_PATH=$(dirname $0)
+
+SEC_NAME="Configuration Test"
+PING=0fff
+DEBUG_LEVEL=0ffd
+
+GET=00
+DIAG=00
+
+CONF_DIR=$(mktemp -d)
+CONF_FILE=$CONF_DIR/diagd.conf
+trap "rm -rf $CONF_DIR" EXIT
+
+#16 and 17 bytes of ping data, the test sets req.max_len to 16
+DATA_16=00112233445566778899aabbccddeeff
+DATA_17="$DATA_16"00
+
+echo "#-----------------------$SEC_NAME-----------------------"
+
+#a line over 255 characters is skipped whole, none of its keys is set
+LONG_LINE="req.max_len = 8$(printf '%300s' '')log.level = 3"
+
+#need to restart the diag daemon with the test configuration, bad lines are skipped and the last
+#good line of a key wins
+cat > $CONF_FILE << EOF
+# diagd configuration test
+bogus.key = 1
+req.max_len = 0xFFFFFFFF
+req.max_len = 16   # the last good line wins
+log.level = 2
+sched.bulk_max = 2 3
+timeout.0x10000 = 60000
+$LONG_LINE
+EOF
+chmod 600 $CONF_FILE
+
+$CUR_PATH/kill_diagd.sh
+$CUR_PATH/start_diagd.sh -c $CONF_FILE
+
+#Define array for command and description: following Diag and DVT Spec
+
+#command array
+array_command[0]="$PING""$DATA_16"
+
+#command description array, need match with command array above.
+array_des[0]="Ping at the configured request length"
+
+array_command_fail[0]="$PING""$DATA_17"
+
+array_des_fail[0]="Ping over the configured request length"
+
+#a file others can write is refused on reload, the current configuration is kept
+array_command_refused[0]="$PING""$DATA_17"
+
+array_des_refused[0]="Ping over the kept request length"
+
+#the keys are removed on reload, their defaults come back
+array_command_removed[0]="$PING""$DATA_17"
+
+array_des_removed[0]="Ping over the removed request length"
+
+. $CUR_PATH/diag_verify.sh
+
+diag_verify true array_command[@] array_des[@]
+
+diag_verify false array_command_fail[@] array_des_fail[@]
+
+diag_verify_output "$DEBUG_LEVEL""$GET""$DIAG" "^0000: 02" "Get the configured debug level"
+
+echo "log.level = 3" > $CONF_FILE
+chmod 620 $CONF_FILE
+$CUR_PATH/reload_diagd.sh
+
+diag_verify false array_command_refused[@] array_des_refused[@]
+
+diag_verify_output "$DEBUG_LEVEL""$GET""$DIAG" "^0000: 02" "Get the kept debug level"
+
+echo "# diagd configuration test, every key removed" > $CONF_FILE
+chmod 600 $CONF_FILE
+$CUR_PATH/reload_diagd.sh
+
+diag_verify true array_command_removed[@] array_des_removed[@]
+
+diag_verify_output "$DEBUG_LEVEL""$GET""$DIAG" "^0000: 01" "Get the default debug level"
+
+#back to the default configuration for the other tests
+$CUR_PATH/kill_diagd.sh
+
+echo -e '\n\n'
+echo "#-------------------$SEC_NAME passed!-------------------"
+echo -e '\n\n'
+exit 0
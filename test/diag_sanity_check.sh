@@ -44,6 +44,37 @@ if [ $? != 0 ]; then
   exit -1
 fi
 
+#capture the benchmark traffic and replay it
+$CLIENT_CMD 0ffc000000000000000000 > /dev/null
+
+$DIAGD_TEST b -c 4 -t 1 -m echo/64:70,ping/16:20,fixed/512:8,delay/1:2
+if [ $? != 0 ]; then
+  echo b test failed!
+  exit -1
+fi
+
+$CLIENT_CMD 0ffc01 > /dev/null
+
+#the same load over the shared memory transport
+DIAG_SHM=1 $DIAGD_TEST b -c 4 -t 1 -m echo/64:70,ping/16:20,fixed/512:8,delay/1:2
+if [ $? != 0 ]; then
+  echo b test over shared memory failed!
+  exit -1
+fi
+
+$DIAGD_TEST p -a /var/lib/diagd/diagd.cap
+if [ $? != 0 ]; then
+  echo p test failed!
+  exit -1
+fi
+
+#run the fuzz corpus in-process, catches crashes and slow requests
+$CUR_PATH/diagd_fuzz.sh
+if [ $? != 0 ]; then
+  echo fuzz corpus test failed!
+  exit -1
+fi
+
 
 SUB_TEST_FILES=$(ls $CUR_PATH/*_test.sh)
 
@@ -55,6 +86,15 @@ for test_file in $SUB_TEST_FILES; do
   fi
 done
 
+#the sub tests again, every diag_send session on shared memory
+for test_file in $SUB_TEST_FILES; do
+  DIAG_SHM=1 $test_file
+  if [ $? != 0 ]; then
+    echo sub test over shared memory failed!
+    exit -1
+  fi
+done
+
 # stop the diagd
 $CUR_PATH/kill_diagd.sh
 
@@ -22,42 +22,44 @@ CLIENT_CMD="$CUR_PATH/../out/install/bin/diag_send"
 
 declare -i __exit_status=0
 local index=0
+local expect=$1
+local prefix=""
+local block=""
+local line
 
 declare -a __array_command=("${!2}")
 declare -a __array_des=("${!3}")
 
-for var in ${__array_command[@]}; do
-    echo -e "$index)"
-
-    echo ${__array_des[$index]} : $var
-
-    $CLIENT_CMD $var > $FILE_TEMP
-
-    local test_pass=$?
-
-    if [ $1 = "true" ]; then
-        if [ $test_pass != 0 ]; then
-            __exit_status=1;
+#a failure test expects every command to fail
+if [ $expect != "true" ]; then
+    prefix="!"
+fi
 
-            echo -e $CLIENT_CMD $var failed!!!!!!!!!!!!!!!!!! '\n'
-            echo -e '\n'$SEC_NAME ${__array_des[$index]} : $var failed!!! '\n' >> $FILE_FAILURE_LOG
-            cat $FILE_TEMP
-            cat $FILE_TEMP>>$FILE_FAILURE_LOG
-        else
-            echo -e $CLIENT_CMD $var succeeded! '\n'
-        fi
-    else
-        if [ $test_pass != 0 ]; then
-            echo -e $CLIENT_CMD $var failure test passed! '\n'
-            cat $FILE_TEMP
-        else
-            __exit_status=2
-
-            echo -e $CLIENT_CMD $var verify failure failed!!!!!!!!!!!!!!!!!! '\n'
-            echo -e '\n'$SEC_NAME ${__array_des[$index]} : $var verify failure failed!!! '\n' >> $FILE_FAILURE_LOG
-            cat $FILE_TEMP>>$FILE_FAILURE_LOG
-        fi
-    fi
+#send all the commands in one session, each result ends with an @@END line
+for var in ${__array_command[@]}; do
+    echo "$prefix$var"
+done | $CLIENT_CMD -s > $FILE_TEMP
+
+while IFS= read -r line; do
+    case "$line" in
+    @@BEGIN*)
+        block=""
+        ;;
+    @@END*)
+        diag_verify_result $expect $index "$block" ${line#@@END * }
+        let index+=1;
+        ;;
+    @@DONE*)
+        ;;
+    *)
+        block+="$line"$'\n'
+        ;;
+    esac
+done < $FILE_TEMP
+
+#the session is broken, the commands left are not run
+while [ $index -lt ${#__array_command[@]} ]; do
+    diag_verify_result $expect $index "$(cat $FILE_TEMP)" FAIL --
     let index+=1;
 done
 
@@ -76,3 +78,68 @@ fi
 return $__exit_status
 }
 
+# $1 true verify pass; false verify fail
+# $2 command index
+# $3 command output
+# $4 PASS if the command got the expected result
+diag_verify_result() {
+local var=${__array_command[$2]}
+
+echo -e "$2)"
+
+echo ${__array_des[$2]} : $var
+
+if [ $1 = "true" ]; then
+    if [ $4 != "PASS" ]; then
+        __exit_status=1;
+
+        echo -e $CLIENT_CMD $var failed!!!!!!!!!!!!!!!!!! '\n'
+        echo -e '\n'$SEC_NAME ${__array_des[$2]} : $var failed!!! '\n' >> $FILE_FAILURE_LOG
+        echo -n "$3"
+        echo -n "$3">>$FILE_FAILURE_LOG
+    else
+        echo -e $CLIENT_CMD $var succeeded! '\n'
+    fi
+else
+    if [ $4 = "PASS" ]; then
+        echo -e $CLIENT_CMD $var failure test passed! '\n'
+        echo -n "$3"
+    else
+        __exit_status=2
+
+        echo -e $CLIENT_CMD $var verify failure failed!!!!!!!!!!!!!!!!!! '\n'
+        echo -e '\n'$SEC_NAME ${__array_des[$2]} : $var verify failure failed!!! '\n' >> $FILE_FAILURE_LOG
+        echo -n "$3">>$FILE_FAILURE_LOG
+    fi
+fi
+}
+
+# $1 command
+# $2 pattern the command output must match, e.g. the response data
+# $3 command description
+diag_verify_output() {
+
+#check the diag daemon first
+$CUR_PATH/start_diagd.sh
+
+local FILE_FAILURE_LOG="$0"_failure_log.txt
+local CLIENT_CMD="$CUR_PATH/../out/install/bin/diag_send"
+local output
+
+echo $3 : $1
+
+output=$($CLIENT_CMD $1)
+if [ $? != 0 ] || [ -z "$(echo "$output" | grep "$2")" ]; then
+    echo -e $CLIENT_CMD $1 failed, expected "'$2'" !!!!!!!!!!!!!!!!!! '\n'
+    echo -e '\n'$SEC_NAME $3 : $1 failed, expected "'$2'" !!! '\n' >> $FILE_FAILURE_LOG
+    echo "$output"
+    echo "$output" >> $FILE_FAILURE_LOG
+
+    echo -e '\n\n'
+    echo "#-------------------$SEC_NAME failed!-------------------"
+    echo -e '\n\n'
+    exit 1
+fi
+
+echo -e $CLIENT_CMD $1 succeeded! '\n'
+}
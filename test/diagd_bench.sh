@@ -0,0 +1,57 @@
+#!/bin/bash
+# run the standard diagd benchmark suite, one JSON line per scenario
+# usage: diagd_bench.sh [RESULT_FILE] [LABEL]
+# lines with the same model, clients, rate and mix are the same scenario,
+# compare them across builds, e.g. with jq '[.label,.model,.clients,.rate,.mix,.latency_us.p99]'
+
+CUR_PATH=$(dirname $0)
+DIAGD_TEST=$CUR_PATH/../out/install/bin/diagd_test
+
+RESULT_FILE=${1:-/tmp/diagd_bench.jsonl}
+LABEL=${2:-$(git -C $CUR_PATH describe --always --dirty 2>/dev/null)}
+
+DURATION=5
+WARMUP=1
+MIX="echo/64:70,ping/16:20,fixed/512:8,delay/1:2"
+
+#scenario array: diagd_test b options
+array_bench[0]="-c 1 -m echo/64:1"
+array_bench[1]="-c 4 -m echo/64:1"
+array_bench[2]="-c 16 -m echo/64:1"
+array_bench[3]="-c 4 -m ping/16:1"
+array_bench[4]="-c 4 -m fixed/2048:1"
+array_bench[5]="-c 16 -m $MIX"
+array_bench[6]="-c 16 -r 1000 -m $MIX"
+array_bench[7]="-c 16 -r 5000 -m $MIX"
+
+#the same scenarios over the shared memory transport, labelled LABEL+shm
+array_bench_shm[0]="-c 1 -m echo/64:1"
+array_bench_shm[1]="-c 4 -m fixed/2048:1"
+array_bench_shm[2]="-c 16 -m $MIX"
+
+#need to restart the diag daemon
+$CUR_PATH/kill_diagd.sh
+$CUR_PATH/start_diagd.sh
+
+ret=0
+for bench in "${array_bench[@]}"; do
+  $DIAGD_TEST b $bench -t $DURATION -w $WARMUP -l "$LABEL" -o $RESULT_FILE
+  if [ $? != 0 ]; then
+    echo "benchmark \"$bench\" failed!"
+    ret=1
+  fi
+done
+
+for bench in "${array_bench_shm[@]}"; do
+  DIAG_SHM=1 $DIAGD_TEST b $bench -t $DURATION -w $WARMUP -l "$LABEL+shm" -o $RESULT_FILE
+  if [ $? != 0 ]; then
+    echo "benchmark \"$bench\" over shared memory failed!"
+    ret=1
+  fi
+done
+
+# stop the diagd
+$CUR_PATH/kill_diagd.sh
+
+echo "results appended to $RESULT_FILE"
+exit $ret
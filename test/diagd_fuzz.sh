@@ -0,0 +1,65 @@
+#!/bin/bash
+# build the fuzz corpus from the test/*_test.sh commands and run every input through diagd_fuzz
+# usage: diagd_fuzz.sh [CORPUS_DIR] [SLOW_MS]
+# the corpus seeds a fuzzer as well, e.g. diagd_fuzz CORPUS_DIR -max_len=65536 for libFuzzer
+
+CUR_PATH=$(dirname $0)
+DIAGD_FUZZ=$CUR_PATH/../out/install/bin/diagd_fuzz
+
+CORPUS_DIR=${1:-/tmp/diagd_fuzz_corpus}
+SLOW_MS=${2:-1000}
+
+STUB_DIR=$(mktemp -d)
+trap "rm -rf $STUB_DIR" EXIT
+
+#the test scripts only print their commands with these stubs
+cat > $STUB_DIR/diag_verify.sh <<'STUB'
+function diag_verify()
+{
+  local -a __array_command=(${!2})
+  local cmd
+  for cmd in "${__array_command[@]}"; do
+    echo "@@CMD $cmd"
+  done
+}
+function diag_verify_output()
+{
+  echo "@@CMD $1"
+}
+STUB
+touch $STUB_DIR/kill_diagd.sh $STUB_DIR/start_diagd.sh $STUB_DIR/reload_diagd.sh
+chmod +x $STUB_DIR/kill_diagd.sh $STUB_DIR/start_diagd.sh $STUB_DIR/reload_diagd.sh
+
+#write a DIAG request: opcode, version, reserved, no_rsp, seq_tag, length, then the data
+function write_frame()
+{
+  local cmd=$1
+  local data=${cmd:4}
+  printf "$(echo -n "${cmd:0:4}000000000000$(printf %08x $((${#data} / 2)))$data" | \
+            sed 's/../\\x&/g')"
+}
+
+rm -rf $CORPUS_DIR
+mkdir -p $CORPUS_DIR
+
+for test_file in $CUR_PATH/*_test.sh; do
+  name=$(basename $test_file _test.sh)
+  cp $test_file $STUB_DIR/
+  index=0
+  for cmd in $(bash $STUB_DIR/$(basename $test_file) | sed -n 's/^@@CMD //p'); do
+    if [[ $cmd =~ ^([0-9a-fA-F]{2})+$ ]] && [ ${#cmd} -ge 4 ]; then
+      write_frame $cmd > $CORPUS_DIR/${name}_$index
+      index=$((index + 1))
+    fi
+  done
+done
+
+#framing seeds: two requests in one stream, a cut request and a length over the limit
+write_frame 000001 > $CORPUS_DIR/frame_pipelined
+write_frame 000002 >> $CORPUS_DIR/frame_pipelined
+write_frame 00000102 | head -c 13 > $CORPUS_DIR/frame_cut
+printf '\x00\x00\x00\x00\x00\x00\x00\x00\xff\xff\xff\xff' > $CORPUS_DIR/frame_huge
+
+echo "$(ls $CORPUS_DIR | wc -l) inputs in $CORPUS_DIR"
+
+$DIAGD_FUZZ -s $SLOW_MS $CORPUS_DIR
@@ -7,11 +7,18 @@ OPCODE=0004
 
 READ_ACTION=00
 WRITE_ACTION=01
+READ_BLOCK_ACTION=02
+WRITE_BLOCK_ACTION=03
 
 EEPROM=00
 ADDR=0010
 DATA=ff
 
+# 40 bytes at 0x001c cross the 32 byte page boundary of the 24C64 CB EEPROM
+BLOCK_ADDR=001c
+BLOCK_LEN=0028
+BLOCK_DATA=$(printf '%02x' $(seq 1 40))
+
 echo "#-----------------------$SEC_NAME-----------------------"
 
 #Define array for command and description: following Diag and DVT Spec
@@ -20,16 +27,28 @@ echo "#-----------------------$SEC_NAME-----------------------"
 array_command[0]=01000102
 array_command[1]="$OPCODE""$READ_ACTION""$EEPROM""$ADDR"
 array_command[2]="$OPCODE""$WRITE_ACTION""$EEPROM""$ADDR""$DATA"
+array_command[3]="$OPCODE""$WRITE_BLOCK_ACTION""$EEPROM""$BLOCK_ADDR""$BLOCK_LEN""$BLOCK_DATA"
+array_command[4]="$OPCODE""$READ_BLOCK_ACTION""$EEPROM""$BLOCK_ADDR""$BLOCK_LEN"
+array_command[5]="$OPCODE""$READ_BLOCK_ACTION""$EEPROM""0000""0000"
 
 #command description array, need match with command array above.
 array_des[0]="Suspend the DUT"
 array_des[1]="READ EEPROM"
 array_des[2]="WRITE EEPROM"
+array_des[3]="WRITE EEPROM block across a page boundary"
+array_des[4]="READ EEPROM block"
+array_des[5]="READ the whole EEPROM"
 
 array_command_fail[0]="$OPCODE"03
 array_command_fail[1]="$OPCODE""$READ_ACTION""0f""$ADDR"
+array_command_fail[2]="$OPCODE""$READ_BLOCK_ACTION""$EEPROM""1ff0""0020"
+array_command_fail[3]="$OPCODE""$WRITE_BLOCK_ACTION""$EEPROM""$BLOCK_ADDR""0002""01"
+array_command_fail[4]="$OPCODE""$READ_BLOCK_ACTION""$EEPROM""2000""0000"
 array_des_fail[0]="Invalid action"
 array_des_fail[1]="Invalid eeprom"
+array_des_fail[2]="READ EEPROM block past the end"
+array_des_fail[3]="WRITE EEPROM block with short data"
+array_des_fail[4]="READ EEPROM to the end from past the end"
 
 . $CUR_PATH/diag_verify.sh
 
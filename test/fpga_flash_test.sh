@@ -9,9 +9,25 @@ GET_INF_ACTION=00
 GET_CFI_ACTION=01
 GET_MEM_ACTION=02
 SET_MEM_ACTION=03
+STREAM_BEGIN_ACTION=04
+STREAM_DATA_ACTION=05
+STREAM_END_ACTION=06
+GET_CRC_ACTION=07
+DIFF_BEGIN_ACTION=08
+GET_STATS_ACTION=09
 ADDR=ABCD0000
 LEN=10
 MEM=01020304010203040102030401020304
+IMAGE_ADDR=00100000
+IMAGE_LEN=00000020
+IMAGE_CRC=91267E8A
+CHUNK0=000102030405060708090A0B0C0D0E0F
+CHUNK0_CRC=CECEE288
+CHUNK1=101112131415161718191A1B1C1D1E1F
+CHUNK1_CRC=F4A7FD67
+NEW_IMAGE_CRC=DF9D5EBB
+NEW_CHUNK1=202122232425262728292A2B2C2D2E2F
+NEW_CHUNK1_CRC=BA1CDD56
 
 echo "#-----------------------$SEC_NAME-----------------------"
 
@@ -23,6 +39,20 @@ array_command[1]="$OPCODE""$GET_INF_ACTION"
 array_command[2]="$OPCODE""$GET_CFI_ACTION"
 array_command[3]="$OPCODE""$GET_MEM_ACTION""$ADDR""$LEN"
 array_command[4]="$OPCODE""$SET_MEM_ACTION""$ADDR""$LEN""$MEM"
+array_command[5]="$OPCODE""$STREAM_BEGIN_ACTION""$IMAGE_ADDR""$IMAGE_LEN""$IMAGE_CRC"
+array_command[6]="$OPCODE""$STREAM_DATA_ACTION""00000000""$CHUNK0_CRC""$CHUNK0"
+array_command[7]="$OPCODE""$STREAM_DATA_ACTION""00000010""$CHUNK1_CRC""$CHUNK1"
+array_command[8]="$OPCODE""$STREAM_END_ACTION"
+array_command[9]="$OPCODE""$GET_CRC_ACTION""$IMAGE_ADDR""$IMAGE_LEN"
+array_command[10]="$OPCODE""$DIFF_BEGIN_ACTION""$IMAGE_ADDR""$IMAGE_LEN""$IMAGE_CRC""$IMAGE_CRC"
+array_command[11]="$OPCODE""$STREAM_END_ACTION"
+array_command[12]="$OPCODE""$DIFF_BEGIN_ACTION""$IMAGE_ADDR""$IMAGE_LEN""$NEW_IMAGE_CRC""$NEW_IMAGE_CRC"
+array_command[13]="$OPCODE""$GET_STATS_ACTION"
+array_command[14]="$OPCODE""$STREAM_DATA_ACTION""00000000""$CHUNK0_CRC""$CHUNK0"
+array_command[15]="$OPCODE""$STREAM_DATA_ACTION""00000010""$NEW_CHUNK1_CRC""$NEW_CHUNK1"
+array_command[16]="$OPCODE""$STREAM_END_ACTION"
+array_command[17]="$OPCODE""$GET_STATS_ACTION"
+array_command[18]="$OPCODE""$STREAM_BEGIN_ACTION""$IMAGE_ADDR""$IMAGE_LEN""$IMAGE_CRC"
 
 #command description array, need match with command array above.
 array_des[0]="Suspend the DUT"
@@ -30,9 +60,42 @@ array_des[1]="Get information"
 array_des[2]="Get CFI query"
 array_des[3]="Get memory array"
 array_des[4]="Set memory array"
+array_des[5]="Start streaming an image"
+array_des[6]="Stream the first chunk"
+array_des[7]="Stream the second chunk"
+array_des[8]="Finish and verify the image"
+array_des[9]="Get the image CRC"
+array_des[10]="Start a differential stream of the same image"
+array_des[11]="Finish the differential stream without data"
+array_des[12]="Start a differential stream of a changed image"
+array_des[13]="Get the stream progress"
+array_des[14]="Stream the first chunk of the changed sector"
+array_des[15]="Stream the second chunk of the changed sector"
+array_des[16]="Finish and verify the changed image"
+array_des[17]="Get the stream statistics"
+array_des[18]="Start streaming an image again"
 
 array_command_fail[0]="$OPCODE"04
+array_command_fail[1]="$OPCODE""$STREAM_DATA_ACTION""00000000""$CHUNK1_CRC""$CHUNK0"
+array_command_fail[2]="$OPCODE""$STREAM_DATA_ACTION""00000010""$CHUNK1_CRC""$CHUNK1"
+array_command_fail[3]="$OPCODE""$STREAM_END_ACTION"
+array_command_fail[4]="$OPCODE""$STREAM_BEGIN_ACTION""00100010""$IMAGE_LEN""$IMAGE_CRC"
+array_command_fail[5]="$OPCODE""$STREAM_END_ACTION"
+array_command_fail[6]="$OPCODE""$STREAM_BEGIN_ACTION""$IMAGE_ADDR""00000000""$IMAGE_CRC"
+array_command_fail[7]="$OPCODE""$DIFF_BEGIN_ACTION""$IMAGE_ADDR""$IMAGE_LEN""$IMAGE_CRC""$IMAGE_CRC""$IMAGE_CRC"
+array_command_fail[8]="$OPCODE""$DIFF_BEGIN_ACTION""$IMAGE_ADDR""$IMAGE_LEN""$IMAGE_CRC""0000"
+array_command_fail[9]="$OPCODE""$GET_CRC_ACTION""fffffff0""00000020"
+
 array_des_fail[0]="Read invalid action"
+array_des_fail[1]="Stream a chunk with a wrong CRC"
+array_des_fail[2]="Stream a chunk at a wrong offset"
+array_des_fail[3]="Finish an incomplete image"
+array_des_fail[4]="Start streaming at an unaligned address"
+array_des_fail[5]="Finish without a stream"
+array_des_fail[6]="Start streaming an empty image"
+array_des_fail[7]="Differential stream with too many sector CRCs"
+array_des_fail[8]="Differential stream with a partial sector CRC"
+array_des_fail[9]="Get the CRC of a range past the end of flash"
 
 . $CUR_PATH/diag_verify.sh
 
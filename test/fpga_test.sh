@@ -14,6 +14,8 @@ DMA_WR_ACTION=05
 SF_TST_ACTION=06
 ST_MOD_ACTION=07
 DOWNLD_ACTION=08
+RD_BLK_ACTION=09
+WR_BLK_ACTION=0a
 
 REG_ADDR=0005
 REG_DATA=DEADBEEF
@@ -28,6 +30,11 @@ MODE=01
 
 IMAGE=00
 
+BLK_ADDR=00100000
+BLK_SIZE=00000008
+BLK_DATA=0011223344556677
+BLK_BIG_SIZE=00020000
+
 
 echo "#-----------------------$SEC_NAME-----------------------"
 
@@ -45,7 +52,10 @@ array_command[7]="$OPCODE""$DMA_RD_ACTION""$MEM_ADDR""$MEM_SIZE"
 array_command[8]="$OPCODE""$SF_TST_ACTION""$SUB_TEST"
 array_command[9]="$OPCODE""$ST_MOD_ACTION""$MODE"
 array_command[10]="$OPCODE""$DOWNLD_ACTION""$IMAGE"
-array_command[11]=0ffd010001
+array_command[11]="$OPCODE""$WR_BLK_ACTION""$BLK_ADDR""$BLK_SIZE""$BLK_DATA"
+array_command[12]="$OPCODE""$RD_BLK_ACTION""$BLK_ADDR""$BLK_SIZE"
+array_command[13]="$OPCODE""$RD_BLK_ACTION""$BLK_ADDR""$BLK_BIG_SIZE"
+array_command[14]=0ffd010001
 
 #command description array, need match with command array above.
 array_des[0]="Suspend the DUT"
@@ -59,25 +69,35 @@ array_des[7]="DMA RD FPGA memory addr=$MEM_ADDR len=$MEM_SIZE"
 array_des[8]="Set FPGA sub test=$SUB_TEST"
 array_des[9]="Set FPGA mode=$MODE"
 array_des[10]="Download FPGA image=$IMAGE"
-array_des[11]="Disable Data Dump"
+array_des[11]="Bulk write FPGA memory addr=$BLK_ADDR len=$BLK_SIZE data=$BLK_DATA"
+array_des[12]="Bulk read FPGA memory addr=$BLK_ADDR len=$BLK_SIZE"
+array_des[13]="Bulk read FPGA memory addr=$BLK_ADDR len=$BLK_BIG_SIZE in chunks"
+array_des[14]="Disable Data Dump"
 
 REG_ADDR=1000
 MEM_ADDR=01000000
 SUB_TEST=0f
 MODE=0f
 IMAGE=0f
+BLK_ADDR=00fffffc
 
 array_command_fail[0]="$OPCODE""$RD_REG_ACTION""$REG_ADDR"
 array_command_fail[1]="$OPCODE""$RD_MEM_ACTION""$MEM_ADDR""$MEM_SIZE"
 array_command_fail[2]="$OPCODE""$SF_TST_ACTION""$SUB_TEST"
 array_command_fail[3]="$OPCODE""$ST_MOD_ACTION""$MODE"
 array_command_fail[4]="$OPCODE""$DOWNLD_ACTION""$IMAGE"
+array_command_fail[5]="$OPCODE""$RD_BLK_ACTION""$BLK_ADDR""$BLK_SIZE"
+array_command_fail[6]="$OPCODE""$WR_BLK_ACTION""$BLK_ADDR""$BLK_SIZE""$BLK_DATA"
+array_command_fail[7]="$OPCODE""$RD_BLK_ACTION""$BLK_ADDR""00000000"
 
 array_des_fail[0]="Read invalid FPGA register"
 array_des_fail[1]="Read invalid FPGA memory"
 array_des_fail[2]="Invalide Self Test"
 array_des_fail[3]="Invalide Mode"
 array_des_fail[4]="Invalide Download image"
+array_des_fail[5]="Bulk read past the end of FPGA memory"
+array_des_fail[6]="Bulk write past the end of FPGA memory"
+array_des_fail[7]="Bulk read of zero length"
 
 . $CUR_PATH/diag_verify.sh
 
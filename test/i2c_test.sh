@@ -7,6 +7,8 @@ OPCODE=0010
 
 RD_ACTION=00
 WR_ACTION=01
+RD_BLOCK_ACTION=02
+WR_BLOCK_ACTION=03
 
 PCH_SMB=00
 ADDRESS=50
@@ -18,6 +20,15 @@ WR_LEN=02
 WR_DATA1=0102
 WR_DATA2=ffff
 
+BLOCK_BUS=16
+BLOCK_PAGE=08
+BLOCK_OFFSET=04
+BLOCK_LEN=0010
+BLOCK_DATA=000102030405060708090a0b0c0d0e0f
+BLOCK_RD_LEN=0100
+
+CPU_BUS=10
+
 
 echo "#-----------------------$SEC_NAME-----------------------"
 
@@ -31,7 +42,12 @@ array_command[3]="$OPCODE""$WR_ACTION""$PCH_SMB""$ADDRESS""$WR_OFFSET""$WR_LEN""
 array_command[4]="$OPCODE""$RD_ACTION""$PCH_SMB""$ADDRESS""$RD_OFFSET""$RD_LEN"
 array_command[5]="$OPCODE""$WR_ACTION""$PCH_SMB""$ADDRESS""$WR_OFFSET""$WR_LEN""$WR_DATA2"
 array_command[6]="$OPCODE""$RD_ACTION""$PCH_SMB""$ADDRESS""$RD_OFFSET""$RD_LEN"
-array_command[7]=0ffd010001
+array_command[7]="$OPCODE""$WR_BLOCK_ACTION""$BLOCK_BUS""$ADDRESS""$BLOCK_OFFSET""$BLOCK_PAGE""$BLOCK_LEN""$BLOCK_DATA"
+array_command[8]="$OPCODE""$RD_BLOCK_ACTION""$BLOCK_BUS""$ADDRESS""$RD_OFFSET""$BLOCK_RD_LEN"
+array_command[9]="$OPCODE""$RD_BLOCK_ACTION""$PCH_SMB""$ADDRESS""$RD_OFFSET""$BLOCK_RD_LEN"
+array_command[10]="$OPCODE""$WR_ACTION""$CPU_BUS""$ADDRESS""$WR_OFFSET""$WR_LEN""$WR_DATA1"
+array_command[11]="$OPCODE""$RD_ACTION""$CPU_BUS""$ADDRESS""$WR_OFFSET""$WR_LEN"
+array_command[12]=0ffd010001
 
 #command description array, need match with command array above.
 array_des[0]="Suspend the DUT"
@@ -41,10 +57,17 @@ array_des[3]="Write I2C Bus=$PCH_SMB Address=$ADDRESS Offset=$WR_OFFSET Len=$WR_
 array_des[4]="Read I2C Bus=$PCH_SMB Address=$ADDRESS Offset=$RD_OFFSET Len=$RD_LEN"
 array_des[5]="Write I2C Bus=$PCH_SMB Address=$ADDRESS Offset=$WR_OFFSET Len=$WR_LEN Data=$WR_DATA2"
 array_des[6]="Read I2C Bus=$PCH_SMB Address=$ADDRESS Offset=$RD_OFFSET Len=$RD_LEN"
-array_des[7]="Disable Data Dump"
+array_des[7]="Write I2C block Bus=$BLOCK_BUS Address=$ADDRESS Offset=$BLOCK_OFFSET Page=$BLOCK_PAGE Len=$BLOCK_LEN"
+array_des[8]="Read I2C block Bus=$BLOCK_BUS Address=$ADDRESS Offset=$RD_OFFSET Len=$BLOCK_RD_LEN"
+array_des[9]="Read I2C block Bus=$PCH_SMB Address=$ADDRESS Offset=$RD_OFFSET Len=$BLOCK_RD_LEN"
+array_des[10]="Write I2C Bus=$CPU_BUS Address=$ADDRESS Offset=$WR_OFFSET Len=$WR_LEN Data=$WR_DATA1"
+array_des[11]="Read I2C Bus=$CPU_BUS Address=$ADDRESS Offset=$WR_OFFSET Len=$WR_LEN"
+array_des[12]="Disable Data Dump"
 
 array_command_fail[0]="$OPCODE""$RD_ACTION""08""$ADDRESS""$RD_OFFSET""$RD_LEN"
+array_command_fail[1]="$OPCODE""$WR_BLOCK_ACTION""$BLOCK_BUS""$ADDRESS""$BLOCK_OFFSET""$BLOCK_PAGE""0004""01"
 array_des_fail[0]="Read invalid Bus"
+array_des_fail[1]="Write I2C block with short data"
 
 . $CUR_PATH/diag_verify.sh
 
@@ -11,6 +11,11 @@ if [ -e $DIAGD_PID_FILE ]; then
     # stop the diagd
     echo kill diag deamon
     kill -s SIGINT $PID
+
+    # wait the daemon exited
+    while [ -n "$(ps -p $PID | grep diagd)" ]; do
+      sleep 0.1
+    done
   fi
 fi
 
@@ -0,0 +1,16 @@
+#!/bin/bash
+
+DIAGD_PID_FILE="/tmp/diagd.pid"
+
+if [ -e $DIAGD_PID_FILE ]; then
+  PID=$(cat $DIAGD_PID_FILE)
+
+  if [ -n "$(ps -p $PID | grep diagd)" ]; then
+    # reload the configuration file
+    echo reload diag deamon configuration
+    kill -s SIGHUP $PID
+
+    # wait the configuration reloaded
+    sleep 1
+  fi
+fi
@@ -8,8 +8,10 @@ OPCODE=0006
 GET_STATUS=00
 TX_CONFIG=01
 DUMP_REGISTER=02
+SNAPSHOT=03
 
 SFP_ID=03
+SFP_ALL=ff
 
 TX_DISABLE=00
 TX_ENABLE=01
@@ -28,6 +30,9 @@ array_command[2]="$OPCODE""$TX_CONFIG""$SFP_ID""$TX_DISABLE"
 array_command[3]="$OPCODE""$TX_CONFIG""$SFP_ID""$TX_ENABLE"
 array_command[4]="$OPCODE""$DUMP_REGISTER""$SFP_ID""$REG_A0"
 array_command[5]="$OPCODE""$DUMP_REGISTER""$SFP_ID""$REG_A2"
+array_command[6]="$OPCODE""$SNAPSHOT""$SFP_ID"
+array_command[7]="$OPCODE""$SNAPSHOT""$SFP_ALL"
+array_command[8]="$OPCODE""$SNAPSHOT""$SFP_ALL"
 
 #command description array, need match with command array above.
 array_des[0]="Suspend the DUT"
@@ -36,6 +41,9 @@ array_des[2]="Config SFP $SFP_ID tx disable"
 array_des[3]="Config SFP $SFP_ID tx enable"
 array_des[4]="Dump SFP $SFP_ID A0 Registers"
 array_des[5]="Dump SFP $SFP_ID A2 Registers"
+array_des[6]="Snapshot SFP $SFP_ID"
+array_des[7]="Snapshot all SFPs"
+array_des[8]="Snapshot all SFPs with cached ID pages"
 
 array_command_fail[0]="$OPCODE""04""$SFP_ID"
 
@@ -46,12 +54,16 @@ SFP_ID=03
 array_command_fail[2]="$OPCODE""$TX_CONFIG""$SFP_ID""03"
 
 array_command_fail[3]="$OPCODE""$DUMP_REGISTER""$SFP_ID""02"
+array_command_fail[4]="$OPCODE""$SNAPSHOT""50"
+array_command_fail[5]="$OPCODE""$SNAPSHOT""$SFP_ALL""00"
 
 
 array_des_fail[0]="Invalid action"
 array_des_fail[1]="Invalid SFP ID"
 array_des_fail[2]="Invalid TX config"
 array_des_fail[3]="Invalid dump registers"
+array_des_fail[4]="Snapshot invalid SFP ID"
+array_des_fail[5]="Snapshot with extra data"
 
 
 . $CUR_PATH/diag_verify.sh
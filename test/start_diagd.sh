@@ -18,7 +18,7 @@ if [ ! -e $DIAGD_PID_FILE ]; then
   echo start the diag daemon
 
   rm -f $DIAGD_LOG_FILE
-  $DIAGD_APP > $DIAGD_LOG_FILE 2>&1 &
+  $DIAGD_APP "$@" > $DIAGD_LOG_FILE 2>&1 &
   chmod 666 $DIAGD_LOG_FILE
 
   # wait the daemon started